@@ -0,0 +1,753 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "drm_info.h"
+#include "input.h"
+#include "json_writer.h"
+#include "model.h"
+#include "modifiers.h"
+#include "pool.h"
+#include "tables.h"
+#include "tree_writer.h"
+
+/* Aggregates dumps into how many of their nodes have each cap, connector
+ * type, format, etc., per driver and per kernel release. Every job has its own
+ * accumulators, which are only merged once all of the dumps have been
+ * analyzed, so workers never share anything. */
+
+#define ANALYZE_LINES_PER_JOB 256
+
+/* Number of nodes with something, keyed by a name or a number */
+struct count {
+	bool used;
+	const char *name; // Interned, NULL for numbers
+	uint64_t key;
+	uint64_t n;
+	struct group *group; // Only in maps of groups
+};
+
+/* Open addressing hash table of counts */
+struct count_map {
+	struct count *items;
+	size_t len, cap;
+};
+
+struct group {
+	uint64_t nodes;
+	struct count_map caps, client_caps, connectors, planes, formats,
+		modifiers;
+};
+
+struct analyzer {
+	uint64_t nodes;
+	// Lines or files which couldn't be loaded
+	uint64_t invalid;
+	struct count_map drivers, kernels;
+	// Everything the node being analyzed has, once
+	struct group node;
+	// The names counts point to, which are only copied the first time they
+	// are seen
+	struct count_map strings;
+};
+
+static uint64_t count_hash(const char *name, uint64_t key)
+{
+	if (!name) {
+		uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+		return hash ^ hash >> 32;
+	}
+
+	uint64_t hash = 14695981039346656037ull;
+	for (const char *c = name; *c; ++c) {
+		hash ^= (unsigned char)*c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static bool count_matches(const struct count *count, const char *name,
+		uint64_t key)
+{
+	if (!name) {
+		return !count->name && count->key == key;
+	}
+	return count->name && strcmp(count->name, name) == 0;
+}
+
+static void *xcalloc(size_t n, size_t size)
+{
+	void *ptr = calloc(n, size);
+	if (!ptr) {
+		perror("calloc");
+		exit(EXIT_FAILURE);
+	}
+	return ptr;
+}
+
+static void count_map_grow(struct count_map *map)
+{
+	size_t cap = map->cap ? 2 * map->cap : 16;
+	struct count *items = xcalloc(cap, sizeof(*items));
+	for (size_t i = 0; i < map->cap; ++i) {
+		if (!map->items[i].used) {
+			continue;
+		}
+		size_t j = count_hash(map->items[i].name, map->items[i].key) &
+			(cap - 1);
+		while (items[j].used) {
+			j = (j + 1) & (cap - 1);
+		}
+		items[j] = map->items[i];
+	}
+	free(map->items);
+	map->items = items;
+	map->cap = cap;
+}
+
+/* Returns the count of name, or of key if name is NULL, which is added if
+ * it's not there yet. name must outlive the map, see intern(). */
+static struct count *count_get(struct count_map *map, const char *name,
+		uint64_t key)
+{
+	if (2 * (map->len + 1) > map->cap) {
+		count_map_grow(map);
+	}
+
+	size_t mask = map->cap - 1;
+	size_t i = count_hash(name, key) & mask;
+	while (map->items[i].used) {
+		if (count_matches(&map->items[i], name, key)) {
+			return &map->items[i];
+		}
+		i = (i + 1) & mask;
+	}
+
+	struct count *count = &map->items[i];
+	count->used = true;
+	count->name = name;
+	count->key = key;
+	++map->len;
+	return count;
+}
+
+/* Returns the copy of name in strings, which lives until strings_finish() */
+static const char *intern(struct count_map *strings, const char *name)
+{
+	struct count *count = count_get(strings, name, 0);
+	if (count->n++ == 0) {
+		count->name = strdup(name);
+		if (!count->name) {
+			perror("strdup");
+			exit(EXIT_FAILURE);
+		}
+	}
+	return count->name;
+}
+
+static void strings_finish(struct count_map *strings)
+{
+	for (size_t i = 0; i < strings->cap; ++i) {
+		free((char *)strings->items[i].name);
+	}
+	free(strings->items);
+}
+
+static void count_map_add(struct count_map *dst, const struct count_map *src)
+{
+	for (size_t i = 0; i < src->cap; ++i) {
+		const struct count *count = &src->items[i];
+		if (count->used) {
+			count_get(dst, count->name, count->key)->n += count->n;
+		}
+	}
+}
+
+/* Empties the map, but keeps its memory */
+static void count_map_clear(struct count_map *map)
+{
+	if (map->items) {
+		memset(map->items, 0, map->cap * sizeof(*map->items));
+	}
+	map->len = 0;
+}
+
+static void group_finish(struct group *group);
+
+static void count_map_finish(struct count_map *map)
+{
+	for (size_t i = 0; i < map->cap; ++i) {
+		if (map->items[i].group) {
+			group_finish(map->items[i].group);
+			free(map->items[i].group);
+		}
+	}
+	free(map->items);
+}
+
+#define GROUP_MAPS(group) \
+	{ &(group)->caps, &(group)->client_caps, &(group)->connectors, \
+	  &(group)->planes, &(group)->formats, &(group)->modifiers }
+
+static void group_add(struct group *dst, const struct group *src)
+{
+	struct count_map *dst_maps[] = GROUP_MAPS(dst);
+	const struct count_map *src_maps[] = GROUP_MAPS(src);
+	dst->nodes += src->nodes;
+	for (size_t i = 0; i < sizeof(dst_maps) / sizeof(dst_maps[0]); ++i) {
+		count_map_add(dst_maps[i], src_maps[i]);
+	}
+}
+
+static void group_clear(struct group *group)
+{
+	struct count_map *maps[] = GROUP_MAPS(group);
+	group->nodes = 0;
+	for (size_t i = 0; i < sizeof(maps) / sizeof(maps[0]); ++i) {
+		count_map_clear(maps[i]);
+	}
+}
+
+static void group_finish(struct group *group)
+{
+	struct count_map *maps[] = GROUP_MAPS(group);
+	for (size_t i = 0; i < sizeof(maps) / sizeof(maps[0]); ++i) {
+		count_map_finish(maps[i]);
+	}
+}
+
+static struct group *group_get(struct count_map *groups, const char *name)
+{
+	struct count *count = count_get(groups, name, 0);
+	if (!count->group) {
+		count->group = xcalloc(1, sizeof(*count->group));
+	}
+	return count->group;
+}
+
+static void count_in_formats(struct group *group,
+		const struct model_properties *props)
+{
+	for (size_t i = 0; props && i < props->len; ++i) {
+		const struct model_property *prop = &props->items[i];
+		if (prop->data_type != MODEL_DATA_BLOB ||
+				prop->data.blob->type != MODEL_BLOB_IN_FORMATS) {
+			continue;
+		}
+		const struct model_blob *blob = prop->data.blob;
+		for (size_t j = 0; j < blob->in_formats.n_mods; ++j) {
+			count_get(&group->modifiers, NULL,
+				blob->in_formats.mods[j].modifier)->n = 1;
+		}
+	}
+}
+
+static void analyze_node(const char *path, const struct model_node *node,
+		void *data)
+{
+	(void)path;
+
+	struct analyzer *analyzer = data;
+	struct group *group = &analyzer->node;
+	struct count_map *strings = &analyzer->strings;
+
+	group->nodes = 1;
+	const struct model_driver *driver = node->driver;
+	for (size_t i = 0; driver && i < driver->n_caps; ++i) {
+		const struct model_cap *cap = &driver->caps[i];
+		if (cap->supported && cap->value != 0) {
+			count_get(&group->caps, intern(strings, cap->name), 0)->n = 1;
+		}
+	}
+	for (size_t i = 0; driver && i < driver->n_client_caps; ++i) {
+		const struct model_cap *cap = &driver->client_caps[i];
+		if (cap->supported) {
+			count_get(&group->client_caps, intern(strings, cap->name),
+				0)->n = 1;
+		}
+	}
+
+	for (size_t i = 0; i < node->n_connectors; ++i) {
+		count_get(&group->connectors, NULL, node->connectors[i]->type)->n = 1;
+	}
+
+	if (node->planes) {
+		count_get(&group->planes, NULL, node->n_planes)->n = 1;
+	}
+	for (size_t i = 0; node->planes && i < node->n_planes; ++i) {
+		const struct model_plane *plane = node->planes[i];
+		for (size_t j = 0; j < plane->n_formats; ++j) {
+			count_get(&group->formats, NULL, plane->formats[j])->n = 1;
+		}
+		count_in_formats(group, plane->props);
+	}
+
+	const char *driver_name = driver && driver->name ?
+		driver->name : "unknown";
+	const char *release = driver && driver->kernel &&
+		driver->kernel->release ? driver->kernel->release : "unknown";
+	group_add(group_get(&analyzer->drivers, intern(strings, driver_name)),
+		group);
+	group_add(group_get(&analyzer->kernels, intern(strings, release)),
+		group);
+	group_clear(group);
+	++analyzer->nodes;
+}
+
+/* Input is split into as many shards as there are jobs, job i gets lines or
+ * files i, i + jobs, i + 2 * jobs, etc. */
+struct analysis {
+	struct analyzer *analyzers;
+	size_t jobs;
+	const struct line *lines;
+	size_t n_lines;
+	char **files;
+	size_t n_files;
+};
+
+static void analyze_lines(size_t job, void *data)
+{
+	struct analysis *analysis = data;
+	struct analyzer *analyzer = &analysis->analyzers[job];
+
+	for (size_t i = job; i < analysis->n_lines; i += analysis->jobs) {
+		const struct line *line = &analysis->lines[i];
+		if (!drm_info_load_json(line->str, line->len, analyze_node,
+				analyzer)) {
+			fprintf(stderr, "Invalid dump on line %zu\n", line->line_no);
+			++analyzer->invalid;
+		}
+	}
+}
+
+static void analyze_files(size_t job, void *data)
+{
+	struct analysis *analysis = data;
+	struct analyzer *analyzer = &analysis->analyzers[job];
+
+	for (size_t i = job; i < analysis->n_files; i += analysis->jobs) {
+		const char *file = analysis->files[i];
+		struct input in;
+		if (!input_open(&in, file)) {
+			++analyzer->invalid;
+			continue;
+		}
+		if (!input_load(in.buf, in.len, analyze_node, analyzer)) {
+			fprintf(stderr, "%s: invalid dump\n", file);
+			++analyzer->invalid;
+		}
+		input_close(&in);
+	}
+}
+
+/* Analyzes newline-delimited JSON, a window of lines at a time */
+static bool analyze_ndjson(struct analysis *analysis, const char *path)
+{
+	int fd = STDIN_FILENO;
+	if (strcmp(path, "-") != 0) {
+		fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			perror(path);
+			return false;
+		}
+	}
+
+	size_t max_lines = analysis->jobs * ANALYZE_LINES_PER_JOB;
+	struct line *lines = xcalloc(max_lines, sizeof(*lines));
+	struct line_reader reader;
+	line_reader_init(&reader, fd);
+	bool ok = true;
+	while (1) {
+		size_t n;
+		if (!line_reader_next(&reader, lines, max_lines, &n)) {
+			ok = false;
+			break;
+		}
+		if (n == 0) {
+			break;
+		}
+		analysis->lines = lines;
+		analysis->n_lines = n;
+		pool_run(analysis->jobs, analysis->jobs, analyze_lines, analysis);
+	}
+	line_reader_finish(&reader);
+	free(lines);
+
+	if (fd != STDIN_FILENO) {
+		close(fd);
+	}
+	return ok;
+}
+
+/* Adds the regular files of the directory to analysis->files */
+static bool list_dir(struct analysis *analysis, const char *path,
+		size_t *cap)
+{
+	DIR *dir = opendir(path);
+	if (!dir) {
+		perror(path);
+		return false;
+	}
+
+	struct dirent *ent;
+	while ((ent = readdir(dir))) {
+		if (ent->d_name[0] == '.') {
+			continue;
+		}
+
+		char *file = malloc(strlen(path) + strlen(ent->d_name) + 2);
+		if (!file) {
+			perror("malloc");
+			exit(EXIT_FAILURE);
+		}
+		sprintf(file, "%s/%s", path, ent->d_name);
+
+		struct stat st;
+		if (stat(file, &st) != 0 || !S_ISREG(st.st_mode)) {
+			free(file);
+			continue;
+		}
+
+		if (analysis->n_files == *cap) {
+			*cap = *cap ? 2 * *cap : 64;
+			char **files = realloc(analysis->files,
+				*cap * sizeof(*files));
+			if (!files) {
+				perror("realloc");
+				exit(EXIT_FAILURE);
+			}
+			analysis->files = files;
+		}
+		analysis->files[analysis->n_files++] = file;
+	}
+
+	closedir(dir);
+	return true;
+}
+
+enum count_kind {
+	COUNT_NAME,
+	COUNT_CONNECTOR,
+	COUNT_PLANES,
+	COUNT_FORMAT,
+	COUNT_MODIFIER,
+};
+
+static const char *count_label(char *buf, size_t size,
+		const struct count *count, enum count_kind kind, bool json)
+{
+	const struct format_info *info;
+	switch (kind) {
+	case COUNT_NAME:
+		return count->name;
+	case COUNT_CONNECTOR:
+		// Types which are too new for conn_name() would share its label
+		if (count->key != DRM_MODE_CONNECTOR_Unknown &&
+				strcmp(conn_name(count->key), "unknown") == 0) {
+			snprintf(buf, size, "unknown-%"PRIu64, count->key);
+			return buf;
+		}
+		return conn_name(count->key);
+	case COUNT_PLANES:
+		snprintf(buf, size, "%"PRIu64, count->key);
+		return buf;
+	case COUNT_FORMAT:
+		info = format_info_get(count->key);
+		if (info) {
+			return info->name;
+		}
+		snprintf(buf, size, "0x%08"PRIx64, count->key);
+		return buf;
+	case COUNT_MODIFIER:
+		if (!json) {
+			return modifier_info_get(count->key)->name;
+		}
+		snprintf(buf, size, "0x%016"PRIx64, count->key);
+		return buf;
+	}
+	return NULL;
+}
+
+struct sorted_count {
+	const struct count *count;
+	// Either a static string or buf, which moves around while sorting
+	const char *str;
+	char buf[32];
+};
+
+static const char *sorted_count_label(const struct sorted_count *count)
+{
+	return count->str ? count->str : count->buf;
+}
+
+static int sorted_count_cmp(const void *a, const void *b)
+{
+	return strcmp(sorted_count_label(a), sorted_count_label(b));
+}
+
+static int sorted_count_key_cmp(const void *a, const void *b)
+{
+	const struct sorted_count *x = a, *y = b;
+	return (x->count->key > y->count->key) - (x->count->key < y->count->key);
+}
+
+/* Returns the counts of the map with their labels, sorted by label, or by
+ * key for plane counts */
+static struct sorted_count *count_map_sorted(const struct count_map *map,
+		enum count_kind kind, bool json)
+{
+	struct sorted_count *counts = xcalloc(map->len + 1, sizeof(*counts));
+	size_t n = 0;
+	for (size_t i = 0; i < map->cap; ++i) {
+		if (map->items[i].used) {
+			struct sorted_count *count = &counts[n++];
+			count->count = &map->items[i];
+			const char *label = count_label(count->buf,
+				sizeof(count->buf), count->count, kind, json);
+			count->str = label != count->buf ? label : NULL;
+		}
+	}
+	qsort(counts, n, sizeof(*counts),
+		kind == COUNT_PLANES ? sorted_count_key_cmp : sorted_count_cmp);
+	return counts;
+}
+
+struct group_section {
+	const char *title, *key;
+	size_t offset;
+	enum count_kind kind;
+};
+
+static const struct group_section group_sections[] = {
+	{ "Caps", "caps", offsetof(struct group, caps), COUNT_NAME },
+	{ "Client caps", "client_caps", offsetof(struct group, client_caps),
+		COUNT_NAME },
+	{ "Connector types", "connectors", offsetof(struct group, connectors),
+		COUNT_CONNECTOR },
+	{ "Planes", "planes", offsetof(struct group, planes), COUNT_PLANES },
+	{ "Formats", "formats", offsetof(struct group, formats), COUNT_FORMAT },
+	{ "Modifiers", "modifiers", offsetof(struct group, modifiers),
+		COUNT_MODIFIER },
+};
+
+#define N_GROUP_SECTIONS (sizeof(group_sections) / sizeof(group_sections[0]))
+
+static const struct count_map *group_section_map(const struct group *group,
+		const struct group_section *section)
+{
+	return (const struct count_map *)((const char *)group + section->offset);
+}
+
+static void print_group(struct tree_writer *w, const struct group *group)
+{
+	for (size_t i = 0; i < N_GROUP_SECTIONS; ++i) {
+		const struct group_section *section = &group_sections[i];
+		const struct count_map *map = group_section_map(group, section);
+		bool last_section = i == N_GROUP_SECTIONS - 1;
+		tree_writer_item(w, last_section);
+		tree_writer_printf(w, "%s\n", section->title);
+
+		tree_writer_push(w, last_section);
+		struct sorted_count *counts =
+			count_map_sorted(map, section->kind, false);
+		for (size_t j = 0; j < map->len; ++j) {
+			uint64_t n = counts[j].count->n;
+			tree_writer_item(w, j == map->len - 1);
+			tree_writer_printf(w, "%s: %"PRIu64" (%.1f%%)\n",
+				sorted_count_label(&counts[j]), n, 100.0 * n / group->nodes);
+		}
+		free(counts);
+		tree_writer_pop(w);
+	}
+}
+
+static void print_groups(struct tree_writer *w, const char *title,
+		const struct count_map *groups)
+{
+	tree_writer_line(w);
+	tree_writer_printf(w, "%s:\n", title);
+
+	struct sorted_count *counts = count_map_sorted(groups, COUNT_NAME, false);
+	for (size_t i = 0; i < groups->len; ++i) {
+		const struct group *group = counts[i].count->group;
+		bool last = i == groups->len - 1;
+		tree_writer_item(w, last);
+		tree_writer_printf(w, "%s: %"PRIu64" nodes\n", sorted_count_label(&counts[i]),
+			group->nodes);
+		tree_writer_push(w, last);
+		print_group(w, group);
+		tree_writer_pop(w);
+	}
+	free(counts);
+}
+
+static void write_group_json(struct json_writer *w, const struct group *group)
+{
+	json_writer_object_begin(w);
+	json_writer_key(w, "nodes");
+	json_writer_uint64(w, group->nodes);
+	for (size_t i = 0; i < N_GROUP_SECTIONS; ++i) {
+		const struct group_section *section = &group_sections[i];
+		const struct count_map *map = group_section_map(group, section);
+		json_writer_key(w, section->key);
+		json_writer_object_begin(w);
+		struct sorted_count *counts =
+			count_map_sorted(map, section->kind, true);
+		for (size_t j = 0; j < map->len; ++j) {
+			json_writer_key(w, sorted_count_label(&counts[j]));
+			json_writer_uint64(w, counts[j].count->n);
+		}
+		free(counts);
+		json_writer_object_end(w);
+	}
+	json_writer_object_end(w);
+}
+
+static void write_groups_json(struct json_writer *w, const char *key,
+		const struct count_map *groups)
+{
+	json_writer_key(w, key);
+	json_writer_object_begin(w);
+	struct sorted_count *counts = count_map_sorted(groups, COUNT_NAME, true);
+	for (size_t i = 0; i < groups->len; ++i) {
+		json_writer_key(w, sorted_count_label(&counts[i]));
+		write_group_json(w, counts[i].count->group);
+	}
+	free(counts);
+	json_writer_object_end(w);
+}
+
+static void merge_groups(struct count_map *dst, const struct count_map *src)
+{
+	for (size_t i = 0; i < src->cap; ++i) {
+		const struct count *count = &src->items[i];
+		if (count->used) {
+			group_add(group_get(dst, count->name), count->group);
+		}
+	}
+}
+
+int drm_info_analyze(int argc, char *argv[])
+{
+	bool json = false;
+	int jobs = 0;
+
+	int opt;
+	char *end;
+	while ((opt = getopt(argc, argv, "jJ:")) != -1) {
+		switch (opt) {
+		case 'j':
+			json = true;
+			break;
+		case 'J':
+			jobs = strtol(optarg, &end, 10);
+			if (*end != '\0' || jobs <= 0) {
+				fprintf(stderr, "invalid number of jobs: %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		default:
+			fprintf(stderr, "usage: drm_info analyze [-j] [-J jobs] "
+				"[path]...\n");
+			return opt == '?' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (jobs == 0) {
+		jobs = pool_cpu_count();
+	}
+
+	struct analysis analysis = {
+		.analyzers = xcalloc(jobs, sizeof(*analysis.analyzers)),
+		.jobs = jobs,
+	};
+
+	// Directories are listed first and their files analyzed together, other
+	// paths are newline-delimited JSON
+	static char *stdin_path[] = { "-", NULL };
+	char **paths = argv[optind] ? &argv[optind] : stdin_path;
+	bool ok = true;
+	size_t files_cap = 0;
+	for (size_t i = 0; paths[i]; ++i) {
+		struct stat st;
+		if (strcmp(paths[i], "-") != 0 && stat(paths[i], &st) == 0 &&
+				S_ISDIR(st.st_mode)) {
+			ok = list_dir(&analysis, paths[i], &files_cap) && ok;
+		} else {
+			ok = analyze_ndjson(&analysis, paths[i]) && ok;
+		}
+	}
+	if (analysis.n_files > 0) {
+		pool_run(analysis.jobs, analysis.jobs, analyze_files, &analysis);
+	}
+
+	struct analyzer *total = &analysis.analyzers[0];
+	for (int i = 1; i < jobs; ++i) {
+		struct analyzer *analyzer = &analysis.analyzers[i];
+		total->nodes += analyzer->nodes;
+		total->invalid += analyzer->invalid;
+		merge_groups(&total->drivers, &analyzer->drivers);
+		merge_groups(&total->kernels, &analyzer->kernels);
+	}
+
+	if (json) {
+		struct json_writer *w = xcalloc(1, sizeof(*w));
+		json_writer_init(w, STDOUT_FILENO, JSON_WRITER_PRETTY);
+		json_writer_object_begin(w);
+		json_writer_key(w, "nodes");
+		json_writer_uint64(w, total->nodes);
+		json_writer_key(w, "invalid");
+		json_writer_uint64(w, total->invalid);
+		write_groups_json(w, "drivers", &total->drivers);
+		write_groups_json(w, "kernels", &total->kernels);
+		json_writer_object_end(w);
+		if (!json_writer_close(w)) {
+			perror("write");
+			ok = false;
+		}
+		json_writer_finish(w);
+		free(w);
+	} else {
+		struct tree_writer *w = xcalloc(1, sizeof(*w));
+		tree_writer_init(w, STDOUT_FILENO);
+		tree_writer_line(w);
+		tree_writer_printf(w, "Nodes: %"PRIu64"\n", total->nodes);
+		if (total->invalid > 0) {
+			tree_writer_line(w);
+			tree_writer_printf(w, "Invalid dumps: %"PRIu64"\n",
+			total->invalid);
+		}
+		print_groups(w, "Drivers", &total->drivers);
+		print_groups(w, "Kernels", &total->kernels);
+		if (!tree_writer_flush(w)) {
+			perror("write");
+			ok = false;
+		}
+		free(w);
+	}
+
+	if (total->invalid > 0) {
+		ok = false;
+	}
+
+	for (int i = 0; i < jobs; ++i) {
+		struct analyzer *analyzer = &analysis.analyzers[i];
+		count_map_finish(&analyzer->drivers);
+		count_map_finish(&analyzer->kernels);
+		group_finish(&analyzer->node);
+		strings_finish(&analyzer->strings);
+	}
+	free(analysis.analyzers);
+	for (size_t i = 0; i < analysis.n_files; ++i) {
+		free(analysis.files[i]);
+	}
+	free(analysis.files);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
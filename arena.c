@@ -0,0 +1,119 @@
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define MIN_BLOCK_SIZE 4096
+#define MAX_BLOCK_SIZE (256 * 1024)
+
+struct arena_block {
+	struct arena_block *next;
+	size_t used, cap;
+	alignas(max_align_t) unsigned char data[];
+};
+
+static struct arena_block *block_create(size_t cap)
+{
+	struct arena_block *block = calloc(1, sizeof(*block) + cap);
+	if (!block) {
+		perror("calloc");
+		abort();
+	}
+	block->cap = cap;
+	return block;
+}
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+	size = (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+
+	struct arena_block *block = arena->blocks;
+	if (block && block->cap - block->used >= size) {
+		void *ptr = block->data + block->used;
+		block->used += size;
+		return ptr;
+	}
+
+	if (arena->block_size < MIN_BLOCK_SIZE) {
+		arena->block_size = MIN_BLOCK_SIZE;
+	}
+
+	if (size > arena->block_size / 4) {
+		// Too large to share a block with anything else. Put it after
+		// the current block, which may still have room.
+		block = block_create(size);
+		block->used = size;
+		if (arena->blocks) {
+			block->next = arena->blocks->next;
+			arena->blocks->next = block;
+		} else {
+			arena->blocks = block;
+		}
+		return block->data;
+	}
+
+	block = block_create(arena->block_size);
+	block->used = size;
+	block->next = arena->blocks;
+	arena->blocks = block;
+	if (arena->block_size < MAX_BLOCK_SIZE) {
+		arena->block_size *= 2;
+	}
+	return block->data;
+}
+
+void *arena_memdup(struct arena *arena, const void *data, size_t len)
+{
+	void *ptr = arena_alloc(arena, len);
+	if (len > 0) {
+		memcpy(ptr, data, len);
+	}
+	return ptr;
+}
+
+char *arena_strdup(struct arena *arena, const char *str)
+{
+	return arena_strndup(arena, str, strlen(str));
+}
+
+char *arena_strndup(struct arena *arena, const char *str, size_t len)
+{
+	len = strnlen(str, len);
+	char *ptr = arena_alloc(arena, len + 1);
+	memcpy(ptr, str, len);
+	return ptr;
+}
+
+void arena_adopt(struct arena *dst, struct arena *src)
+{
+	if (!src->blocks) {
+		return;
+	}
+	if (!dst->blocks) {
+		*dst = *src;
+		*src = (struct arena){0};
+		return;
+	}
+
+	// Keep allocating from dst's current block
+	struct arena_block *tail = src->blocks;
+	while (tail->next)
+		tail = tail->next;
+	tail->next = dst->blocks->next;
+	dst->blocks->next = src->blocks;
+	*src = (struct arena){0};
+}
+
+void arena_finish(struct arena *arena)
+{
+	struct arena_block *block = arena->blocks;
+	while (block) {
+		struct arena_block *next = block->next;
+		free(block);
+		block = next;
+	}
+	*arena = (struct arena){0};
+}
@@ -0,0 +1,28 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Bump allocator for collected data. Everything allocated from an arena is
+ * freed at once by arena_finish(), so objects built from it don't need to
+ * track their own memory. Arenas aren't thread-safe. */
+
+struct arena_block;
+
+struct arena {
+	struct arena_block *blocks;
+	// Size of the next block, grows as the arena does
+	size_t block_size;
+};
+
+/* Returns zeroed memory, never NULL, even for a size of 0 */
+void *arena_alloc(struct arena *arena, size_t size);
+void *arena_memdup(struct arena *arena, const void *data, size_t len);
+char *arena_strdup(struct arena *arena, const char *str);
+char *arena_strndup(struct arena *arena, const char *str, size_t len);
+
+/* Moves everything allocated from src to dst, leaving src empty */
+void arena_adopt(struct arena *dst, struct arena *src);
+void arena_finish(struct arena *arena);
+
+#endif
@@ -0,0 +1,215 @@
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64_X86
+#include <immintrin.h>
+#endif
+
+#include "base64.h"
+
+static const char alphabet[64] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Block encoders only encode whole 3-byte groups, and return how many bytes of
+ * in they consumed. Whatever they leave is done by the scalar encoder. */
+typedef size_t (*encode_func)(char *out, const unsigned char *in, size_t len);
+
+static size_t encode_scalar(char *out, const unsigned char *in, size_t len)
+{
+	size_t i = 0;
+	for (; i + 3 <= len; i += 3) {
+		uint32_t v = (uint32_t)in[i] << 16 | in[i + 1] << 8 | in[i + 2];
+		*out++ = alphabet[v >> 18];
+		*out++ = alphabet[(v >> 12) & 0x3F];
+		*out++ = alphabet[(v >> 6) & 0x3F];
+		*out++ = alphabet[v & 0x3F];
+	}
+	return i;
+}
+
+#ifdef BASE64_X86
+/* Both x86 encoders work the same way, from W. Muła and D. Lemire's "Faster
+ * Base64 Encoding and Decoding Using AVX2 Instructions": 12 input bytes are
+ * shuffled to 4 lanes of 32 bits, the four 6-bit indices of each lane are
+ * moved to their own byte with multiplies, and indices are turned into
+ * characters by adding an offset which depends on the range they're in. */
+
+__attribute__((target("ssse3")))
+static inline __m128i reshuffle_ssse3(__m128i in)
+{
+	in = _mm_shuffle_epi8(in, _mm_set_epi8(
+		10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	__m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+	__m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+	__m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+	__m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+	return _mm_or_si128(t1, t3);
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i translate_ssse3(__m128i in)
+{
+	// Offsets for A-Z, a-z, 0-9 (10 times), + and /
+	const __m128i lut = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4,
+		-4, -4, -4, -4, -19, -16, 0, 0);
+	__m128i ranges = _mm_subs_epu8(in, _mm_set1_epi8(51));
+	__m128i lower = _mm_cmpgt_epi8(in, _mm_set1_epi8(25));
+	ranges = _mm_sub_epi8(ranges, lower);
+	return _mm_add_epi8(in, _mm_shuffle_epi8(lut, ranges));
+}
+
+__attribute__((target("ssse3")))
+static size_t encode_ssse3(char *out, const unsigned char *in, size_t len)
+{
+	size_t i = 0;
+	// Each 16-byte load only has 12 bytes encoded
+	for (; i + 16 <= len; i += 12) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		v = translate_ssse3(reshuffle_ssse3(v));
+		_mm_storeu_si128((__m128i *)out, v);
+		out += 16;
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i reshuffle_avx2(__m256i in)
+{
+	in = _mm256_shuffle_epi8(in, _mm256_set_epi8(
+		10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+		10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	__m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00));
+	__m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+	__m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0));
+	__m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+	return _mm256_or_si256(t1, t3);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i translate_avx2(__m256i in)
+{
+	const __m256i lut = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4,
+		-4, -4, -4, -4, -19, -16, 0, 0,
+		65, 71, -4, -4, -4, -4, -4, -4,
+		-4, -4, -4, -4, -19, -16, 0, 0);
+	__m256i ranges = _mm256_subs_epu8(in, _mm256_set1_epi8(51));
+	__m256i lower = _mm256_cmpgt_epi8(in, _mm256_set1_epi8(25));
+	ranges = _mm256_sub_epi8(ranges, lower);
+	return _mm256_add_epi8(in, _mm256_shuffle_epi8(lut, ranges));
+}
+
+__attribute__((target("avx2")))
+static size_t encode_avx2(char *out, const unsigned char *in, size_t len)
+{
+	size_t i = 0;
+	// Shuffles don't cross 128-bit lanes, so each lane gets 12 bytes of its
+	// own, and the second load reads 4 bytes past the 24 encoded
+	for (; i + 28 <= len; i += 24) {
+		__m128i lo = _mm_loadu_si128((const __m128i *)(in + i));
+		__m128i hi = _mm_loadu_si128((const __m128i *)(in + i + 12));
+		__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo),
+			hi, 1);
+		v = translate_avx2(reshuffle_avx2(v));
+		_mm256_storeu_si256((__m256i *)out, v);
+		out += 32;
+	}
+	return i;
+}
+#endif
+
+static encode_func get_encoder(void)
+{
+#ifdef BASE64_X86
+	if (__builtin_cpu_supports("avx2")) {
+		return encode_avx2;
+	}
+	if (__builtin_cpu_supports("ssse3")) {
+		return encode_ssse3;
+	}
+#endif
+	return encode_scalar;
+}
+
+size_t base64_encode(char *out, const void *in, size_t len)
+{
+	const unsigned char *src = in;
+	char *dst = out;
+
+	size_t n = get_encoder()(dst, src, len);
+	dst += n / 3 * 4;
+	src += n;
+	len -= n;
+
+	n = encode_scalar(dst, src, len);
+	dst += n / 3 * 4;
+	src += n;
+	len -= n;
+
+	if (len > 0) {
+		uint32_t v = (uint32_t)src[0] << 16;
+		if (len == 2) {
+			v |= src[1] << 8;
+		}
+		*dst++ = alphabet[v >> 18];
+		*dst++ = alphabet[(v >> 12) & 0x3F];
+		*dst++ = len == 2 ? alphabet[(v >> 6) & 0x3F] : '=';
+		*dst++ = '=';
+	}
+
+	return dst - out;
+}
+
+static int decode_char(char c)
+{
+	if (c >= 'A' && c <= 'Z') {
+		return c - 'A';
+	} else if (c >= 'a' && c <= 'z') {
+		return c - 'a' + 26;
+	} else if (c >= '0' && c <= '9') {
+		return c - '0' + 52;
+	} else if (c == '+') {
+		return 62;
+	} else if (c == '/') {
+		return 63;
+	}
+	return -1;
+}
+
+bool base64_decode(void *out, size_t *out_len, const char *in, size_t len)
+{
+	unsigned char *dst = out;
+	*out_len = 0;
+	if (len % 4 != 0) {
+		return false;
+	}
+
+	for (size_t i = 0; i < len; i += 4) {
+		bool last = i + 4 == len;
+		// Padding is only allowed at the end
+		size_t n_pad = 0;
+		if (last && in[i + 3] == '=') {
+			n_pad = in[i + 2] == '=' ? 2 : 1;
+		}
+
+		uint32_t v = 0;
+		for (size_t j = 0; j < 4 - n_pad; ++j) {
+			int d = decode_char(in[i + j]);
+			if (d < 0) {
+				return false;
+			}
+			v = v << 6 | d;
+		}
+		v <<= 6 * n_pad;
+
+		*dst++ = v >> 16;
+		if (n_pad < 2) {
+			*dst++ = (v >> 8) & 0xFF;
+		}
+		if (n_pad < 1) {
+			*dst++ = v & 0xFF;
+		}
+	}
+
+	*out_len = dst - (unsigned char *)out;
+	return true;
+}
@@ -0,0 +1,21 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Standard base64 (RFC 4648), with padding. The encoder uses AVX2 or SSSE3 on
+ * x86 CPUs which have them, picked at runtime. */
+
+#define BASE64_ENCODED_LEN(len) (((len) + 2) / 3 * 4)
+
+/* Encodes len bytes of in to out, which must have room for
+ * BASE64_ENCODED_LEN(len) characters. Returns the number of characters
+ * written. */
+size_t base64_encode(char *out, const void *in, size_t len);
+/* Decodes len characters of in to out, which must have room for len / 4 * 3
+ * bytes, and sets *out_len to the number of bytes written. Returns false if in
+ * isn't valid base64. */
+bool base64_decode(void *out, size_t *out_len, const char *in, size_t len);
+
+#endif
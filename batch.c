@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "drm_info.h"
+#include "input.h"
+#include "pool.h"
+#include "tree_writer.h"
+
+/* Records are rendered a window at a time, then written out in order before
+ * the next window is read. Windows have this many records per job, so that
+ * the cost of starting the workers is spread over enough records, while
+ * only the input and output of one window is kept in memory. */
+#define BATCH_RECORDS_PER_JOB 32
+
+struct batch_record {
+	struct line line;
+	bool ok;
+	const struct print_options *opts;
+	// Only while the record is rendered
+	struct tree_writer *writer;
+	// Sized for the record, and reused by every window
+	struct tree_writer_mem out;
+};
+
+static void print_record_node(const char *path, const struct model_node *node,
+		void *data)
+{
+	struct batch_record *record = data;
+
+	print_node(record->writer, path, node, record->opts);
+}
+
+static void render_record(size_t i, void *data)
+{
+	struct batch_record *record = &((struct batch_record *)data)[i];
+
+	// Renders straight to out, the buffer of the writer isn't used
+	struct tree_writer writer;
+	tree_writer_init_mem(&writer, &record->out);
+	record->writer = &writer;
+	record->ok = drm_info_load_json(record->line.str, record->line.len,
+		print_record_node, record);
+	// Sets the length of out
+	if (!tree_writer_flush(&writer)) {
+		record->ok = false;
+	}
+	record->writer = NULL;
+}
+
+bool drm_info_batch(int fd, struct tree_writer *w, int jobs,
+		const struct print_options *opts)
+{
+	if (jobs <= 0) {
+		jobs = pool_cpu_count();
+	}
+
+	size_t max_records = (size_t)jobs * BATCH_RECORDS_PER_JOB;
+	struct batch_record *records = calloc(max_records, sizeof(*records));
+	struct line *lines = calloc(max_records, sizeof(*lines));
+	if (!records || !lines) {
+		perror("calloc");
+		free(records);
+		free(lines);
+		return false;
+	}
+
+	struct line_reader reader;
+	line_reader_init(&reader, fd);
+	// Invalid records are reported and skipped, read and write errors end
+	// the batch
+	bool ok = true;
+	while (1) {
+		size_t n;
+		if (!line_reader_next(&reader, lines, max_records, &n)) {
+			ok = false;
+			break;
+		}
+		if (n == 0) {
+			break;
+		}
+
+		for (size_t i = 0; i < n; ++i) {
+			records[i].line = lines[i];
+			records[i].opts = opts;
+		}
+		pool_run(n, jobs, render_record, records);
+
+		for (size_t i = 0; i < n; ++i) {
+			struct batch_record *record = &records[i];
+			if (!record->ok) {
+				fprintf(stderr, "Invalid record on line %zu\n",
+					record->line.line_no);
+				ok = false;
+				continue;
+			}
+			tree_writer_write(w, record->out.data, record->out.len);
+		}
+		if (!tree_writer_flush(w)) {
+			perror("write");
+			ok = false;
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < max_records; ++i) {
+		free(records[i].out.data);
+	}
+	free(records);
+	free(lines);
+	line_reader_finish(&reader);
+	return ok;
+}
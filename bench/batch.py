@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+
+# Times --batch on a generated file of records with -J 1 up to a number of
+# jobs, to see how rendering scales with threads.
+#
+# Usage: batch.py <drm_info> [records] [max jobs] [--dedup]
+
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+args = [arg for arg in sys.argv[1:] if arg != '--dedup']
+if not args:
+	sys.exit('usage: {} <drm_info> [records] [max jobs] [--dedup]'.format(
+		sys.argv[0]))
+drm_info = args[0]
+n_records = int(args[1]) if len(args) > 1 else 500
+max_jobs = int(args[2]) if len(args) > 2 else os.cpu_count()
+dump_format = '--dedup' if '--dedup' in sys.argv else '--compact'
+
+gen_dump = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+	'gen_dump.py')
+
+def record(planes):
+	dump = subprocess.run([sys.executable, gen_dump, str(planes)],
+		stdout=subprocess.PIPE, check=True).stdout
+	line = subprocess.run([drm_info, '-i', '-', dump_format], input=dump,
+		stdout=subprocess.PIPE, check=True).stdout
+	return line.strip() + b'\n'
+
+with tempfile.TemporaryDirectory() as tmp:
+	# Records of different sizes, so that threads don't finish in lockstep
+	variants = [record(planes) for planes in range(8, 48, 8)]
+	records = os.path.join(tmp, 'records.ndjson')
+	with open(records, 'wb') as f:
+		for i in range(n_records):
+			f.write(variants[i % len(variants)])
+	print('{} records, {} bytes'.format(n_records, os.path.getsize(records)))
+
+	base = None
+	with open(os.devnull, 'w') as devnull:
+		for jobs in range(1, max_jobs + 1):
+			start = time.perf_counter()
+			subprocess.run([drm_info, '-i', records, '--batch',
+				'-J', str(jobs)], stdout=devnull, check=True)
+			elapsed = time.perf_counter() - start
+			base = base or elapsed
+			print('-J {}: {:.2f}s, {:.2f}x'.format(jobs, elapsed,
+				base / elapsed))
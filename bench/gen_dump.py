@@ -0,0 +1,327 @@
+#!/usr/bin/env python3
+
+# Writes a synthetic dump, in the format of drm_info -j, of an atomic driver
+# with a given number of planes per node. The output only depends on the
+# arguments, so it can be replayed with -i to compare builds of drm_info.
+#
+# Usage: gen_dump.py [planes] [nodes]
+
+import sys
+import json
+
+planes_per_node = int(sys.argv[1]) if len(sys.argv) > 1 else 40
+n_nodes = int(sys.argv[2]) if len(sys.argv) > 2 else 1
+
+# drm_mode.h
+RANGE = 1 << 1
+IMMUTABLE = 1 << 2
+ENUM = 1 << 3
+BLOB = 1 << 4
+BITMASK = 1 << 5
+OBJECT = 1 << 6
+SIGNED_RANGE = 2 << 6
+ATOMIC = 0x80000000
+
+OBJECT_CRTC = 0xcccccccc
+OBJECT_FB = 0xfbfbfbfb
+
+U32_MAX = (1 << 32) - 1
+S32_MAX = (1 << 31) - 1
+
+formats = [
+	0x34325258, # XR24
+	0x34325241, # AR24
+	0x34324258, # XB24
+	0x34324241, # AB24
+	0x36314752, # RG16
+	0x30335258, # XR30
+	0x30334258, # XB30
+	0x48345258, # XR4H
+	0x56595559, # YUYV
+	0x3231564e, # NV12
+	0x30313050, # P010
+]
+
+modifiers = [
+	0x0000000000000000, # LINEAR
+	0x0100000000000001, # I915_FORMAT_MOD_X_TILED
+	0x0100000000000002, # I915_FORMAT_MOD_Y_TILED
+	0x0100000000000003, # I915_FORMAT_MOD_Yf_TILED
+	0x0100000000000004, # I915_FORMAT_MOD_Y_TILED_CCS
+	0x0100000000000009, # I915_FORMAT_MOD_4_TILED
+]
+
+class Node:
+	def __init__(self):
+		self.prop_ids = {}
+		self.next_blob = 1000
+
+	def prop_id(self, name):
+		return self.prop_ids.setdefault(name, len(self.prop_ids) + 1)
+
+	def prop(self, name, flags, spec, raw_value, value=None, data=None):
+		kind = flags & (RANGE | ENUM | BLOB | BITMASK | OBJECT | SIGNED_RANGE)
+		return name, {
+			'id': self.prop_id(name),
+			'flags': flags,
+			'type': kind,
+			'atomic': bool(flags & ATOMIC),
+			'immutable': bool(flags & IMMUTABLE),
+			'raw_value': raw_value,
+			'spec': spec,
+			'value': value,
+			'data': data,
+		}
+
+	def range(self, name, lo, hi, value, flags=0, data=None):
+		return self.prop(name, RANGE | flags, {'min': lo, 'max': hi},
+			value, value, data)
+
+	def signed_range(self, name, lo, value):
+		return self.prop(name, SIGNED_RANGE | ATOMIC,
+			{'min': lo, 'max': S32_MAX}, value, value)
+
+	def enum(self, name, names, value, flags=0):
+		spec = [{'name': n, 'value': i} for i, n in enumerate(names)]
+		return self.prop(name, ENUM | flags, spec, value, value)
+
+	def bitmask(self, name, names, value):
+		spec = [{'name': n, 'value': i} for i, n in enumerate(names)]
+		return self.prop(name, BITMASK, spec, value, value)
+
+	def blob(self, name, data=None, flags=0):
+		blob_id = 0
+		if data is not None:
+			blob_id = self.next_blob
+			self.next_blob += 1
+		return self.prop(name, BLOB | flags, None, blob_id, None, data)
+
+	def object(self, name, kind, obj_id, data=None):
+		return self.prop(name, OBJECT | ATOMIC, kind, obj_id, obj_id, data)
+
+def mode(w, h, clock, hss, hse, ht, vss, vse, vt, refresh, preferred=False):
+	return {
+		'clock': clock,
+		'hdisplay': w,
+		'hsync_start': hss,
+		'hsync_end': hse,
+		'htotal': ht,
+		'hskew': 0,
+		'vdisplay': h,
+		'vsync_start': vss,
+		'vsync_end': vse,
+		'vtotal': vt,
+		'vscan': 0,
+		'vrefresh': refresh,
+		'flags': 0x5,
+		'type': 0x48 if preferred else 0x40,
+		'name': '{}x{}'.format(w, h),
+	}
+
+modes = [
+	mode(3840, 2160, 594000, 4016, 4104, 4400, 2168, 2178, 2250, 60, True),
+	mode(3840, 2160, 297000, 4016, 4104, 4400, 2168, 2178, 2250, 30),
+	mode(2560, 1440, 241500, 2608, 2640, 2720, 1443, 1448, 1481, 60),
+	mode(1920, 1200, 154000, 1968, 2000, 2080, 1203, 1209, 1235, 60),
+	mode(1920, 1080, 148500, 2008, 2052, 2200, 1084, 1089, 1125, 60),
+	mode(1920, 1080, 148500, 2448, 2492, 2640, 1084, 1089, 1125, 50),
+	mode(1680, 1050, 119000, 1728, 1760, 1840, 1053, 1059, 1080, 60),
+	mode(1280, 1024, 108000, 1328, 1440, 1688, 1025, 1028, 1066, 60),
+	mode(1280, 720, 74250, 1390, 1430, 1650, 725, 730, 750, 60),
+	mode(1024, 768, 65000, 1048, 1184, 1344, 771, 777, 806, 60),
+	mode(800, 600, 40000, 840, 968, 1056, 601, 605, 628, 60),
+	mode(640, 480, 25175, 656, 752, 800, 490, 492, 525, 60),
+]
+
+def gen_node(index):
+	n = Node()
+	crtc_ids = [100 + i for i in range(4)]
+	fb = {
+		'id': 500,
+		'width': 3840,
+		'height': 2160,
+		'format': formats[0],
+		'modifier': modifiers[4],
+		'planes': [
+			{'offset': 0, 'pitch': 15360},
+			{'offset': 33177600, 'pitch': 512},
+		],
+	}
+
+	connectors = []
+	encoders = []
+	for i, (kind, status) in enumerate([(11, 1), (10, 1), (10, 2), (14, 2)]):
+		conn_id = 200 + i
+		enc_id = 300 + i
+		crtc_id = crtc_ids[i] if status == 1 else 0
+		connectors.append({
+			'id': conn_id,
+			'type': kind,
+			'status': status,
+			'phy_width': 600 if status == 1 else 0,
+			'phy_height': 340 if status == 1 else 0,
+			'subpixel': 2 if status == 1 else 1,
+			'encoder_id': enc_id if status == 1 else 0,
+			'encoders': [enc_id],
+			'modes': modes if status == 1 else [],
+			'properties': dict([
+				n.blob('EDID', flags=IMMUTABLE),
+				n.enum('DPMS', ['On', 'Standby', 'Suspend', 'Off'], 0),
+				n.enum('link-status', ['Good', 'Bad'], 0),
+				n.blob('PATH', flags=IMMUTABLE),
+				n.blob('TILE', flags=IMMUTABLE),
+				n.object('CRTC_ID', OBJECT_CRTC, crtc_id),
+				n.range('max bpc', 6, 12, 8),
+				n.enum('Content Protection',
+					['Undesired', 'Desired', 'Enabled'], 0),
+				n.blob('HDR_OUTPUT_METADATA'),
+				n.enum('Broadcast RGB', ['Automatic', 'Full', 'Limited 16:235'],
+					0),
+			]),
+		})
+		encoders.append({
+			'id': enc_id,
+			'type': 2,
+			'crtc_id': crtc_id,
+			'possible_crtcs': (1 << len(crtc_ids)) - 1,
+			'possible_clones': 0,
+		})
+
+	crtcs = []
+	for i, crtc_id in enumerate(crtc_ids):
+		active = i < 2
+		crtc_mode = modes[0] if active else None
+		crtcs.append({
+			'id': crtc_id,
+			'fb_id': fb['id'] if active else 0,
+			'x': 0,
+			'y': 0,
+			'mode': crtc_mode,
+			'gamma_size': 1024,
+			'properties': dict([
+				n.range('ACTIVE', 0, 1, int(active), ATOMIC),
+				n.blob('MODE_ID', crtc_mode, ATOMIC),
+				n.prop('OUT_FENCE_PTR', RANGE | ATOMIC, {'min': 0, 'max': U32_MAX},
+					0, 0),
+				n.range('VRR_ENABLED', 0, 1, 0),
+				n.blob('DEGAMMA_LUT'),
+				n.range('DEGAMMA_LUT_SIZE', 0, U32_MAX, 129, IMMUTABLE),
+				n.blob('CTM'),
+				n.blob('GAMMA_LUT'),
+				n.range('GAMMA_LUT_SIZE', 0, U32_MAX, 1024, IMMUTABLE),
+			]),
+		})
+
+	in_formats = [{'modifier': m, 'formats': formats[:len(formats) - j]}
+		for j, m in enumerate(modifiers)]
+	cursor_formats = [{'modifier': 0, 'formats': [formats[1]]}]
+
+	planes = []
+	for i in range(planes_per_node):
+		crtc_index = i % len(crtc_ids)
+		cursor = i >= planes_per_node - len(crtc_ids)
+		primary = i < len(crtc_ids)
+		on = primary and crtc_index < 2
+		crtc_id = crtc_ids[crtc_index] if on else 0
+		plane_fb = fb if on else None
+		w, h = (3840, 2160) if on else (0, 0)
+		plane_formats = cursor_formats if cursor else in_formats
+		planes.append({
+			'id': 400 + i,
+			'possible_crtcs': 1 << crtc_index,
+			'crtc_id': crtc_id,
+			'fb_id': fb['id'] if on else 0,
+			'crtc_x': 0,
+			'crtc_y': 0,
+			'x': 0,
+			'y': 0,
+			'gamma_size': 0,
+			'fb': plane_fb,
+			'formats': sorted({f for m in plane_formats for f in m['formats']}),
+			'properties': dict([
+				n.enum('type', ['Overlay', 'Primary', 'Cursor'],
+					2 if cursor else 1 if primary else 0, IMMUTABLE),
+				n.object('FB_ID', OBJECT_FB, fb['id'] if on else 0, plane_fb),
+				n.signed_range('IN_FENCE_FD', -1, -1),
+				n.object('CRTC_ID', OBJECT_CRTC, crtc_id),
+				n.range('SRC_X', 0, U32_MAX, 0, ATOMIC, 0),
+				n.range('SRC_Y', 0, U32_MAX, 0, ATOMIC, 0),
+				n.range('SRC_W', 0, U32_MAX, w << 16, ATOMIC, w),
+				n.range('SRC_H', 0, U32_MAX, h << 16, ATOMIC, h),
+				n.signed_range('CRTC_X', -S32_MAX - 1, 0),
+				n.signed_range('CRTC_Y', -S32_MAX - 1, 0),
+				n.range('CRTC_W', 0, S32_MAX, w, ATOMIC),
+				n.range('CRTC_H', 0, S32_MAX, h, ATOMIC),
+				n.blob('IN_FORMATS', plane_formats, IMMUTABLE),
+				n.bitmask('rotation', ['rotate-0', 'rotate-90', 'rotate-180',
+					'rotate-270', 'reflect-x', 'reflect-y'], 1),
+				n.enum('pixel blend mode', ['None', 'Pre-multiplied', 'Coverage'],
+					1),
+				n.range('alpha', 0, 0xffff, 0xffff),
+				n.range('zpos', 0, planes_per_node - 1, i, IMMUTABLE),
+				n.enum('COLOR_ENCODING', ['ITU-R BT.601 YCbCr',
+					'ITU-R BT.709 YCbCr', 'ITU-R BT.2020 YCbCr'], 1),
+				n.enum('COLOR_RANGE', ['YCbCr limited range',
+					'YCbCr full range'], 0),
+				n.blob('FB_DAMAGE_CLIPS', flags=ATOMIC),
+				n.range('SCALING_FILTER', 0, 1, 0),
+			]),
+		})
+
+	return {
+		'driver': {
+			'name': 'i915',
+			'desc': 'Intel Graphics',
+			'version': {'major': 1, 'minor': 6, 'patch': 0,
+				'date': '20230929'},
+			'kernel': {'sysname': 'Linux', 'release': '6.8.0',
+				'version': '#1 SMP PREEMPT_DYNAMIC'},
+			'client_caps': {
+				'STEREO_3D': True,
+				'UNIVERSAL_PLANES': True,
+				'ATOMIC': True,
+				'ASPECT_RATIO': True,
+				'WRITEBACK_CONNECTORS': True,
+			},
+			'caps': {
+				'DUMB_BUFFER': 1,
+				'VBLANK_HIGH_CRTC': 1,
+				'DUMB_PREFERRED_DEPTH': 24,
+				'DUMB_PREFER_SHADOW': 1,
+				'PRIME': 3,
+				'TIMESTAMP_MONOTONIC': 1,
+				'ASYNC_PAGE_FLIP': 1,
+				'CURSOR_WIDTH': 256,
+				'CURSOR_HEIGHT': 256,
+				'ADDFB2_MODIFIERS': 1,
+				'PAGE_FLIP_TARGET': 0,
+				'CRTC_IN_VBLANK_EVENT': 1,
+				'SYNCOBJ': 1,
+				'SYNCOBJ_TIMELINE': 1,
+			},
+		},
+		'device': {
+			'available_nodes': 5,
+			'bus_type': 0,
+			'device_data': {
+				'vendor': 0x8086,
+				'device': 0xa7a0 + index,
+				'subsystem_vendor': 0x17aa,
+				'subsystem_device': 0x22e6,
+			},
+		},
+		'fb_size': {
+			'min_width': 0,
+			'max_width': 16384,
+			'min_height': 0,
+			'max_height': 16384,
+		},
+		'connectors': connectors,
+		'encoders': encoders,
+		'crtcs': crtcs,
+		'planes': planes,
+	}
+
+dump = {'/dev/dri/card{}'.format(i): gen_node(i) for i in range(n_nodes)}
+json.dump(dump, sys.stdout, indent=2)
+sys.stdout.write('\n')
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+
+# Times pretty-printing a dump from gen_dump.py with -i, written to /dev/null,
+# to a file and to a terminal. Run it with two builds to compare them.
+#
+# Usage: pretty.py <drm_info> [runs] [planes]
+
+import os
+import pty
+import subprocess
+import sys
+import tempfile
+import time
+
+if len(sys.argv) < 2:
+	sys.exit('usage: {} <drm_info> [runs] [planes]'.format(sys.argv[0]))
+drm_info = sys.argv[1]
+runs = int(sys.argv[2]) if len(sys.argv) > 2 else 20
+planes = sys.argv[3] if len(sys.argv) > 3 else '40'
+
+gen_dump = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+	'gen_dump.py')
+
+def replay(stdout):
+	start = time.perf_counter()
+	for _ in range(runs):
+		subprocess.run([drm_info, '-i', dump], stdout=stdout, check=True)
+	return time.perf_counter() - start
+
+# Reads the terminal until the child closes it, like a terminal emulator
+def replay_tty():
+	pid, fd = pty.fork()
+	if pid == 0:
+		for _ in range(runs):
+			if subprocess.run([drm_info, '-i', dump]).returncode != 0:
+				os._exit(1)
+		os._exit(0)
+	start = time.perf_counter()
+	try:
+		while os.read(fd, 65536):
+			pass
+	except OSError:
+		pass
+	_, status = os.waitpid(pid, 0)
+	if status != 0:
+		sys.exit('{} failed'.format(drm_info))
+	return time.perf_counter() - start
+
+with tempfile.TemporaryDirectory() as tmp:
+	dump = os.path.join(tmp, 'dump.json')
+	with open(dump, 'w') as f:
+		subprocess.run([sys.executable, gen_dump, planes], stdout=f,
+			check=True)
+
+	out = os.path.join(tmp, 'out.txt')
+	with open(out, 'w') as f:
+		subprocess.run([drm_info, '-i', dump], stdout=f, check=True)
+	print('{} bytes of output, {} runs'.format(os.path.getsize(out), runs))
+
+	with open(os.devnull, 'w') as f:
+		print('/dev/null: {:.2f}s'.format(replay(f)))
+	with open(out, 'w') as f:
+		print('file:      {:.2f}s'.format(replay(f)))
+	print('tty:       {:.2f}s'.format(replay_tty()))
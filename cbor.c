@@ -0,0 +1,127 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cbor.h"
+
+// Nesting limit for skipped items, to avoid unbounded recursion on bad input
+#define MAX_SKIP_DEPTH 64
+
+void cbor_reader_init(struct cbor_reader *r, const void *data, size_t len)
+{
+	r->data = data;
+	r->len = len;
+	r->pos = 0;
+	r->error = false;
+}
+
+static bool fail(struct cbor_reader *r)
+{
+	r->error = true;
+	return false;
+}
+
+bool cbor_next(struct cbor_reader *r, struct cbor_item *item)
+{
+	if (r->error || r->pos >= r->len) {
+		return false;
+	}
+
+	unsigned char initial = r->data[r->pos++];
+	item->major = initial >> 5;
+	item->indefinite = false;
+	item->str = NULL;
+
+	unsigned int info = initial & 0x1F;
+	size_t n;
+	if (info < 24) {
+		item->value = info;
+		n = 0;
+	} else if (info <= 27) {
+		n = (size_t)1 << (info - 24);
+	} else if (info == CBOR_INDEFINITE &&
+			(item->major == CBOR_ARRAY || item->major == CBOR_MAP)) {
+		item->indefinite = true;
+		item->value = 0;
+		return true;
+	} else {
+		// Reserved, indefinite strings and the break aren't written
+		return fail(r);
+	}
+
+	if (n > 0) {
+		if (r->len - r->pos < n) {
+			return fail(r);
+		}
+		item->value = 0;
+		for (size_t i = 0; i < n; ++i) {
+			item->value = item->value << 8 | r->data[r->pos++];
+		}
+	}
+
+	if (item->major == CBOR_TEXT || item->major == CBOR_BYTES) {
+		if (r->len - r->pos < item->value) {
+			return fail(r);
+		}
+		item->str = (const char *)r->data + r->pos;
+		r->pos += item->value;
+	}
+
+	return true;
+}
+
+bool cbor_container_next(struct cbor_reader *r,
+		const struct cbor_item *container, uint64_t i)
+{
+	if (r->error) {
+		return false;
+	}
+	if (!container->indefinite) {
+		return i < container->value;
+	}
+	if (r->pos >= r->len) {
+		return fail(r);
+	}
+	if (r->data[r->pos] == CBOR_BREAK) {
+		++r->pos;
+		return false;
+	}
+	return true;
+}
+
+static bool skip(struct cbor_reader *r, const struct cbor_item *item,
+		int depth)
+{
+	if (depth > MAX_SKIP_DEPTH) {
+		return fail(r);
+	}
+
+	uint64_t per_entry;
+	switch (item->major) {
+	case CBOR_ARRAY:
+		per_entry = 1;
+		break;
+	case CBOR_MAP:
+		per_entry = 2;
+		break;
+	case CBOR_TAG:;
+		struct cbor_item tagged;
+		return cbor_next(r, &tagged) && skip(r, &tagged, depth + 1);
+	default:
+		return true;
+	}
+
+	for (uint64_t i = 0; cbor_container_next(r, item, i); ++i) {
+		for (uint64_t j = 0; j < per_entry; ++j) {
+			struct cbor_item child;
+			if (!cbor_next(r, &child) || !skip(r, &child, depth + 1)) {
+				return fail(r);
+			}
+		}
+	}
+	return !r->error;
+}
+
+bool cbor_skip_item(struct cbor_reader *r, const struct cbor_item *item)
+{
+	return skip(r, item, 0);
+}
@@ -0,0 +1,61 @@
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Minimal CBOR (RFC 8949) pull decoder, for the subset written by
+ * json_writer: integers, text and byte strings, arrays, maps, tags, booleans
+ * and null. Containers may have a definite or an indefinite length. */
+
+enum cbor_major {
+	CBOR_UINT = 0,
+	CBOR_NEGINT = 1,
+	CBOR_BYTES = 2,
+	CBOR_TEXT = 3,
+	CBOR_ARRAY = 4,
+	CBOR_MAP = 5,
+	CBOR_TAG = 6,
+	CBOR_SIMPLE = 7,
+};
+
+#define CBOR_FALSE 0xF4
+#define CBOR_TRUE 0xF5
+#define CBOR_NULL 0xF6
+#define CBOR_BREAK 0xFF
+#define CBOR_INDEFINITE 31
+
+// Byte string which is expected to be converted to base64, e.g. in JSON
+#define CBOR_TAG_BASE64 22
+#define CBOR_TAG_SELF_DESCRIBED 55799
+
+struct cbor_item {
+	enum cbor_major major;
+	// Integer value, -1 - value for negative integers, number of bytes of
+	// strings, number of items of arrays, number of pairs of maps, tag
+	// number, or simple value
+	uint64_t value;
+	bool indefinite; // Containers only
+	const char *str; // Text and byte strings
+};
+
+struct cbor_reader {
+	const unsigned char *data;
+	size_t len, pos;
+	bool error;
+};
+
+void cbor_reader_init(struct cbor_reader *r, const void *data, size_t len);
+
+/* Reads the next data item. For containers, only the head is read, and their
+ * items follow. Returns false on error or at the end of the data. */
+bool cbor_next(struct cbor_reader *r, struct cbor_item *item);
+/* Returns true if there is another item in container, of which i items were
+ * already read. Consumes the break of indefinite containers. */
+bool cbor_container_next(struct cbor_reader *r,
+	const struct cbor_item *container, uint64_t i);
+/* Skips the rest of a data item whose head was just read */
+bool cbor_skip_item(struct cbor_reader *r, const struct cbor_item *item);
+
+#endif
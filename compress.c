@@ -0,0 +1,204 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "compress.h"
+
+#define COMPRESS_BUF_SIZE (64 * 1024)
+
+struct compressor {
+	enum compress_format format;
+	int fd;
+#ifdef HAVE_ZLIB
+	z_stream zs;
+#endif
+#ifdef HAVE_ZSTD
+	ZSTD_CCtx *zstd;
+#endif
+	unsigned char out[COMPRESS_BUF_SIZE];
+};
+
+#if defined(HAVE_ZLIB) || defined(HAVE_ZSTD)
+static bool write_out(struct compressor *c, size_t len)
+{
+	size_t off = 0;
+	while (off < len) {
+		ssize_t n = write(c->fd, c->out + off, len - off);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		off += n;
+	}
+	return true;
+}
+#endif
+
+struct compressor *compressor_create(enum compress_format format, int fd)
+{
+	struct compressor *c = calloc(1, sizeof(*c));
+	if (!c) {
+		perror("calloc");
+		return NULL;
+	}
+	c->format = format;
+	c->fd = fd;
+
+	switch (format) {
+	case COMPRESS_GZIP:
+#ifdef HAVE_ZLIB
+		// 16 more window bits ask for a gzip header and trailer
+		if (deflateInit2(&c->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+				15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			fprintf(stderr, "deflateInit2 failed\n");
+			break;
+		}
+		return c;
+#else
+		fprintf(stderr, "drm_info was built without zlib\n");
+		break;
+#endif
+	case COMPRESS_ZSTD:
+#ifdef HAVE_ZSTD
+		c->zstd = ZSTD_createCCtx();
+		if (!c->zstd) {
+			fprintf(stderr, "ZSTD_createCCtx failed\n");
+			break;
+		}
+		return c;
+#else
+		fprintf(stderr, "drm_info was built without zstd\n");
+		break;
+#endif
+	}
+
+	free(c);
+	return NULL;
+}
+
+void compressor_destroy(struct compressor *c)
+{
+	if (!c) {
+		return;
+	}
+
+	switch (c->format) {
+	case COMPRESS_GZIP:
+#ifdef HAVE_ZLIB
+		deflateEnd(&c->zs);
+#endif
+		break;
+	case COMPRESS_ZSTD:
+#ifdef HAVE_ZSTD
+		ZSTD_freeCCtx(c->zstd);
+#endif
+		break;
+	}
+	free(c);
+}
+
+#ifdef HAVE_ZLIB
+static bool deflate_data(struct compressor *c, const void *data, size_t len,
+		int mode)
+{
+	c->zs.next_in = (Bytef *)data;
+	c->zs.avail_in = len;
+
+	// Keep going as long as deflate() fills the whole buffer, it may have
+	// more to write out
+	do {
+		c->zs.next_out = c->out;
+		c->zs.avail_out = sizeof(c->out);
+		// Z_BUF_ERROR only means there was nothing to do
+		if (deflate(&c->zs, mode) == Z_STREAM_ERROR) {
+			fprintf(stderr, "deflate failed\n");
+			return false;
+		}
+		if (!write_out(c, sizeof(c->out) - c->zs.avail_out)) {
+			return false;
+		}
+	} while (c->zs.avail_out == 0);
+
+	return true;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static bool zstd_data(struct compressor *c, const void *data, size_t len,
+		ZSTD_EndDirective op)
+{
+	ZSTD_inBuffer in = { .src = data, .size = len };
+	bool done;
+	do {
+		ZSTD_outBuffer out = { .dst = c->out, .size = sizeof(c->out) };
+		// Number of bytes left to flush
+		size_t left = ZSTD_compressStream2(c->zstd, &out, &in, op);
+		if (ZSTD_isError(left)) {
+			fprintf(stderr, "ZSTD_compressStream2: %s\n",
+				ZSTD_getErrorName(left));
+			return false;
+		}
+		if (!write_out(c, out.pos)) {
+			return false;
+		}
+		done = op == ZSTD_e_continue ? in.pos == in.size : left == 0;
+	} while (!done);
+
+	return true;
+}
+#endif
+
+bool compressor_write(struct compressor *c, const void *data, size_t len,
+		bool flush)
+{
+	// Unused for formats which aren't built in
+	(void)data;
+	(void)len;
+	(void)flush;
+
+	switch (c->format) {
+	case COMPRESS_GZIP:
+#ifdef HAVE_ZLIB
+		return deflate_data(c, data, len, flush ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+#else
+		break;
+#endif
+	case COMPRESS_ZSTD:
+#ifdef HAVE_ZSTD
+		return zstd_data(c, data, len,
+			flush ? ZSTD_e_flush : ZSTD_e_continue);
+#else
+		break;
+#endif
+	}
+	return false;
+}
+
+bool compressor_end(struct compressor *c)
+{
+	switch (c->format) {
+	case COMPRESS_GZIP:
+#ifdef HAVE_ZLIB
+		return deflate_data(c, NULL, 0, Z_FINISH);
+#else
+		break;
+#endif
+	case COMPRESS_ZSTD:
+#ifdef HAVE_ZSTD
+		return zstd_data(c, NULL, 0, ZSTD_e_end);
+#else
+		break;
+#endif
+	}
+	return false;
+}
@@ -0,0 +1,37 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Streaming compressor writing to a file descriptor. Memory use is bounded by
+ * the compression state and a fixed-size output buffer, whatever the amount of
+ * data. Which formats are supported depends on the libraries drm_info was
+ * built with. */
+
+enum compress_format {
+	COMPRESS_GZIP,
+	COMPRESS_ZSTD,
+};
+
+#ifdef HAVE_ZSTD
+#define COMPRESS_DEFAULT COMPRESS_ZSTD
+#else
+#define COMPRESS_DEFAULT COMPRESS_GZIP
+#endif
+
+struct compressor;
+
+/* Returns NULL, after printing why, if format isn't supported */
+struct compressor *compressor_create(enum compress_format format, int fd);
+void compressor_destroy(struct compressor *c);
+
+/* Compresses len bytes of data. With flush, everything compressed so far is
+ * written out, so that the output can be decompressed up to this point.
+ * Returns false on error. */
+bool compressor_write(struct compressor *c, const void *data, size_t len,
+	bool flush);
+/* Ends the compressed stream and writes it out */
+bool compressor_end(struct compressor *c);
+
+#endif
@@ -0,0 +1,379 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debugfs.h"
+
+enum plane_field {
+	PLANE_CRTC = 1 << 0,
+	PLANE_FB = 1 << 1,
+	PLANE_CRTC_POS = 1 << 2,
+	PLANE_SRC_POS = 1 << 3,
+	PLANE_ALL = (1 << 4) - 1,
+};
+
+enum crtc_field {
+	CRTC_ENABLE = 1 << 0,
+	CRTC_ACTIVE = 1 << 1,
+	CRTC_MODE = 1 << 2,
+	CRTC_ALL = (1 << 3) - 1,
+};
+
+enum fb_field {
+	FB_FORMAT = 1 << 0,
+	FB_MODIFIER = 1 << 1,
+	FB_SIZE = 1 << 2,
+	FB_ALL = (1 << 3) - 1,
+};
+
+/* Objects as they're being parsed. Planes refer to CRTCs by name, so those
+ * can only be resolved once everything has been read. */
+struct plane_entry {
+	struct debugfs_plane plane;
+	char crtc[DRM_DISPLAY_MODE_LEN];
+	unsigned int fields;
+};
+
+struct crtc_entry {
+	struct debugfs_crtc crtc;
+	char name[DRM_DISPLAY_MODE_LEN];
+	unsigned int fields;
+};
+
+struct fb_entry {
+	struct debugfs_fb fb;
+	unsigned int fields;
+};
+
+struct parser {
+	struct plane_entry *planes;
+	size_t n_planes;
+	struct crtc_entry *crtcs;
+	size_t n_crtcs;
+	struct fb_entry *fbs;
+	size_t n_fbs;
+
+	struct plane_entry *plane;
+	struct crtc_entry *crtc;
+	// The FB being printed as part of the current plane, NULL if it's
+	// already known
+	struct fb_entry *fb;
+};
+
+static void *append(void *arr, size_t *len, size_t size)
+{
+	char *new_arr = realloc(arr, (*len + 1) * size);
+	if (!new_arr) {
+		return NULL;
+	}
+	memset(new_arr + *len * size, 0, size);
+	++*len;
+	return new_arr;
+}
+
+/* Copies a name printed after "]: " */
+static void copy_name(char *dst, const char *line)
+{
+	const char *name = strstr(line, "]: ");
+	name = name ? name + 3 : "";
+	snprintf(dst, DRM_DISPLAY_MODE_LEN, "%.*s",
+		(int)strcspn(name, "\n"), name);
+}
+
+/* Parses a 16.16 fixed point value printed as a decimal with 6 digits. The
+ * kernel truncates the fraction, so round it back up. */
+static uint32_t parse_fixed(uint32_t integer, uint32_t frac)
+{
+	return (integer << 16) + (frac * 1024 + 15624) / 15625;
+}
+
+static bool parse_plane_line(struct parser *p, const char *line, int depth)
+{
+	struct debugfs_plane *plane = &p->plane->plane;
+	if (depth == 1) {
+		p->fb = NULL;
+	}
+
+	if (depth == 1 && strncmp(line, "crtc=", 5) == 0) {
+		snprintf(p->plane->crtc, sizeof(p->plane->crtc), "%.*s",
+			(int)strcspn(line + 5, "\n"), line + 5);
+		p->plane->fields |= PLANE_CRTC;
+	} else if (depth == 1 && sscanf(line, "fb=%" SCNu32, &plane->fb_id) == 1) {
+		p->plane->fields |= PLANE_FB;
+
+		// The same FB may be attached to multiple planes
+		bool known = plane->fb_id == 0;
+		for (size_t i = 0; !known && i < p->n_fbs; ++i) {
+			known = p->fbs[i].fb.id == plane->fb_id;
+		}
+		if (!known) {
+			struct fb_entry *fbs = append(p->fbs, &p->n_fbs,
+				sizeof(*fbs));
+			if (!fbs) {
+				return false;
+			}
+			p->fbs = fbs;
+			p->fb = &fbs[p->n_fbs - 1];
+			p->fb->fb.id = plane->fb_id;
+		}
+	} else if (depth == 1 && strncmp(line, "crtc-pos=", 9) == 0) {
+		if (sscanf(line + 9, "%" SCNu32 "x%" SCNu32 "%" SCNd32 "%" SCNd32,
+				&plane->crtc_w, &plane->crtc_h,
+				&plane->crtc_x, &plane->crtc_y) == 4) {
+			p->plane->fields |= PLANE_CRTC_POS;
+		}
+	} else if (depth == 1 && strncmp(line, "src-pos=", 8) == 0) {
+		uint32_t v[8];
+		if (sscanf(line + 8, "%" SCNu32 ".%" SCNu32 "x%" SCNu32 ".%" SCNu32
+				"+%" SCNu32 ".%" SCNu32 "+%" SCNu32 ".%" SCNu32,
+				&v[0], &v[1], &v[2], &v[3],
+				&v[4], &v[5], &v[6], &v[7]) == 8) {
+			plane->src_w = parse_fixed(v[0], v[1]);
+			plane->src_h = parse_fixed(v[2], v[3]);
+			plane->src_x = parse_fixed(v[4], v[5]);
+			plane->src_y = parse_fixed(v[6], v[7]);
+			p->plane->fields |= PLANE_SRC_POS;
+		}
+	} else if (depth >= 2 && p->fb) {
+		struct fb_entry *fb = p->fb;
+		uint32_t i, val;
+		const char *fourcc;
+		if (depth == 2 && strncmp(line, "format=", 7) == 0 &&
+				(fourcc = strstr(line, "(0x"))) {
+			// e.g. "format=XR24 little-endian (0x34325258)"
+			fb->fb.format = strtoul(fourcc + 1, NULL, 16);
+			fb->fields |= FB_FORMAT;
+		} else if (depth == 2 && sscanf(line, "modifier=0x%" SCNx64,
+				&fb->fb.modifier) == 1) {
+			fb->fields |= FB_MODIFIER;
+		} else if (depth == 2 && sscanf(line, "size=%" SCNu32 "x%" SCNu32,
+				&fb->fb.width, &fb->fb.height) == 2) {
+			fb->fields |= FB_SIZE;
+		} else if (depth == 3 && sscanf(line,
+				"pitch[%" SCNu32 "]=%" SCNu32, &i, &val) == 2 &&
+				i < 4) {
+			fb->fb.pitches[i] = val;
+		} else if (depth == 3 && sscanf(line,
+				"offset[%" SCNu32 "]=%" SCNu32, &i, &val) == 2 &&
+				i < 4) {
+			fb->fb.offsets[i] = val;
+		}
+	}
+	return true;
+}
+
+static bool parse_mode(drmModeModeInfo *mode, const char *line)
+{
+	// e.g. mode: "1920x1080": 60 148500 1920 2008 2052 2200 1080 1084 1089
+	// 1125 0x48 0x5
+	const char *name = strchr(line, '"');
+	const char *name_end = name ? strchr(name + 1, '"') : NULL;
+	if (!name_end) {
+		return false;
+	}
+
+	int vrefresh, clock, hdisplay, hsync_start, hsync_end, htotal,
+		vdisplay, vsync_start, vsync_end, vtotal;
+	unsigned int type, flags;
+	if (sscanf(name_end + 1, ": %d %d %d %d %d %d %d %d %d %d 0x%x 0x%x",
+			&vrefresh, &clock, &hdisplay, &hsync_start, &hsync_end,
+			&htotal, &vdisplay, &vsync_start, &vsync_end, &vtotal,
+			&type, &flags) != 12) {
+		return false;
+	}
+
+	memset(mode, 0, sizeof(*mode));
+	mode->vrefresh = vrefresh;
+	mode->clock = clock;
+	mode->hdisplay = hdisplay;
+	mode->hsync_start = hsync_start;
+	mode->hsync_end = hsync_end;
+	mode->htotal = htotal;
+	mode->vdisplay = vdisplay;
+	mode->vsync_start = vsync_start;
+	mode->vsync_end = vsync_end;
+	mode->vtotal = vtotal;
+	mode->type = type;
+	mode->flags = flags;
+	snprintf(mode->name, sizeof(mode->name), "%.*s",
+		(int)(name_end - name - 1), name + 1);
+	return true;
+}
+
+static void parse_crtc_line(struct parser *p, const char *line, int depth)
+{
+	struct crtc_entry *crtc = p->crtc;
+	int val;
+	if (depth != 1) {
+		return;
+	} else if (sscanf(line, "enable=%d", &val) == 1) {
+		crtc->crtc.enable = val;
+		crtc->fields |= CRTC_ENABLE;
+	} else if (sscanf(line, "active=%d", &val) == 1) {
+		crtc->crtc.active = val;
+		crtc->fields |= CRTC_ACTIVE;
+	} else if (strncmp(line, "mode: ", 6) == 0 &&
+			parse_mode(&crtc->crtc.mode, line)) {
+		crtc->fields |= CRTC_MODE;
+	}
+}
+
+static bool parse_line(struct parser *p, const char *line)
+{
+	int depth = strspn(line, "\t");
+	line += depth;
+
+	uint32_t id;
+	if (depth > 0) {
+		if (p->plane) {
+			return parse_plane_line(p, line, depth);
+		} else if (p->crtc) {
+			parse_crtc_line(p, line, depth);
+		}
+		return true;
+	}
+
+	p->plane = NULL;
+	p->crtc = NULL;
+	p->fb = NULL;
+	if (sscanf(line, "plane[%" SCNu32 "]", &id) == 1) {
+		struct plane_entry *planes = append(p->planes, &p->n_planes,
+			sizeof(*planes));
+		if (!planes) {
+			return false;
+		}
+		p->planes = planes;
+		p->plane = &planes[p->n_planes - 1];
+		p->plane->plane.id = id;
+	} else if (sscanf(line, "crtc[%" SCNu32 "]", &id) == 1) {
+		struct crtc_entry *crtcs = append(p->crtcs, &p->n_crtcs,
+			sizeof(*crtcs));
+		if (!crtcs) {
+			return false;
+		}
+		p->crtcs = crtcs;
+		p->crtc = &crtcs[p->n_crtcs - 1];
+		p->crtc->crtc.id = id;
+		copy_name(p->crtc->name, line);
+	}
+	return true;
+}
+
+/* Moves the complete objects out of the parser */
+static bool finish(struct parser *p, struct debugfs_state *state)
+{
+	state->planes = calloc(p->n_planes + 1, sizeof(*state->planes));
+	state->crtcs = calloc(p->n_crtcs + 1, sizeof(*state->crtcs));
+	state->fbs = calloc(p->n_fbs + 1, sizeof(*state->fbs));
+	if (!state->planes || !state->crtcs || !state->fbs) {
+		return false;
+	}
+
+	for (size_t i = 0; i < p->n_crtcs; ++i) {
+		if (p->crtcs[i].fields == CRTC_ALL) {
+			state->crtcs[state->n_crtcs++] = p->crtcs[i].crtc;
+		}
+	}
+
+	for (size_t i = 0; i < p->n_fbs; ++i) {
+		if (p->fbs[i].fields == FB_ALL) {
+			state->fbs[state->n_fbs++] = p->fbs[i].fb;
+		}
+	}
+
+	for (size_t i = 0; i < p->n_planes; ++i) {
+		struct plane_entry *entry = &p->planes[i];
+		if (entry->fields != PLANE_ALL) {
+			continue;
+		}
+
+		// Disabled planes print "crtc=(null)"
+		bool found = strcmp(entry->crtc, "(null)") == 0;
+		for (size_t j = 0; !found && j < p->n_crtcs; ++j) {
+			if (strcmp(p->crtcs[j].name, entry->crtc) == 0) {
+				entry->plane.crtc_id = p->crtcs[j].crtc.id;
+				found = true;
+			}
+		}
+		if (found) {
+			state->planes[state->n_planes++] = entry->plane;
+		}
+	}
+
+	return true;
+}
+
+struct debugfs_state *debugfs_state_read(const char *path)
+{
+	FILE *f = fopen(path, "re");
+	if (!f) {
+		return NULL;
+	}
+
+	struct parser p = {0};
+	bool ok = true;
+	char *line = NULL;
+	size_t line_cap = 0;
+	while (ok && getline(&line, &line_cap, f) >= 0) {
+		ok = parse_line(&p, line);
+	}
+	ok = ok && !ferror(f);
+	free(line);
+	fclose(f);
+
+	struct debugfs_state *state = calloc(1, sizeof(*state));
+	if (!state || !ok || !finish(&p, state)) {
+		debugfs_state_destroy(state);
+		state = NULL;
+	}
+
+	free(p.planes);
+	free(p.crtcs);
+	free(p.fbs);
+	return state;
+}
+
+void debugfs_state_destroy(struct debugfs_state *state)
+{
+	if (!state) {
+		return;
+	}
+	free(state->planes);
+	free(state->crtcs);
+	free(state->fbs);
+	free(state);
+}
+
+const struct debugfs_plane *debugfs_get_plane(
+		const struct debugfs_state *state, uint32_t id)
+{
+	for (size_t i = 0; i < state->n_planes; ++i) {
+		if (state->planes[i].id == id) {
+			return &state->planes[i];
+		}
+	}
+	return NULL;
+}
+
+const struct debugfs_crtc *debugfs_get_crtc(
+		const struct debugfs_state *state, uint32_t id)
+{
+	for (size_t i = 0; i < state->n_crtcs; ++i) {
+		if (state->crtcs[i].id == id) {
+			return &state->crtcs[i];
+		}
+	}
+	return NULL;
+}
+
+const struct debugfs_fb *debugfs_get_fb(const struct debugfs_state *state,
+		uint32_t id)
+{
+	for (size_t i = 0; i < state->n_fbs; ++i) {
+		if (state->fbs[i].id == id) {
+			return &state->fbs[i];
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,61 @@
+#ifndef DEBUGFS_H
+#define DEBUGFS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <xf86drmMode.h>
+
+/* Parser for the atomic state the kernel prints to debugfs, in
+ * <debugfs>/dri/<minor>/state. It has the state of every plane and CRTC, and
+ * of the FBs attached to them, in a single read. Only atomic drivers have
+ * it. */
+
+struct debugfs_fb {
+	uint32_t id;
+	uint32_t width, height;
+	uint32_t format;
+	// The state doesn't say whether the FB was created with a modifier
+	uint64_t modifier;
+	uint32_t pitches[4], offsets[4];
+};
+
+struct debugfs_plane {
+	uint32_t id;
+	uint32_t crtc_id; // 0 if disabled
+	uint32_t fb_id; // 0 if none
+	int32_t crtc_x, crtc_y;
+	uint32_t crtc_w, crtc_h;
+	uint32_t src_x, src_y, src_w, src_h; // 16.16 fixed point
+};
+
+struct debugfs_crtc {
+	uint32_t id;
+	bool enable, active;
+	drmModeModeInfo mode; // hskew and vscan aren't in the state
+};
+
+struct debugfs_state {
+	struct debugfs_plane *planes;
+	size_t n_planes;
+	struct debugfs_crtc *crtcs;
+	size_t n_crtcs;
+	struct debugfs_fb *fbs;
+	size_t n_fbs;
+};
+
+/* Returns NULL if the file can't be read. Objects which are missing some of
+ * their fields are left out. */
+struct debugfs_state *debugfs_state_read(const char *path);
+void debugfs_state_destroy(struct debugfs_state *state);
+
+/* These return NULL if the object isn't in the state */
+const struct debugfs_plane *debugfs_get_plane(
+	const struct debugfs_state *state, uint32_t id);
+const struct debugfs_crtc *debugfs_get_crtc(
+	const struct debugfs_state *state, uint32_t id);
+const struct debugfs_fb *debugfs_get_fb(const struct debugfs_state *state,
+	uint32_t id);
+
+#endif
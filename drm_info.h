@@ -1,9 +1,73 @@
 #ifndef DRM_INFO_H
 #define DRM_INFO_H
 
-struct json_object;
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-struct json_object *drm_info(char *paths[]);
-void print_drm(struct json_object *obj);
+struct model_node;
+struct selector;
+struct tree_writer;
+
+struct drm_info_options {
+	// Maximum number of nodes collected concurrently, 0 for no limit
+	int jobs;
+	// Maximum number of objects collected concurrently per node, 0 for the
+	// default
+	int object_jobs;
+	// Milliseconds after which to give up on a node, 0 for no limit
+	int timeout;
+	// Print per-node collection statistics to stderr
+	bool stats;
+	// Fields to collect, NULL for everything
+	const struct selector *sel;
+	// Root of sysfs, e.g. "/sys", to read connectors from when it has all of
+	// the selected fields. NULL to always use ioctls.
+	const char *sysfs_root;
+	// Root of debugfs, e.g. "/sys/kernel/debug", to read the atomic state of
+	// planes and CRTCs from when possible. NULL to always use ioctls.
+	const char *debugfs_root;
+	// Collect the raw contents of blob properties, which are otherwise only
+	// collected for the ones drm_info can decode
+	bool blob_contents;
+};
+
+/* node is only valid until the function returns */
+typedef void (*drm_info_func)(const char *path, const struct model_node *node,
+	void *data);
+
+bool drm_info_stream(char *paths[], const struct drm_info_options *opts,
+	drm_info_func func, void *data);
+/* Calls func for each node of the CBOR documents in buf, as written with -c */
+bool drm_info_load_cbor(const void *buf, size_t len, drm_info_func func,
+	void *data);
+/* Calls func for each node of the JSON documents in buf, as written with -j,
+ * --compact or --dedup */
+bool drm_info_load_json(const void *buf, size_t len, drm_info_func func,
+	void *data);
+
+struct print_options {
+	// Print modifiers which support the same formats together, and the
+	// IN_FORMATS of planes which have the same as an earlier one as a
+	// reference to it
+	bool group_formats;
+};
+
+void print_node(struct tree_writer *w, const char *path,
+	const struct model_node *node, const struct print_options *opts);
+/* Name of a DRM_MODE_CONNECTOR_* type */
+const char *conn_name(uint32_t type);
+
+/* Pretty-prints the records of the NDJSON read from fd, each line being one
+ * or more documents as written with --compact or --dedup, to w in input
+ * order. Up to jobs records are loaded and rendered concurrently, one per CPU
+ * if jobs <= 0. Invalid records are reported and skipped, and make it return
+ * false. */
+bool drm_info_batch(int fd, struct tree_writer *w, int jobs,
+	const struct print_options *opts);
+
+/* Entry point of "drm_info analyze", which prints statistics about the dumps
+ * in the directories or newline-delimited JSON files given as arguments */
+int drm_info_analyze(int argc, char *argv[]);
 
 #endif
@@ -2,56 +2,329 @@
 
 import sys
 import re
+import random
 
 def case_print(f, c, s):
 	f.write('\tcase {}:\n'.format(c))
 	f.write('\t\treturn "{}";\n'.format(s))
 
 info = {
-	'fmt': r'^#define (\w+)\s*(?:\\$\s*)?fourcc_code',
+	'fmt': r'^#define (\w+)\s*(?:\\$\s*)?fourcc_code\(\s*\'(.)\',\s*\'(.)\',\s*\'(.)\',\s*\'(.)\'\s*\)',
 	'basic_pre': r'^#define (I915_FORMAT_MOD_\w+)\b',
 	'basic_post': r'^#define (DRM_FORMAT_MOD_(?:INVALID|LINEAR|SAMSUNG|QCOM|VIVANTE|NVIDIA|BROADCOM|ALLWINNER)\w*)\s',
 }
 
-with open(sys.argv[1], 'r') as f:
+# Layout of the formats we know about: bits per pixel of each plane, with
+# chroma planes counted in chroma samples, horizontal and vertical chroma
+# subsampling, alpha and YUV. The same as the kernel's drm_format_info table,
+# except for formats with blocks of pixels which don't fit a whole number of
+# bits per pixel. Formats which aren't in here only get a name.
+def rgb(bpp, alpha=False):
+	return ((bpp,), 1, 1, alpha, False)
+
+def rgb_a8(bpp):
+	return ((bpp, 8), 1, 1, True, False)
+
+def yuv(bpp, hsub=1, vsub=1, alpha=False):
+	return (bpp, hsub, vsub, alpha, True)
+
+layouts = {
+	'C1': rgb(1), 'C2': rgb(2), 'C4': rgb(4), 'C8': rgb(8),
+	'D1': rgb(1), 'D2': rgb(2), 'D4': rgb(4), 'D8': rgb(8),
+	'R1': rgb(1), 'R2': rgb(2), 'R4': rgb(4), 'R8': rgb(8),
+	'R10': rgb(16), 'R12': rgb(16), 'R16': rgb(16),
+	'RG88': rgb(16), 'GR88': rgb(16),
+	'RG1616': rgb(32), 'GR1616': rgb(32),
+	'RGB332': rgb(8), 'BGR233': rgb(8),
+
+	'XRGB4444': rgb(16), 'XBGR4444': rgb(16),
+	'RGBX4444': rgb(16), 'BGRX4444': rgb(16),
+	'ARGB4444': rgb(16, True), 'ABGR4444': rgb(16, True),
+	'RGBA4444': rgb(16, True), 'BGRA4444': rgb(16, True),
+	'XRGB1555': rgb(16), 'XBGR1555': rgb(16),
+	'RGBX5551': rgb(16), 'BGRX5551': rgb(16),
+	'ARGB1555': rgb(16, True), 'ABGR1555': rgb(16, True),
+	'RGBA5551': rgb(16, True), 'BGRA5551': rgb(16, True),
+	'RGB565': rgb(16), 'BGR565': rgb(16),
+
+	'RGB888': rgb(24), 'BGR888': rgb(24),
+
+	'XRGB8888': rgb(32), 'XBGR8888': rgb(32),
+	'RGBX8888': rgb(32), 'BGRX8888': rgb(32),
+	'ARGB8888': rgb(32, True), 'ABGR8888': rgb(32, True),
+	'RGBA8888': rgb(32, True), 'BGRA8888': rgb(32, True),
+	'XRGB2101010': rgb(32), 'XBGR2101010': rgb(32),
+	'RGBX1010102': rgb(32), 'BGRX1010102': rgb(32),
+	'ARGB2101010': rgb(32, True), 'ABGR2101010': rgb(32, True),
+	'RGBA1010102': rgb(32, True), 'BGRA1010102': rgb(32, True),
+
+	'RGB161616': rgb(48), 'BGR161616': rgb(48),
+	'XRGB16161616': rgb(64), 'XBGR16161616': rgb(64),
+	'ARGB16161616': rgb(64, True), 'ABGR16161616': rgb(64, True),
+	'XRGB16161616F': rgb(64), 'XBGR16161616F': rgb(64),
+	'ARGB16161616F': rgb(64, True), 'ABGR16161616F': rgb(64, True),
+	'AXBXGXRX106106106106': rgb(64, True),
+
+	'RGB565_A8': rgb_a8(16), 'BGR565_A8': rgb_a8(16),
+	'RGB888_A8': rgb_a8(24), 'BGR888_A8': rgb_a8(24),
+	'XRGB8888_A8': rgb_a8(32), 'XBGR8888_A8': rgb_a8(32),
+	'RGBX8888_A8': rgb_a8(32), 'BGRX8888_A8': rgb_a8(32),
+
+	'YUYV': yuv((16,), 2), 'YVYU': yuv((16,), 2),
+	'UYVY': yuv((16,), 2), 'VYUY': yuv((16,), 2),
+	'AYUV': yuv((32,), alpha=True), 'AVUY8888': yuv((32,), alpha=True),
+	'XYUV8888': yuv((32,)), 'XVUY8888': yuv((32,)),
+	'VUY888': yuv((24,)),
+	'Y210': yuv((32,), 2), 'Y212': yuv((32,), 2), 'Y216': yuv((32,), 2),
+	'Y410': yuv((32,), alpha=True), 'Y412': yuv((64,), alpha=True),
+	'Y416': yuv((64,), alpha=True),
+	'XVYU2101010': yuv((32,)), 'XVYU12_16161616': yuv((64,)),
+	'XVYU16161616': yuv((64,)),
+
+	'NV12': yuv((8, 16), 2, 2), 'NV21': yuv((8, 16), 2, 2),
+	'NV16': yuv((8, 16), 2, 1), 'NV61': yuv((8, 16), 2, 1),
+	'NV24': yuv((8, 16)), 'NV42': yuv((8, 16)),
+	'NV15': yuv((10, 20), 2, 2), 'NV20': yuv((10, 20), 2, 1),
+	'NV30': yuv((10, 20)),
+	'P010': yuv((16, 32), 2, 2), 'P012': yuv((16, 32), 2, 2),
+	'P016': yuv((16, 32), 2, 2), 'P210': yuv((16, 32), 2, 1),
+
+	'YUV410': yuv((8, 8, 8), 4, 4), 'YVU410': yuv((8, 8, 8), 4, 4),
+	'YUV411': yuv((8, 8, 8), 4, 1), 'YVU411': yuv((8, 8, 8), 4, 1),
+	'YUV420': yuv((8, 8, 8), 2, 2), 'YVU420': yuv((8, 8, 8), 2, 2),
+	'YUV422': yuv((8, 8, 8), 2, 1), 'YVU422': yuv((8, 8, 8), 2, 1),
+	'YUV444': yuv((8, 8, 8)), 'YVU444': yuv((8, 8, 8)),
+	'Q410': yuv((16, 16, 16)), 'Q401': yuv((16, 16, 16)),
+}
+
+# Both tables are indexed by a multiplicative hash (formats) or a seeded
+# 32-bit FNV-1a (names), keeping the top bits. Parameters are searched for
+# until no two keys share a slot, starting from tables with twice as many
+# slots as keys and growing them if nothing is found. The search is seeded,
+# so the output only depends on the header.
+def find_perfect_hash(keys, hash_func):
+	rng = random.Random(0)
+	bits = max(1, (2 * len(keys) - 1).bit_length())
+	while True:
+		for _ in range(20000):
+			param = rng.getrandbits(32) | 1
+			slots = set()
+			for key in keys:
+				slot = hash_func(key, param) >> (32 - bits)
+				if slot in slots:
+					break
+				slots.add(slot)
+			else:
+				return param, bits
+		bits += 1
+
+def format_hash(fmt, mult):
+	return (fmt * mult) & 0xFFFFFFFF
+
+def name_hash(name, seed):
+	h = seed
+	for c in name.encode():
+		h ^= c
+		h = (h * 16777619) & 0xFFFFFFFF
+	return h
+
+def fourcc(chars):
+	return sum(ord(c) << (8 * i) for i, c in enumerate(chars))
+
+def slot_table(f, ctype, name, keys, hash_func, param, bits):
+	f.write('static const {} {}[{}] = {{\n'.format(ctype, name, 1 << bits))
+	for i, key in enumerate(keys):
+		f.write('\t[{}] = {},\n'.format(hash_func(key, param) >> (32 - bits), i + 1))
+	f.write('};\n\n')
+
+# With --test, writes a program which checks that every name in the tables
+# round-trips through the lookups, against the values of the header's macros
+# rather than the ones computed here
+write_test = sys.argv[1] == '--test'
+header, output = sys.argv[2:4] if write_test else sys.argv[1:3]
+
+with open(header, 'r') as f:
 	data = f.read()
 	for k, v in info.items():
 		info[k] = re.findall(v, data, flags=re.M)
 
-with open(sys.argv[2], 'w') as f:
+formats = [('DRM_FORMAT_INVALID', 0)]
+seen = {0}
+for ident, *chars in info['fmt']:
+	# Aliases would never be found by value, and can't share a slot
+	if fourcc(chars) not in seen:
+		formats.append((ident, fourcc(chars)))
+		seen.add(fourcc(chars))
+values = [value for _, value in formats]
+names = [ident[len('DRM_FORMAT_'):] for ident, _ in formats]
+mods = info['basic_pre'] + info['basic_post']
+
+if write_test:
+	with open(output, 'w') as f:
+		f.write('''\
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <drm_fourcc.h>
+
+#include "tables.h"
+
+static const struct {
+	const char *name;
+	uint32_t format;
+} formats[] = {
+''')
+		for ident, name in zip([ident for ident, _ in formats], names):
+			f.write('\t{{ "{}", {} }},\n'.format(name, ident))
+		f.write('};\n\n')
+
+		f.write('static const struct {\n\tconst char *name;\n\tuint64_t modifier;\n} mods[] = {\n')
+		for ident in mods:
+			f.write('\t{{ "{}", {} }},\n'.format(ident, ident))
+		f.write('''\
+};
+
+int main(void)
+{
+	int ret = EXIT_SUCCESS;
+
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+		const struct format_info *info = format_info_from_str(formats[i].name);
+		if (!info || info->format != formats[i].format) {
+			fprintf(stderr, "format_info_from_str(\\"%s\\") is wrong\\n",
+				formats[i].name);
+			ret = EXIT_FAILURE;
+		}
+		if (strcmp(format_str(formats[i].format), formats[i].name) != 0) {
+			fprintf(stderr, "format_str(0x%08x) isn't %s\\n",
+				formats[i].format, formats[i].name);
+			ret = EXIT_FAILURE;
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(mods) / sizeof(mods[0]); ++i) {
+		uint64_t mod;
+		if (!basic_modifier_from_str(mods[i].name, &mod) ||
+				mod != mods[i].modifier) {
+			fprintf(stderr, "basic_modifier_from_str(\\"%s\\") is wrong\\n",
+				mods[i].name);
+			ret = EXIT_FAILURE;
+		}
+		if (strcmp(basic_modifier_str(mods[i].modifier), mods[i].name) != 0) {
+			fprintf(stderr, "basic_modifier_str() of %s is wrong\\n",
+				mods[i].name);
+			ret = EXIT_FAILURE;
+		}
+	}
+
+	return ret;
+}
+''')
+	sys.exit(0)
+
+fmt_mult, fmt_bits = find_perfect_hash(values, format_hash)
+name_seed, name_bits = find_perfect_hash(names, name_hash)
+mod_seed, mod_bits = find_perfect_hash(mods, name_hash)
+
+with open(output, 'w') as f:
 	f.write('''\
 #include <stdint.h>
+#include <string.h>
 #include <drm_fourcc.h>
 
 #include "tables.h"
 
-const char *format_str(uint32_t format)
-{
-	switch (format) {
-	case DRM_FORMAT_INVALID:
-		return "INVALID";
 ''')
 
-	for ident in info['fmt']:
-		case_print(f, ident, ident[len('DRM_FORMAT_'):])
+	# The hash tables are built from fourccs computed from the arguments of
+	# fourcc_code(), which have to match what the compiler makes of them
+	for ident, *chars in info['fmt']:
+		f.write('_Static_assert({} == 0x{:08x}u, "{}");\n'.format(
+			ident, fourcc(chars), ident))
+	f.write('\n')
+
+	f.write('static const struct format_info formats[] = {\n')
+	for (ident, _), name in zip(formats, names):
+		layout = layouts.get(name)
+		if not layout:
+			f.write('\t{{ .format = {}, .name = "{}" }},\n'.format(ident, name))
+			continue
+		bpp, hsub, vsub, alpha, is_yuv = layout
+		f.write('\t{{ {}, "{}", {}, {{ {} }}, {}, {}, {}, {} }},\n'.format(
+			ident, name, len(bpp), ', '.join(map(str, bpp)), hsub, vsub,
+			'true' if alpha else 'false', 'true' if is_yuv else 'false'))
+	f.write('};\n\n')
+
+	f.write('static const struct {\n\tconst char *name;\n\tuint64_t modifier;\n} mods[] = {\n')
+	for ident in mods:
+		f.write('\t{{ "{}", {} }},\n'.format(ident, ident))
+	f.write('};\n\n')
+
+	f.write('/* Slots hold indices + 1 into the arrays above, 0 when empty */\n')
+	slot_table(f, 'uint16_t', 'format_slots', values, format_hash,
+		fmt_mult, fmt_bits)
+	slot_table(f, 'uint16_t', 'format_name_slots', names, name_hash,
+		name_seed, name_bits)
+	slot_table(f, 'uint16_t', 'mod_name_slots', mods, name_hash,
+		mod_seed, mod_bits)
 
 	f.write('''\
-	default:
-		return "Unknown";
-	}
-}
+static uint32_t name_hash(const char *name, uint32_t seed)
+{{
+	uint32_t hash = seed;
+	for (const char *c = name; *c; ++c) {{
+		hash ^= (unsigned char)*c;
+		hash *= 16777619;
+	}}
+	return hash;
+}}
+
+const struct format_info *format_info_get(uint32_t format)
+{{
+	uint16_t i = format_slots[(uint32_t)(format * {mult}u) >> {fmt_shift}];
+	if (i == 0 || formats[i - 1].format != format) {{
+		return NULL;
+	}}
+	return &formats[i - 1];
+}}
+
+const char *format_str(uint32_t format)
+{{
+	const struct format_info *info = format_info_get(format);
+	return info ? info->name : "Unknown";
+}}
+
+const struct format_info *format_info_from_str(const char *name)
+{{
+	uint16_t i = format_name_slots[name_hash(name, {name_seed}u) >> {name_shift}];
+	if (i == 0 || strcmp(formats[i - 1].name, name) != 0) {{
+		return NULL;
+	}}
+	return &formats[i - 1];
+}}
 
 const char *basic_modifier_str(uint64_t modifier)
-{
-	switch (modifier) {
-''')
+{{
+	switch (modifier) {{
+'''.format(mult=fmt_mult, fmt_shift=32 - fmt_bits,
+		name_seed=name_seed, name_shift=32 - name_bits))
 
-	for ident in info['basic_pre'] + info['basic_post']:
+	for ident in mods:
 		case_print(f, ident, ident)
 
 	f.write('''\
 	default:
 		return "Unknown";
-	}
-}
-''')
+	}}
+}}
+
+bool basic_modifier_from_str(const char *name, uint64_t *modifier)
+{{
+	uint16_t i = mod_name_slots[name_hash(name, {mod_seed}u) >> {mod_shift}];
+	if (i == 0 || strcmp(mods[i - 1].name, name) != 0) {{
+		return false;
+	}}
+	*modifier = mods[i - 1].modifier;
+	return true;
+}}
+'''.format(mod_seed=mod_seed, mod_shift=32 - mod_bits))
@@ -0,0 +1,186 @@
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "drm_info.h"
+#include "input.h"
+
+#define LINE_READER_READ_SIZE (1024 * 1024)
+
+/* Reads all of fd */
+static void *read_input(int fd, const char *path, size_t *len)
+{
+	size_t cap = 64 * 1024;
+	char *buf = malloc(cap);
+	*len = 0;
+	while (buf) {
+		if (*len == cap) {
+			cap *= 2;
+			char *new_buf = realloc(buf, cap);
+			if (!new_buf) {
+				perror("realloc");
+				free(buf);
+				buf = NULL;
+				break;
+			}
+			buf = new_buf;
+		}
+
+		ssize_t n = read(fd, buf + *len, cap - *len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		} else if (n < 0) {
+			perror(path);
+			free(buf);
+			buf = NULL;
+			break;
+		} else if (n == 0) {
+			break;
+		}
+		*len += n;
+	}
+	return buf;
+}
+
+bool input_open(struct input *in, const char *path)
+{
+	int fd = STDIN_FILENO;
+	if (strcmp(path, "-") != 0) {
+		fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			perror(path);
+			return false;
+		}
+	}
+
+	struct stat st;
+	in->mapped = false;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+			(uintmax_t)st.st_size <= SIZE_MAX) {
+		in->len = st.st_size;
+		in->buf = mmap(NULL, in->len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (in->buf != MAP_FAILED) {
+			// Documents are only read once, from start to end
+			posix_madvise(in->buf, in->len, POSIX_MADV_SEQUENTIAL);
+			in->mapped = true;
+		}
+	}
+	if (!in->mapped) {
+		in->buf = read_input(fd, path, &in->len);
+	}
+
+	if (fd != STDIN_FILENO) {
+		close(fd);
+	}
+	return in->buf != NULL;
+}
+
+void input_close(struct input *in)
+{
+	if (in->mapped) {
+		munmap(in->buf, in->len);
+	} else {
+		free(in->buf);
+	}
+}
+
+bool input_load(const void *buf, size_t len, drm_info_func func, void *data)
+{
+	const char *str = buf;
+	size_t i = 0;
+	while (i < len && isspace((unsigned char)str[i])) {
+		++i;
+	}
+	if (i < len && str[i] == '{') {
+		return drm_info_load_json(buf, len, func, data);
+	}
+	return drm_info_load_cbor(buf, len, func, data);
+}
+
+void line_reader_init(struct line_reader *r, int fd)
+{
+	*r = (struct line_reader){ .fd = fd };
+}
+
+void line_reader_finish(struct line_reader *r)
+{
+	free(r->buf);
+	r->buf = NULL;
+}
+
+/* Reads more of the file, keeping what hasn't been consumed yet */
+static bool read_more(struct line_reader *r)
+{
+	if (r->pos > 0) {
+		memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+	}
+	r->len -= r->pos;
+	r->scan -= r->pos;
+	r->pos = 0;
+
+	if (r->cap - r->len < LINE_READER_READ_SIZE) {
+		size_t cap = r->cap ? 2 * r->cap : LINE_READER_READ_SIZE;
+		while (cap - r->len < LINE_READER_READ_SIZE) {
+			cap *= 2;
+		}
+		char *buf = realloc(r->buf, cap);
+		if (!buf) {
+			perror("realloc");
+			return false;
+		}
+		r->buf = buf;
+		r->cap = cap;
+	}
+
+	while (1) {
+		ssize_t n = read(r->fd, r->buf + r->len, r->cap - r->len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		} else if (n < 0) {
+			perror("read");
+			return false;
+		}
+		r->eof = n == 0;
+		r->len += n;
+		return true;
+	}
+}
+
+bool line_reader_next(struct line_reader *r, struct line *lines, size_t max,
+		size_t *n)
+{
+	*n = 0;
+
+	// Make sure that max lines past pos are complete, unless the file ends
+	// first
+	size_t complete = 0;
+	r->scan = r->pos;
+	while (complete < max) {
+		const char *nl = r->scan < r->len ?
+			memchr(r->buf + r->scan, '\n', r->len - r->scan) : NULL;
+		if (nl) {
+			r->scan = nl - r->buf + 1;
+			++complete;
+		} else if (r->eof) {
+			break;
+		} else if (!read_more(r)) {
+			return false;
+		}
+	}
+
+	while (*n < max && r->pos < r->len) {
+		const char *str = r->buf + r->pos;
+		const char *nl = memchr(str, '\n', r->len - r->pos);
+		size_t len = nl ? (size_t)(nl - str) : r->len - r->pos;
+		lines[(*n)++] = (struct line){ str, len, ++r->line_no };
+		r->pos += nl ? len + 1 : len;
+	}
+	return true;
+}
@@ -0,0 +1,47 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "drm_info.h"
+
+/* Whole contents of a file */
+struct input {
+	void *buf;
+	size_t len;
+	bool mapped;
+};
+
+/* Maps path, or stdin for "-". Pipes and other files which can't be mapped
+ * are read instead. */
+bool input_open(struct input *in, const char *path);
+void input_close(struct input *in);
+/* Loads JSON or CBOR, depending on what buf looks like */
+bool input_load(const void *buf, size_t len, drm_info_func func, void *data);
+
+struct line {
+	const char *str; // Without the newline
+	size_t len;
+	size_t line_no; // From 1
+};
+
+/* Reads a file a batch of lines at a time, for newline-delimited JSON. Only
+ * the current batch is kept in memory. */
+struct line_reader {
+	int fd;
+	bool eof;
+	char *buf;
+	// Lines start at pos, the ones before scan are complete
+	size_t len, cap, pos, scan;
+	size_t line_no;
+};
+
+void line_reader_init(struct line_reader *r, int fd);
+void line_reader_finish(struct line_reader *r);
+/* Reads up to max lines, the last one may not end with a newline. They're
+ * valid until the next call. Sets *n to 0 at the end of the file. */
+bool line_reader_next(struct line_reader *r, struct line *lines, size_t max,
+	size_t *n);
+
+#endif
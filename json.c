@@ -2,19 +2,34 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/utsname.h>
+#include <time.h>
 #include <unistd.h>
 
-#include <json_object.h>
+#include <drm_fourcc.h>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
+#include "arena.h"
+#include "debugfs.h"
 #include "drm_info.h"
+#include "kms.h"
+#include "model.h"
+#include "pool.h"
+#include "props.h"
+#include "selector.h"
+#include "sysfs.h"
+
+#define DEFAULT_OBJECT_JOBS 4
+/* How long nodes which timed out get to finish once everything else was
+ * reported, so that they can be freed */
+#define ABANDON_GRACE_MS 500
 
 static const struct {
 	const char *name;
@@ -47,721 +62,2011 @@ static const struct {
 	{ "SYNCOBJ_TIMELINE", DRM_CAP_SYNCOBJ_TIMELINE },
 };
 
-static struct json_object *kernel_info(void)
+/* Open-addressing hash table of property definitions, keyed by ID */
+struct prop_cache {
+	struct model_prop_def **defs;
+	size_t len, cap;
+};
+
+/* Blob contents and the decoded blob, unless there's no decoder or the
+ * contents aren't valid, shared by every blob ID with the same contents */
+struct blob_data {
+	blob_decoder decode;
+	uint64_t hash;
+	size_t len;
+	void *data;
+	bool decoded;
+	struct model_blob blob;
+};
+
+struct blob_ref {
+	uint32_t id;
+	blob_decoder decode;
+	struct blob_data *data;
+};
+
+/* Blobs are looked up by ID first, to skip the ioctl for blobs we've already
+ * seen, then by contents, so that e.g. identical IN_FORMATS blobs of
+ * different planes are only decoded and stored once. Both tables use open
+ * addressing. */
+struct blob_cache {
+	struct blob_ref *refs;
+	size_t refs_len, refs_cap;
+
+	struct blob_data **datas;
+	size_t datas_len, datas_cap;
+};
+
+struct kms_slot {
+	struct kms kms;
+	struct kms_slot *next;
+};
+
+/* State shared by every object collected from a node */
+struct node_cache {
+	pthread_mutex_t lock;
+	// Property definitions and decoded blobs, which outlive the objects
+	// they were first collected for. Protected by the lock.
+	struct arena arena;
+	struct prop_cache props;
+	struct blob_cache blobs;
+	// Scratch buffers aren't thread-safe, so each object being collected
+	// takes one from this list and puts it back when done
+	struct kms_slot *free_kms;
+};
+
+struct node_stats {
+	unsigned int ioctls;
+	unsigned int prop_lookups;
+	unsigned int props_fetched;
+	unsigned int blobs_fetched;
+	unsigned int blobs_decoded;
+};
+
+enum object_section {
+	OBJECTS_CONNECTORS,
+	OBJECTS_ENCODERS,
+	OBJECTS_CRTCS,
+	OBJECTS_PLANES,
+	OBJECTS_COUNT,
+};
+
+enum node_state {
+	NODE_PENDING,
+	NODE_RUNNING,
+	NODE_DONE,
+	NODE_TIMED_OUT,
+};
+
+/* Signalled by nodes when they finish */
+struct node_waiter {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+/* Collection context, for a whole node or a single object of it */
+struct node {
+	const char *path;
+	int fd;
+	// Maximum number of objects collected concurrently
+	int jobs;
+	// Fields to collect, for the node or object
+	const struct selector *sel;
+	// Root of sysfs to read connectors from, NULL to only use ioctls
+	const char *sysfs_root;
+	// Root of debugfs to read the atomic state from, NULL to only use ioctls
+	const char *debugfs_root;
+	// Collect the contents of every blob property
+	bool blob_contents;
+	// Atomic state read from debugfs, NULL if it isn't available
+	struct debugfs_state *atomic_state;
+
+	// Errors are buffered per node, so that nodes collected concurrently
+	// don't interleave their messages on stderr. Written with the cache
+	// lock held.
+	FILE *err;
+	char *err_buf;
+	size_t err_len;
+	// Copy of the errors up to the deadline, if the node timed out
+	char *timeout_err;
+	size_t timeout_err_len;
+
+	struct node_cache *cache;
+	struct kms *kms;
+	struct node_stats stats;
+
+	// Everything collected by this context is allocated from here
+	struct arena arena;
+	// The collected node or object, e.g. a struct model_plane
+	void *obj;
+
+	// Only used for whole nodes, see collect_nodes().
+	// Sections collected so far, see node_publish():
+	struct model_node model;
+	// Holds the result, and everything it refers to once the node is done.
+	// Only used by node_result() until then.
+	struct arena result;
+	// Protected by the cache lock:
+	struct model_node published;
+	struct object *objects;
+	size_t n_objects[OBJECTS_COUNT];
+	bool no_planes;
+	bool sysfs_connectors;
+	bool ok, abandoned, finishing;
+	// Protected by the waiter lock:
+	struct node_waiter *waiter;
+	bool done;
+	// Only used by collect_nodes():
+	enum node_state state;
+	struct timespec deadline;
+};
+
+static void node_perror(struct node *node, const char *msg)
 {
-	struct utsname utsname;
-	if (uname(&utsname) != 0) {
-		perror("uname");
-		return NULL;
+	char buf[256];
+	if (strerror_r(errno, buf, sizeof(buf)) != 0) {
+		snprintf(buf, sizeof(buf), "Unknown error %d", errno);
 	}
 
-	struct json_object *obj = json_object_new_object();
-	json_object_object_add(obj, "sysname",
-		json_object_new_string(utsname.sysname));
-	json_object_object_add(obj, "release",
-		json_object_new_string(utsname.release));
-	json_object_object_add(obj, "version",
-		json_object_new_string(utsname.version));
-	return obj;
+	pthread_mutex_lock(&node->cache->lock);
+	fprintf(node->err, "%s: %s\n", msg, buf);
+	// Keeps err_buf up to date, for node_abandon()
+	fflush(node->err);
+	pthread_mutex_unlock(&node->cache->lock);
 }
 
-static struct json_object *driver_info(int fd)
+static void *calloc_or_abort(size_t n, size_t size)
 {
-	drmVersion *ver = drmGetVersion(fd);
-	if (!ver) {
-		perror("drmGetVersion");
+	void *ptr = calloc(n, size);
+	if (!ptr) {
+		perror("calloc");
+		abort();
+	}
+	return ptr;
+}
+
+/* Knuth's multiplicative hash, for tables keyed by DRM object IDs */
+static uint32_t id_hash(uint32_t id)
+{
+	return id * 2654435761u;
+}
+
+static struct model_kernel *kernel_info(struct node *node)
+{
+	struct utsname utsname;
+	if (uname(&utsname) != 0) {
+		node_perror(node, "uname");
 		return NULL;
 	}
 
-	struct json_object *obj = json_object_new_object();
+	struct model_kernel *kernel = arena_alloc(&node->arena, sizeof(*kernel));
+	kernel->sysname = arena_strdup(&node->arena, utsname.sysname);
+	kernel->release = arena_strdup(&node->arena, utsname.release);
+	kernel->version = arena_strdup(&node->arena, utsname.version);
+	return kernel;
+}
 
-	json_object_object_add(obj, "name", json_object_new_string(ver->name));
-	json_object_object_add(obj, "desc", json_object_new_string(ver->desc));
+/* Client capabilities change which objects and properties are exposed, so
+ * they're always enabled, even if they aren't selected */
+static struct model_cap *client_caps_info(struct node *node)
+{
+	size_t n = sizeof(client_caps) / sizeof(client_caps[0]);
+	struct model_cap *result = arena_alloc(&node->arena, n * sizeof(*result));
+	for (size_t i = 0; i < n; ++i) {
+		result[i].name = client_caps[i].name;
+		result[i].supported =
+			drmSetClientCap(node->fd, client_caps[i].cap, 1) == 0;
+		node->stats.ioctls += 1;
+	}
+	return result;
+}
 
-	struct json_object *ver_obj = json_object_new_object();
-	json_object_object_add(ver_obj, "major",
-		json_object_new_int(ver->version_major));
-	json_object_object_add(ver_obj, "minor",
-		json_object_new_int(ver->version_minor));
-	json_object_object_add(ver_obj, "patch",
-		json_object_new_int(ver->version_patchlevel));
-	json_object_object_add(ver_obj, "date",
-		json_object_new_string(ver->date));
-	json_object_object_add(obj, "version", ver_obj);
+static struct model_driver *driver_info(struct node *node,
+		const struct selector *sel, struct model_cap *node_client_caps)
+{
+	struct model_driver *driver = arena_alloc(&node->arena, sizeof(*driver));
+
+	if (selector_has(sel, "name") || selector_has(sel, "desc") ||
+			selector_has(sel, "version")) {
+		drmVersion *ver = drmGetVersion(node->fd);
+		node->stats.ioctls += 2;
+		if (!ver) {
+			node_perror(node, "drmGetVersion");
+			return NULL;
+		}
 
-	drmFreeVersion(ver);
+		driver->name = arena_strdup(&node->arena, ver->name);
+		driver->desc = arena_strdup(&node->arena, ver->desc);
+		driver->version.major = ver->version_major;
+		driver->version.minor = ver->version_minor;
+		driver->version.patch = ver->version_patchlevel;
+		driver->version.date = arena_strdup(&node->arena, ver->date);
 
-	json_object_object_add(obj, "kernel", kernel_info());
+		drmFreeVersion(ver);
+	}
 
-	struct json_object *client_caps_obj = json_object_new_object();
-	for (size_t i = 0; i < sizeof(client_caps) / sizeof(client_caps[0]); ++i) {
-		bool supported = drmSetClientCap(fd, client_caps[i].cap, 1) == 0;
-		json_object_object_add(client_caps_obj, client_caps[i].name,
-			json_object_new_boolean(supported));
+	if (selector_has(sel, "kernel")) {
+		driver->kernel = kernel_info(node);
 	}
-	json_object_object_add(obj, "client_caps", client_caps_obj);
 
-	struct json_object *caps_obj = json_object_new_object();
-	for (size_t i = 0; i < sizeof(caps) / sizeof(caps[0]); ++i) {
-		struct json_object *cap_obj = NULL;
-		uint64_t cap;
-		if (drmGetCap(fd, caps[i].cap, &cap) == 0) {
-			cap_obj = json_object_new_uint64(cap);
+	driver->client_caps = node_client_caps;
+	driver->n_client_caps = sizeof(client_caps) / sizeof(client_caps[0]);
+
+	if (selector_has(sel, "caps")) {
+		driver->n_caps = sizeof(caps) / sizeof(caps[0]);
+		driver->caps = arena_alloc(&node->arena,
+			driver->n_caps * sizeof(*driver->caps));
+		for (size_t i = 0; i < driver->n_caps; ++i) {
+			struct model_cap *cap = &driver->caps[i];
+			cap->name = caps[i].name;
+			node->stats.ioctls += 1;
+			cap->supported =
+				drmGetCap(node->fd, caps[i].cap, &cap->value) == 0;
 		}
-		json_object_object_add(caps_obj, caps[i].name, cap_obj);
 	}
-	json_object_object_add(obj, "caps", caps_obj);
 
-	return obj;
+	return driver;
 }
 
-static struct json_object *device_info(int fd)
+static struct model_device *device_info(struct node *node)
 {
 	drmDevice *dev;
-	if (drmGetDevice(fd, &dev) != 0) {
-		perror("drmGetDevice");
+	if (drmGetDevice(node->fd, &dev) != 0) {
+		node_perror(node, "drmGetDevice");
 		return NULL;
 	}
 
-	struct json_object *obj = json_object_new_object();
-	json_object_object_add(obj, "available_nodes",
-		json_object_new_uint64(dev->available_nodes));
-	json_object_object_add(obj, "bus_type",
-		json_object_new_uint64(dev->bustype));
+	struct model_device *device = arena_alloc(&node->arena, sizeof(*device));
+	device->available_nodes = dev->available_nodes;
+	device->bus_type = dev->bustype;
 
-	struct json_object *device_data_obj = NULL;
 	switch (dev->bustype) {
 	case DRM_BUS_PCI:;
 		drmPciDeviceInfo *pci = dev->deviceinfo.pci;
-		device_data_obj = json_object_new_object();
-		json_object_object_add(device_data_obj, "vendor",
-			json_object_new_uint64(pci->vendor_id));
-		json_object_object_add(device_data_obj, "device",
-			json_object_new_uint64(pci->device_id));
-		json_object_object_add(device_data_obj, "subsystem_vendor",
-			json_object_new_uint64(pci->subvendor_id));
-		json_object_object_add(device_data_obj, "subsystem_device",
-			json_object_new_uint64(pci->subdevice_id));
+		device->data.pci.vendor = pci->vendor_id;
+		device->data.pci.device = pci->device_id;
+		device->data.pci.subsystem_vendor = pci->subvendor_id;
+		device->data.pci.subsystem_device = pci->subdevice_id;
 		break;
 	case DRM_BUS_USB:;
 		drmUsbDeviceInfo *usb = dev->deviceinfo.usb;
-		device_data_obj = json_object_new_object();
-		json_object_object_add(device_data_obj, "vendor",
-			json_object_new_uint64(usb->vendor));
-		json_object_object_add(device_data_obj, "product",
-			json_object_new_uint64(usb->product));
+		device->data.usb.vendor = usb->vendor;
+		device->data.usb.product = usb->product;
 		break;
 	case DRM_BUS_PLATFORM:;
 		drmPlatformDeviceInfo *platform = dev->deviceinfo.platform;
-		device_data_obj = json_object_new_object();
-		struct json_object *compatible_arr = json_object_new_array();
-		for (size_t i = 0; platform->compatible[i]; ++i)
-			json_object_array_add(compatible_arr,
-				json_object_new_string(platform->compatible[i]));
-		json_object_object_add(device_data_obj, "compatible", compatible_arr);
+		size_t n = 0;
+		while (platform->compatible[n])
+			++n;
+		char **compatible = arena_alloc(&node->arena,
+			n * sizeof(*compatible));
+		for (size_t i = 0; i < n; ++i) {
+			compatible[i] = arena_strdup(&node->arena,
+				platform->compatible[i]);
+		}
+		device->data.platform.compatible = compatible;
+		device->data.platform.n_compatible = n;
 		break;
 	}
-	json_object_object_add(obj, "device_data", device_data_obj);
 
 	drmFreeDevice(&dev);
 
-	return obj;
+	return device;
 }
 
-static struct json_object *in_formats_info(int fd, uint32_t blob_id)
+/* 64-bit FNV-1a */
+static uint64_t blob_hash(const void *data, size_t len)
 {
-	struct json_object *arr = json_object_new_array();
-
-	drmModePropertyBlobRes *blob = drmModeGetPropertyBlob(fd, blob_id);
-	if (!blob) {
-		perror("drmModeGetPropertyBlob");
-		return NULL;
+	const unsigned char *p = data;
+	uint64_t hash = 0xcbf29ce484222325;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= p[i];
+		hash *= 0x100000001b3;
 	}
-
-	struct drm_format_modifier_blob *data = blob->data;
-
-	uint32_t *fmts = (uint32_t *)
-		((char *)data + data->formats_offset);
-
-	struct drm_format_modifier *mods = (struct drm_format_modifier *)
-		((char *)data + data->modifiers_offset);
-
-	for (uint32_t i = 0; i < data->count_modifiers; ++i) {
-		struct json_object *mod_obj = json_object_new_object();
-		json_object_object_add(mod_obj, "modifier",
-			json_object_new_uint64(mods[i].modifier));
-
-		struct json_object *fmts_arr = json_object_new_array();
-		for (uint64_t j = 0; j < 64; ++j) {
-			if (mods[i].formats & (1ull << j)) {
-				uint32_t fmt = fmts[j + mods[i].offset];
-				json_object_array_add(fmts_arr, json_object_new_uint64(fmt));
-			}
+	return hash;
+}
+static void blob_refs_insert(struct blob_cache *cache, struct blob_ref ref)
+{
+	if ((cache->refs_len + 1) * 2 > cache->refs_cap) {
+		size_t cap = cache->refs_cap ? cache->refs_cap * 2 : 32;
+		struct blob_ref *refs = calloc_or_abort(cap, sizeof(*refs));
+		for (size_t i = 0; i < cache->refs_cap; ++i) {
+			if (!cache->refs[i].id)
+				continue;
+			size_t j = id_hash(cache->refs[i].id) & (cap - 1);
+			while (refs[j].id)
+				j = (j + 1) & (cap - 1);
+			refs[j] = cache->refs[i];
 		}
-		json_object_object_add(mod_obj, "formats", fmts_arr);
-
-		json_object_array_add(arr, mod_obj);
+		free(cache->refs);
+		cache->refs = refs;
+		cache->refs_cap = cap;
 	}
 
-	drmModeFreePropertyBlob(blob);
-
-	return arr;
+	size_t mask = cache->refs_cap - 1;
+	size_t i = id_hash(ref.id) & mask;
+	while (cache->refs[i].id)
+		i = (i + 1) & mask;
+	cache->refs[i] = ref;
+	++cache->refs_len;
 }
 
-static struct json_object *mode_info(const drmModeModeInfo *mode)
+static void blob_datas_insert(struct blob_cache *cache, struct blob_data *data)
 {
-	struct json_object *obj = json_object_new_object();
-
-	json_object_object_add(obj, "clock", json_object_new_uint64(mode->clock));
-
-	json_object_object_add(obj, "hdisplay", json_object_new_uint64(mode->hdisplay));
-	json_object_object_add(obj, "hsync_start", json_object_new_uint64(mode->hsync_start));
-	json_object_object_add(obj, "hsync_end", json_object_new_uint64(mode->hsync_end));
-	json_object_object_add(obj, "htotal", json_object_new_uint64(mode->htotal));
-	json_object_object_add(obj, "hskew", json_object_new_uint64(mode->hskew));
-
-	json_object_object_add(obj, "vdisplay", json_object_new_uint64(mode->vdisplay));
-	json_object_object_add(obj, "vsync_start", json_object_new_uint64(mode->vsync_start));
-	json_object_object_add(obj, "vsync_end", json_object_new_uint64(mode->vsync_end));
-	json_object_object_add(obj, "vtotal", json_object_new_uint64(mode->vtotal));
-	json_object_object_add(obj, "vscan", json_object_new_uint64(mode->vscan));
-
-	json_object_object_add(obj, "vrefresh", json_object_new_uint64(mode->vrefresh));
-
-	json_object_object_add(obj, "flags", json_object_new_uint64(mode->flags));
-	json_object_object_add(obj, "type", json_object_new_uint64(mode->type));
-	json_object_object_add(obj, "name", json_object_new_string(mode->name));
+	if ((cache->datas_len + 1) * 2 > cache->datas_cap) {
+		size_t cap = cache->datas_cap ? cache->datas_cap * 2 : 32;
+		struct blob_data **datas = calloc_or_abort(cap, sizeof(*datas));
+		for (size_t i = 0; i < cache->datas_cap; ++i) {
+			if (!cache->datas[i])
+				continue;
+			size_t j = cache->datas[i]->hash & (cap - 1);
+			while (datas[j])
+				j = (j + 1) & (cap - 1);
+			datas[j] = cache->datas[i];
+		}
+		free(cache->datas);
+		cache->datas = datas;
+		cache->datas_cap = cap;
+	}
 
-	return obj;
+	size_t mask = cache->datas_cap - 1;
+	size_t i = data->hash & mask;
+	while (cache->datas[i])
+		i = (i + 1) & mask;
+	cache->datas[i] = data;
+	++cache->datas_len;
 }
 
-static struct json_object *mode_id_info(int fd, uint32_t blob_id)
+static struct blob_data *blob_datas_find(struct blob_cache *cache,
+		blob_decoder decode, uint64_t hash, const void *data, size_t len)
 {
-	drmModePropertyBlobRes *blob = drmModeGetPropertyBlob(fd, blob_id);
-	if (!blob) {
-		perror("drmModeGetPropertyBlob");
+	if (cache->datas_cap == 0) {
 		return NULL;
 	}
 
-	drmModeModeInfo *mode = blob->data;
-
-	struct json_object *obj = mode_info(mode);
+	size_t mask = cache->datas_cap - 1;
+	for (size_t i = hash & mask; cache->datas[i]; i = (i + 1) & mask) {
+		struct blob_data *d = cache->datas[i];
+		if (d->hash == hash && d->decode == decode && d->len == len &&
+				memcmp(d->data, data, len) == 0) {
+			return d;
+		}
+	}
+	return NULL;
+}
 
-	drmModeFreePropertyBlob(blob);
+static struct blob_ref *blob_refs_find(struct blob_cache *cache,
+		uint32_t blob_id, blob_decoder decode)
+{
+	if (cache->refs_cap == 0) {
+		return NULL;
+	}
 
-	return obj;
+	size_t mask = cache->refs_cap - 1;
+	for (size_t i = id_hash(blob_id) & mask; cache->refs[i].id;
+			i = (i + 1) & mask) {
+		struct blob_ref *ref = &cache->refs[i];
+		if (ref->id == blob_id && ref->decode == decode) {
+			return ref;
+		}
+	}
+	return NULL;
 }
 
-static struct json_object *writeback_pixel_formats_info(int fd, uint32_t blob_id)
+/* Returns the blob contents, decoded with decode unless it's NULL. They're
+ * shared and must not be modified. */
+static const struct blob_data *blob_info(struct node *node, uint32_t blob_id,
+		blob_decoder decode)
 {
-	struct json_object *arr = json_object_new_array();
+	struct blob_cache *cache = &node->cache->blobs;
+
+	// Refs move when the table grows, the data they point to doesn't
+	pthread_mutex_lock(&node->cache->lock);
+	struct blob_ref *ref = blob_refs_find(cache, blob_id, decode);
+	struct blob_data *cached = ref ? ref->data : NULL;
+	pthread_mutex_unlock(&node->cache->lock);
+	if (cached) {
+		return cached;
+	}
 
-	drmModePropertyBlobRes *blob = drmModeGetPropertyBlob(fd, blob_id);
+	drmModePropertyBlobRes *blob = kms_get_blob(node->kms, blob_id);
 	if (!blob) {
-		perror("drmModeGetPropertyBlob");
+		node_perror(node, "drmModeGetPropertyBlob");
 		return NULL;
 	}
+	++node->stats.blobs_fetched;
+
+	uint64_t hash = blob_hash(blob->data, blob->length);
+
+	// Decoding is cheap compared to the ioctl, so do it with the lock held
+	// rather than racing other objects to insert the same blob
+	pthread_mutex_lock(&node->cache->lock);
+
+	struct blob_data *data =
+		blob_datas_find(cache, decode, hash, blob->data, blob->length);
+	if (!data) {
+		struct arena *arena = &node->cache->arena;
+		data = arena_alloc(arena, sizeof(*data));
+		data->decode = decode;
+		data->hash = hash;
+		data->len = blob->length;
+		data->data = arena_memdup(arena, blob->data, blob->length);
+		if (decode) {
+			data->decoded = decode(&data->blob, arena, data->data,
+				data->len);
+			++node->stats.blobs_decoded;
+		}
+		blob_datas_insert(cache, data);
+	}
 
-	uint32_t *fmts = blob->data;
-	uint32_t fmts_len = blob->length / sizeof(uint32_t);
-	for (uint32_t i = 0; i < fmts_len; ++i) {
-		json_object_array_add(arr, json_object_new_uint64(fmts[i]));
+	if (!blob_refs_find(cache, blob_id, decode)) {
+		blob_refs_insert(cache, (struct blob_ref){
+			.id = blob_id,
+			.decode = decode,
+			.data = data,
+		});
 	}
 
-	drmModeFreePropertyBlob(blob);
+	pthread_mutex_unlock(&node->cache->lock);
+
+	kms_free_blob(node->kms, blob);
 
-	return arr;
+	return data;
 }
 
-static struct json_object *path_info(int fd, uint32_t blob_id)
+/* Blobs themselves are in the cache's arena */
+static void blob_cache_finish(struct blob_cache *cache)
 {
-	drmModePropertyBlobRes *blob = drmModeGetPropertyBlob(fd, blob_id);
-	if (!blob) {
-		perror("drmModeGetPropertyBlob");
-		return NULL;
-	}
+	free(cache->datas);
+	free(cache->refs);
+}
 
-	struct json_object *obj = json_object_new_string_len(blob->data, blob->length);
+static struct model_fb *fb_info(struct node *node, uint32_t id)
+{
+	const struct debugfs_fb *state_fb = node->atomic_state ?
+		debugfs_get_fb(node->atomic_state, id) : NULL;
+	if (state_fb) {
+		struct model_fb *fb = arena_alloc(&node->arena, sizeof(*fb));
+		fb->id = state_fb->id;
+		fb->width = state_fb->width;
+		fb->height = state_fb->height;
+
+		// Whether the FB was created with a modifier isn't in the state,
+		// assume it wasn't if it's linear
+		fb->has_format = true;
+		fb->format = state_fb->format;
+		fb->has_modifier = state_fb->modifier != DRM_FORMAT_MOD_LINEAR;
+		fb->modifier = state_fb->modifier;
+
+		for (size_t i = 0; i < sizeof(state_fb->pitches) / sizeof(state_fb->pitches[0]); i++) {
+			if (!state_fb->pitches[i])
+				continue;
 
-	drmModeFreePropertyBlob(blob);
+			fb->planes[fb->n_planes++] = (struct model_fb_plane){
+				.offset = state_fb->offsets[i],
+				.pitch = state_fb->pitches[i],
+			};
+		}
 
-	return obj;
-}
+		return fb;
+	}
 
-static struct json_object *fb_info(int fd, uint32_t id)
-{
 #ifdef HAVE_GETFB2
-	drmModeFB2 *fb2 = drmModeGetFB2(fd, id);
+	drmModeFB2 *fb2 = drmModeGetFB2(node->fd, id);
+	node->stats.ioctls += 1;
 	if (!fb2 && errno != EINVAL) {
-		perror("drmModeGetFB2");
+		node_perror(node, "drmModeGetFB2");
 		return NULL;
 	}
 	if (fb2) {
-		struct json_object *obj = json_object_new_object();
-		json_object_object_add(obj, "id", json_object_new_uint64(fb2->fb_id));
-		json_object_object_add(obj, "width", json_object_new_uint64(fb2->width));
-		json_object_object_add(obj, "height", json_object_new_uint64(fb2->height));
-
-		json_object_object_add(obj, "format", json_object_new_uint64(fb2->pixel_format));
-		if (fb2->flags & DRM_MODE_FB_MODIFIERS) {
-			json_object_object_add(obj, "modifier", json_object_new_uint64(fb2->modifier));
-		}
+		struct model_fb *fb = arena_alloc(&node->arena, sizeof(*fb));
+		fb->id = fb2->fb_id;
+		fb->width = fb2->width;
+		fb->height = fb2->height;
 
-		struct json_object *planes_arr = json_object_new_array();
-		json_object_object_add(obj, "planes", planes_arr);
+		fb->has_format = true;
+		fb->format = fb2->pixel_format;
+		fb->has_modifier = fb2->flags & DRM_MODE_FB_MODIFIERS;
+		fb->modifier = fb2->modifier;
 
 		for (size_t i = 0; i < sizeof(fb2->pitches) / sizeof(fb2->pitches[0]); i++) {
 			if (!fb2->pitches[i])
 				continue;
 
-			struct json_object *plane_obj = json_object_new_object();
-			json_object_array_add(planes_arr, plane_obj);
-
-			json_object_object_add(plane_obj, "offset",
-				json_object_new_uint64(fb2->offsets[i]));
-			json_object_object_add(plane_obj, "pitch",
-				json_object_new_uint64(fb2->pitches[i]));
+			fb->planes[fb->n_planes++] = (struct model_fb_plane){
+				.offset = fb2->offsets[i],
+				.pitch = fb2->pitches[i],
+			};
 		}
 
 		drmModeFreeFB2(fb2);
 
-		return obj;
+		return fb;
 	}
 #endif
 
 	// Fallback to drmModeGetFB is drmModeGetFB2 isn't available
-	drmModeFB *fb = drmModeGetFB(fd, id);
-	if (!fb) {
-		perror("drmModeGetFB");
+	drmModeFB *legacy_fb = drmModeGetFB(node->fd, id);
+	node->stats.ioctls += 1;
+	if (!legacy_fb) {
+		node_perror(node, "drmModeGetFB");
 		return NULL;
 	}
 
-	struct json_object *obj = json_object_new_object();
-	json_object_object_add(obj, "id", json_object_new_uint64(fb->fb_id));
-	json_object_object_add(obj, "width", json_object_new_uint64(fb->width));
-	json_object_object_add(obj, "height", json_object_new_uint64(fb->height));
+	struct model_fb *fb = arena_alloc(&node->arena, sizeof(*fb));
+	fb->id = legacy_fb->fb_id;
+	fb->width = legacy_fb->width;
+	fb->height = legacy_fb->height;
 
 	// Legacy properties
-	json_object_object_add(obj, "pitch", json_object_new_uint64(fb->pitch));
-	json_object_object_add(obj, "bpp", json_object_new_uint64(fb->bpp));
-	json_object_object_add(obj, "depth", json_object_new_uint64(fb->depth));
+	fb->legacy = true;
+	fb->pitch = legacy_fb->pitch;
+	fb->bpp = legacy_fb->bpp;
+	fb->depth = legacy_fb->depth;
+
+	drmModeFreeFB(legacy_fb);
+
+	return fb;
+}
+
+static void spec_info(struct model_prop_def *def, struct arena *arena,
+		const drmModePropertyRes *prop)
+{
+	uint32_t type = prop->flags &
+		(DRM_MODE_PROP_LEGACY_TYPE | DRM_MODE_PROP_EXTENDED_TYPE);
+
+	switch (type) {
+	case DRM_MODE_PROP_RANGE:
+		def->spec.range.min = prop->values[0];
+		def->spec.range.max = prop->values[1];
+		break;
+	case DRM_MODE_PROP_ENUM:
+	case DRM_MODE_PROP_BITMASK:
+		def->spec.enums.n_items = prop->count_enums;
+		def->spec.enums.items = arena_alloc(arena,
+			prop->count_enums * sizeof(*def->spec.enums.items));
+		for (int j = 0; j < prop->count_enums; ++j) {
+			struct model_enum *item = &def->spec.enums.items[j];
+			memcpy(item->name, prop->enums[j].name, sizeof(item->name));
+			item->name[sizeof(item->name) - 1] = '\0';
+			item->value = prop->enums[j].value;
+		}
+		break;
+	case DRM_MODE_PROP_OBJECT:
+		def->spec.object_type = prop->values[0];
+		break;
+	case DRM_MODE_PROP_SIGNED_RANGE:
+		def->spec.srange.min = (int64_t)prop->values[0];
+		def->spec.srange.max = (int64_t)prop->values[1];
+		break;
+	}
+}
+
+static struct model_prop_def *prop_cache_find(struct prop_cache *cache,
+		uint32_t prop_id)
+{
+	if (cache->cap == 0) {
+		return NULL;
+	}
+
+	size_t mask = cache->cap - 1;
+	for (size_t i = id_hash(prop_id) & mask; cache->defs[i];
+			i = (i + 1) & mask) {
+		if (cache->defs[i]->id == prop_id) {
+			return cache->defs[i];
+		}
+	}
+	return NULL;
+}
 
-	drmModeFreeFB(fb);
+static void prop_cache_insert(struct prop_cache *cache,
+		struct model_prop_def *def)
+{
+	// Keep the load factor under 1/2
+	if ((cache->len + 1) * 2 > cache->cap) {
+		size_t cap = cache->cap ? cache->cap * 2 : 64;
+		struct model_prop_def **defs = calloc_or_abort(cap, sizeof(*defs));
+		for (size_t i = 0; i < cache->cap; ++i) {
+			if (!cache->defs[i])
+				continue;
+			size_t j = id_hash(cache->defs[i]->id) & (cap - 1);
+			while (defs[j])
+				j = (j + 1) & (cap - 1);
+			defs[j] = cache->defs[i];
+		}
+		free(cache->defs);
+		cache->defs = defs;
+		cache->cap = cap;
+	}
 
-	return obj;
+	size_t mask = cache->cap - 1;
+	size_t i = id_hash(def->id) & mask;
+	while (cache->defs[i])
+		i = (i + 1) & mask;
+	cache->defs[i] = def;
+	++cache->len;
 }
 
+/* Property definitions are the same for every object on a device, so only
+ * fetch each of them once. Definitions are never freed before the node is
+ * done, so the returned pointer can be used without holding the lock. */
+static const struct model_prop_def *get_prop_def(struct node *node,
+		uint32_t prop_id)
+{
+	struct prop_cache *cache = &node->cache->props;
+
+	++node->stats.prop_lookups;
 
-static struct json_object *properties_info(int fd, uint32_t id, uint32_t type)
+	pthread_mutex_lock(&node->cache->lock);
+	struct model_prop_def *def = prop_cache_find(cache, prop_id);
+	pthread_mutex_unlock(&node->cache->lock);
+	if (def) {
+		return def;
+	}
+
+	drmModePropertyRes *prop = kms_get_property(node->kms, prop_id);
+	if (!prop) {
+		node_perror(node, "drmModeGetProperty");
+		return NULL;
+	}
+	++node->stats.props_fetched;
+
+	// Another object may have fetched the same property in the meantime
+	pthread_mutex_lock(&node->cache->lock);
+	def = prop_cache_find(cache, prop_id);
+	if (!def) {
+		def = arena_alloc(&node->cache->arena, sizeof(*def));
+		def->id = prop->prop_id;
+		def->flags = prop->flags;
+		memcpy(def->name, prop->name, sizeof(def->name));
+		def->name[sizeof(def->name) - 1] = '\0';
+		spec_info(def, &node->cache->arena, prop);
+		prop_cache_insert(cache, def);
+	}
+	pthread_mutex_unlock(&node->cache->lock);
+
+	kms_free_property(node->kms, prop);
+
+	return def;
+}
+
+/* Definitions themselves are in the cache's arena */
+static void prop_cache_finish(struct prop_cache *cache)
+{
+	free(cache->defs);
+}
+
+/* Property definitions are needed to know property names, but the values and
+ * blobs of unselected properties aren't fetched */
+static struct model_properties *properties_info(struct node *node,
+		const struct selector *sel, uint32_t id, uint32_t type)
 {
-	drmModeObjectProperties *props = drmModeObjectGetProperties(fd, id, type);
+	drmModeObjectProperties *props = kms_get_properties(node->kms, id, type);
 	if (!props) {
-		perror("drmModeObjectGetProperties");
+		node_perror(node, "drmModeObjectGetProperties");
 		return NULL;
 	}
 
-	struct json_object *obj = json_object_new_object();
+	struct model_properties *result =
+		arena_alloc(&node->arena, sizeof(*result));
+	result->items = arena_alloc(&node->arena,
+		props->count_props * sizeof(*result->items));
 
 	for (uint32_t i = 0; i < props->count_props; ++i) {
-		drmModePropertyRes *prop = drmModeGetProperty(fd, props->props[i]);
-		if (!prop) {
-			perror("drmModeGetProperty");
+		const struct model_prop_def *def =
+			get_prop_def(node, props->props[i]);
+		if (!def || !selector_has(sel, def->name)) {
 			continue;
 		}
+		const struct selector *prop_sel = selector_get(sel, def->name);
 
-		uint32_t flags = prop->flags;
-		uint32_t type = flags &
+		uint32_t type = def->flags &
 			(DRM_MODE_PROP_LEGACY_TYPE | DRM_MODE_PROP_EXTENDED_TYPE);
-		bool atomic = flags & DRM_MODE_PROP_ATOMIC;
-		bool immutable = flags & DRM_MODE_PROP_IMMUTABLE;
 		uint64_t value = props->prop_values[i];
 
-		struct json_object *prop_obj = json_object_new_object();
-		json_object_object_add(prop_obj, "id",
-			json_object_new_uint64(prop->prop_id));
-		json_object_object_add(prop_obj, "flags",
-			json_object_new_uint64(flags));
-		json_object_object_add(prop_obj, "type", json_object_new_uint64(type));
-		json_object_object_add(prop_obj, "atomic",
-			json_object_new_boolean(atomic));
-		json_object_object_add(prop_obj, "immutable",
-			json_object_new_boolean(immutable));
-
-		json_object_object_add(prop_obj, "raw_value",
-			json_object_new_uint64(value));
-
-		struct json_object *spec_obj = NULL;
-		switch (type) {
-		case DRM_MODE_PROP_RANGE:
-			spec_obj = json_object_new_object();
-			json_object_object_add(spec_obj, "min",
-				json_object_new_uint64(prop->values[0]));
-			json_object_object_add(spec_obj, "max",
-				json_object_new_uint64(prop->values[1]));
-			break;
-		case DRM_MODE_PROP_ENUM:
-		case DRM_MODE_PROP_BITMASK:
-			spec_obj = json_object_new_array();
-			for (int j = 0; j < prop->count_enums; ++j) {
-				struct json_object *item_obj = json_object_new_object();
-				json_object_object_add(item_obj, "name",
-					json_object_new_string(prop->enums[j].name));
-				json_object_object_add(item_obj, "value",
-					json_object_new_uint64(prop->enums[j].value));
-				json_object_array_add(spec_obj, item_obj);
-			}
-			break;
-		case DRM_MODE_PROP_OBJECT:
-			spec_obj = json_object_new_uint64(prop->values[0]);
-			break;
-		case DRM_MODE_PROP_SIGNED_RANGE:
-			spec_obj = json_object_new_object();
-			json_object_object_add(spec_obj, "min",
-				json_object_new_int64((int64_t)prop->values[0]));
-			json_object_object_add(spec_obj, "max",
-				json_object_new_int64((int64_t)prop->values[1]));
-			break;
-		}
-		json_object_object_add(prop_obj, "spec", spec_obj);
+		struct model_property *prop = &result->items[result->len++];
+		prop->def = def;
+		prop->raw_value = value;
 
-		struct json_object *value_obj = NULL;
-		switch (type) {
-		case DRM_MODE_PROP_RANGE:
-		case DRM_MODE_PROP_ENUM:
-		case DRM_MODE_PROP_BITMASK:
-		case DRM_MODE_PROP_OBJECT:
-			value_obj = json_object_new_uint64(value);
-			break;
-		case DRM_MODE_PROP_BLOB:
-			// TODO: base64-encode blob contents
-			value_obj = NULL;
-			break;
-		case DRM_MODE_PROP_SIGNED_RANGE:
-			value_obj = json_object_new_int64((int64_t)value);
-			break;
+		bool has_data = selector_has(prop_sel, "data");
+		// Blob contents are the value of blob properties
+		bool has_contents = node->blob_contents &&
+			type == DRM_MODE_PROP_BLOB && selector_has(prop_sel, "value");
+		if (!has_data && !has_contents) {
+			continue;
 		}
-		json_object_object_add(prop_obj, "value", value_obj);
 
-		struct json_object *data_obj = NULL;
+		const struct prop_handler *handler = prop_handler_get(def->name);
+		blob_decoder decode;
 		switch (type) {
 		case DRM_MODE_PROP_BLOB:
-			if (!value) {
+			decode = has_data && handler && handler->kind == PROP_BLOB ?
+				handler->decode : NULL;
+			if (!value || (!decode && !has_contents)) {
+				break;
+			}
+			const struct blob_data *blob = blob_info(node, value, decode);
+			if (!blob) {
 				break;
 			}
-			if (strcmp(prop->name, "IN_FORMATS") == 0) {
-				data_obj = in_formats_info(fd, value);
-			} else if (strcmp(prop->name, "MODE_ID") == 0) {
-				data_obj = mode_id_info(fd, value);
-			} else if (strcmp(prop->name, "WRITEBACK_PIXEL_FORMATS") == 0) {
-				data_obj = writeback_pixel_formats_info(fd, value);
-			} else if (strcmp(prop->name, "PATH") == 0) {
-				data_obj = path_info(fd, value);
+			if (blob->decoded) {
+				prop->data_type = MODEL_DATA_BLOB;
+				prop->data.blob = &blob->blob;
+			}
+			if (has_contents) {
+				prop->blob_contents = blob->data;
+				prop->blob_len = blob->len;
 			}
 			break;
 		case DRM_MODE_PROP_RANGE:
-			// This is a special case, as the SRC_* properties are
-			// in 16.16 fixed point
-			if (strncmp(prop->name, "SRC_", 4) == 0) {
-				data_obj = json_object_new_uint64(value >> 16);
+			if (handler && handler->kind == PROP_FIXED_16_16) {
+				prop->data_type = MODEL_DATA_UINT;
+				prop->data.uint = value >> 16;
 			}
 			break;
 		case DRM_MODE_PROP_OBJECT:
 			if (!value) {
 				break;
 			}
-			if (strcmp(prop->name, "FB_ID") == 0) {
-				data_obj = fb_info(fd, value);
+			if (handler && handler->kind == PROP_FB) {
+				prop->data.fb = fb_info(node, value);
+				if (prop->data.fb) {
+					prop->data_type = MODEL_DATA_FB;
+				}
 			}
 			break;
 		}
-		json_object_object_add(prop_obj, "data", data_obj);
+	}
+
+	kms_free_properties(node->kms, props);
+
+	return result;
+}
+
+static struct model_connector *connector_info(struct node *node, uint32_t id)
+{
+	drmModeConnector *conn = kms_get_connector(node->kms, id);
+	if (!conn) {
+		node_perror(node, "drmModeGetConnectorCurrent");
+		return NULL;
+	}
+
+	struct model_connector *result =
+		arena_alloc(&node->arena, sizeof(*result));
+
+	result->id = conn->connector_id;
+	result->type = conn->connector_type;
+	result->status = conn->connection;
+	result->phy_width = conn->mmWidth;
+	result->phy_height = conn->mmHeight;
+	result->subpixel = conn->subpixel;
+	result->encoder_id = conn->encoder_id;
+
+	if (selector_has(node->sel, "encoders")) {
+		result->n_encoders = conn->count_encoders;
+		result->encoders = arena_memdup(&node->arena, conn->encoders,
+			conn->count_encoders * sizeof(*conn->encoders));
+	}
 
-		json_object_object_add(obj, prop->name, prop_obj);
+	if (selector_has(node->sel, "modes")) {
+		result->n_modes = conn->count_modes;
+		result->modes = arena_memdup(&node->arena, conn->modes,
+			conn->count_modes * sizeof(*conn->modes));
+	}
 
-		drmModeFreeProperty(prop);
+	if (selector_has(node->sel, "properties")) {
+		result->props = properties_info(node,
+			selector_get(node->sel, "properties"), conn->connector_id,
+			DRM_MODE_OBJECT_CONNECTOR);
 	}
 
-	drmModeFreeObjectProperties(props);
+	kms_free_connector(node->kms, conn);
 
-	return obj;
+	return result;
 }
 
-static struct json_object *connectors_info(int fd, drmModeRes *res)
+static const char *const sysfs_conn_fields[] = {
+	"id", "type", "status", "modes", "properties", NULL,
+};
+static const char *const sysfs_mode_fields[] = { "name", NULL };
+static const char *const sysfs_props[] = { "EDID", "DPMS", NULL };
+static const char *const sysfs_edid_fields[] = { "value", "data", NULL };
+static const char *const sysfs_dpms_fields[] = { "raw_value", "value", NULL };
+
+/* Properties read from sysfs or the atomic state only have their values, so
+ * their definitions only have what's needed to render those */
+static const struct model_prop_def edid_def = {
+	.name = "EDID", .flags = DRM_MODE_PROP_BLOB,
+};
+static const struct model_prop_def dpms_def = {
+	.name = "DPMS", .flags = DRM_MODE_PROP_ENUM,
+};
+
+/* Returns true if sysfs has every connector field sel asks for */
+static bool sysfs_has_connectors(const struct selector *sel)
 {
-	struct json_object *arr = json_object_new_array();
+	if (!selector_within(sel, sysfs_conn_fields)) {
+		return false;
+	}
+	if (selector_has(sel, "modes") &&
+			!selector_within(selector_get(sel, "modes"),
+			sysfs_mode_fields)) {
+		return false;
+	}
+	if (!selector_has(sel, "properties")) {
+		return true;
+	}
 
-	for (int i = 0; i < res->count_connectors; ++i) {
-		drmModeConnector *conn = drmModeGetConnectorCurrent(fd, res->connectors[i]);
-		if (!conn) {
-			perror("drmModeGetConnectorCurrent");
-			continue;
+	const struct selector *props_sel = selector_get(sel, "properties");
+	if (!selector_within(props_sel, sysfs_props)) {
+		return false;
+	}
+	if (selector_has(props_sel, "EDID") &&
+			!selector_within(selector_get(props_sel, "EDID"),
+			sysfs_edid_fields)) {
+		return false;
+	}
+	if (selector_has(props_sel, "DPMS") &&
+			!selector_within(selector_get(props_sel, "DPMS"),
+			sysfs_dpms_fields)) {
+		return false;
+	}
+	return true;
+}
+
+/* Collects the connectors section from sysfs into node->model, without
+ * opening the node. Returns false if sysfs doesn't have everything which was
+ * asked for, in which case ioctls need to be used. */
+static bool sysfs_connectors_info(struct node *node)
+{
+	const struct selector *sel = selector_get(node->sel, "connectors");
+	if (!sysfs_has_connectors(sel)) {
+		return false;
+	}
+
+	bool has_props = selector_has(sel, "properties");
+	const struct selector *props_sel = selector_get(sel, "properties");
+	bool has_edid = has_props && selector_has(props_sel, "EDID");
+	const struct selector *edid_sel = selector_get(props_sel, "EDID");
+	bool has_dpms = has_props && selector_has(props_sel, "DPMS");
+
+	blob_decoder decode_edid = prop_handler_get("EDID")->decode;
+	bool edid_data = has_edid && selector_has(edid_sel, "data");
+	bool edid_contents = has_edid && node->blob_contents &&
+		selector_has(edid_sel, "value");
+
+	uint32_t fields = 0;
+	if (selector_has(sel, "status")) {
+		fields |= SYSFS_STATUS;
+	}
+	if (selector_has(sel, "modes")) {
+		fields |= SYSFS_MODES;
+	}
+	if (edid_data || edid_contents) {
+		fields |= SYSFS_EDID;
+	}
+	if (has_dpms) {
+		fields |= SYSFS_DPMS;
+	}
+
+	// sysfs names connectors after the card node, e.g. card0-HDMI-A-1
+	const char *card = strrchr(node->path, '/');
+	card = card ? card + 1 : node->path;
+
+	struct sysfs_connector *conns;
+	size_t n_conns;
+	if (!sysfs_get_connectors(node->sysfs_root, card, fields, &conns,
+			&n_conns)) {
+		return false;
+	}
+
+	// Older kernels don't expose connector IDs
+	for (size_t i = 0; selector_has(sel, "id") && i < n_conns; ++i) {
+		if (!conns[i].id) {
+			sysfs_free_connectors(conns, n_conns);
+			return false;
 		}
+	}
 
-		struct json_object *conn_obj = json_object_new_object();
+	struct arena *arena = &node->arena;
+	struct model_connector **results =
+		arena_alloc(arena, n_conns * sizeof(*results));
+	for (size_t i = 0; i < n_conns; ++i) {
+		const struct sysfs_connector *conn = &conns[i];
+		struct model_connector *result =
+			arena_alloc(arena, sizeof(*result));
+		results[i] = result;
+
+		result->id = conn->id;
+		result->type = conn->type;
+		result->status = conn->status;
+
+		// sysfs only has mode names
+		result->n_modes = conn->n_modes;
+		result->modes = arena_alloc(arena,
+			conn->n_modes * sizeof(*result->modes));
+		for (size_t j = 0; j < conn->n_modes; ++j) {
+			snprintf(result->modes[j].name,
+				sizeof(result->modes[j].name), "%s",
+				conn->modes[j]);
+		}
 
-		json_object_object_add(conn_obj, "id",
-			json_object_new_uint64(conn->connector_id));
-		json_object_object_add(conn_obj, "type",
-			json_object_new_uint64(conn->connector_type));
-		json_object_object_add(conn_obj, "status",
-			json_object_new_uint64(conn->connection));
-		json_object_object_add(conn_obj, "phy_width",
-			json_object_new_uint64(conn->mmWidth));
-		json_object_object_add(conn_obj, "phy_height",
-			json_object_new_uint64(conn->mmHeight));
-		json_object_object_add(conn_obj, "subpixel",
-			json_object_new_uint64(conn->subpixel));
-		json_object_object_add(conn_obj, "encoder_id",
-			json_object_new_uint64(conn->encoder_id));
+		if (!has_props) {
+			continue;
+		}
 
-		struct json_object *encoders_arr = json_object_new_array();
-		for (int j = 0; j < conn->count_encoders; ++j) {
-			json_object_array_add(encoders_arr,
-				json_object_new_uint64(conn->encoders[j]));
+		// Writeback connectors don't have either property. Otherwise,
+		// the kernel attaches EDID before DPMS.
+		struct model_properties *props =
+			arena_alloc(arena, sizeof(*props));
+		props->items = arena_alloc(arena, 2 * sizeof(*props->items));
+		result->props = props;
+		if (conn->type == DRM_MODE_CONNECTOR_WRITEBACK) {
+			continue;
 		}
-		json_object_object_add(conn_obj, "encoders", encoders_arr);
 
-		struct json_object *modes_arr = json_object_new_array();
-		for (int j = 0; j < conn->count_modes; ++j) {
-			const drmModeModeInfo *mode = &conn->modes[j];
-			json_object_array_add(modes_arr, mode_info(mode));
+		struct model_property *edid = &props->items[props->len++];
+		edid->def = &edid_def;
+		if (conn->edid_len > 0 && edid_data) {
+			struct model_blob *blob = arena_alloc(arena, sizeof(*blob));
+			if (decode_edid(blob, arena, conn->edid, conn->edid_len)) {
+				edid->data_type = MODEL_DATA_BLOB;
+				edid->data.blob = blob;
+			}
+		}
+		if (conn->edid_len > 0 && edid_contents) {
+			edid->blob_contents = arena_memdup(arena, conn->edid,
+				conn->edid_len);
+			edid->blob_len = conn->edid_len;
 		}
-		json_object_object_add(conn_obj, "modes", modes_arr);
 
-		struct json_object *props_obj = properties_info(fd,
-			conn->connector_id, DRM_MODE_OBJECT_CONNECTOR);
-		json_object_object_add(conn_obj, "properties", props_obj);
+		struct model_property *dpms = &props->items[props->len++];
+		dpms->def = &dpms_def;
+		dpms->raw_value = conn->dpms;
+	}
+
+	sysfs_free_connectors(conns, n_conns);
 
-		drmModeFreeConnector(conn);
+	node->model.connectors = results;
+	node->model.n_connectors = n_conns;
+	return true;
+}
 
-		json_object_array_add(arr, conn_obj);
+static struct model_encoder *encoder_info(struct node *node, uint32_t id)
+{
+	drmModeEncoder *enc = drmModeGetEncoder(node->fd, id);
+	node->stats.ioctls += 1;
+	if (!enc) {
+		node_perror(node, "drmModeGetEncoder");
+		return NULL;
 	}
 
-	return arr;
+	struct model_encoder *result = arena_alloc(&node->arena, sizeof(*result));
+	result->id = enc->encoder_id;
+	result->type = enc->encoder_type;
+	result->crtc_id = enc->crtc_id;
+	result->possible_crtcs = enc->possible_crtcs;
+	result->possible_clones = enc->possible_clones;
+
+	drmModeFreeEncoder(enc);
+
+	return result;
+}
+
+static const char *const state_crtc_fields[] = {
+	"id", "mode", "properties", NULL,
+};
+static const char *const state_mode_fields[] = {
+	"clock", "hdisplay", "hsync_start", "hsync_end", "htotal",
+	"vdisplay", "vsync_start", "vsync_end", "vtotal", "vrefresh",
+	"flags", "type", "name", NULL,
+};
+static const char *const state_crtc_props[] = { "ACTIVE", NULL };
+static const char *const state_prop_fields[] = {
+	"raw_value", "value", "data", NULL,
+};
+
+static const struct model_prop_def active_def = {
+	.name = "ACTIVE", .flags = DRM_MODE_PROP_RANGE,
+};
+
+/* Returns true if sel only asks for properties in props, and only for their
+ * values */
+static bool state_has_props(const struct selector *sel,
+		const char *const props[])
+{
+	if (!selector_within(sel, props)) {
+		return false;
+	}
+	for (size_t i = 0; props[i]; ++i) {
+		if (selector_has(sel, props[i]) &&
+				!selector_within(selector_get(sel, props[i]),
+				state_prop_fields)) {
+			return false;
+		}
+	}
+	return true;
 }
 
-static struct json_object *encoders_info(int fd, drmModeRes *res)
+/* Collects a CRTC from the atomic state, if it has everything which was asked
+ * for */
+static struct model_crtc *state_crtc_info(struct node *node, uint32_t id)
 {
-	struct json_object *arr = json_object_new_array();
+	const struct selector *sel = node->sel;
+	if (!node->atomic_state || !selector_within(sel, state_crtc_fields) ||
+			(selector_has(sel, "mode") &&
+			!selector_within(selector_get(sel, "mode"),
+			state_mode_fields)) ||
+			(selector_has(sel, "properties") &&
+			!state_has_props(selector_get(sel, "properties"),
+			state_crtc_props))) {
+		return NULL;
+	}
 
-	for (int i = 0; i < res->count_encoders; ++i) {
-		drmModeEncoder *enc = drmModeGetEncoder(fd, res->encoders[i]);
-		if (!enc) {
-			perror("drmModeGetEncoder");
-			continue;
+	const struct debugfs_crtc *crtc =
+		debugfs_get_crtc(node->atomic_state, id);
+	if (!crtc) {
+		return NULL;
+	}
+
+	struct model_crtc *result = arena_alloc(&node->arena, sizeof(*result));
+	result->id = crtc->id;
+	if (crtc->enable) {
+		result->mode = arena_memdup(&node->arena, &crtc->mode,
+			sizeof(crtc->mode));
+	}
+
+	struct model_properties *props =
+		arena_alloc(&node->arena, sizeof(*props));
+	props->items = arena_alloc(&node->arena, sizeof(*props->items));
+	props->items[0].def = &active_def;
+	props->items[0].raw_value = crtc->active;
+	props->len = 1;
+	result->props = props;
+
+	return result;
+}
+
+static struct model_crtc *crtc_info(struct node *node, uint32_t id)
+{
+	struct model_crtc *state_crtc = state_crtc_info(node, id);
+	if (state_crtc) {
+		return state_crtc;
+	}
+
+	drmModeCrtc *crtc = drmModeGetCrtc(node->fd, id);
+	node->stats.ioctls += 1;
+	if (!crtc) {
+		node_perror(node, "drmModeGetCrtc");
+		return NULL;
+	}
+
+	struct model_crtc *result = arena_alloc(&node->arena, sizeof(*result));
+	result->id = crtc->crtc_id;
+	result->fb_id = crtc->buffer_id;
+	result->x = crtc->x;
+	result->y = crtc->y;
+	if (crtc->mode_valid) {
+		result->mode = arena_memdup(&node->arena, &crtc->mode,
+			sizeof(crtc->mode));
+	}
+	result->gamma_size = crtc->gamma_size;
+
+	if (selector_has(node->sel, "properties")) {
+		result->props = properties_info(node,
+			selector_get(node->sel, "properties"), crtc->crtc_id,
+			DRM_MODE_OBJECT_CRTC);
+	}
+
+	drmModeFreeCrtc(crtc);
+
+	return result;
+}
+
+static const char *const state_plane_fields[] = {
+	"id", "crtc_id", "fb_id", "fb", "properties", NULL,
+};
+static const char *const state_plane_props[] = {
+	"FB_ID", "CRTC_ID", "CRTC_X", "CRTC_Y", "CRTC_W", "CRTC_H",
+	"SRC_X", "SRC_Y", "SRC_W", "SRC_H", NULL,
+};
+
+/* In the order the kernel attaches these properties */
+static const struct model_prop_def state_plane_defs[] = {
+	{ .name = "FB_ID", .flags = DRM_MODE_PROP_OBJECT },
+	{ .name = "CRTC_ID", .flags = DRM_MODE_PROP_OBJECT },
+	{ .name = "CRTC_X", .flags = DRM_MODE_PROP_SIGNED_RANGE },
+	{ .name = "CRTC_Y", .flags = DRM_MODE_PROP_SIGNED_RANGE },
+	{ .name = "CRTC_W", .flags = DRM_MODE_PROP_RANGE },
+	{ .name = "CRTC_H", .flags = DRM_MODE_PROP_RANGE },
+	{ .name = "SRC_X", .flags = DRM_MODE_PROP_RANGE },
+	{ .name = "SRC_Y", .flags = DRM_MODE_PROP_RANGE },
+	{ .name = "SRC_W", .flags = DRM_MODE_PROP_RANGE },
+	{ .name = "SRC_H", .flags = DRM_MODE_PROP_RANGE },
+};
+
+/* Collects a plane from the atomic state, if it has everything which was
+ * asked for */
+static struct model_plane *state_plane_info(struct node *node, uint32_t id)
+{
+	const struct selector *sel = node->sel;
+	if (!node->atomic_state || !selector_within(sel, state_plane_fields) ||
+			(selector_has(sel, "properties") &&
+			!state_has_props(selector_get(sel, "properties"),
+			state_plane_props))) {
+		return NULL;
+	}
+
+	const struct debugfs_plane *plane =
+		debugfs_get_plane(node->atomic_state, id);
+	if (!plane) {
+		return NULL;
+	}
+
+	struct model_plane *result = arena_alloc(&node->arena, sizeof(*result));
+	result->id = plane->id;
+	result->crtc_id = plane->crtc_id;
+	result->fb_id = plane->fb_id;
+
+	if (plane->fb_id && selector_has(sel, "fb")) {
+		result->fb = fb_info(node, plane->fb_id);
+	}
+
+	if (!selector_has(sel, "properties")) {
+		return result;
+	}
+
+	const uint64_t values[] = {
+		plane->fb_id, plane->crtc_id,
+		(uint64_t)(int64_t)plane->crtc_x, (uint64_t)(int64_t)plane->crtc_y,
+		plane->crtc_w, plane->crtc_h,
+		plane->src_x, plane->src_y, plane->src_w, plane->src_h,
+	};
+	size_t n_props = sizeof(values) / sizeof(values[0]);
+
+	struct model_properties *props =
+		arena_alloc(&node->arena, sizeof(*props));
+	props->items = arena_alloc(&node->arena,
+		n_props * sizeof(*props->items));
+	props->len = n_props;
+	for (size_t i = 0; i < n_props; ++i) {
+		struct model_property *prop = &props->items[i];
+		prop->def = &state_plane_defs[i];
+		prop->raw_value = values[i];
+		const struct prop_handler *handler =
+			prop_handler_get(prop->def->name);
+		if (handler && handler->kind == PROP_FIXED_16_16) {
+			prop->data_type = MODEL_DATA_UINT;
+			prop->data.uint = values[i] >> 16;
 		}
+	}
+
+	const struct selector *props_sel = selector_get(sel, "properties");
+	if (plane->fb_id && selector_has(props_sel, "FB_ID") &&
+			selector_has(selector_get(props_sel, "FB_ID"), "data")) {
+		props->items[0].data.fb = fb_info(node, plane->fb_id);
+		if (props->items[0].data.fb) {
+			props->items[0].data_type = MODEL_DATA_FB;
+		}
+	}
+	result->props = props;
+
+	return result;
+}
+
+static struct model_plane *plane_info(struct node *node, uint32_t id)
+{
+	struct model_plane *state_plane = state_plane_info(node, id);
+	if (state_plane) {
+		return state_plane;
+	}
+
+	drmModePlane *plane = kms_get_plane(node->kms, id);
+	if (!plane) {
+		node_perror(node, "drmModeGetPlane");
+		return NULL;
+	}
 
-		struct json_object *enc_obj = json_object_new_object();
+	struct model_plane *result = arena_alloc(&node->arena, sizeof(*result));
+	result->id = plane->plane_id;
+	result->possible_crtcs = plane->possible_crtcs;
+	result->crtc_id = plane->crtc_id;
+	result->fb_id = plane->fb_id;
+	result->crtc_x = plane->crtc_x;
+	result->crtc_y = plane->crtc_y;
+	result->x = plane->x;
+	result->y = plane->y;
+	result->gamma_size = plane->gamma_size;
+
+	if (plane->fb_id && selector_has(node->sel, "fb")) {
+		result->fb = fb_info(node, plane->fb_id);
+	}
+
+	if (selector_has(node->sel, "formats")) {
+		result->n_formats = plane->count_formats;
+		result->formats = arena_memdup(&node->arena, plane->formats,
+			plane->count_formats * sizeof(*plane->formats));
+	}
 
-		json_object_object_add(enc_obj, "id",
-			json_object_new_uint64(enc->encoder_id));
-		json_object_object_add(enc_obj, "type",
-			json_object_new_uint64(enc->encoder_type));
-		json_object_object_add(enc_obj, "crtc_id",
-			json_object_new_uint64(enc->crtc_id));
-		json_object_object_add(enc_obj, "possible_crtcs",
-			json_object_new_uint64(enc->possible_crtcs));
-		json_object_object_add(enc_obj, "possible_clones",
-			json_object_new_uint64(enc->possible_clones));
+	if (selector_has(node->sel, "properties")) {
+		result->props = properties_info(node,
+			selector_get(node->sel, "properties"), plane->plane_id,
+			DRM_MODE_OBJECT_PLANE);
+	}
 
-		drmModeFreeEncoder(enc);
+	kms_free_plane(node->kms, plane);
 
-		json_object_array_add(arr, enc_obj);
+	return result;
+}
+
+static void node_open_err(struct node *node)
+{
+	node->err = open_memstream(&node->err_buf, &node->err_len);
+	if (!node->err) {
+		node->err = stderr;
 	}
+}
 
-	return arr;
+static void node_close_err(struct node *node)
+{
+	if (node->err != stderr) {
+		fclose(node->err);
+	}
 }
 
-static struct json_object *crtcs_info(int fd, drmModeRes *res)
+static struct kms *node_get_kms(struct node *node)
 {
-	struct json_object *arr = json_object_new_array();
+	pthread_mutex_lock(&node->cache->lock);
+	struct kms_slot *slot = node->cache->free_kms;
+	if (slot) {
+		node->cache->free_kms = slot->next;
+	}
+	pthread_mutex_unlock(&node->cache->lock);
 
-	for (int i = 0; i < res->count_crtcs; ++i) {
-		drmModeCrtc *crtc = drmModeGetCrtc(fd, res->crtcs[i]);
-		if (!crtc) {
-			perror("drmModeGetCrtc");
-			continue;
+	if (!slot) {
+		slot = calloc_or_abort(1, sizeof(*slot));
+		kms_init(&slot->kms, node->fd);
+	}
+	return &slot->kms;
+}
+
+static void node_put_kms(struct node *node, struct kms *kms)
+{
+	struct kms_slot *slot = (struct kms_slot *)kms;
+
+	pthread_mutex_lock(&node->cache->lock);
+	slot->next = node->cache->free_kms;
+	node->cache->free_kms = slot;
+	pthread_mutex_unlock(&node->cache->lock);
+}
+
+struct object {
+	uint32_t type;
+	uint32_t id;
+	struct node node;
+	// Protected by the cache lock
+	bool done;
+};
+
+static void collect_object(size_t i, void *data)
+{
+	struct object *object = &((struct object *)data)[i];
+	struct node *node = &object->node;
+
+	node_open_err(node);
+	node->kms = node_get_kms(node);
+
+	switch (object->type) {
+	case DRM_MODE_OBJECT_CONNECTOR:
+		node->obj = connector_info(node, object->id);
+		break;
+	case DRM_MODE_OBJECT_ENCODER:
+		node->obj = encoder_info(node, object->id);
+		break;
+	case DRM_MODE_OBJECT_CRTC:
+		node->obj = crtc_info(node, object->id);
+		break;
+	case DRM_MODE_OBJECT_PLANE:
+		node->obj = plane_info(node, object->id);
+		break;
+	}
+
+	node_put_kms(node, node->kms);
+	node_close_err(node);
+
+	pthread_mutex_lock(&node->cache->lock);
+	object->done = true;
+	pthread_mutex_unlock(&node->cache->lock);
+}
+
+static size_t add_objects(struct node *node, struct object *objects,
+		uint32_t type, const char *section, const uint32_t *ids, size_t n)
+{
+	if (!selector_has(node->sel, section)) {
+		return 0;
+	}
+
+	const struct selector *sel = selector_get(node->sel, section);
+	for (size_t i = 0; i < n; ++i) {
+		objects[i].type = type;
+		objects[i].id = ids[i];
+		objects[i].node.path = node->path;
+		objects[i].node.fd = node->fd;
+		objects[i].node.sel = sel;
+		objects[i].node.blob_contents = node->blob_contents;
+		objects[i].node.atomic_state = node->atomic_state;
+		objects[i].node.cache = node->cache;
+	}
+	return n;
+}
+
+/* Adds a section collected into node->model to the node's result. Once the
+ * node has timed out, it's no longer ours to add to. */
+static void node_publish(struct node *node, enum model_section section)
+{
+	node->model.sections |= section;
+
+	pthread_mutex_lock(&node->cache->lock);
+	if (!node->abandoned) {
+		node->published = node->model;
+	}
+	pthread_mutex_unlock(&node->cache->lock);
+}
+
+/* Reads the atomic state from debugfs, which is named after the minor of the
+ * node, e.g. dri/0/state for card0 */
+static struct debugfs_state *node_atomic_state(struct node *node)
+{
+	const char *name = strrchr(node->path, '/');
+	name = name ? name + 1 : node->path;
+	const char *minor = name + strcspn(name, "0123456789");
+	if (*minor == '\0') {
+		return NULL;
+	}
+
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/dri/%s/state", node->debugfs_root,
+		minor);
+	return debugfs_state_read(path);
+}
+
+static void node_info(struct node *node)
+{
+	// Connectors can be read from sysfs, if it has everything which was
+	// asked for. If nothing else was, the node isn't even opened.
+	bool sysfs_conns = node->sysfs_root &&
+		selector_has(node->sel, "connectors") &&
+		sysfs_connectors_info(node);
+	pthread_mutex_lock(&node->cache->lock);
+	node->sysfs_connectors = sysfs_conns;
+	pthread_mutex_unlock(&node->cache->lock);
+
+	bool need_res = selector_has(node->sel, "fb_size") ||
+		(selector_has(node->sel, "connectors") && !sysfs_conns) ||
+		selector_has(node->sel, "encoders") ||
+		selector_has(node->sel, "crtcs");
+	if (!need_res && !selector_has(node->sel, "driver") &&
+			!selector_has(node->sel, "device") &&
+			!selector_has(node->sel, "planes")) {
+		if (sysfs_conns) {
+			node_publish(node, MODEL_CONNECTORS);
 		}
+		node->ok = true;
+		return;
+	}
 
-		struct json_object *crtc_obj = json_object_new_object();
+	node->fd = open(node->path, O_RDONLY);
+	if (node->fd < 0) {
+		node_perror(node, node->path);
+		return;
+	}
 
-		json_object_object_add(crtc_obj, "id",
-			json_object_new_uint64(crtc->crtc_id));
-		json_object_object_add(crtc_obj, "fb_id",
-			json_object_new_uint64(crtc->buffer_id));
-		json_object_object_add(crtc_obj, "x",
-			json_object_new_uint64(crtc->x));
-		json_object_object_add(crtc_obj, "y",
-			json_object_new_uint64(crtc->y));
-		if (crtc->mode_valid) {
-			json_object_object_add(crtc_obj, "mode", mode_info(&crtc->mode));
-		} else {
-			json_object_object_add(crtc_obj, "mode", NULL);
+	// Planes and CRTCs can be read from the atomic state, and the FBs
+	// attached to them
+	if (node->debugfs_root && (selector_has(node->sel, "crtcs") ||
+			selector_has(node->sel, "planes"))) {
+		node->atomic_state = node_atomic_state(node);
+	}
+
+	// Get driver info before getting resources, as it'll try to enable some
+	// DRM client capabilities
+	struct model_cap *node_client_caps = client_caps_info(node);
+	if (selector_has(node->sel, "driver")) {
+		node->model.driver = driver_info(node,
+			selector_get(node->sel, "driver"), node_client_caps);
+		node_publish(node, MODEL_DRIVER);
+	}
+
+	if (selector_has(node->sel, "device")) {
+		node->model.device = device_info(node);
+		node_publish(node, MODEL_DEVICE);
+	}
+
+	// Only ask for the resources if something needs them
+	drmModeRes *res = NULL;
+	if (need_res) {
+		res = drmModeGetResources(node->fd);
+		node->stats.ioctls += 2;
+		if (!res) {
+			node_perror(node, "drmModeGetResources");
+			close(node->fd);
+			return;
 		}
-		json_object_object_add(crtc_obj, "gamma_size",
-			json_object_new_int(crtc->gamma_size));
+	}
 
-		struct json_object *props_obj = properties_info(fd,
-			crtc->crtc_id, DRM_MODE_OBJECT_CRTC);
-		json_object_object_add(crtc_obj, "properties", props_obj);
+	if (res && selector_has(node->sel, "fb_size")) {
+		struct model_fb_size *fb_size =
+			arena_alloc(&node->arena, sizeof(*fb_size));
+		fb_size->min_width = res->min_width;
+		fb_size->max_width = res->max_width;
+		fb_size->min_height = res->min_height;
+		fb_size->max_height = res->max_height;
+		node->model.fb_size = fb_size;
+		node_publish(node, MODEL_FB_SIZE);
+	}
 
-		drmModeFreeCrtc(crtc);
+	if (sysfs_conns) {
+		node_publish(node, MODEL_CONNECTORS);
+	}
 
-		json_object_array_add(arr, crtc_obj);
+	drmModePlaneRes *plane_res = NULL;
+	if (selector_has(node->sel, "planes")) {
+		plane_res = drmModeGetPlaneResources(node->fd);
+		node->stats.ioctls += 2;
+		if (!plane_res) {
+			node_perror(node, "drmModeGetPlaneResources");
+		}
+	}
+
+	// Every connector, encoder, CRTC and plane is collected separately,
+	// so that e.g. slow connectors don't hold up the planes
+	size_t n_objects = 0;
+	if (res) {
+		n_objects += res->count_connectors + res->count_encoders +
+			res->count_crtcs;
+	}
+	if (plane_res) {
+		n_objects += plane_res->count_planes;
+	}
+	struct object *objects = calloc_or_abort(n_objects + 1, sizeof(*objects));
+
+	size_t n_conns = 0, n_encs = 0, n_crtcs = 0, n_planes = 0;
+	if (res) {
+		n_conns = add_objects(node, objects, DRM_MODE_OBJECT_CONNECTOR,
+			"connectors", res->connectors,
+			sysfs_conns ? 0 : res->count_connectors);
+		n_encs = add_objects(node, objects + n_conns,
+			DRM_MODE_OBJECT_ENCODER, "encoders", res->encoders,
+			res->count_encoders);
+		n_crtcs = add_objects(node, objects + n_conns + n_encs,
+			DRM_MODE_OBJECT_CRTC, "crtcs", res->crtcs,
+			res->count_crtcs);
 	}
+	if (plane_res) {
+		n_planes = add_objects(node, objects + n_conns + n_encs + n_crtcs,
+			DRM_MODE_OBJECT_PLANE, "planes", plane_res->planes,
+			plane_res->count_planes);
+	}
+	n_objects = n_conns + n_encs + n_crtcs + n_planes;
+
+	pthread_mutex_lock(&node->cache->lock);
+	node->objects = objects;
+	node->n_objects[OBJECTS_CONNECTORS] = n_conns;
+	node->n_objects[OBJECTS_ENCODERS] = n_encs;
+	node->n_objects[OBJECTS_CRTCS] = n_crtcs;
+	node->n_objects[OBJECTS_PLANES] = n_planes;
+	node->no_planes = selector_has(node->sel, "planes") && !plane_res;
+	pthread_mutex_unlock(&node->cache->lock);
+
+	pool_run(n_objects, node->jobs, collect_object, objects);
+
+	drmModeFreePlaneResources(plane_res);
+	drmModeFreeResources(res);
+
+	close(node->fd);
 
-	return arr;
+	node->ok = true;
 }
 
-static struct json_object *planes_info(int fd)
+static const struct {
+	const char *name;
+	enum model_section section;
+} object_sections[] = {
+	[OBJECTS_CONNECTORS] = { "connectors", MODEL_CONNECTORS },
+	[OBJECTS_ENCODERS] = { "encoders", MODEL_ENCODERS },
+	[OBJECTS_CRTCS] = { "crtcs", MODEL_CRTCS },
+	[OBJECTS_PLANES] = { "planes", MODEL_PLANES },
+};
+
+/* Builds the node's result from the sections published so far, merging the
+ * objects' errors and statistics into the node's. If the node timed out, its
+ * collection is still running, so only finished objects are taken. Called
+ * with the cache lock held. */
+static struct model_node *node_result(struct node *node, bool timed_out)
 {
-	drmModePlaneRes *res = drmModeGetPlaneResources(fd);
-	if (!res) {
-		perror("drmModeGetPlaneResources");
+	if (!timed_out && !node->ok) {
 		return NULL;
 	}
 
-	struct json_object *arr = json_object_new_array();
+	struct model_node *model = arena_alloc(&node->result, sizeof(*model));
+	*model = node->published;
 
-	for (uint32_t i = 0; i < res->count_planes; ++i) {
-		drmModePlane *plane = drmModeGetPlane(fd, res->planes[i]);
-		if (!plane) {
-			perror("drmModeGetPlane");
+	struct object *objects = node->objects;
+	for (size_t i = 0; objects && i < OBJECTS_COUNT; ++i) {
+		if (!selector_has(node->sel, object_sections[i].name) ||
+				(i == OBJECTS_CONNECTORS && node->sysfs_connectors)) {
+			continue;
+		}
+		model->sections |= object_sections[i].section;
+		if (i == OBJECTS_PLANES && node->no_planes) {
 			continue;
 		}
 
-		struct json_object *plane_obj = json_object_new_object();
+		void **arr = arena_alloc(&node->result,
+			node->n_objects[i] * sizeof(*arr));
+		size_t len = 0;
+		for (size_t j = 0; j < node->n_objects[i]; ++j) {
+			struct object *object = &objects[j];
+			struct node *child = &object->node;
+			if (timed_out) {
+				if (object->done) {
+					fwrite(child->err_buf, 1, child->err_len,
+						node->err);
+					if (child->obj) {
+						arr[len++] = child->obj;
+					}
+				}
+				continue;
+			}
 
-		json_object_object_add(plane_obj, "id",
-			json_object_new_uint64(plane->plane_id));
-		json_object_object_add(plane_obj, "possible_crtcs",
-			json_object_new_uint64(plane->possible_crtcs));
-		json_object_object_add(plane_obj, "crtc_id",
-			json_object_new_uint64(plane->crtc_id));
-		json_object_object_add(plane_obj, "fb_id",
-			json_object_new_uint64(plane->fb_id));
-		json_object_object_add(plane_obj, "crtc_x",
-			json_object_new_uint64(plane->crtc_x));
-		json_object_object_add(plane_obj, "crtc_y",
-			json_object_new_uint64(plane->crtc_y));
-		json_object_object_add(plane_obj, "x",
-			json_object_new_uint64(plane->x));
-		json_object_object_add(plane_obj, "y",
-			json_object_new_uint64(plane->y));
-		json_object_object_add(plane_obj, "gamma_size",
-			json_object_new_uint64(plane->gamma_size));
+			fwrite(child->err_buf, 1, child->err_len, node->err);
+			free(child->err_buf);
 
-		json_object_object_add(plane_obj, "fb",
-			plane->fb_id ? fb_info(fd, plane->fb_id) : NULL);
+			node->stats.ioctls += child->stats.ioctls;
+			node->stats.prop_lookups += child->stats.prop_lookups;
+			node->stats.props_fetched += child->stats.props_fetched;
+			node->stats.blobs_fetched += child->stats.blobs_fetched;
+			node->stats.blobs_decoded += child->stats.blobs_decoded;
 
-		struct json_object *formats_arr = json_object_new_array();
-		for (uint32_t j = 0; j < plane->count_formats; ++j) {
-			json_object_array_add(formats_arr,
-				json_object_new_uint64(plane->formats[j]));
+			if (child->obj) {
+				arr[len++] = child->obj;
+			}
+			arena_adopt(&node->result, &child->arena);
 		}
-		json_object_object_add(plane_obj, "formats", formats_arr);
 
-		struct json_object *props_obj = properties_info(fd,
-			plane->plane_id, DRM_MODE_OBJECT_PLANE);
-		json_object_object_add(plane_obj, "properties", props_obj);
+		switch (i) {
+		case OBJECTS_CONNECTORS:
+			model->connectors = (struct model_connector **)arr;
+			model->n_connectors = len;
+			break;
+		case OBJECTS_ENCODERS:
+			model->encoders = (struct model_encoder **)arr;
+			model->n_encoders = len;
+			break;
+		case OBJECTS_CRTCS:
+			model->crtcs = (struct model_crtc **)arr;
+			model->n_crtcs = len;
+			break;
+		case OBJECTS_PLANES:
+			model->planes = (struct model_plane **)arr;
+			model->n_planes = len;
+			break;
+		}
 
-		drmModeFreePlane(plane);
+		objects += node->n_objects[i];
+	}
 
-		json_object_array_add(arr, plane_obj);
+	if (timed_out) {
+		model->timed_out = true;
+	} else {
+		free(node->objects);
 	}
 
-	drmModeFreePlaneResources(res);
+	return model;
+}
+
+/* Frees the objects of a node which was abandoned, once they're all done.
+ * What was reported refers to their memory, so the result adopts it. */
+static void node_release_objects(struct node *node)
+{
+	size_t n_objects = 0;
+	for (size_t i = 0; i < OBJECTS_COUNT; ++i) {
+		n_objects += node->n_objects[i];
+	}
 
-	return arr;
+	for (size_t i = 0; i < n_objects; ++i) {
+		struct node *child = &node->objects[i].node;
+		free(child->err_buf);
+		arena_adopt(&node->result, &child->arena);
+	}
+	free(node->objects);
 }
 
-static struct json_object *node_info(const char *path)
+static void collect_node(struct node *node)
 {
-	int fd = open(path, O_RDONLY);
-	if (fd < 0) {
-		perror(path);
-		return NULL;
+	struct node_cache *cache = node->cache;
+
+	node_info(node);
+	debugfs_state_destroy(node->atomic_state);
+
+	pthread_mutex_lock(&cache->lock);
+	// If the node was abandoned, drm_info() already reported what we had
+	bool abandoned = node->abandoned;
+	if (!abandoned) {
+		node->obj = node_result(node, false);
 	}
+	node->finishing = true;
+	pthread_mutex_unlock(&cache->lock);
 
-	struct json_object *obj = json_object_new_object();
+	if (abandoned) {
+		node_release_objects(node);
+	}
 
-	// Get driver info before getting resources, as it'll try to enable some
-	// DRM client capabilities
-	json_object_object_add(obj, "driver", driver_info(fd));
+	prop_cache_finish(&cache->props);
+	blob_cache_finish(&cache->blobs);
 
-	json_object_object_add(obj, "device", device_info(fd));
+	// The result refers to everything collected
+	arena_adopt(&node->result, &node->arena);
+	arena_adopt(&node->result, &cache->arena);
 
-	drmModeRes *res = drmModeGetResources(fd);
-	if (!res) {
-		perror("drmModeGetResources");
-		close(fd);
-		json_object_put(obj);
-		return NULL;
+	while (cache->free_kms) {
+		struct kms_slot *slot = cache->free_kms;
+		cache->free_kms = slot->next;
+		node->stats.ioctls += slot->kms.ioctls;
+		kms_finish(&slot->kms);
+		free(slot);
 	}
 
-	struct json_object *fb_size_obj = json_object_new_object();
-	json_object_object_add(fb_size_obj, "min_width",
-		json_object_new_uint64(res->min_width));
-	json_object_object_add(fb_size_obj, "max_width",
-		json_object_new_uint64(res->max_width));
-	json_object_object_add(fb_size_obj, "min_height",
-		json_object_new_uint64(res->min_height));
-	json_object_object_add(fb_size_obj, "max_height",
-		json_object_new_uint64(res->max_height));
-	json_object_object_add(obj, "fb_size", fb_size_obj);
+	node_close_err(node);
 
-	json_object_object_add(obj, "connectors", connectors_info(fd, res));
-	json_object_object_add(obj, "encoders", encoders_info(fd, res));
-	json_object_object_add(obj, "crtcs", crtcs_info(fd, res));
-	json_object_object_add(obj, "planes", planes_info(fd));
+	pthread_mutex_lock(&node->waiter->lock);
+	node->done = true;
+	pthread_cond_signal(&node->waiter->cond);
+	pthread_mutex_unlock(&node->waiter->lock);
+}
 
-	drmModeFreeResources(res);
+static void *node_thread(void *data)
+{
+	collect_node(data);
+	return NULL;
+}
+
+/* Gives up on a node which missed its deadline. Returns false if it turned
+ * out to be finishing anyway. */
+static bool node_abandon(struct node *node)
+{
+	pthread_mutex_lock(&node->cache->lock);
+	bool finishing = node->finishing;
+	if (!finishing) {
+		node->abandoned = true;
+		node->obj = node_result(node, true);
+
+		// The node keeps writing to its buffer, so report a copy
+		fflush(node->err);
+		if (node->err_len > 0) {
+			node->timeout_err = malloc(node->err_len);
+		}
+		if (node->timeout_err) {
+			memcpy(node->timeout_err, node->err_buf, node->err_len);
+			node->timeout_err_len = node->err_len;
+		}
+	}
+	pthread_mutex_unlock(&node->cache->lock);
+	return !finishing;
+}
 
-	close(fd);
+/* Frees what's left of a node once it's been reported and is done */
+static void node_free(struct node *node)
+{
+	free(node->err_buf);
+	pthread_mutex_destroy(&node->cache->lock);
+	arena_finish(&node->result);
+}
 
-	return obj;
+static bool timespec_before(const struct timespec *a, const struct timespec *b)
+{
+	return a->tv_sec < b->tv_sec ||
+		(a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
 }
 
-/* paths is a NULL terminated argv array */
-struct json_object *drm_info(char *paths[])
+static void deadline_after(struct timespec *deadline, int ms)
 {
-	struct json_object *obj = json_object_new_object();
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	deadline->tv_sec += ms / 1000;
+	deadline->tv_nsec += (long)(ms % 1000) * 1000000;
+	if (deadline->tv_nsec >= 1000000000) {
+		deadline->tv_sec += 1;
+		deadline->tv_nsec -= 1000000000;
+	}
+}
 
-	/* Print everything by default */
-	if (!paths[0]) {
-		drmDevice *devices[64];
-		int n = drmGetDevices(devices, sizeof(devices) / sizeof(devices[0]));
-		if (n < 0) {
-			perror("drmGetDevices");
-			json_object_put(obj);
-			return NULL;
+struct node_sink {
+	const struct drm_info_options *opts;
+	bool enumerate;
+	drm_info_func func;
+	void *data;
+};
+
+static void report_node(struct node *node, const struct node_sink *sink)
+{
+	const struct drm_info_options *opts = sink->opts;
+
+	if (node->state == NODE_TIMED_OUT) {
+		if (node->timeout_err) {
+			fwrite(node->timeout_err, 1, node->timeout_err_len,
+				stderr);
+			free(node->timeout_err);
 		}
+		fprintf(stderr, "%s: timed out after %d ms\n", node->path,
+			opts->timeout);
+		// The rest of the node may still be in use, it's freed by
+		// collect_nodes() once it's done
+		sink->func(node->path, node->obj, sink->data);
+		return;
+	}
 
-		for (int i = 0; i < n; ++i) {
-			drmDevice *dev = devices[i];
-			if (!(dev->available_nodes & (1 << DRM_NODE_PRIMARY)))
+	fwrite(node->err_buf, 1, node->err_len, stderr);
+
+	if (opts->stats) {
+		fprintf(stderr, "%s: %u ioctls, %u property lookups, "
+			"%u property definitions fetched, %u blobs fetched, "
+			"%u blobs decoded\n", node->path,
+			node->stats.ioctls, node->stats.prop_lookups,
+			node->stats.props_fetched, node->stats.blobs_fetched,
+			node->stats.blobs_decoded);
+	}
+
+	if (!node->obj) {
+		if (sink->enumerate) {
+			fprintf(stderr, "Failed to retrieve information from %s\n",
+				node->path);
+		}
+		node_free(node);
+		return;
+	}
+
+	sink->func(node->path, node->obj, sink->data);
+	node->obj = NULL;
+	node_free(node);
+}
+
+/* Collects nodes on their own threads, up to jobs at a time, and waits for
+ * them to finish or to miss their deadline. Nodes are reported in order as
+ * soon as they and all the nodes before them are done. Nodes which missed
+ * their deadline are freed if they finish shortly after. Returns false if
+ * any is still running, in which case its memory must be left alone. */
+static bool collect_nodes(struct node *nodes, size_t n_nodes,
+		const struct node_sink *sink)
+{
+	int jobs = sink->opts->jobs;
+	int timeout_ms = sink->opts->timeout;
+
+	struct node_waiter *waiter = calloc_or_abort(1, sizeof(*waiter));
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&waiter->lock, NULL);
+	pthread_cond_init(&waiter->cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	size_t next = 0, running = 0, reported = 0;
+	bool abandoned = false;
+
+	pthread_mutex_lock(&waiter->lock);
+	while (reported < n_nodes) {
+		while (next < n_nodes && (jobs <= 0 || running < (size_t)jobs)) {
+			struct node *node = &nodes[next++];
+			node->waiter = waiter;
+			node->state = NODE_RUNNING;
+			++running;
+
+			deadline_after(&node->deadline, timeout_ms);
+			// Before the thread starts, node_abandon() may need it
+			node_open_err(node);
+
+			pthread_attr_t thread_attr;
+			pthread_attr_init(&thread_attr);
+			pthread_attr_setdetachstate(&thread_attr,
+				PTHREAD_CREATE_DETACHED);
+			pthread_t thread;
+			int ret = pthread_create(&thread, &thread_attr,
+				node_thread, node);
+			pthread_attr_destroy(&thread_attr);
+			if (ret != 0) {
+				// Collect it ourselves, without a deadline
+				pthread_mutex_unlock(&waiter->lock);
+				collect_node(node);
+				pthread_mutex_lock(&waiter->lock);
+			}
+		}
+
+		struct timespec *deadline = NULL;
+		bool any_done = false;
+		for (size_t i = reported; i < next; ++i) {
+			struct node *node = &nodes[i];
+			if (node->state != NODE_RUNNING)
+				continue;
+			if (node->done) {
+				any_done = true;
+			} else if (!deadline ||
+					timespec_before(&node->deadline, deadline)) {
+				deadline = &node->deadline;
+			}
+		}
+
+		if (any_done || !deadline) {
+			// Something finished, no need to wait
+		} else if (timeout_ms > 0) {
+			pthread_cond_timedwait(&waiter->cond, &waiter->lock, deadline);
+		} else {
+			pthread_cond_wait(&waiter->cond, &waiter->lock);
+		}
+
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		for (size_t i = reported; i < next; ++i) {
+			struct node *node = &nodes[i];
+			if (node->state != NODE_RUNNING)
 				continue;
 
-			const char *path = dev->nodes[DRM_NODE_PRIMARY];
-			struct json_object *dev_obj = node_info(path);
-			if (!dev_obj) {
-				fprintf(stderr, "Failed to retrieve information from %s\n", path);
+			if (node->done) {
+				node->state = NODE_DONE;
+			} else if (timeout_ms > 0 &&
+					!timespec_before(&now, &node->deadline) &&
+					node_abandon(node)) {
+				node->state = NODE_TIMED_OUT;
+				abandoned = true;
+			} else {
 				continue;
 			}
+			--running;
+		}
 
-			json_object_object_add(obj, path, dev_obj);
+		// Report in the same order nodes were given, regardless of
+		// which finished first
+		while (reported < next && nodes[reported].state != NODE_RUNNING) {
+			pthread_mutex_unlock(&waiter->lock);
+			report_node(&nodes[reported], sink);
+			pthread_mutex_lock(&waiter->lock);
+			++reported;
 		}
+	}
 
-		drmFreeDevices(devices, n);
-	} else {
-		for (char **path = paths; *path; ++path) {
-			struct json_object *dev = node_info(*path);
-			if (!dev)
+	if (abandoned) {
+		struct timespec grace;
+		deadline_after(&grace, ABANDON_GRACE_MS);
+		abandoned = false;
+		for (size_t i = 0; i < n_nodes; ++i) {
+			struct node *node = &nodes[i];
+			if (node->state != NODE_TIMED_OUT)
+				continue;
+			while (!node->done && pthread_cond_timedwait(&waiter->cond,
+					&waiter->lock, &grace) == 0) {
+				// Another node finished
+			}
+			if (node->done) {
+				node_free(node);
+			} else {
+				abandoned = true;
+			}
+		}
+	}
+	pthread_mutex_unlock(&waiter->lock);
+
+	if (!abandoned) {
+		pthread_mutex_destroy(&waiter->lock);
+		pthread_cond_destroy(&waiter->cond);
+		free(waiter);
+	}
+
+	return !abandoned;
+}
+
+/* Memory of the nodes of a drm_info_stream() call which were still running
+ * when it returned. They may be stuck in an ioctl until the process exits, so
+ * it's never freed, but it's kept reachable for leak checkers. */
+struct abandoned_nodes {
+	struct abandoned_nodes *next;
+	drmDevice **devices;
+	struct node *nodes;
+	struct node_cache *caches;
+};
+
+static struct abandoned_nodes *abandoned_nodes;
+static pthread_mutex_t abandoned_nodes_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void park_abandoned_nodes(drmDevice **devices, struct node *nodes,
+		struct node_cache *caches)
+{
+	struct abandoned_nodes *parked = calloc_or_abort(1, sizeof(*parked));
+	parked->devices = devices;
+	parked->nodes = nodes;
+	parked->caches = caches;
+
+	pthread_mutex_lock(&abandoned_nodes_lock);
+	parked->next = abandoned_nodes;
+	abandoned_nodes = parked;
+	pthread_mutex_unlock(&abandoned_nodes_lock);
+}
+
+/* paths is a NULL terminated argv array. func is called for each node, in
+ * order, as soon as it's been collected. */
+bool drm_info_stream(char *paths[], const struct drm_info_options *opts,
+		drm_info_func func, void *data)
+{
+	drmDevice **devices = NULL;
+	int n_devices = 0;
+	struct node *nodes;
+	size_t n_nodes = 0;
+
+	/* Print everything by default */
+	bool enumerate = !paths[0];
+	if (enumerate) {
+		n_devices = drmGetDevices2(0, NULL, 0);
+		if (n_devices < 0) {
+			perror("drmGetDevices2");
+			return false;
+		}
+
+		devices = calloc_or_abort(n_devices + 1, sizeof(*devices));
+		n_devices = drmGetDevices2(0, devices, n_devices);
+		if (n_devices < 0) {
+			perror("drmGetDevices2");
+			free(devices);
+			return false;
+		}
+
+		nodes = calloc_or_abort(n_devices + 1, sizeof(*nodes));
+		for (int i = 0; i < n_devices; ++i) {
+			drmDevice *dev = devices[i];
+			if (!(dev->available_nodes & (1 << DRM_NODE_PRIMARY)))
 				continue;
 
-			json_object_object_add(obj, *path, dev);
+			nodes[n_nodes++].path = dev->nodes[DRM_NODE_PRIMARY];
+		}
+	} else {
+		while (paths[n_nodes])
+			++n_nodes;
+
+		nodes = calloc_or_abort(n_nodes, sizeof(*nodes));
+		for (size_t i = 0; i < n_nodes; ++i)
+			nodes[i].path = paths[i];
+	}
+
+	int object_jobs = opts->object_jobs > 0 ?
+		opts->object_jobs : DEFAULT_OBJECT_JOBS;
+	struct node_cache *caches = calloc_or_abort(n_nodes + 1,
+		sizeof(*caches));
+	for (size_t i = 0; i < n_nodes; ++i) {
+		pthread_mutex_init(&caches[i].lock, NULL);
+		nodes[i].cache = &caches[i];
+		nodes[i].jobs = object_jobs;
+		nodes[i].sel = opts->sel;
+		nodes[i].sysfs_root = opts->sysfs_root;
+		nodes[i].debugfs_root = opts->debugfs_root;
+		nodes[i].blob_contents = opts->blob_contents;
+	}
+
+	struct node_sink sink = {
+		.opts = opts,
+		.enumerate = enumerate,
+		.func = func,
+		.data = data,
+	};
+	bool all_done = collect_nodes(nodes, n_nodes, &sink);
+
+	// Nodes which timed out may still be running and using their memory,
+	// so it's only freed if everything finished
+	if (all_done) {
+		free(caches);
+		free(nodes);
+		if (enumerate) {
+			drmFreeDevices(devices, n_devices);
+			free(devices);
 		}
+	} else {
+		park_abandoned_nodes(devices, nodes, caches);
 	}
 
-	return obj;
+	return true;
 }
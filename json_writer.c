@@ -0,0 +1,685 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "base64.h"
+#include "cbor.h"
+#include "compress.h"
+#include "json_writer.h"
+
+struct json_writer_shared_value {
+	uint64_t hash;
+	size_t offset, len;
+};
+
+struct json_writer_shared {
+	// Nesting of json_writer_shared_begin(), only the outermost value is
+	// shared
+	size_t depth;
+	// Offset of the value being written in data
+	size_t start;
+
+	// Bytes of every shared value, back to back
+	char *data;
+	size_t data_len, data_cap;
+	struct json_writer_shared_value *values;
+	size_t n_values, values_cap;
+	// Open-addressing hash table of indices in values, plus one
+	size_t *slots;
+	size_t slots_cap;
+};
+
+void json_writer_init(struct json_writer *w, int fd,
+		enum json_writer_format format)
+{
+	w->fd = fd;
+	w->format = format;
+	w->failed = false;
+	w->compressor = NULL;
+	w->depth = 0;
+	w->in_member = false;
+	w->measuring = false;
+	w->sizes = NULL;
+	w->n_sizes = w->sizes_cap = w->next_size = 0;
+	w->shared = NULL;
+	w->capturing = false;
+	w->len = 0;
+}
+
+void json_writer_finish(struct json_writer *w)
+{
+	free(w->sizes);
+	w->sizes = NULL;
+	w->n_sizes = w->sizes_cap = w->next_size = 0;
+
+	if (w->shared) {
+		free(w->shared->data);
+		free(w->shared->values);
+		free(w->shared->slots);
+		free(w->shared);
+		w->shared = NULL;
+	}
+}
+
+void json_writer_set_compressor(struct json_writer *w, struct compressor *c)
+{
+	w->compressor = c;
+}
+
+/* Writes out the buffer. Compressors only write out everything they were
+ * given with sync, which costs some compression ratio. */
+static void write_buf(struct json_writer *w, bool sync)
+{
+	if (w->compressor) {
+		if (!w->failed &&
+				!compressor_write(w->compressor, w->buf, w->len, sync)) {
+			w->failed = true;
+		}
+		w->len = 0;
+		return;
+	}
+
+	size_t off = 0;
+	while (off < w->len && !w->failed) {
+		ssize_t n = write(w->fd, w->buf + off, w->len - off);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			w->failed = true;
+			break;
+		}
+		off += n;
+	}
+	w->len = 0;
+}
+
+bool json_writer_flush(struct json_writer *w)
+{
+	write_buf(w, true);
+	return !w->failed;
+}
+
+bool json_writer_close(struct json_writer *w)
+{
+	write_buf(w, false);
+	if (w->compressor && !w->failed && !compressor_end(w->compressor)) {
+		w->failed = true;
+	}
+	return !w->failed;
+}
+
+static void *realloc_or_abort(void *ptr, size_t size)
+{
+	ptr = realloc(ptr, size);
+	if (!ptr) {
+		perror("realloc");
+		abort();
+	}
+	return ptr;
+}
+
+/* Makes room for len more bytes in the shared value being written, and
+ * returns where they go */
+static char *capture_reserve(struct json_writer *w, size_t len)
+{
+	struct json_writer_shared *shared = w->shared;
+	if (shared->data_len + len > shared->data_cap) {
+		while (shared->data_len + len > shared->data_cap) {
+			shared->data_cap = shared->data_cap ?
+				2 * shared->data_cap : 4096;
+		}
+		shared->data = realloc_or_abort(shared->data, shared->data_cap);
+	}
+	return shared->data + shared->data_len;
+}
+
+/* Appends to the shared value being written */
+static void capture(struct json_writer *w, const void *data, size_t len)
+{
+	memcpy(capture_reserve(w, len), data, len);
+	w->shared->data_len += len;
+}
+
+static void append(struct json_writer *w, const void *data, size_t len)
+{
+	if (w->capturing) {
+		capture(w, data, len);
+		return;
+	}
+
+	const char *ptr = data;
+	while (len > 0) {
+		if (w->len == sizeof(w->buf)) {
+			write_buf(w, false);
+		}
+		size_t n = sizeof(w->buf) - w->len;
+		if (n > len) {
+			n = len;
+		}
+		memcpy(w->buf + w->len, ptr, n);
+		w->len += n;
+		ptr += n;
+		len -= n;
+	}
+}
+
+static void append_char(struct json_writer *w, char c)
+{
+	if (w->capturing) {
+		capture(w, &c, 1);
+		return;
+	}
+	if (w->len == sizeof(w->buf)) {
+		write_buf(w, false);
+	}
+	w->buf[w->len++] = c;
+}
+
+/* Encodes data straight into the buffer, in chunks of whole 3-byte groups
+ * which fit */
+static void append_base64(struct json_writer *w, const unsigned char *data,
+		size_t len)
+{
+	if (w->capturing) {
+		char *dst = capture_reserve(w, BASE64_ENCODED_LEN(len));
+		w->shared->data_len += base64_encode(dst, data, len);
+		return;
+	}
+
+	while (len > 0) {
+		if (sizeof(w->buf) - w->len < 4) {
+			write_buf(w, false);
+		}
+		size_t n = (sizeof(w->buf) - w->len) / 4 * 3;
+		if (n > len) {
+			n = len;
+		}
+		w->len += base64_encode(w->buf + w->len, data, n);
+		data += n;
+		len -= n;
+	}
+}
+
+static void append_str(struct json_writer *w, const char *str)
+{
+	append(w, str, strlen(str));
+}
+
+/* Writes the initial bytes of a CBOR data item, with val in the shortest
+ * form */
+static void cbor_head(struct json_writer *w, int major, uint64_t val)
+{
+	unsigned char head[9];
+	size_t n;
+	if (val < 24) {
+		head[0] = major << 5 | val;
+		n = 1;
+	} else if (val <= UINT8_MAX) {
+		head[0] = major << 5 | 24;
+		n = 2;
+	} else if (val <= UINT16_MAX) {
+		head[0] = major << 5 | 25;
+		n = 3;
+	} else if (val <= UINT32_MAX) {
+		head[0] = major << 5 | 26;
+		n = 5;
+	} else {
+		head[0] = major << 5 | 27;
+		n = 9;
+	}
+	// Big-endian argument
+	for (size_t i = n - 1; i > 0; --i) {
+		head[i] = val & 0xFF;
+		val >>= 8;
+	}
+	append(w, head, n);
+}
+
+static void indent(struct json_writer *w, size_t level)
+{
+	static const char spaces[] = "                                ";
+	size_t n = 2 * level;
+	while (n > 0) {
+		size_t m = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+		append(w, spaces, m);
+		n -= m;
+	}
+}
+
+/* Starts a new member of the innermost container, unless it's an object
+ * member whose key was already written. Returns false if the value must not
+ * be written, because it's only being measured. */
+static bool begin_value(struct json_writer *w)
+{
+	if (w->in_member) {
+		w->in_member = false;
+		return !w->measuring;
+	}
+	if (w->measuring) {
+		// Containers outside of the measured value are left alone
+		if (w->depth > w->measure_depth) {
+			++w->sizes[w->levels[w->depth - 1].size_index];
+		}
+		return false;
+	}
+	if (w->depth == 0) {
+		return true;
+	}
+
+	struct json_writer_level *level = &w->levels[w->depth - 1];
+
+	if (w->format != JSON_WRITER_CBOR && level->n_members > 0) {
+		append_char(w, ',');
+	}
+	++level->n_members;
+	if (w->format == JSON_WRITER_PRETTY) {
+		append_char(w, '\n');
+		indent(w, w->depth);
+	}
+	return true;
+}
+
+static void escape(struct json_writer *w, const char *str, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	// Copy runs of characters which don't need escaping at once
+	size_t start = 0;
+	for (size_t i = 0; i < len; ++i) {
+		unsigned char c = str[i];
+		if (c >= ' ' && c != '"' && c != '\\' && c != '/') {
+			continue;
+		}
+
+		append(w, str + start, i - start);
+		start = i + 1;
+
+		char esc[6] = { '\\', 0 };
+		size_t esc_len = 2;
+		switch (c) {
+		case '\b': esc[1] = 'b'; break;
+		case '\n': esc[1] = 'n'; break;
+		case '\r': esc[1] = 'r'; break;
+		case '\t': esc[1] = 't'; break;
+		case '\f': esc[1] = 'f'; break;
+		case '"':
+		case '\\':
+		case '/':
+			esc[1] = c;
+			break;
+		default:
+			memcpy(esc + 1, "u00", 3);
+			esc[4] = hex[c >> 4];
+			esc[5] = hex[c & 0xF];
+			esc_len = 6;
+			break;
+		}
+		append(w, esc, esc_len);
+	}
+	append(w, str + start, len - start);
+}
+
+static void write_string(struct json_writer *w, const char *str, size_t len)
+{
+	if (w->format == JSON_WRITER_CBOR) {
+		cbor_head(w, CBOR_TEXT, len);
+		append(w, str, len);
+		return;
+	}
+
+	append_char(w, '"');
+	escape(w, str, len);
+	append_char(w, '"');
+}
+
+static void container_begin(struct json_writer *w, int major, char c)
+{
+	bool write = begin_value(w);
+	if (w->depth == JSON_WRITER_MAX_DEPTH) {
+		fprintf(stderr, "JSON nested too deeply\n");
+		abort();
+	}
+	struct json_writer_level *level = &w->levels[w->depth++];
+	*level = (struct json_writer_level){0};
+
+	if (w->measuring) {
+		if (w->n_sizes == w->sizes_cap) {
+			w->sizes_cap = w->sizes_cap ? 2 * w->sizes_cap : 64;
+			w->sizes = realloc_or_abort(w->sizes,
+				w->sizes_cap * sizeof(*w->sizes));
+		}
+		level->size_index = w->n_sizes;
+		w->sizes[w->n_sizes++] = 0;
+		return;
+	}
+	if (!write) {
+		return;
+	}
+
+	if (w->format != JSON_WRITER_CBOR) {
+		append_char(w, c);
+	} else if (w->next_size < w->n_sizes) {
+		cbor_head(w, major, w->sizes[w->next_size++]);
+	} else {
+		level->indefinite = true;
+		append_char(w, major << 5 | CBOR_INDEFINITE);
+	}
+}
+
+static void container_end(struct json_writer *w, char c)
+{
+	struct json_writer_level *level = &w->levels[--w->depth];
+	if (w->measuring) {
+		return;
+	}
+
+	switch (w->format) {
+	case JSON_WRITER_PRETTY:
+		// Like json-c, even if the container is empty
+		append_char(w, '\n');
+		indent(w, w->depth);
+		/* fallthrough */
+	case JSON_WRITER_COMPACT:
+		append_char(w, c);
+		break;
+	case JSON_WRITER_CBOR:
+		if (level->indefinite) {
+			append_char(w, (char)CBOR_BREAK);
+		}
+		break;
+	}
+}
+
+void json_writer_object_begin(struct json_writer *w)
+{
+	container_begin(w, CBOR_MAP, '{');
+}
+
+void json_writer_object_end(struct json_writer *w)
+{
+	container_end(w, '}');
+}
+
+void json_writer_array_begin(struct json_writer *w)
+{
+	container_begin(w, CBOR_ARRAY, '[');
+}
+
+void json_writer_array_end(struct json_writer *w)
+{
+	container_end(w, ']');
+}
+
+void json_writer_key(struct json_writer *w, const char *key)
+{
+	bool write = begin_value(w);
+	w->in_member = true;
+	if (!write) {
+		return;
+	}
+
+	write_string(w, key, strlen(key));
+	switch (w->format) {
+	case JSON_WRITER_PRETTY:
+		append(w, ": ", 2);
+		break;
+	case JSON_WRITER_COMPACT:
+		append_char(w, ':');
+		break;
+	case JSON_WRITER_CBOR:
+		break;
+	}
+}
+
+void json_writer_null(struct json_writer *w)
+{
+	if (!begin_value(w)) {
+		return;
+	}
+	if (w->format == JSON_WRITER_CBOR) {
+		append_char(w, (char)CBOR_NULL);
+	} else {
+		append(w, "null", 4);
+	}
+}
+
+void json_writer_bool(struct json_writer *w, bool val)
+{
+	if (!begin_value(w)) {
+		return;
+	}
+	if (w->format == JSON_WRITER_CBOR) {
+		append_char(w, (char)(val ? CBOR_TRUE : CBOR_FALSE));
+	} else {
+		append_str(w, val ? "true" : "false");
+	}
+}
+
+static void append_uint64(struct json_writer *w, uint64_t val)
+{
+	char str[20];
+	size_t i = sizeof(str);
+	do {
+		str[--i] = '0' + val % 10;
+		val /= 10;
+	} while (val > 0);
+	append(w, str + i, sizeof(str) - i);
+}
+
+void json_writer_uint64(struct json_writer *w, uint64_t val)
+{
+	if (!begin_value(w)) {
+		return;
+	}
+	if (w->format == JSON_WRITER_CBOR) {
+		cbor_head(w, CBOR_UINT, val);
+	} else {
+		append_uint64(w, val);
+	}
+}
+
+void json_writer_int64(struct json_writer *w, int64_t val)
+{
+	if (!begin_value(w)) {
+		return;
+	}
+	if (w->format == JSON_WRITER_CBOR) {
+		if (val < 0) {
+			// Encoded as -1 - n
+			cbor_head(w, CBOR_NEGINT, ~(uint64_t)val);
+		} else {
+			cbor_head(w, CBOR_UINT, val);
+		}
+	} else if (val < 0) {
+		append_char(w, '-');
+		// Negate in unsigned arithmetic, which also works for INT64_MIN
+		append_uint64(w, -(uint64_t)val);
+	} else {
+		append_uint64(w, val);
+	}
+}
+
+void json_writer_string(struct json_writer *w, const char *str)
+{
+	json_writer_string_len(w, str, strlen(str));
+}
+
+void json_writer_string_len(struct json_writer *w, const char *str,
+		size_t len)
+{
+	if (!begin_value(w)) {
+		return;
+	}
+	write_string(w, str, len);
+}
+
+void json_writer_bytes(struct json_writer *w, const void *data, size_t len)
+{
+	if (!begin_value(w)) {
+		return;
+	}
+	if (w->format == JSON_WRITER_CBOR) {
+		cbor_head(w, CBOR_TAG, CBOR_TAG_BASE64);
+		cbor_head(w, CBOR_BYTES, len);
+		append(w, data, len);
+		return;
+	}
+
+	append_char(w, '"');
+	append_base64(w, data, len);
+	append_char(w, '"');
+}
+
+void json_writer_raw(struct json_writer *w, const char *str)
+{
+	append_str(w, str);
+}
+
+void json_writer_cbor_magic(struct json_writer *w)
+{
+	cbor_head(w, CBOR_TAG, CBOR_TAG_SELF_DESCRIBED);
+}
+
+void json_writer_measure_begin(struct json_writer *w)
+{
+	w->measuring = true;
+	w->measure_depth = w->depth;
+	w->n_sizes = w->next_size = 0;
+	w->saved_in_member = w->in_member;
+}
+
+void json_writer_measure_end(struct json_writer *w)
+{
+	w->measuring = false;
+	w->in_member = w->saved_in_member;
+}
+
+void json_writer_enable_shared(struct json_writer *w)
+{
+	w->shared = calloc(1, sizeof(*w->shared));
+	if (!w->shared) {
+		perror("calloc");
+		abort();
+	}
+}
+
+/* 64-bit FNV-1a */
+static uint64_t shared_hash(const char *data, size_t len)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= (unsigned char)data[i];
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+static void shared_slots_insert(struct json_writer_shared *shared,
+		size_t index)
+{
+	size_t mask = shared->slots_cap - 1;
+	size_t i = shared->values[index].hash & mask;
+	while (shared->slots[i]) {
+		i = (i + 1) & mask;
+	}
+	shared->slots[i] = index + 1;
+}
+
+/* Returns the index of the value, adding it if it's new */
+static size_t shared_intern(struct json_writer_shared *shared, size_t offset,
+		size_t len)
+{
+	const char *data = shared->data + offset;
+	uint64_t hash = shared_hash(data, len);
+
+	if (shared->slots_cap > 0) {
+		size_t mask = shared->slots_cap - 1;
+		for (size_t i = hash & mask; shared->slots[i]; i = (i + 1) & mask) {
+			const struct json_writer_shared_value *v =
+				&shared->values[shared->slots[i] - 1];
+			if (v->hash == hash && v->len == len &&
+					memcmp(shared->data + v->offset, data, len) == 0) {
+				// Drop the copy
+				shared->data_len = offset;
+				return shared->slots[i] - 1;
+			}
+		}
+	}
+
+	if (shared->n_values == shared->values_cap) {
+		shared->values_cap = shared->values_cap ?
+			2 * shared->values_cap : 64;
+		shared->values = realloc_or_abort(shared->values,
+			shared->values_cap * sizeof(*shared->values));
+	}
+	size_t index = shared->n_values++;
+	shared->values[index] = (struct json_writer_shared_value){
+		.hash = hash,
+		.offset = offset,
+		.len = len,
+	};
+
+	if (shared->n_values * 2 > shared->slots_cap) {
+		free(shared->slots);
+		shared->slots_cap = shared->slots_cap ? 2 * shared->slots_cap : 128;
+		shared->slots = calloc(shared->slots_cap, sizeof(*shared->slots));
+		if (!shared->slots) {
+			perror("calloc");
+			abort();
+		}
+		for (size_t i = 0; i < shared->n_values; ++i) {
+			shared_slots_insert(shared, i);
+		}
+	} else {
+		shared_slots_insert(shared, index);
+	}
+	return index;
+}
+
+void json_writer_shared_begin(struct json_writer *w)
+{
+	struct json_writer_shared *shared = w->shared;
+	if (!shared || shared->depth++ > 0) {
+		return;
+	}
+
+	// The separator goes to the output, before the reference, and the value
+	// is written as if it was at the top level
+	begin_value(w);
+	w->in_member = true;
+	shared->start = shared->data_len;
+	w->capturing = true;
+}
+
+void json_writer_shared_end(struct json_writer *w)
+{
+	struct json_writer_shared *shared = w->shared;
+	if (!shared || --shared->depth > 0) {
+		return;
+	}
+
+	w->capturing = false;
+	size_t index = shared_intern(shared, shared->start,
+		shared->data_len - shared->start);
+
+	// The separator was already written
+	w->in_member = true;
+	json_writer_object_begin(w);
+	json_writer_key(w, "$ref");
+	json_writer_uint64(w, index);
+	json_writer_object_end(w);
+}
+
+void json_writer_shared_write(struct json_writer *w)
+{
+	json_writer_array_begin(w);
+	for (size_t i = 0; w->shared && i < w->shared->n_values; ++i) {
+		const struct json_writer_shared_value *v = &w->shared->values[i];
+		begin_value(w);
+		append(w, w->shared->data + v->offset, v->len);
+	}
+	json_writer_array_end(w);
+}
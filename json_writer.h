@@ -0,0 +1,124 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Streaming emitter for the JSON data model, writing to a file descriptor
+ * through a fixed-size buffer, so memory use doesn't depend on the size of the
+ * document.
+ *
+ * Pretty output is byte-for-byte what json-c prints with
+ * JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_SPACED, compact output what it
+ * prints with JSON_C_TO_STRING_PLAIN. CBOR output (RFC 8949) uses the
+ * shortest encoding of integers and lengths, and text strings for keys.
+ *
+ * Values inside an object must be preceded by json_writer_key(). Write errors
+ * are sticky and reported by json_writer_flush(). */
+
+#define JSON_WRITER_MAX_DEPTH 32
+#define JSON_WRITER_BUF_SIZE (64 * 1024)
+
+enum json_writer_format {
+	JSON_WRITER_PRETTY,
+	JSON_WRITER_COMPACT,
+	JSON_WRITER_CBOR,
+};
+
+struct json_writer_level {
+	size_t n_members;
+	// CBOR only, containers which weren't measured have an indefinite length
+	bool indefinite;
+	size_t size_index;
+};
+
+struct compressor;
+struct json_writer_shared;
+
+struct json_writer {
+	int fd;
+	enum json_writer_format format;
+	bool failed;
+	// Compresses the output if set
+	struct compressor *compressor;
+
+	// Nesting stack of the open containers
+	size_t depth;
+	struct json_writer_level levels[JSON_WRITER_MAX_DEPTH];
+	// Set between a key and its value
+	bool in_member;
+
+	// Number of members of each container, in the order they were begun,
+	// while measuring and then while writing the measured value
+	bool measuring;
+	size_t measure_depth;
+	size_t *sizes;
+	size_t n_sizes, sizes_cap, next_size;
+	bool saved_in_member;
+
+	// Dictionary of shared values, NULL unless enabled
+	struct json_writer_shared *shared;
+	// Set while a shared value is being written to the dictionary
+	bool capturing;
+
+	size_t len;
+	char buf[JSON_WRITER_BUF_SIZE];
+};
+
+void json_writer_init(struct json_writer *w, int fd,
+	enum json_writer_format format);
+void json_writer_finish(struct json_writer *w);
+/* Compresses everything written from now on with c, which must outlive the
+ * writer */
+void json_writer_set_compressor(struct json_writer *w, struct compressor *c);
+
+void json_writer_object_begin(struct json_writer *w);
+void json_writer_object_end(struct json_writer *w);
+void json_writer_array_begin(struct json_writer *w);
+void json_writer_array_end(struct json_writer *w);
+void json_writer_key(struct json_writer *w, const char *key);
+
+void json_writer_null(struct json_writer *w);
+void json_writer_bool(struct json_writer *w, bool val);
+void json_writer_uint64(struct json_writer *w, uint64_t val);
+void json_writer_int64(struct json_writer *w, int64_t val);
+void json_writer_string(struct json_writer *w, const char *str);
+void json_writer_string_len(struct json_writer *w, const char *str,
+	size_t len);
+/* Writes a base64 string, or in CBOR a byte string tagged for conversion to
+ * base64 */
+void json_writer_bytes(struct json_writer *w, const void *data, size_t len);
+/* Writes str as is, outside of any container */
+void json_writer_raw(struct json_writer *w, const char *str);
+/* Writes the self-described CBOR tag, which marks the data as CBOR */
+void json_writer_cbor_magic(struct json_writer *w);
+
+/* CBOR has the length of containers up front. Between
+ * json_writer_measure_begin() and json_writer_measure_end(), a single value is
+ * only measured and nothing is written, and the exact same value must then be
+ * written again. Containers which weren't measured get an indefinite length.
+ * Only valid for CBOR. */
+void json_writer_measure_begin(struct json_writer *w);
+void json_writer_measure_end(struct json_writer *w);
+
+/* Shared values are written once, to a dictionary, and referred to as
+ * {"$ref": index} wherever they appear. Between json_writer_shared_begin() and
+ * json_writer_shared_end(), a single value is written to the dictionary
+ * instead of the output, unless the same bytes are already there. Nested
+ * shared values are written inline. Only valid for compact JSON. */
+void json_writer_enable_shared(struct json_writer *w);
+void json_writer_shared_begin(struct json_writer *w);
+void json_writer_shared_end(struct json_writer *w);
+/* Writes the array of the shared values written so far, indexed by their
+ * references */
+void json_writer_shared_write(struct json_writer *w);
+
+/* Writes out everything buffered so far, including what the compressor holds
+ * back. Returns false if any write failed since the writer was initialised. */
+bool json_writer_flush(struct json_writer *w);
+/* Writes out everything buffered so far and ends the compressed stream, if
+ * any. Returns false if any write failed since the writer was initialised. */
+bool json_writer_close(struct json_writer *w);
+
+#endif
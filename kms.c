@@ -0,0 +1,430 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "kms.h"
+
+#ifdef USE_RAW_IOCTL
+
+static bool buf_reserve(struct kms_buf *buf, size_t size)
+{
+	if (size <= buf->cap) {
+		return true;
+	}
+
+	size_t cap = buf->cap ? buf->cap : 64;
+	while (cap < size)
+		cap *= 2;
+
+	void *data = realloc(buf->data, cap);
+	if (!data) {
+		errno = ENOMEM;
+		return false;
+	}
+	buf->data = data;
+	buf->cap = cap;
+	return true;
+}
+
+static uint32_t buf_count(const struct kms_buf *buf, size_t elem_size)
+{
+	return buf->cap / elem_size;
+}
+
+static uint64_t buf_ptr(const struct kms_buf *buf)
+{
+	return (uint64_t)(uintptr_t)buf->data;
+}
+
+static int kms_ioctl(struct kms *kms, unsigned long req, void *arg)
+{
+	++kms->ioctls;
+	return drmIoctl(kms->fd, req, arg);
+}
+
+void kms_init(struct kms *kms, int fd)
+{
+	memset(kms, 0, sizeof(*kms));
+	kms->fd = fd;
+
+	// Big enough for most objects, so that even the first one only needs
+	// a single ioctl. Failures are caught when the buffers are used.
+	buf_reserve(&kms->conn_modes, 16 * sizeof(struct drm_mode_modeinfo));
+	buf_reserve(&kms->conn_props, 32 * sizeof(uint32_t));
+	buf_reserve(&kms->conn_values, 32 * sizeof(uint64_t));
+	buf_reserve(&kms->conn_encoders, 8 * sizeof(uint32_t));
+	buf_reserve(&kms->plane_formats, 64 * sizeof(uint32_t));
+	buf_reserve(&kms->obj_props_ids, 32 * sizeof(uint32_t));
+	buf_reserve(&kms->obj_props_values, 32 * sizeof(uint64_t));
+	buf_reserve(&kms->prop_values, 16 * sizeof(uint64_t));
+	buf_reserve(&kms->prop_enums, 16 * sizeof(struct drm_mode_property_enum));
+}
+
+void kms_finish(struct kms *kms)
+{
+	struct kms_buf *bufs[] = {
+		&kms->conn_modes, &kms->conn_props, &kms->conn_values,
+		&kms->conn_encoders, &kms->plane_formats, &kms->obj_props_ids,
+		&kms->obj_props_values, &kms->prop_values, &kms->prop_enums,
+		&kms->blob_data,
+	};
+	for (size_t i = 0; i < sizeof(bufs) / sizeof(bufs[0]); ++i)
+		free(bufs[i]->data);
+}
+
+drmModeConnector *kms_get_connector(struct kms *kms, uint32_t id)
+{
+	struct drm_mode_get_connector conn;
+	while (1) {
+		// count_modes must never be 0, otherwise the kernel probes the
+		// connector
+		if (!buf_reserve(&kms->conn_modes, sizeof(struct drm_mode_modeinfo))) {
+			return NULL;
+		}
+
+		uint32_t count_props = buf_count(&kms->conn_props, sizeof(uint32_t));
+		uint32_t count_values = buf_count(&kms->conn_values, sizeof(uint64_t));
+		if (count_values < count_props)
+			count_props = count_values;
+
+		memset(&conn, 0, sizeof(conn));
+		conn.connector_id = id;
+		conn.count_modes = buf_count(&kms->conn_modes,
+			sizeof(struct drm_mode_modeinfo));
+		conn.modes_ptr = buf_ptr(&kms->conn_modes);
+		conn.count_props = count_props;
+		conn.props_ptr = buf_ptr(&kms->conn_props);
+		conn.prop_values_ptr = buf_ptr(&kms->conn_values);
+		conn.count_encoders = buf_count(&kms->conn_encoders, sizeof(uint32_t));
+		conn.encoders_ptr = buf_ptr(&kms->conn_encoders);
+
+		uint32_t count_modes = conn.count_modes;
+		uint32_t count_encoders = conn.count_encoders;
+
+		if (kms_ioctl(kms, DRM_IOCTL_MODE_GETCONNECTOR, &conn) != 0) {
+			return NULL;
+		}
+
+		if (conn.count_modes <= count_modes &&
+				conn.count_props <= count_props &&
+				conn.count_encoders <= count_encoders) {
+			break;
+		}
+
+		// The arrays didn't fit, grow them and try again
+		if (!buf_reserve(&kms->conn_modes,
+					conn.count_modes * sizeof(struct drm_mode_modeinfo)) ||
+				!buf_reserve(&kms->conn_props,
+					conn.count_props * sizeof(uint32_t)) ||
+				!buf_reserve(&kms->conn_values,
+					conn.count_props * sizeof(uint64_t)) ||
+				!buf_reserve(&kms->conn_encoders,
+					conn.count_encoders * sizeof(uint32_t))) {
+			return NULL;
+		}
+	}
+
+	drmModeConnector *r = &kms->conn;
+	r->connector_id = conn.connector_id;
+	r->encoder_id = conn.encoder_id;
+	r->connection = conn.connection;
+	r->mmWidth = conn.mm_width;
+	r->mmHeight = conn.mm_height;
+	// Same conversion from the kernel's subpixel order as libdrm
+	r->subpixel = conn.subpixel + 1;
+	r->count_modes = conn.count_modes;
+	r->modes = kms->conn_modes.data;
+	r->count_props = conn.count_props;
+	r->props = kms->conn_props.data;
+	r->prop_values = kms->conn_values.data;
+	r->count_encoders = conn.count_encoders;
+	r->encoders = kms->conn_encoders.data;
+	r->connector_type = conn.connector_type;
+	r->connector_type_id = conn.connector_type_id;
+	return r;
+}
+
+void kms_free_connector(struct kms *kms, drmModeConnector *conn)
+{
+	// Owned by kms
+	(void)kms;
+	(void)conn;
+}
+
+drmModePlane *kms_get_plane(struct kms *kms, uint32_t id)
+{
+	struct drm_mode_get_plane plane;
+	while (1) {
+		memset(&plane, 0, sizeof(plane));
+		plane.plane_id = id;
+		plane.count_format_types =
+			buf_count(&kms->plane_formats, sizeof(uint32_t));
+		plane.format_type_ptr = buf_ptr(&kms->plane_formats);
+
+		uint32_t count_formats = plane.count_format_types;
+
+		if (kms_ioctl(kms, DRM_IOCTL_MODE_GETPLANE, &plane) != 0) {
+			return NULL;
+		}
+
+		if (plane.count_format_types <= count_formats) {
+			break;
+		}
+
+		if (!buf_reserve(&kms->plane_formats,
+				plane.count_format_types * sizeof(uint32_t))) {
+			return NULL;
+		}
+	}
+
+	drmModePlane *r = &kms->plane;
+	memset(r, 0, sizeof(*r));
+	r->count_formats = plane.count_format_types;
+	r->formats = kms->plane_formats.data;
+	r->plane_id = plane.plane_id;
+	r->crtc_id = plane.crtc_id;
+	r->fb_id = plane.fb_id;
+	r->possible_crtcs = plane.possible_crtcs;
+	r->gamma_size = plane.gamma_size;
+	return r;
+}
+
+void kms_free_plane(struct kms *kms, drmModePlane *plane)
+{
+	// Owned by kms
+	(void)kms;
+	(void)plane;
+}
+
+drmModeObjectProperties *kms_get_properties(struct kms *kms, uint32_t id,
+		uint32_t type)
+{
+	struct drm_mode_obj_get_properties props;
+	while (1) {
+		uint32_t count_props =
+			buf_count(&kms->obj_props_ids, sizeof(uint32_t));
+		uint32_t count_values =
+			buf_count(&kms->obj_props_values, sizeof(uint64_t));
+		if (count_values < count_props)
+			count_props = count_values;
+
+		memset(&props, 0, sizeof(props));
+		props.obj_id = id;
+		props.obj_type = type;
+		props.count_props = count_props;
+		props.props_ptr = buf_ptr(&kms->obj_props_ids);
+		props.prop_values_ptr = buf_ptr(&kms->obj_props_values);
+
+		if (kms_ioctl(kms, DRM_IOCTL_MODE_OBJ_GETPROPERTIES, &props) != 0) {
+			return NULL;
+		}
+
+		if (props.count_props <= count_props) {
+			break;
+		}
+
+		if (!buf_reserve(&kms->obj_props_ids,
+					props.count_props * sizeof(uint32_t)) ||
+				!buf_reserve(&kms->obj_props_values,
+					props.count_props * sizeof(uint64_t))) {
+			return NULL;
+		}
+	}
+
+	drmModeObjectProperties *r = &kms->obj_props;
+	r->count_props = props.count_props;
+	r->props = kms->obj_props_ids.data;
+	r->prop_values = kms->obj_props_values.data;
+	return r;
+}
+
+void kms_free_properties(struct kms *kms, drmModeObjectProperties *props)
+{
+	// Owned by kms
+	(void)kms;
+	(void)props;
+}
+
+drmModePropertyRes *kms_get_property(struct kms *kms, uint32_t id)
+{
+	struct drm_mode_get_property prop;
+	while (1) {
+		// enum_blob_ptr holds either enums or blob IDs, the latter are
+		// smaller
+		memset(&prop, 0, sizeof(prop));
+		prop.prop_id = id;
+		prop.count_values = buf_count(&kms->prop_values, sizeof(uint64_t));
+		prop.values_ptr = buf_ptr(&kms->prop_values);
+		prop.count_enum_blobs = buf_count(&kms->prop_enums,
+			sizeof(struct drm_mode_property_enum));
+		prop.enum_blob_ptr = buf_ptr(&kms->prop_enums);
+
+		uint32_t count_values = prop.count_values;
+		uint32_t count_enum_blobs = prop.count_enum_blobs;
+
+		if (kms_ioctl(kms, DRM_IOCTL_MODE_GETPROPERTY, &prop) != 0) {
+			return NULL;
+		}
+
+		if (prop.count_values <= count_values &&
+				prop.count_enum_blobs <= count_enum_blobs) {
+			break;
+		}
+
+		if (!buf_reserve(&kms->prop_values,
+					prop.count_values * sizeof(uint64_t)) ||
+				!buf_reserve(&kms->prop_enums, prop.count_enum_blobs *
+					sizeof(struct drm_mode_property_enum))) {
+			return NULL;
+		}
+	}
+
+	drmModePropertyRes *r = &kms->prop;
+	memset(r, 0, sizeof(*r));
+	r->prop_id = prop.prop_id;
+	r->flags = prop.flags;
+	memcpy(r->name, prop.name, sizeof(r->name));
+	r->name[sizeof(r->name) - 1] = '\0';
+	r->count_values = prop.count_values;
+	r->values = kms->prop_values.data;
+	if (prop.flags & (DRM_MODE_PROP_ENUM | DRM_MODE_PROP_BITMASK)) {
+		r->count_enums = prop.count_enum_blobs;
+		r->enums = kms->prop_enums.data;
+	} else if (prop.flags & DRM_MODE_PROP_BLOB) {
+		r->count_blobs = prop.count_enum_blobs;
+		r->blob_ids = kms->prop_enums.data;
+	}
+	return r;
+}
+
+void kms_free_property(struct kms *kms, drmModePropertyRes *prop)
+{
+	// Owned by kms
+	(void)kms;
+	(void)prop;
+}
+
+drmModePropertyBlobRes *kms_get_blob(struct kms *kms, uint32_t id)
+{
+	// The kernel only copies the blob if the length matches exactly, so
+	// guess it's the same as the previous one. Blobs of a given kind often
+	// are, e.g. IN_FORMATS or MODE_ID.
+	struct drm_mode_get_blob blob = {
+		.blob_id = id,
+		.length = kms->blob.length,
+		.data = buf_ptr(&kms->blob_data),
+	};
+	while (1) {
+		uint32_t length = blob.length;
+
+		if (kms_ioctl(kms, DRM_IOCTL_MODE_GETPROPBLOB, &blob) != 0) {
+			return NULL;
+		}
+
+		if (blob.length == length) {
+			break;
+		}
+
+		if (!buf_reserve(&kms->blob_data, blob.length)) {
+			return NULL;
+		}
+		blob.data = buf_ptr(&kms->blob_data);
+	}
+
+	drmModePropertyBlobRes *r = &kms->blob;
+	r->id = id;
+	r->length = blob.length;
+	r->data = kms->blob_data.data;
+	return r;
+}
+
+void kms_free_blob(struct kms *kms, drmModePropertyBlobRes *blob)
+{
+	// Owned by kms
+	(void)kms;
+	(void)blob;
+}
+
+#else
+
+void kms_init(struct kms *kms, int fd)
+{
+	memset(kms, 0, sizeof(*kms));
+	kms->fd = fd;
+}
+
+void kms_finish(struct kms *kms)
+{
+	// Nothing to do
+	(void)kms;
+}
+
+/* libdrm's getters issue one ioctl for the array sizes, then another one
+ * to fill them in. */
+
+drmModeConnector *kms_get_connector(struct kms *kms, uint32_t id)
+{
+	kms->ioctls += 2;
+	return drmModeGetConnectorCurrent(kms->fd, id);
+}
+
+void kms_free_connector(struct kms *kms, drmModeConnector *conn)
+{
+	(void)kms;
+	drmModeFreeConnector(conn);
+}
+
+drmModePlane *kms_get_plane(struct kms *kms, uint32_t id)
+{
+	kms->ioctls += 2;
+	return drmModeGetPlane(kms->fd, id);
+}
+
+void kms_free_plane(struct kms *kms, drmModePlane *plane)
+{
+	(void)kms;
+	drmModeFreePlane(plane);
+}
+
+drmModeObjectProperties *kms_get_properties(struct kms *kms, uint32_t id,
+		uint32_t type)
+{
+	kms->ioctls += 2;
+	return drmModeObjectGetProperties(kms->fd, id, type);
+}
+
+void kms_free_properties(struct kms *kms, drmModeObjectProperties *props)
+{
+	(void)kms;
+	drmModeFreeObjectProperties(props);
+}
+
+drmModePropertyRes *kms_get_property(struct kms *kms, uint32_t id)
+{
+	kms->ioctls += 2;
+	return drmModeGetProperty(kms->fd, id);
+}
+
+void kms_free_property(struct kms *kms, drmModePropertyRes *prop)
+{
+	(void)kms;
+	drmModeFreeProperty(prop);
+}
+
+drmModePropertyBlobRes *kms_get_blob(struct kms *kms, uint32_t id)
+{
+	kms->ioctls += 2;
+	return drmModeGetPropertyBlob(kms->fd, id);
+}
+
+void kms_free_blob(struct kms *kms, drmModePropertyBlobRes *blob)
+{
+	(void)kms;
+	drmModeFreePropertyBlob(blob);
+}
+
+#endif
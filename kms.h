@@ -0,0 +1,67 @@
+#ifndef KMS_H
+#define KMS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <xf86drmMode.h>
+
+/* Wrappers for the KMS getters which return variable-length arrays.
+ *
+ * With USE_RAW_IOCTL, these issue DRM_IOCTL_MODE_* directly into scratch
+ * buffers owned by struct kms, which grow to the largest object seen so far.
+ * The first ioctl is sized from those buffers, so in the common case each
+ * object only takes a single ioctl and no allocation. Returned objects are
+ * only valid until the next call of the same getter.
+ *
+ * Otherwise, they forward to libdrm, which always issues one ioctl for the
+ * counts and another for the data. */
+
+struct kms_buf {
+	void *data;
+	size_t cap;
+};
+
+struct kms {
+	int fd;
+	unsigned int ioctls;
+
+#ifdef USE_RAW_IOCTL
+	drmModeConnector conn;
+	struct kms_buf conn_modes, conn_props, conn_values, conn_encoders;
+
+	drmModePlane plane;
+	struct kms_buf plane_formats;
+
+	drmModeObjectProperties obj_props;
+	struct kms_buf obj_props_ids, obj_props_values;
+
+	drmModePropertyRes prop;
+	struct kms_buf prop_values, prop_enums;
+
+	drmModePropertyBlobRes blob;
+	struct kms_buf blob_data;
+#endif
+};
+
+void kms_init(struct kms *kms, int fd);
+void kms_finish(struct kms *kms);
+
+/* Doesn't probe connectors, like drmModeGetConnectorCurrent */
+drmModeConnector *kms_get_connector(struct kms *kms, uint32_t id);
+void kms_free_connector(struct kms *kms, drmModeConnector *conn);
+
+drmModePlane *kms_get_plane(struct kms *kms, uint32_t id);
+void kms_free_plane(struct kms *kms, drmModePlane *plane);
+
+drmModeObjectProperties *kms_get_properties(struct kms *kms, uint32_t id,
+	uint32_t type);
+void kms_free_properties(struct kms *kms, drmModeObjectProperties *props);
+
+drmModePropertyRes *kms_get_property(struct kms *kms, uint32_t id);
+void kms_free_property(struct kms *kms, drmModePropertyRes *prop);
+
+drmModePropertyBlobRes *kms_get_blob(struct kms *kms, uint32_t id);
+void kms_free_blob(struct kms *kms, drmModePropertyBlobRes *blob);
+
+#endif
@@ -1,40 +1,325 @@
+#include <fcntl.h>
 #include <getopt.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
-#include <json_object.h>
-#include <json_util.h>
-
+#include "compress.h"
 #include "drm_info.h"
+#include "input.h"
+#include "json_writer.h"
+#include "model.h"
+#include "modifiers.h"
+#include "pci_names.h"
+#include "selector.h"
+#include "tree_writer.h"
+
+struct json_printer {
+	struct json_writer writer;
+	const struct selector *sel;
+};
+
+/* Streams a node as a member of the top-level object, which is left open
+ * until every node has been printed */
+static void print_json_node(const char *path, const struct model_node *node,
+		void *data)
+{
+	struct json_printer *printer = data;
+
+	json_writer_key(&printer->writer, path);
+	if (printer->writer.format == JSON_WRITER_CBOR) {
+		// CBOR needs the lengths of containers up front
+		json_writer_measure_begin(&printer->writer);
+		model_node_write_json(&printer->writer, node, printer->sel);
+		json_writer_measure_end(&printer->writer);
+	}
+	model_node_write_json(&printer->writer, node, printer->sel);
+	json_writer_flush(&printer->writer);
+}
+
+struct pretty_printer {
+	struct tree_writer writer;
+	struct print_options opts;
+};
+
+static void print_pretty_node(const char *path, const struct model_node *node,
+		void *data)
+{
+	struct pretty_printer *printer = data;
+
+	print_node(&printer->writer, path, node, &printer->opts);
+	tree_writer_flush(&printer->writer);
+}
+
+static const struct option long_options[] = {
+	{ "timeout", required_argument, NULL, 'T' },
+	{ "sysfs", optional_argument, NULL, 'S' },
+	{ "debugfs", optional_argument, NULL, 'D' },
+	{ "compact", no_argument, NULL, 'C' },
+	{ "dedup", no_argument, NULL, 'U' },
+	{ "compress", optional_argument, NULL, 'Z' },
+	{ "group-formats", no_argument, NULL, 'G' },
+	{ "blob-contents", no_argument, NULL, 'B' },
+	{ "batch", no_argument, NULL, 'N' },
+	{ 0 },
+};
 
 int main(int argc, char *argv[])
 {
 	bool json = false;
+	bool dedup = false;
+	bool compress = false;
+	bool group_formats = false;
+	bool batch = false;
+	enum compress_format compress_format = COMPRESS_DEFAULT;
+	enum json_writer_format format = JSON_WRITER_PRETTY;
+	const char *input = NULL;
+	struct drm_info_options opts = {0};
+	struct selector *sel = NULL;
+
+	if (argc > 1 && strcmp(argv[1], "analyze") == 0) {
+		int ret = drm_info_analyze(argc - 1, &argv[1]);
+		modifier_info_finish();
+		return ret;
+	}
 
 	int opt;
-	while ((opt = getopt(argc, argv, "j")) != -1) {
+	char *end;
+	while ((opt = getopt_long(argc, argv, "ci:jJ:O:q:s", long_options,
+			NULL)) != -1) {
 		switch (opt) {
+		case 'c':
+			json = true;
+			format = JSON_WRITER_CBOR;
+			break;
+		case 'i':
+			input = optarg;
+			break;
 		case 'j':
 			json = true;
 			break;
+		case 'C':
+			json = true;
+			format = JSON_WRITER_COMPACT;
+			break;
+		case 'U':
+			dedup = true;
+			break;
+		case 'G':
+			group_formats = true;
+			break;
+		case 'B':
+			opts.blob_contents = true;
+			break;
+		case 'N':
+			batch = true;
+			break;
+		case 'Z':
+			compress = true;
+			if (!optarg) {
+				compress_format = COMPRESS_DEFAULT;
+			} else if (strcmp(optarg, "gzip") == 0) {
+				compress_format = COMPRESS_GZIP;
+			} else if (strcmp(optarg, "zstd") == 0) {
+				compress_format = COMPRESS_ZSTD;
+			} else {
+				fprintf(stderr, "invalid compression format: %s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'J':
+			opts.jobs = strtol(optarg, &end, 10);
+			if (*end != '\0' || opts.jobs <= 0) {
+				fprintf(stderr, "invalid number of jobs: %s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'O':
+			opts.object_jobs = strtol(optarg, &end, 10);
+			if (*end != '\0' || opts.object_jobs <= 0) {
+				fprintf(stderr, "invalid number of jobs: %s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'T':
+			opts.timeout = strtol(optarg, &end, 10);
+			if (*end != '\0' || opts.timeout <= 0) {
+				fprintf(stderr, "invalid timeout: %s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'q':
+			selector_destroy(sel);
+			sel = selector_parse(optarg);
+			if (!sel) {
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 's':
+			opts.stats = true;
+			break;
+		case 'S':
+			opts.sysfs_root = optarg ? optarg : "/sys";
+			break;
+		case 'D':
+			opts.debugfs_root = optarg ? optarg : "/sys/kernel/debug";
+			break;
 		default:
-			fprintf(stderr, "usage: drm_info [-j] [--] [path]...\n");
+			fprintf(stderr, "usage: drm_info [-j|-c] [-J jobs] [-O jobs] "
+				"[-q fields] [-s] [--timeout ms] [--sysfs[=root]] "
+				"[--debugfs[=root]] [--compact] [--dedup] "
+				"[--compress[=format]] [--group-formats] "
+				"[--blob-contents] [--] [path]...\n"
+				"       drm_info -i file [-j|-c] [-q fields] "
+				"[--compact] [--dedup] [--compress[=format]] "
+				"[--group-formats]\n"
+				"       drm_info -i file --batch [-J jobs] "
+				"[--group-formats]\n"
+				"       drm_info analyze [-j] [-J jobs] [path]...\n");
 			exit(opt == '?' ? EXIT_SUCCESS : EXIT_FAILURE);
 		}
 	}
 
-	struct json_object *obj = drm_info(&argv[optind]);
-	if (!obj) {
+	if (dedup) {
+		if (format == JSON_WRITER_CBOR) {
+			fprintf(stderr, "--dedup can't be used with -c\n");
+			exit(EXIT_FAILURE);
+		}
+		json = true;
+		format = JSON_WRITER_COMPACT;
+	}
+	if (sel && !json) {
+		fprintf(stderr, "-q requires -j\n");
 		exit(EXIT_FAILURE);
 	}
+	if (opts.sysfs_root && !sel) {
+		// Without it, every connector field is needed and sysfs is
+		// never enough
+		fprintf(stderr, "--sysfs requires -q\n");
+		exit(EXIT_FAILURE);
+	}
+	if (group_formats && json) {
+		fprintf(stderr, "--group-formats can't be used with -j or -c\n");
+		exit(EXIT_FAILURE);
+	}
+	if (opts.blob_contents && !json) {
+		fprintf(stderr, "--blob-contents requires -j or -c\n");
+		exit(EXIT_FAILURE);
+	}
+	if (compress && !json) {
+		fprintf(stderr, "--compress requires -j or -c\n");
+		exit(EXIT_FAILURE);
+	}
+	if (batch && (!input || json)) {
+		fprintf(stderr, "--batch requires -i, and can't be used with -j "
+			"or -c\n");
+		exit(EXIT_FAILURE);
+	}
+	if (input && argv[optind]) {
+		fprintf(stderr, "-i doesn't take any device paths\n");
+		exit(EXIT_FAILURE);
+	}
+	opts.sel = sel;
+
+	drm_info_func func = json ? print_json_node : print_pretty_node;
+	void *data;
+	struct json_printer *printer = NULL;
+	struct pretty_printer *pretty = NULL;
+	struct compressor *compressor = NULL;
+	if (!json) {
+		pretty = calloc(1, sizeof(*pretty));
+		if (!pretty) {
+			perror("calloc");
+			exit(EXIT_FAILURE);
+		}
+		tree_writer_init(&pretty->writer, STDOUT_FILENO);
+		pretty->opts.group_formats = group_formats;
+		data = pretty;
+	} else {
+		printer = calloc(1, sizeof(*printer));
+		if (!printer) {
+			perror("calloc");
+			exit(EXIT_FAILURE);
+		}
+		json_writer_init(&printer->writer, STDOUT_FILENO, format);
+		printer->sel = sel;
+		if (compress) {
+			compressor = compressor_create(compress_format,
+				STDOUT_FILENO);
+			if (!compressor) {
+				exit(EXIT_FAILURE);
+			}
+			json_writer_set_compressor(&printer->writer, compressor);
+		}
+		if (dedup) {
+			json_writer_enable_shared(&printer->writer);
+		}
+		if (format == JSON_WRITER_CBOR) {
+			json_writer_cbor_magic(&printer->writer);
+		}
+		// The number of nodes isn't known yet, so in CBOR this is the only
+		// container with an indefinite length
+		json_writer_object_begin(&printer->writer);
+		data = printer;
+	}
+
+	bool ok;
+	if (batch) {
+		int fd = STDIN_FILENO;
+		if (strcmp(input, "-") != 0) {
+			fd = open(input, O_RDONLY | O_CLOEXEC);
+			if (fd < 0) {
+				perror(input);
+				exit(EXIT_FAILURE);
+			}
+		}
+		ok = drm_info_batch(fd, &pretty->writer, opts.jobs, &pretty->opts);
+		if (fd != STDIN_FILENO) {
+			close(fd);
+		}
+	} else if (input) {
+		struct input in;
+		ok = input_open(&in, input);
+		if (ok) {
+			ok = input_load(in.buf, in.len, func, data);
+			input_close(&in);
+		}
+	} else {
+		ok = drm_info_stream(&argv[optind], &opts, func, data);
+	}
+	if (!ok) {
+		exit(EXIT_FAILURE);
+	}
+
 	if (json) {
-		json_object_to_fd(STDOUT_FILENO, obj,
-			JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_SPACED);
+		if (dedup) {
+			// Written last, once every node has added its values
+			json_writer_key(&printer->writer, "$shared");
+			json_writer_shared_write(&printer->writer);
+		}
+		json_writer_object_end(&printer->writer);
+		if (format == JSON_WRITER_COMPACT) {
+			// One document per line
+			json_writer_raw(&printer->writer, "\n");
+		}
+		if (!json_writer_close(&printer->writer)) {
+			perror("write");
+			exit(EXIT_FAILURE);
+		}
+		json_writer_finish(&printer->writer);
+		compressor_destroy(compressor);
+		free(printer);
 	} else {
-		print_drm(obj);
+		if (!tree_writer_flush(&pretty->writer)) {
+			perror("write");
+			exit(EXIT_FAILURE);
+		}
+		free(pretty);
 	}
-	json_object_put(obj);
+	selector_destroy(sel);
+	modifier_info_finish();
+	pci_names_finish();
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,290 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <xf86drmMode.h>
+
+/* Snapshot of a node, as collected by json.c and rendered by the JSON and
+ * pretty printers. Everything is allocated from arenas which live as long as
+ * the snapshot, and is never modified once published.
+ *
+ * Only the fields which were selected are guaranteed to be filled, renderers
+ * must apply the same selector that was used for collection. Pointers which
+ * may be NULL are rendered as null. */
+
+struct json_writer;
+struct selector;
+
+struct model_cap {
+	const char *name;
+	bool supported;
+	uint64_t value;
+};
+
+struct model_kernel {
+	char *sysname, *release, *version;
+};
+
+struct model_driver {
+	char *name, *desc;
+	struct {
+		int major, minor, patch;
+		char *date;
+	} version;
+	struct model_kernel *kernel; // NULL if uname() failed
+	struct model_cap *client_caps;
+	size_t n_client_caps;
+	struct model_cap *caps;
+	size_t n_caps;
+};
+
+struct model_device {
+	uint32_t available_nodes;
+	int bus_type; // DRM_BUS_*, device data is only set for PCI, USB and
+	              // platform devices
+	union {
+		struct {
+			uint16_t vendor, device;
+			uint16_t subsystem_vendor, subsystem_device;
+		} pci;
+		struct {
+			uint16_t vendor, product;
+		} usb;
+		struct {
+			char **compatible;
+			size_t n_compatible;
+		} platform;
+	} data;
+};
+
+struct model_fb_size {
+	uint32_t min_width, max_width;
+	uint32_t min_height, max_height;
+};
+
+struct model_enum {
+	char name[DRM_PROP_NAME_LEN];
+	uint64_t value;
+};
+
+/* Shared by every object with the property */
+struct model_prop_def {
+	uint32_t id;
+	uint32_t flags;
+	char name[DRM_PROP_NAME_LEN];
+	union {
+		struct {
+			uint64_t min, max;
+		} range;
+		struct {
+			int64_t min, max;
+		} srange;
+		struct {
+			struct model_enum *items;
+			size_t n_items;
+		} enums; // Enums and bitmasks
+		uint32_t object_type;
+	} spec;
+};
+
+struct model_fb_plane {
+	uint32_t offset, pitch;
+};
+
+struct model_fb {
+	uint32_t id;
+	uint32_t width, height;
+
+	// Only from drmModeGetFB
+	bool legacy;
+	uint32_t pitch, bpp, depth;
+
+	// Only from drmModeGetFB2, or the atomic state
+	bool has_format, has_modifier;
+	uint32_t format;
+	uint64_t modifier;
+	struct model_fb_plane planes[4];
+	size_t n_planes;
+};
+
+struct model_in_format {
+	uint64_t modifier;
+	uint32_t *formats;
+	size_t n_formats;
+};
+
+enum model_blob_type {
+	MODEL_BLOB_IN_FORMATS,
+	MODEL_BLOB_MODE,
+	MODEL_BLOB_FORMATS,
+	MODEL_BLOB_PATH,
+	MODEL_BLOB_EDID,
+	MODEL_BLOB_LUT,
+	MODEL_BLOB_CTM,
+	MODEL_BLOB_HDR_METADATA,
+	MODEL_BLOB_RECTS,
+};
+
+/* Identification of the monitor from the EDID base block */
+struct model_edid {
+	char vendor[4]; // PNP ID
+	uint16_t product;
+	uint32_t serial;
+	// Display product name descriptor, empty if there's none
+	char name[14];
+	// Week 0xFF means year is the model year
+	uint8_t week;
+	uint16_t year;
+	uint8_t version, revision;
+	uint8_t n_extensions;
+};
+
+/* Summary of a GAMMA_LUT or DEGAMMA_LUT */
+struct model_lut {
+	uint32_t size;
+	// Per channel, in red, green, blue order
+	uint16_t min[3], max[3];
+	// Every channel is non-decreasing
+	bool monotonic;
+	// Every channel is the identity, within half a step
+	bool linear;
+};
+
+/* Decoded blob, shared by every property with the same blob contents */
+struct model_blob {
+	enum model_blob_type type;
+	union {
+		struct {
+			struct model_in_format *mods;
+			size_t n_mods;
+		} in_formats;
+		drmModeModeInfo mode;
+		struct {
+			uint32_t *formats;
+			size_t n_formats;
+		} formats;
+		struct {
+			char *str;
+			size_t len;
+		} path;
+		struct model_edid edid;
+		struct model_lut lut;
+		// 3x3 matrix in row-major order, in signed 32.32 fixed point
+		int64_t ctm[9];
+		struct hdr_output_metadata hdr_metadata;
+		struct {
+			struct drm_mode_rect *rects;
+			size_t n_rects;
+		} rects;
+	};
+};
+
+enum model_data_type {
+	MODEL_DATA_NONE,
+	MODEL_DATA_UINT,
+	MODEL_DATA_FB,
+	MODEL_DATA_BLOB,
+};
+
+struct model_property {
+	const struct model_prop_def *def;
+	uint64_t raw_value;
+	enum model_data_type data_type;
+	union {
+		uint64_t uint;
+		struct model_fb *fb;
+		const struct model_blob *blob;
+	} data;
+	// Contents of blob properties, NULL unless they were collected, see
+	// drm_info_options.blob_contents
+	const void *blob_contents;
+	size_t blob_len;
+};
+
+struct model_properties {
+	struct model_property *items;
+	size_t len;
+};
+
+struct model_connector {
+	uint32_t id;
+	uint32_t type; // DRM_MODE_CONNECTOR_*
+	uint32_t status; // drmModeConnection
+	uint32_t phy_width, phy_height;
+	uint32_t subpixel; // drmModeSubPixel
+	uint32_t encoder_id;
+	uint32_t *encoders;
+	size_t n_encoders;
+	drmModeModeInfo *modes;
+	size_t n_modes;
+	struct model_properties *props;
+};
+
+struct model_encoder {
+	uint32_t id;
+	uint32_t type; // DRM_MODE_ENCODER_*
+	uint32_t crtc_id;
+	uint32_t possible_crtcs, possible_clones;
+};
+
+struct model_crtc {
+	uint32_t id;
+	uint32_t fb_id;
+	uint32_t x, y;
+	drmModeModeInfo *mode; // NULL if not set
+	int gamma_size;
+	struct model_properties *props;
+};
+
+struct model_plane {
+	uint32_t id;
+	uint32_t possible_crtcs;
+	uint32_t crtc_id, fb_id;
+	uint32_t crtc_x, crtc_y;
+	uint32_t x, y;
+	uint32_t gamma_size;
+	struct model_fb *fb;
+	uint32_t *formats;
+	size_t n_formats;
+	struct model_properties *props;
+};
+
+enum model_section {
+	MODEL_DRIVER = 1 << 0,
+	MODEL_DEVICE = 1 << 1,
+	MODEL_FB_SIZE = 1 << 2,
+	MODEL_CONNECTORS = 1 << 3,
+	MODEL_ENCODERS = 1 << 4,
+	MODEL_CRTCS = 1 << 5,
+	MODEL_PLANES = 1 << 6,
+};
+
+struct model_node {
+	// Mask of enum model_section, for the sections which were collected.
+	// Nodes which timed out may be missing some.
+	uint32_t sections;
+	bool timed_out;
+
+	struct model_driver *driver;
+	struct model_device *device;
+	struct model_fb_size *fb_size;
+	struct model_connector **connectors;
+	size_t n_connectors;
+	struct model_encoder **encoders;
+	size_t n_encoders;
+	struct model_crtc **crtcs;
+	size_t n_crtcs;
+	struct model_plane **planes; // NULL if planes couldn't be listed
+	size_t n_planes;
+};
+
+/* Writes the JSON object of a node. Only the fields selected by sel are
+ * written, NULL selects everything. Modes, IN_FORMATS and enum specs are
+ * written as shared values, see json_writer_shared_begin(). */
+void model_node_write_json(struct json_writer *w,
+	const struct model_node *node, const struct selector *sel);
+
+#endif
@@ -0,0 +1,659 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "arena.h"
+#include "cbor.h"
+#include "drm_info.h"
+#include "model.h"
+#include "model_schema.h"
+#include "props.h"
+
+/* Loads snapshots back from the CBOR written by model_node_write_json(), with
+ * the same layout as the JSON output. Members which are missing, e.g. because
+ * they weren't selected, are left zeroed, and unknown members are skipped.
+ * Errors are sticky in the reader, so loaders don't return anything and
+ * callers check r->error once done. */
+
+struct loader {
+	struct cbor_reader *r;
+	struct arena *arena;
+};
+
+static void fail(struct loader *l)
+{
+	l->r->error = true;
+}
+
+static bool key_is(const struct cbor_item *key, const char *name)
+{
+	size_t len = strlen(name);
+	return key->value == len && memcmp(key->str, name, len) == 0;
+}
+
+static bool is_null(const struct cbor_item *item)
+{
+	return item->major == CBOR_SIMPLE && item->value == (CBOR_NULL & 0x1F);
+}
+
+static void expect(struct loader *l, const struct cbor_item *item,
+		enum cbor_major major)
+{
+	if (item->major != major) {
+		fail(l);
+	}
+}
+
+/* Reads the key and the head of the value of the next member of map, of which
+ * *i members were already read. Fails if map isn't a map. */
+static bool next_member(struct loader *l, const struct cbor_item *map,
+		uint64_t *i, struct cbor_item *key, struct cbor_item *val)
+{
+	if (map->major != CBOR_MAP) {
+		fail(l);
+		return false;
+	}
+	if (!cbor_container_next(l->r, map, *i)) {
+		return false;
+	}
+	++*i;
+	if (!cbor_next(l->r, key) || key->major != CBOR_TEXT ||
+			!cbor_next(l->r, val)) {
+		fail(l);
+		return false;
+	}
+	return true;
+}
+
+/* Reads the head of the next item of array, of which *i items were already
+ * read. Fails if arr isn't an array. */
+static bool next_item(struct loader *l, const struct cbor_item *arr,
+		uint64_t *i, struct cbor_item *item)
+{
+	if (arr->major != CBOR_ARRAY) {
+		fail(l);
+		return false;
+	}
+	if (!cbor_container_next(l->r, arr, *i)) {
+		return false;
+	}
+	++*i;
+	if (!cbor_next(l->r, item)) {
+		fail(l);
+		return false;
+	}
+	return true;
+}
+
+static void skip(struct loader *l, const struct cbor_item *item)
+{
+	cbor_skip_item(l->r, item);
+}
+
+/* Number of items to reserve room for up front. Every item takes at least a
+ * byte, which bounds lengths coming from bad input. */
+static size_t reserve(struct loader *l, const struct cbor_item *container)
+{
+	if (container->indefinite) {
+		return 0;
+	}
+	size_t left = l->r->len - l->r->pos;
+	return container->value < left ? container->value : left;
+}
+
+/* Makes room for one more item in an array of len items, with room for *cap
+ * of them. Returns the possibly moved array. */
+static void *grow(struct loader *l, void *items, size_t len, size_t *cap,
+		size_t size)
+{
+	if (len < *cap) {
+		return items;
+	}
+	*cap = *cap ? 2 * *cap : 8;
+	void *new_items = arena_alloc(l->arena, *cap * size);
+	if (len > 0) {
+		memcpy(new_items, items, len * size);
+	}
+	return new_items;
+}
+
+static uint64_t get_uint(struct loader *l, const struct cbor_item *item)
+{
+	expect(l, item, CBOR_UINT);
+	return item->value;
+}
+
+/* Returns the two's complement bits of an integer of either sign */
+static uint64_t get_int(struct loader *l, const struct cbor_item *item)
+{
+	if (item->major == CBOR_NEGINT) {
+		return ~item->value;
+	}
+	return get_uint(l, item);
+}
+
+static bool get_bool(struct loader *l, const struct cbor_item *item)
+{
+	if (item->major != CBOR_SIMPLE || (item->value != (CBOR_TRUE & 0x1F) &&
+			item->value != (CBOR_FALSE & 0x1F))) {
+		fail(l);
+		return false;
+	}
+	return item->value == (CBOR_TRUE & 0x1F);
+}
+
+static char *get_string(struct loader *l, const struct cbor_item *item)
+{
+	if (item->major != CBOR_TEXT) {
+		fail(l);
+		return "";
+	}
+	// arena_strndup() would stop at NUL bytes
+	char *str = arena_alloc(l->arena, item->value + 1);
+	memcpy(str, item->str, item->value);
+	return str;
+}
+
+/* Copies a string into a fixed-size, NUL-terminated buffer */
+static void get_name(struct loader *l, const struct cbor_item *item,
+		char *buf, size_t size)
+{
+	if (item->major != CBOR_TEXT) {
+		fail(l);
+		return;
+	}
+	size_t len = item->value < size - 1 ? item->value : size - 1;
+	memcpy(buf, item->str, len);
+	buf[len] = '\0';
+}
+
+static void load_caps(struct loader *l, const struct cbor_item *map,
+		struct model_cap **caps, size_t *n_caps, bool client)
+{
+	size_t cap = reserve(l, map);
+	*caps = arena_alloc(l->arena, cap * sizeof(**caps));
+	*n_caps = 0;
+
+	struct cbor_item key, val;
+	for (uint64_t i = 0; next_member(l, map, &i, &key, &val);) {
+		*caps = grow(l, *caps, *n_caps, &cap, sizeof(**caps));
+		struct model_cap *c = &(*caps)[(*n_caps)++];
+		c->name = get_string(l, &key);
+		if (client) {
+			c->supported = get_bool(l, &val);
+		} else if (!is_null(&val)) {
+			c->supported = true;
+			c->value = get_uint(l, &val);
+		}
+	}
+}
+
+static void load_object(struct loader *l, const struct cbor_item *map,
+	const struct model_field *fields, void *base);
+
+static struct model_fb *load_fb(struct loader *l, const struct cbor_item *map)
+{
+	if (is_null(map)) {
+		return NULL;
+	}
+
+	struct model_fb *fb = arena_alloc(l->arena, sizeof(*fb));
+
+	struct cbor_item key, val;
+	for (uint64_t i = 0; next_member(l, map, &i, &key, &val);) {
+		if (key_is(&key, "id")) {
+			fb->id = get_uint(l, &val);
+		} else if (key_is(&key, "width")) {
+			fb->width = get_uint(l, &val);
+		} else if (key_is(&key, "height")) {
+			fb->height = get_uint(l, &val);
+		} else if (key_is(&key, "pitch")) {
+			// Only legacy FBs have a pitch outside of their planes
+			fb->legacy = true;
+			fb->pitch = get_uint(l, &val);
+		} else if (key_is(&key, "bpp")) {
+			fb->bpp = get_uint(l, &val);
+		} else if (key_is(&key, "depth")) {
+			fb->depth = get_uint(l, &val);
+		} else if (key_is(&key, "format")) {
+			fb->has_format = true;
+			fb->format = get_uint(l, &val);
+		} else if (key_is(&key, "modifier")) {
+			fb->has_modifier = true;
+			fb->modifier = get_uint(l, &val);
+		} else if (key_is(&key, "planes")) {
+			struct cbor_item plane;
+			for (uint64_t j = 0; next_item(l, &val, &j, &plane);) {
+				if (fb->n_planes == 4) {
+					fail(l);
+					break;
+				}
+				load_object(l, &plane, model_fb_plane_fields,
+					&fb->planes[fb->n_planes++]);
+			}
+		} else {
+			skip(l, &val);
+		}
+	}
+
+	return fb;
+}
+
+static struct model_properties *load_properties(struct loader *l,
+	const struct cbor_item *map);
+
+/* Loads one item of the type of field */
+static void load_item(struct loader *l, const struct cbor_item *item,
+		const struct model_field *field, void *ptr)
+{
+	switch (field->type) {
+	case MODEL_FIELD_UINT:
+	case MODEL_FIELD_MODIFIER:
+		model_field_set_uint(ptr, field->size, get_uint(l, item));
+		break;
+	case MODEL_FIELD_INT:
+		model_field_set_uint(ptr, field->size, get_int(l, item));
+		break;
+	case MODEL_FIELD_BOOL:
+		*(bool *)ptr = get_bool(l, item);
+		break;
+	case MODEL_FIELD_NAME:
+		get_name(l, item, ptr, field->size);
+		break;
+	case MODEL_FIELD_STRING:
+		*(char **)ptr = get_string(l, item);
+		break;
+	case MODEL_FIELD_OBJECT:
+		load_object(l, item, field->fields, ptr);
+		break;
+	case MODEL_FIELD_FB:
+		*(struct model_fb **)ptr = load_fb(l, item);
+		break;
+	case MODEL_FIELD_PROPERTIES:
+		*(struct model_properties **)ptr = load_properties(l, item);
+		break;
+	}
+}
+
+/* Loads the member of base described by field */
+static void load_value(struct loader *l, const struct cbor_item *val,
+		const struct model_field *field, void *base)
+{
+	char *member = (char *)base + field->offset;
+
+	if (field->flags & MODEL_FIELD_POINTER) {
+		if (is_null(val)) {
+			return;
+		}
+		void *item = arena_alloc(l->arena, field->size);
+		*(void **)member = item;
+		member = item;
+	}
+
+	struct cbor_item item;
+	if (field->flags & MODEL_FIELD_SIZED) {
+		size_t *len = (size_t *)((char *)base + field->count);
+		*(char **)member = get_string(l, val);
+		*len = val->major == CBOR_TEXT ? val->value : 0;
+	} else if (field->flags & MODEL_FIELD_ARRAY) {
+		// Exactly count items
+		uint64_t i = 0;
+		while (next_item(l, val, &i, &item)) {
+			if (i > field->count) {
+				fail(l);
+				skip(l, &item);
+				continue;
+			}
+			load_item(l, &item, field, member + (i - 1) * field->size);
+		}
+		if (i != field->count) {
+			fail(l);
+		}
+	} else if (field->flags & MODEL_FIELD_LIST) {
+		size_t *n = (size_t *)((char *)base + field->count);
+		size_t cap = reserve(l, val);
+		char *items = arena_alloc(l->arena, cap * field->size);
+		*n = 0;
+		for (uint64_t i = 0; next_item(l, val, &i, &item);) {
+			items = grow(l, items, *n, &cap, field->size);
+			load_item(l, &item, field, items + (*n)++ * field->size);
+		}
+		*(void **)member = items;
+	} else {
+		load_item(l, val, field, member);
+	}
+}
+
+/* Returns false if key isn't one of fields */
+static bool load_member(struct loader *l, const struct cbor_item *key,
+		const struct cbor_item *val, const struct model_field *fields,
+		void *base)
+{
+	const struct model_field *field =
+		model_field_find(fields, key->str, key->value);
+	if (!field) {
+		return false;
+	}
+	load_value(l, val, field, base);
+	return true;
+}
+
+static void load_object(struct loader *l, const struct cbor_item *map,
+		const struct model_field *fields, void *base)
+{
+	model_fields_init(fields, base);
+
+	struct cbor_item key, val;
+	for (uint64_t i = 0; next_member(l, map, &i, &key, &val);) {
+		if (!load_member(l, &key, &val, fields, base)) {
+			skip(l, &val);
+		}
+	}
+}
+
+static struct model_driver *load_driver(struct loader *l,
+		const struct cbor_item *map)
+{
+	if (is_null(map)) {
+		return NULL;
+	}
+
+	struct model_driver *driver = arena_alloc(l->arena, sizeof(*driver));
+	model_fields_init(model_driver_fields, driver);
+
+	struct cbor_item key, val;
+	for (uint64_t i = 0; next_member(l, map, &i, &key, &val);) {
+		if (load_member(l, &key, &val, model_driver_fields, driver)) {
+			continue;
+		} else if (key_is(&key, "client_caps")) {
+			load_caps(l, &val, &driver->client_caps,
+				&driver->n_client_caps, true);
+		} else if (key_is(&key, "caps")) {
+			load_caps(l, &val, &driver->caps, &driver->n_caps, false);
+		} else {
+			skip(l, &val);
+		}
+	}
+
+	return driver;
+}
+
+static struct model_device *load_device(struct loader *l,
+		const struct cbor_item *map)
+{
+	if (is_null(map)) {
+		return NULL;
+	}
+
+	struct model_device *dev = arena_alloc(l->arena, sizeof(*dev));
+
+	struct cbor_item key, val;
+	for (uint64_t i = 0; next_member(l, map, &i, &key, &val);) {
+		if (load_member(l, &key, &val, model_device_fields, dev)) {
+			continue;
+		}
+		// Written after bus_type, which says what it contains
+		const struct model_field *fields =
+			model_device_data_fields(dev->bus_type);
+		if (key_is(&key, "device_data") && fields && !is_null(&val)) {
+			load_object(l, &val, fields, dev);
+		} else {
+			skip(l, &val);
+		}
+	}
+
+	return dev;
+}
+
+static void load_spec(struct loader *l, const struct cbor_item *spec,
+		struct model_prop_def *def)
+{
+	switch (spec->major) {
+	case CBOR_MAP:
+		// Ranges and signed ranges share their layout, and get_int()
+		// takes either
+		load_object(l, spec, model_srange_fields, def);
+		break;
+	case CBOR_ARRAY:
+		load_value(l, spec, &model_spec_enums_field, def);
+		break;
+	case CBOR_UINT:
+		def->spec.object_type = spec->value;
+		break;
+	default:
+		skip(l, spec);
+		break;
+	}
+}
+
+/* The layout of decoded blobs depends on their type, which is the one of the
+ * property's handler */
+static const struct model_blob *load_blob(struct loader *l,
+		const struct cbor_item *data, enum model_blob_type type)
+{
+	struct model_blob *blob = arena_alloc(l->arena, sizeof(*blob));
+	blob->type = type;
+
+	const struct model_field *field = model_blob_field(type);
+	if (field) {
+		load_value(l, data, field, blob);
+	} else {
+		skip(l, data);
+	}
+
+	return blob;
+}
+
+static void load_property(struct loader *l, const struct cbor_item *map,
+		struct model_property *prop, struct model_prop_def *def)
+{
+
+	struct cbor_item key, val;
+	for (uint64_t i = 0; next_member(l, map, &i, &key, &val);) {
+		if (key_is(&key, "id")) {
+			def->id = get_uint(l, &val);
+		} else if (key_is(&key, "flags")) {
+			def->flags = get_uint(l, &val);
+		} else if (key_is(&key, "raw_value")) {
+			prop->raw_value = get_uint(l, &val);
+		} else if (key_is(&key, "spec")) {
+			load_spec(l, &val, def);
+		} else if (key_is(&key, "value") && val.major == CBOR_TAG &&
+				val.value == CBOR_TAG_BASE64) {
+			// Blob contents, other values are the raw value
+			struct cbor_item bytes;
+			if (!cbor_next(l->r, &bytes) || bytes.major != CBOR_BYTES) {
+				fail(l);
+				break;
+			}
+			prop->blob_contents = arena_memdup(l->arena, bytes.str,
+				bytes.value);
+			prop->blob_len = bytes.value;
+		} else if (key_is(&key, "data")) {
+			// Written by properties_info() for the properties which
+			// have a handler
+			const struct prop_handler *handler =
+				prop_handler_get(def->name);
+			if (!handler || is_null(&val)) {
+				skip(l, &val);
+				continue;
+			}
+			switch (handler->kind) {
+			case PROP_BLOB:
+				prop->data_type = MODEL_DATA_BLOB;
+				prop->data.blob = load_blob(l, &val, handler->blob_type);
+				break;
+			case PROP_FB:
+				prop->data_type = MODEL_DATA_FB;
+				prop->data.fb = load_fb(l, &val);
+				break;
+			case PROP_FIXED_16_16:
+				prop->data_type = MODEL_DATA_UINT;
+				prop->data.uint = get_uint(l, &val);
+				break;
+			}
+		} else {
+			// "type", "atomic" and "immutable" are part of the flags
+			skip(l, &val);
+		}
+	}
+}
+
+static struct model_properties *load_properties(struct loader *l,
+		const struct cbor_item *map)
+{
+	if (is_null(map)) {
+		return NULL;
+	}
+
+	struct model_properties *props = arena_alloc(l->arena, sizeof(*props));
+	size_t cap = reserve(l, map);
+	props->items = arena_alloc(l->arena, cap * sizeof(*props->items));
+
+	struct cbor_item key, val;
+	for (uint64_t i = 0; next_member(l, map, &i, &key, &val);) {
+		props->items = grow(l, props->items, props->len, &cap,
+			sizeof(*props->items));
+		struct model_property *prop = &props->items[props->len++];
+		*prop = (struct model_property){0};
+
+		struct model_prop_def *def = arena_alloc(l->arena, sizeof(*def));
+		get_name(l, &key, def->name, sizeof(def->name));
+		prop->def = def;
+
+		load_property(l, &val, prop, def);
+	}
+
+	return props;
+}
+
+static void load_node(struct loader *l, const struct cbor_item *map,
+		struct model_node *node)
+{
+
+	struct cbor_item key, val, item;
+	for (uint64_t i = 0; next_member(l, map, &i, &key, &val);) {
+		if (key_is(&key, "driver")) {
+			node->sections |= MODEL_DRIVER;
+			node->driver = load_driver(l, &val);
+		} else if (key_is(&key, "device")) {
+			node->sections |= MODEL_DEVICE;
+			node->device = load_device(l, &val);
+		} else if (key_is(&key, "fb_size")) {
+			node->sections |= MODEL_FB_SIZE;
+			node->fb_size = arena_alloc(l->arena, sizeof(*node->fb_size));
+			load_object(l, &val, model_fb_size_fields, node->fb_size);
+		} else if (key_is(&key, "connectors")) {
+			node->sections |= MODEL_CONNECTORS;
+			size_t cap = reserve(l, &val);
+			node->connectors = arena_alloc(l->arena,
+				cap * sizeof(*node->connectors));
+			for (uint64_t j = 0; next_item(l, &val, &j, &item);) {
+				node->connectors = grow(l, node->connectors,
+					node->n_connectors, &cap, sizeof(*node->connectors));
+				void *obj = arena_alloc(l->arena, sizeof(**node->connectors));
+				load_object(l, &item, model_connector_fields, obj);
+				node->connectors[node->n_connectors++] = obj;
+			}
+		} else if (key_is(&key, "encoders")) {
+			node->sections |= MODEL_ENCODERS;
+			size_t cap = reserve(l, &val);
+			node->encoders = arena_alloc(l->arena,
+				cap * sizeof(*node->encoders));
+			for (uint64_t j = 0; next_item(l, &val, &j, &item);) {
+				node->encoders = grow(l, node->encoders,
+					node->n_encoders, &cap, sizeof(*node->encoders));
+				void *obj = arena_alloc(l->arena, sizeof(**node->encoders));
+				load_object(l, &item, model_encoder_fields, obj);
+				node->encoders[node->n_encoders++] = obj;
+			}
+		} else if (key_is(&key, "crtcs")) {
+			node->sections |= MODEL_CRTCS;
+			size_t cap = reserve(l, &val);
+			node->crtcs = arena_alloc(l->arena, cap * sizeof(*node->crtcs));
+			for (uint64_t j = 0; next_item(l, &val, &j, &item);) {
+				node->crtcs = grow(l, node->crtcs, node->n_crtcs, &cap,
+					sizeof(*node->crtcs));
+				void *obj = arena_alloc(l->arena, sizeof(**node->crtcs));
+				load_object(l, &item, model_crtc_fields, obj);
+				node->crtcs[node->n_crtcs++] = obj;
+			}
+		} else if (key_is(&key, "planes")) {
+			node->sections |= MODEL_PLANES;
+			if (is_null(&val)) {
+				continue;
+			}
+			size_t cap = reserve(l, &val);
+			node->planes = arena_alloc(l->arena,
+				cap * sizeof(*node->planes));
+			for (uint64_t j = 0; next_item(l, &val, &j, &item);) {
+				node->planes = grow(l, node->planes, node->n_planes, &cap,
+					sizeof(*node->planes));
+				void *obj = arena_alloc(l->arena, sizeof(**node->planes));
+				load_object(l, &item, model_plane_fields, obj);
+				node->planes[node->n_planes++] = obj;
+			}
+		} else if (key_is(&key, "timed_out")) {
+			node->timed_out = get_bool(l, &val);
+		} else {
+			skip(l, &val);
+		}
+	}
+}
+
+/* Reads one document, a map of node paths to nodes */
+static void load_document(struct cbor_reader *r, drm_info_func func,
+		void *data)
+{
+	struct cbor_item doc;
+	if (!cbor_next(r, &doc)) {
+		return;
+	}
+	if (doc.major == CBOR_TAG && doc.value == CBOR_TAG_SELF_DESCRIBED &&
+			!cbor_next(r, &doc)) {
+		r->error = true;
+		return;
+	}
+
+	struct cbor_item key, val;
+	for (uint64_t i = 0;;) {
+		struct arena arena = {0};
+		struct loader l = { .r = r, .arena = &arena };
+		if (!next_member(&l, &doc, &i, &key, &val)) {
+			break;
+		}
+
+		char *path = get_string(&l, &key);
+		struct model_node node = {0};
+		load_node(&l, &val, &node);
+		if (!r->error) {
+			func(path, &node, data);
+		}
+		arena_finish(&arena);
+		if (r->error) {
+			break;
+		}
+	}
+}
+
+bool drm_info_load_cbor(const void *buf, size_t len, drm_info_func func,
+		void *data)
+{
+	struct cbor_reader r;
+	cbor_reader_init(&r, buf, len);
+
+	// Several documents may have been concatenated
+	while (!r.error && r.pos < r.len) {
+		load_document(&r, func, data);
+	}
+
+	if (r.error) {
+		fprintf(stderr, "Invalid CBOR at offset %zu\n", r.pos);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,497 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "json_writer.h"
+#include "model.h"
+#include "model_schema.h"
+#include "modifiers.h"
+#include "selector.h"
+
+/* Writes key and val if key is selected */
+static void write_uint(struct json_writer *w, const struct selector *sel,
+		const char *key, uint64_t val)
+{
+	if (selector_has(sel, key)) {
+		json_writer_key(w, key);
+		json_writer_uint64(w, val);
+	}
+}
+
+static void write_bool(struct json_writer *w, const struct selector *sel,
+		const char *key, bool val)
+{
+	if (selector_has(sel, key)) {
+		json_writer_key(w, key);
+		json_writer_bool(w, val);
+	}
+}
+
+static void write_string(struct json_writer *w, const struct selector *sel,
+		const char *key, const char *val)
+{
+	if (selector_has(sel, key)) {
+		json_writer_key(w, key);
+		json_writer_string(w, val);
+	}
+}
+
+static void write_caps(struct json_writer *w, const struct model_cap *caps,
+		size_t n_caps, bool client)
+{
+	json_writer_object_begin(w);
+	for (size_t i = 0; i < n_caps; ++i) {
+		json_writer_key(w, caps[i].name);
+		if (client) {
+			json_writer_bool(w, caps[i].supported);
+		} else if (caps[i].supported) {
+			json_writer_uint64(w, caps[i].value);
+		} else {
+			json_writer_null(w);
+		}
+	}
+	json_writer_object_end(w);
+}
+
+/* Writes the decoded modifier next to the modifier itself */
+static void write_modifier_info(struct json_writer *w, uint64_t modifier)
+{
+	const struct modifier_info *info = modifier_info_get(modifier);
+
+	json_writer_key(w, "modifier_info");
+	// The same few modifiers are used by every plane and FB
+	json_writer_shared_begin(w);
+	json_writer_object_begin(w);
+	write_string(w, NULL, "vendor", info->vendor);
+	write_string(w, NULL, "name", info->name);
+	if (info->tiling) {
+		write_string(w, NULL, "tiling", info->tiling);
+	}
+	if (info->compression) {
+		write_string(w, NULL, "compression", info->compression);
+	}
+	if (info->block_size) {
+		write_string(w, NULL, "block_size", info->block_size);
+	}
+	json_writer_key(w, "flags");
+	json_writer_array_begin(w);
+	for (size_t i = 0; i < info->n_flags; ++i) {
+		json_writer_string(w, info->flags[i]);
+	}
+	json_writer_array_end(w);
+	json_writer_key(w, "params");
+	json_writer_object_begin(w);
+	for (size_t i = 0; i < info->n_params; ++i) {
+		const struct modifier_param *param = &info->params[i];
+		json_writer_key(w, param->name);
+		if (param->str) {
+			json_writer_string(w, param->str);
+		} else {
+			json_writer_uint64(w, param->value);
+		}
+	}
+	json_writer_object_end(w);
+	json_writer_object_end(w);
+	json_writer_shared_end(w);
+}
+
+static void write_object(struct json_writer *w,
+	const struct model_field *fields, const void *base,
+	const struct selector *sel);
+
+static void write_fb(struct json_writer *w, const struct model_fb *fb)
+{
+	if (!fb) {
+		json_writer_null(w);
+		return;
+	}
+
+	json_writer_object_begin(w);
+	write_uint(w, NULL, "id", fb->id);
+	write_uint(w, NULL, "width", fb->width);
+	write_uint(w, NULL, "height", fb->height);
+
+	if (fb->legacy) {
+		write_uint(w, NULL, "pitch", fb->pitch);
+		write_uint(w, NULL, "bpp", fb->bpp);
+		write_uint(w, NULL, "depth", fb->depth);
+		json_writer_object_end(w);
+		return;
+	}
+
+	write_uint(w, NULL, "format", fb->format);
+	if (fb->has_modifier) {
+		write_uint(w, NULL, "modifier", fb->modifier);
+		write_modifier_info(w, fb->modifier);
+	}
+
+	json_writer_key(w, "planes");
+	json_writer_array_begin(w);
+	for (size_t i = 0; i < fb->n_planes; ++i) {
+		write_object(w, model_fb_plane_fields, &fb->planes[i], NULL);
+	}
+	json_writer_array_end(w);
+
+	json_writer_object_end(w);
+}
+
+static void write_properties(struct json_writer *w,
+	const struct model_properties *props, const struct selector *sel);
+
+/* Writes one item of the type of field */
+static void write_item(struct json_writer *w, const struct model_field *field,
+		const void *ptr, const struct selector *sel)
+{
+	switch (field->type) {
+	case MODEL_FIELD_UINT:
+		json_writer_uint64(w, model_field_get_uint(ptr, field->size));
+		break;
+	case MODEL_FIELD_INT:
+		json_writer_int64(w, model_field_get_int(ptr, field->size));
+		break;
+	case MODEL_FIELD_BOOL:
+		json_writer_bool(w, *(const bool *)ptr);
+		break;
+	case MODEL_FIELD_NAME:
+		json_writer_string(w, ptr);
+		break;
+	case MODEL_FIELD_STRING:
+		json_writer_string(w, *(char *const *)ptr);
+		break;
+	case MODEL_FIELD_MODIFIER:
+		json_writer_uint64(w, *(const uint64_t *)ptr);
+		write_modifier_info(w, *(const uint64_t *)ptr);
+		break;
+	case MODEL_FIELD_OBJECT:
+		write_object(w, field->fields, ptr, sel);
+		break;
+	case MODEL_FIELD_FB:
+		write_fb(w, *(struct model_fb *const *)ptr);
+		break;
+	case MODEL_FIELD_PROPERTIES:
+		write_properties(w, *(struct model_properties *const *)ptr, sel);
+		break;
+	}
+}
+
+/* Writes the member of base described by field */
+static void write_value(struct json_writer *w, const struct model_field *field,
+		const void *base, const struct selector *sel)
+{
+	const char *member = (const char *)base + field->offset;
+	const size_t *count = (const size_t *)((const char *)base + field->count);
+
+	if (field->flags & MODEL_FIELD_POINTER) {
+		member = *(const void *const *)member;
+		if (!member) {
+			json_writer_null(w);
+			return;
+		}
+	}
+	if (field->flags & MODEL_FIELD_SIZED) {
+		json_writer_string_len(w, *(char *const *)member, *count);
+		return;
+	}
+	if (!(field->flags & (MODEL_FIELD_ARRAY | MODEL_FIELD_LIST))) {
+		if (field->flags & MODEL_FIELD_SHARED) {
+			json_writer_shared_begin(w);
+		}
+		write_item(w, field, member, sel);
+		if (field->flags & MODEL_FIELD_SHARED) {
+			json_writer_shared_end(w);
+		}
+		return;
+	}
+
+	size_t n = field->count;
+	if (field->flags & MODEL_FIELD_LIST) {
+		member = *(const void *const *)member;
+		n = *count;
+	}
+	if (field->flags & MODEL_FIELD_SHARED) {
+		json_writer_shared_begin(w);
+	}
+	json_writer_array_begin(w);
+	for (size_t i = 0; i < n; ++i) {
+		if (field->flags & MODEL_FIELD_SHARED_ITEMS) {
+			json_writer_shared_begin(w);
+		}
+		write_item(w, field, member + i * field->size, sel);
+		if (field->flags & MODEL_FIELD_SHARED_ITEMS) {
+			json_writer_shared_end(w);
+		}
+	}
+	json_writer_array_end(w);
+	if (field->flags & MODEL_FIELD_SHARED) {
+		json_writer_shared_end(w);
+	}
+}
+
+/* Writes the members of base described by the selected fields */
+static void write_fields(struct json_writer *w,
+		const struct model_field *fields, const void *base,
+		const struct selector *sel)
+{
+	for (const struct model_field *field = fields; field->name; ++field) {
+		if (!selector_has(sel, field->name)) {
+			continue;
+		}
+		json_writer_key(w, field->name);
+		write_value(w, field, base, selector_get(sel, field->name));
+	}
+}
+
+static void write_object(struct json_writer *w,
+		const struct model_field *fields, const void *base,
+		const struct selector *sel)
+{
+	json_writer_object_begin(w);
+	write_fields(w, fields, base, sel);
+	json_writer_object_end(w);
+}
+
+static void write_spec(struct json_writer *w, const struct model_prop_def *def)
+{
+	uint32_t type = def->flags &
+		(DRM_MODE_PROP_LEGACY_TYPE | DRM_MODE_PROP_EXTENDED_TYPE);
+
+	switch (type) {
+	case DRM_MODE_PROP_RANGE:
+		write_object(w, model_range_fields, def, NULL);
+		break;
+	case DRM_MODE_PROP_ENUM:
+	case DRM_MODE_PROP_BITMASK:
+		write_value(w, &model_spec_enums_field, def, NULL);
+		break;
+	case DRM_MODE_PROP_OBJECT:
+		json_writer_uint64(w, def->spec.object_type);
+		break;
+	case DRM_MODE_PROP_SIGNED_RANGE:
+		write_object(w, model_srange_fields, def, NULL);
+		break;
+	default:
+		json_writer_null(w);
+		break;
+	}
+}
+
+static void write_property(struct json_writer *w,
+		const struct model_property *prop, const struct selector *sel)
+{
+	uint32_t flags = prop->def->flags;
+	uint32_t type = flags &
+		(DRM_MODE_PROP_LEGACY_TYPE | DRM_MODE_PROP_EXTENDED_TYPE);
+	bool atomic = flags & DRM_MODE_PROP_ATOMIC;
+	bool immutable = flags & DRM_MODE_PROP_IMMUTABLE;
+
+	json_writer_object_begin(w);
+	write_uint(w, sel, "id", prop->def->id);
+	write_uint(w, sel, "flags", flags);
+	write_uint(w, sel, "type", type);
+	write_bool(w, sel, "atomic", atomic);
+	write_bool(w, sel, "immutable", immutable);
+
+	write_uint(w, sel, "raw_value", prop->raw_value);
+
+	if (selector_has(sel, "spec")) {
+		json_writer_key(w, "spec");
+		write_spec(w, prop->def);
+	}
+
+	if (selector_has(sel, "value")) {
+		json_writer_key(w, "value");
+		switch (type) {
+		case DRM_MODE_PROP_RANGE:
+		case DRM_MODE_PROP_ENUM:
+		case DRM_MODE_PROP_BITMASK:
+		case DRM_MODE_PROP_OBJECT:
+			json_writer_uint64(w, prop->raw_value);
+			break;
+		case DRM_MODE_PROP_SIGNED_RANGE:
+			json_writer_int64(w, (int64_t)prop->raw_value);
+			break;
+		case DRM_MODE_PROP_BLOB:
+			if (!prop->blob_contents) {
+				json_writer_null(w);
+				break;
+			}
+			// CRTCs often have the same gamma LUTs
+			json_writer_shared_begin(w);
+			json_writer_bytes(w, prop->blob_contents, prop->blob_len);
+			json_writer_shared_end(w);
+			break;
+		default:
+			json_writer_null(w);
+			break;
+		}
+	}
+
+	if (selector_has(sel, "data")) {
+		json_writer_key(w, "data");
+		switch (prop->data_type) {
+		case MODEL_DATA_NONE:
+			json_writer_null(w);
+			break;
+		case MODEL_DATA_UINT:
+			json_writer_uint64(w, prop->data.uint);
+			break;
+		case MODEL_DATA_FB:
+			write_fb(w, prop->data.fb);
+			break;
+		case MODEL_DATA_BLOB:;
+			// The layout of decoded blobs depends on their type
+			const struct model_field *field =
+				model_blob_field(prop->data.blob->type);
+			if (field) {
+				write_value(w, field, prop->data.blob, NULL);
+			} else {
+				json_writer_null(w);
+			}
+			break;
+		}
+	}
+
+	json_writer_object_end(w);
+}
+
+static void write_properties(struct json_writer *w,
+		const struct model_properties *props, const struct selector *sel)
+{
+	if (!props) {
+		json_writer_null(w);
+		return;
+	}
+
+	json_writer_object_begin(w);
+	for (size_t i = 0; i < props->len; ++i) {
+		const struct model_property *prop = &props->items[i];
+		if (!selector_has(sel, prop->def->name)) {
+			continue;
+		}
+		json_writer_key(w, prop->def->name);
+		write_property(w, prop, selector_get(sel, prop->def->name));
+	}
+	json_writer_object_end(w);
+}
+
+static void write_driver(struct json_writer *w,
+		const struct model_driver *driver, const struct selector *sel)
+{
+	if (!driver) {
+		json_writer_null(w);
+		return;
+	}
+
+	json_writer_object_begin(w);
+
+	write_fields(w, model_driver_fields, driver, sel);
+
+	if (selector_has(sel, "client_caps")) {
+		json_writer_key(w, "client_caps");
+		write_caps(w, driver->client_caps, driver->n_client_caps, true);
+	}
+	if (selector_has(sel, "caps")) {
+		json_writer_key(w, "caps");
+		write_caps(w, driver->caps, driver->n_caps, false);
+	}
+
+	json_writer_object_end(w);
+}
+
+static void write_device(struct json_writer *w,
+		const struct model_device *dev, const struct selector *sel)
+{
+	if (!dev) {
+		json_writer_null(w);
+		return;
+	}
+
+	json_writer_object_begin(w);
+
+	write_fields(w, model_device_fields, dev, sel);
+
+	if (selector_has(sel, "device_data")) {
+		const struct model_field *fields =
+			model_device_data_fields(dev->bus_type);
+		json_writer_key(w, "device_data");
+		if (fields) {
+			write_object(w, fields, dev, NULL);
+		} else {
+			json_writer_null(w);
+		}
+	}
+
+	json_writer_object_end(w);
+}
+
+void model_node_write_json(struct json_writer *w,
+		const struct model_node *node, const struct selector *sel)
+{
+	json_writer_object_begin(w);
+
+	if (node->sections & MODEL_DRIVER) {
+		json_writer_key(w, "driver");
+		write_driver(w, node->driver, selector_get(sel, "driver"));
+	}
+	if (node->sections & MODEL_DEVICE) {
+		json_writer_key(w, "device");
+		write_device(w, node->device, selector_get(sel, "device"));
+	}
+	if (node->sections & MODEL_FB_SIZE) {
+		json_writer_key(w, "fb_size");
+		write_object(w, model_fb_size_fields, node->fb_size,
+			selector_get(sel, "fb_size"));
+	}
+
+	if (node->sections & MODEL_CONNECTORS) {
+		const struct selector *conn_sel = selector_get(sel, "connectors");
+		json_writer_key(w, "connectors");
+		json_writer_array_begin(w);
+		for (size_t i = 0; i < node->n_connectors; ++i) {
+			write_object(w, model_connector_fields, node->connectors[i],
+				conn_sel);
+		}
+		json_writer_array_end(w);
+	}
+	if (node->sections & MODEL_ENCODERS) {
+		const struct selector *enc_sel = selector_get(sel, "encoders");
+		json_writer_key(w, "encoders");
+		json_writer_array_begin(w);
+		for (size_t i = 0; i < node->n_encoders; ++i) {
+			write_object(w, model_encoder_fields, node->encoders[i],
+				enc_sel);
+		}
+		json_writer_array_end(w);
+	}
+	if (node->sections & MODEL_CRTCS) {
+		const struct selector *crtc_sel = selector_get(sel, "crtcs");
+		json_writer_key(w, "crtcs");
+		json_writer_array_begin(w);
+		for (size_t i = 0; i < node->n_crtcs; ++i) {
+			write_object(w, model_crtc_fields, node->crtcs[i], crtc_sel);
+		}
+		json_writer_array_end(w);
+	}
+	if (node->sections & MODEL_PLANES) {
+		const struct selector *plane_sel = selector_get(sel, "planes");
+		json_writer_key(w, "planes");
+		if (node->planes) {
+			json_writer_array_begin(w);
+			for (size_t i = 0; i < node->n_planes; ++i) {
+				write_object(w, model_plane_fields, node->planes[i],
+					plane_sel);
+			}
+			json_writer_array_end(w);
+		} else {
+			json_writer_null(w);
+		}
+	}
+
+	if (node->timed_out) {
+		write_bool(w, NULL, "timed_out", true);
+	}
+
+	json_writer_object_end(w);
+}
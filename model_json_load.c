@@ -0,0 +1,645 @@
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <json_object.h>
+#include <json_tokener.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "arena.h"
+#include "base64.h"
+#include "drm_info.h"
+#include "model.h"
+#include "model_schema.h"
+#include "props.h"
+
+/* Loads snapshots back from the JSON written by model_node_write_json(), in
+ * the classic layout or with shared values. Members which are missing, e.g.
+ * because they weren't selected, are left zeroed, and unknown members are
+ * ignored. Errors are sticky, so loaders don't return anything and callers
+ * check l->error once done. */
+
+struct loader {
+	struct arena *arena;
+	bool error;
+	// Array of shared values, NULL for the classic layout
+	struct json_object *shared;
+};
+
+static bool is_type(struct json_object *obj, enum json_type type)
+{
+	return obj && json_object_get_type(obj) == type;
+}
+
+/* Returns the value obj refers to if it's a {"$ref": index} object, obj
+ * otherwise */
+static struct json_object *resolve(struct loader *l, struct json_object *obj)
+{
+	struct json_object *ref;
+	if (!is_type(obj, json_type_object) ||
+			json_object_object_length(obj) != 1 ||
+			!json_object_object_get_ex(obj, "$ref", &ref)) {
+		return obj;
+	}
+
+	if (!is_type(ref, json_type_int) || !l->shared ||
+			json_object_get_int64(ref) < 0 ||
+			(uint64_t)json_object_get_int64(ref) >=
+			json_object_array_length(l->shared)) {
+		l->error = true;
+		return NULL;
+	}
+	return json_object_array_get_idx(l->shared, json_object_get_int64(ref));
+}
+
+static bool expect(struct loader *l, struct json_object *obj,
+		enum json_type type)
+{
+	if (!is_type(obj, type)) {
+		l->error = true;
+		return false;
+	}
+	return true;
+}
+
+static size_t array_len(struct loader *l, struct json_object *arr)
+{
+	if (!expect(l, arr, json_type_array)) {
+		return 0;
+	}
+	return json_object_array_length(arr);
+}
+
+static uint64_t get_uint(struct loader *l, struct json_object *obj)
+{
+	if (!expect(l, obj, json_type_int)) {
+		return 0;
+	}
+	return json_object_get_uint64(obj);
+}
+
+/* Returns the two's complement bits of an integer of either sign */
+static uint64_t get_int(struct loader *l, struct json_object *obj)
+{
+	if (!expect(l, obj, json_type_int)) {
+		return 0;
+	}
+	int64_t val = json_object_get_int64(obj);
+	return val < 0 ? (uint64_t)val : json_object_get_uint64(obj);
+}
+
+static bool get_bool(struct loader *l, struct json_object *obj)
+{
+	if (!expect(l, obj, json_type_boolean)) {
+		return false;
+	}
+	return json_object_get_boolean(obj);
+}
+
+static char *get_string(struct loader *l, struct json_object *obj)
+{
+	if (!expect(l, obj, json_type_string)) {
+		return "";
+	}
+	// arena_strndup() would stop at NUL bytes
+	size_t len = json_object_get_string_len(obj);
+	char *str = arena_alloc(l->arena, len + 1);
+	memcpy(str, json_object_get_string(obj), len);
+	return str;
+}
+
+/* Copies a string into a fixed-size, NUL-terminated buffer */
+static void get_name(struct loader *l, struct json_object *obj, char *buf,
+		size_t size)
+{
+	if (!expect(l, obj, json_type_string)) {
+		return;
+	}
+	size_t len = json_object_get_string_len(obj);
+	if (len > size - 1) {
+		len = size - 1;
+	}
+	memcpy(buf, json_object_get_string(obj), len);
+	buf[len] = '\0';
+}
+
+static void load_caps(struct loader *l, struct json_object *obj,
+		struct model_cap **caps, size_t *n_caps, bool client)
+{
+	*n_caps = 0;
+	if (!expect(l, obj, json_type_object)) {
+		*caps = NULL;
+		return;
+	}
+	*caps = arena_alloc(l->arena,
+		json_object_object_length(obj) * sizeof(**caps));
+
+	json_object_object_foreach(obj, key, val) {
+		struct model_cap *c = &(*caps)[(*n_caps)++];
+		c->name = arena_strdup(l->arena, key);
+		if (client) {
+			c->supported = get_bool(l, val);
+		} else if (val) {
+			c->supported = true;
+			c->value = get_uint(l, val);
+		}
+	}
+}
+
+static void load_object(struct loader *l, struct json_object *obj,
+	const struct model_field *fields, void *base);
+
+static struct model_fb *load_fb(struct loader *l, struct json_object *obj)
+{
+	if (!obj || !expect(l, obj, json_type_object)) {
+		return NULL;
+	}
+
+	struct model_fb *fb = arena_alloc(l->arena, sizeof(*fb));
+
+	json_object_object_foreach(obj, key, val) {
+		if (strcmp(key, "id") == 0) {
+			fb->id = get_uint(l, val);
+		} else if (strcmp(key, "width") == 0) {
+			fb->width = get_uint(l, val);
+		} else if (strcmp(key, "height") == 0) {
+			fb->height = get_uint(l, val);
+		} else if (strcmp(key, "pitch") == 0) {
+			// Only legacy FBs have a pitch outside of their planes
+			fb->legacy = true;
+			fb->pitch = get_uint(l, val);
+		} else if (strcmp(key, "bpp") == 0) {
+			fb->bpp = get_uint(l, val);
+		} else if (strcmp(key, "depth") == 0) {
+			fb->depth = get_uint(l, val);
+		} else if (strcmp(key, "format") == 0) {
+			fb->has_format = true;
+			fb->format = get_uint(l, val);
+		} else if (strcmp(key, "modifier") == 0) {
+			fb->has_modifier = true;
+			fb->modifier = get_uint(l, val);
+		} else if (strcmp(key, "planes") == 0) {
+			size_t n = array_len(l, val);
+			if (n > 4) {
+				l->error = true;
+				break;
+			}
+			for (size_t i = 0; i < n; ++i) {
+				load_object(l, json_object_array_get_idx(val, i),
+					model_fb_plane_fields, &fb->planes[fb->n_planes++]);
+			}
+		}
+	}
+
+	return fb;
+}
+
+static struct model_properties *load_properties(struct loader *l,
+	struct json_object *obj);
+
+/* Loads one item of the type of field */
+static void load_item(struct loader *l, struct json_object *val,
+		const struct model_field *field, void *ptr)
+{
+	switch (field->type) {
+	case MODEL_FIELD_UINT:
+	case MODEL_FIELD_MODIFIER:
+		model_field_set_uint(ptr, field->size, get_uint(l, val));
+		break;
+	case MODEL_FIELD_INT:
+		model_field_set_uint(ptr, field->size, get_int(l, val));
+		break;
+	case MODEL_FIELD_BOOL:
+		*(bool *)ptr = get_bool(l, val);
+		break;
+	case MODEL_FIELD_NAME:
+		get_name(l, val, ptr, field->size);
+		break;
+	case MODEL_FIELD_STRING:
+		*(char **)ptr = get_string(l, val);
+		break;
+	case MODEL_FIELD_OBJECT:
+		load_object(l, resolve(l, val), field->fields, ptr);
+		break;
+	case MODEL_FIELD_FB:
+		*(struct model_fb **)ptr = load_fb(l, val);
+		break;
+	case MODEL_FIELD_PROPERTIES:
+		*(struct model_properties **)ptr = load_properties(l, val);
+		break;
+	}
+}
+
+/* Loads the member of base described by field */
+static void load_value(struct loader *l, struct json_object *val,
+		const struct model_field *field, void *base)
+{
+	char *member = (char *)base + field->offset;
+
+	val = resolve(l, val);
+	if (field->flags & MODEL_FIELD_POINTER) {
+		if (!val) {
+			return;
+		}
+		void *item = arena_alloc(l->arena, field->size);
+		*(void **)member = item;
+		member = item;
+	}
+
+	if (field->flags & MODEL_FIELD_SIZED) {
+		size_t *len = (size_t *)((char *)base + field->count);
+		*(char **)member = get_string(l, val);
+		*len = is_type(val, json_type_string) ?
+			json_object_get_string_len(val) : 0;
+	} else if (field->flags & MODEL_FIELD_ARRAY) {
+		if (array_len(l, val) != field->count) {
+			l->error = true;
+			return;
+		}
+		for (size_t i = 0; i < field->count; ++i) {
+			load_item(l, json_object_array_get_idx(val, i), field,
+				member + i * field->size);
+		}
+	} else if (field->flags & MODEL_FIELD_LIST) {
+		size_t *n = (size_t *)((char *)base + field->count);
+		*n = array_len(l, val);
+		char *items = arena_alloc(l->arena, *n * field->size);
+		for (size_t i = 0; i < *n; ++i) {
+			load_item(l, json_object_array_get_idx(val, i), field,
+				items + i * field->size);
+		}
+		*(void **)member = items;
+	} else {
+		load_item(l, val, field, member);
+	}
+}
+
+/* Returns false if key isn't one of fields */
+static bool load_member(struct loader *l, const char *key,
+		struct json_object *val, const struct model_field *fields,
+		void *base)
+{
+	const struct model_field *field =
+		model_field_find(fields, key, strlen(key));
+	if (!field) {
+		return false;
+	}
+	load_value(l, val, field, base);
+	return true;
+}
+
+static void load_object(struct loader *l, struct json_object *obj,
+		const struct model_field *fields, void *base)
+{
+	model_fields_init(fields, base);
+	if (!expect(l, obj, json_type_object)) {
+		return;
+	}
+
+	json_object_object_foreach(obj, key, val) {
+		load_member(l, key, val, fields, base);
+	}
+}
+
+static struct model_driver *load_driver(struct loader *l,
+		struct json_object *obj)
+{
+	if (!obj || !expect(l, obj, json_type_object)) {
+		return NULL;
+	}
+
+	struct model_driver *driver = arena_alloc(l->arena, sizeof(*driver));
+	model_fields_init(model_driver_fields, driver);
+
+	json_object_object_foreach(obj, key, val) {
+		if (load_member(l, key, val, model_driver_fields, driver)) {
+			continue;
+		} else if (strcmp(key, "client_caps") == 0) {
+			load_caps(l, val, &driver->client_caps,
+				&driver->n_client_caps, true);
+		} else if (strcmp(key, "caps") == 0) {
+			load_caps(l, val, &driver->caps, &driver->n_caps, false);
+		}
+	}
+
+	return driver;
+}
+
+static struct model_device *load_device(struct loader *l,
+		struct json_object *obj)
+{
+	if (!obj || !expect(l, obj, json_type_object)) {
+		return NULL;
+	}
+
+	struct model_device *dev = arena_alloc(l->arena, sizeof(*dev));
+
+	json_object_object_foreach(obj, key, val) {
+		load_member(l, key, val, model_device_fields, dev);
+	}
+
+	// device_data depends on bus_type, which may come after it
+	const struct model_field *fields =
+		model_device_data_fields(dev->bus_type);
+	struct json_object *data;
+	if (fields && json_object_object_get_ex(obj, "device_data", &data) &&
+			data) {
+		load_object(l, data, fields, dev);
+	}
+
+	return dev;
+}
+
+static void load_spec(struct loader *l, struct json_object *spec,
+		struct model_prop_def *def)
+{
+	spec = resolve(l, spec);
+	switch (json_object_get_type(spec)) {
+	case json_type_object:
+		// Ranges and signed ranges share their layout, and get_int()
+		// takes either
+		load_object(l, spec, model_srange_fields, def);
+		break;
+	case json_type_array:
+		load_value(l, spec, &model_spec_enums_field, def);
+		break;
+	case json_type_int:
+		def->spec.object_type = get_uint(l, spec);
+		break;
+	default:
+		break;
+	}
+}
+
+/* The layout of decoded blobs depends on their type, which is the one of the
+ * property's handler */
+static const struct model_blob *load_blob(struct loader *l,
+		struct json_object *data, enum model_blob_type type)
+{
+	struct model_blob *blob = arena_alloc(l->arena, sizeof(*blob));
+	blob->type = type;
+
+	const struct model_field *field = model_blob_field(type);
+	if (field) {
+		load_value(l, data, field, blob);
+	}
+
+	return blob;
+}
+
+static void load_blob_contents(struct loader *l, struct json_object *obj,
+		struct model_property *prop)
+{
+	size_t len = json_object_get_string_len(obj);
+	void *data = arena_alloc(l->arena, len / 4 * 3);
+	if (!base64_decode(data, &prop->blob_len, json_object_get_string(obj),
+			len)) {
+		l->error = true;
+		return;
+	}
+	prop->blob_contents = data;
+}
+
+static void load_property(struct loader *l, struct json_object *obj,
+		struct model_property *prop, struct model_prop_def *def)
+{
+	if (!expect(l, obj, json_type_object)) {
+		return;
+	}
+
+	json_object_object_foreach(obj, key, val) {
+		if (strcmp(key, "id") == 0) {
+			def->id = get_uint(l, val);
+		} else if (strcmp(key, "flags") == 0) {
+			def->flags = get_uint(l, val);
+		} else if (strcmp(key, "raw_value") == 0) {
+			prop->raw_value = get_uint(l, val);
+		} else if (strcmp(key, "spec") == 0) {
+			load_spec(l, val, def);
+		} else if (strcmp(key, "value") == 0) {
+			// Blob contents are base64 strings, other values are the
+			// raw value
+			val = resolve(l, val);
+			if (is_type(val, json_type_string)) {
+				load_blob_contents(l, val, prop);
+			}
+		} else if (strcmp(key, "data") == 0) {
+			// Written by properties_info() for the properties which
+			// have a handler
+			val = resolve(l, val);
+			const struct prop_handler *handler =
+				prop_handler_get(def->name);
+			if (!handler || !val) {
+				continue;
+			}
+			switch (handler->kind) {
+			case PROP_BLOB:
+				prop->data_type = MODEL_DATA_BLOB;
+				prop->data.blob = load_blob(l, val, handler->blob_type);
+				break;
+			case PROP_FB:
+				prop->data_type = MODEL_DATA_FB;
+				prop->data.fb = load_fb(l, val);
+				break;
+			case PROP_FIXED_16_16:
+				prop->data_type = MODEL_DATA_UINT;
+				prop->data.uint = get_uint(l, val);
+				break;
+			}
+		}
+		// "type", "atomic" and "immutable" are part of the flags
+	}
+}
+
+static struct model_properties *load_properties(struct loader *l,
+		struct json_object *obj)
+{
+	if (!obj || !expect(l, obj, json_type_object)) {
+		return NULL;
+	}
+
+	struct model_properties *props = arena_alloc(l->arena, sizeof(*props));
+	props->items = arena_alloc(l->arena,
+		json_object_object_length(obj) * sizeof(*props->items));
+
+	json_object_object_foreach(obj, key, val) {
+		struct model_property *prop = &props->items[props->len++];
+		struct model_prop_def *def = arena_alloc(l->arena, sizeof(*def));
+		snprintf(def->name, sizeof(def->name), "%s", key);
+		prop->def = def;
+
+		load_property(l, val, prop, def);
+	}
+
+	return props;
+}
+
+static void load_node(struct loader *l, struct json_object *obj,
+		struct model_node *node)
+{
+	if (!expect(l, obj, json_type_object)) {
+		return;
+	}
+
+	json_object_object_foreach(obj, key, val) {
+		size_t n;
+		if (strcmp(key, "driver") == 0) {
+			node->sections |= MODEL_DRIVER;
+			node->driver = load_driver(l, val);
+		} else if (strcmp(key, "device") == 0) {
+			node->sections |= MODEL_DEVICE;
+			node->device = load_device(l, val);
+		} else if (strcmp(key, "fb_size") == 0) {
+			node->sections |= MODEL_FB_SIZE;
+			node->fb_size = arena_alloc(l->arena, sizeof(*node->fb_size));
+			load_object(l, val, model_fb_size_fields, node->fb_size);
+		} else if (strcmp(key, "connectors") == 0) {
+			node->sections |= MODEL_CONNECTORS;
+			n = array_len(l, val);
+			node->connectors = arena_alloc(l->arena,
+				n * sizeof(*node->connectors));
+			for (size_t i = 0; i < n; ++i) {
+				node->connectors[i] = arena_alloc(l->arena,
+					sizeof(**node->connectors));
+				load_object(l, json_object_array_get_idx(val, i),
+					model_connector_fields, node->connectors[i]);
+			}
+			node->n_connectors = n;
+		} else if (strcmp(key, "encoders") == 0) {
+			node->sections |= MODEL_ENCODERS;
+			n = array_len(l, val);
+			node->encoders = arena_alloc(l->arena,
+				n * sizeof(*node->encoders));
+			for (size_t i = 0; i < n; ++i) {
+				node->encoders[i] = arena_alloc(l->arena,
+					sizeof(**node->encoders));
+				load_object(l, json_object_array_get_idx(val, i),
+					model_encoder_fields, node->encoders[i]);
+			}
+			node->n_encoders = n;
+		} else if (strcmp(key, "crtcs") == 0) {
+			node->sections |= MODEL_CRTCS;
+			n = array_len(l, val);
+			node->crtcs = arena_alloc(l->arena, n * sizeof(*node->crtcs));
+			for (size_t i = 0; i < n; ++i) {
+				node->crtcs[i] = arena_alloc(l->arena,
+					sizeof(**node->crtcs));
+				load_object(l, json_object_array_get_idx(val, i),
+					model_crtc_fields, node->crtcs[i]);
+			}
+			node->n_crtcs = n;
+		} else if (strcmp(key, "planes") == 0) {
+			node->sections |= MODEL_PLANES;
+			if (!val) {
+				continue;
+			}
+			n = array_len(l, val);
+			node->planes = arena_alloc(l->arena, n * sizeof(*node->planes));
+			for (size_t i = 0; i < n; ++i) {
+				node->planes[i] = arena_alloc(l->arena,
+					sizeof(**node->planes));
+				load_object(l, json_object_array_get_idx(val, i),
+					model_plane_fields, node->planes[i]);
+			}
+			node->n_planes = n;
+		} else if (strcmp(key, "timed_out") == 0) {
+			node->timed_out = get_bool(l, val);
+		}
+	}
+}
+
+/* Loads one document, an object of node paths to nodes, plus the shared
+ * values if any */
+static bool load_document(struct json_object *doc, drm_info_func func,
+		void *data)
+{
+	if (!is_type(doc, json_type_object)) {
+		return false;
+	}
+
+	struct json_object *shared = NULL;
+	if (json_object_object_get_ex(doc, "$shared", &shared) &&
+			!is_type(shared, json_type_array)) {
+		return false;
+	}
+
+	json_object_object_foreach(doc, path, val) {
+		if (strcmp(path, "$shared") == 0) {
+			continue;
+		}
+
+		struct arena arena = {0};
+		struct loader l = { .arena = &arena, .shared = shared };
+		struct model_node node = {0};
+		load_node(&l, val, &node);
+		if (!l.error) {
+			func(path, &node, data);
+		}
+		arena_finish(&arena);
+		if (l.error) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Most input given to the tokener at once */
+#define JSON_CHUNK_SIZE ((size_t)1 << 20)
+
+bool drm_info_load_json(const void *buf, size_t len, drm_info_func func,
+		void *data)
+{
+	const char *str = buf;
+
+	struct json_tokener *tok = json_tokener_new();
+	if (!tok) {
+		perror("json_tokener_new");
+		return false;
+	}
+
+	// Several documents may have been concatenated
+	size_t pos = 0;
+	bool ok = true;
+	while (ok) {
+		while (pos < len && isspace((unsigned char)str[pos])) {
+			++pos;
+		}
+		if (pos == len) {
+			break;
+		}
+
+		// Documents are fed to the tokener a chunk at a time, so that they
+		// aren't limited to INT_MAX bytes
+		size_t start = pos;
+		struct json_object *doc;
+		enum json_tokener_error err;
+		json_tokener_reset(tok);
+		do {
+			size_t n = len - pos < JSON_CHUNK_SIZE ? len - pos : JSON_CHUNK_SIZE;
+			doc = json_tokener_parse_ex(tok, str + pos, n);
+			err = json_tokener_get_error(tok);
+			pos += err == json_tokener_continue ?
+				n : json_tokener_get_parse_end(tok);
+		} while (err == json_tokener_continue && pos < len);
+		if (err != json_tokener_success) {
+			fprintf(stderr, "Invalid JSON at offset %zu: %s\n", start,
+				json_tokener_error_desc(err == json_tokener_continue ?
+				json_tokener_error_parse_eof : err));
+			ok = false;
+			break;
+		}
+
+		ok = load_document(doc, func, data);
+		if (!ok) {
+			fprintf(stderr, "Invalid drm_info JSON document\n");
+		}
+		json_object_put(doc);
+	}
+
+	json_tokener_free(tok);
+	return ok;
+}
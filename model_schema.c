@@ -0,0 +1,421 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "model.h"
+#include "model_schema.h"
+
+#define MEMBER(type, member) \
+	.offset = offsetof(type, member), .size = sizeof(((type *)0)->member)
+/* Member of an anonymous struct, from the start of that struct */
+#define NESTED(type, outer, member) \
+	.offset = offsetof(type, outer.member) - offsetof(type, outer), \
+	.size = sizeof(((type *)0)->outer.member)
+#define ITEMS(type, member, n) \
+	.offset = offsetof(type, member), \
+	.size = sizeof(((type *)0)->member[0]), .count = n
+#define LIST(type, member, n_member) \
+	.offset = offsetof(type, member), .size = sizeof(*((type *)0)->member), \
+	.count = offsetof(type, n_member)
+#define POINTER(type, member) \
+	.offset = offsetof(type, member), .size = sizeof(*((type *)0)->member)
+
+static const struct model_field driver_version_fields[] = {
+	{ "major", MODEL_FIELD_INT, 0,
+		NESTED(struct model_driver, version, major) },
+	{ "minor", MODEL_FIELD_INT, 0,
+		NESTED(struct model_driver, version, minor) },
+	{ "patch", MODEL_FIELD_INT, 0,
+		NESTED(struct model_driver, version, patch) },
+	{ "date", MODEL_FIELD_STRING, 0,
+		NESTED(struct model_driver, version, date) },
+	{0},
+};
+
+static const struct model_field kernel_fields[] = {
+	{ "sysname", MODEL_FIELD_STRING, 0, MEMBER(struct model_kernel, sysname) },
+	{ "release", MODEL_FIELD_STRING, 0, MEMBER(struct model_kernel, release) },
+	{ "version", MODEL_FIELD_STRING, 0, MEMBER(struct model_kernel, version) },
+	{0},
+};
+
+// Followed by the caps
+const struct model_field model_driver_fields[] = {
+	{ "name", MODEL_FIELD_STRING, 0, MEMBER(struct model_driver, name) },
+	{ "desc", MODEL_FIELD_STRING, 0, MEMBER(struct model_driver, desc) },
+	{ "version", MODEL_FIELD_OBJECT, 0, MEMBER(struct model_driver, version),
+		.fields = driver_version_fields },
+	{ "kernel", MODEL_FIELD_OBJECT, MODEL_FIELD_POINTER,
+		POINTER(struct model_driver, kernel), .fields = kernel_fields },
+	{0},
+};
+
+// Followed by the device data
+const struct model_field model_device_fields[] = {
+	{ "available_nodes", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_device, available_nodes) },
+	{ "bus_type", MODEL_FIELD_UINT, 0, MEMBER(struct model_device, bus_type) },
+	{0},
+};
+
+static const struct model_field pci_fields[] = {
+	{ "vendor", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_device, data.pci.vendor) },
+	{ "device", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_device, data.pci.device) },
+	{ "subsystem_vendor", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_device, data.pci.subsystem_vendor) },
+	{ "subsystem_device", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_device, data.pci.subsystem_device) },
+	{0},
+};
+
+static const struct model_field usb_fields[] = {
+	{ "vendor", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_device, data.usb.vendor) },
+	{ "product", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_device, data.usb.product) },
+	{0},
+};
+
+static const struct model_field platform_fields[] = {
+	{ "compatible", MODEL_FIELD_STRING, MODEL_FIELD_LIST,
+		LIST(struct model_device, data.platform.compatible,
+			data.platform.n_compatible) },
+	{0},
+};
+
+const struct model_field model_fb_size_fields[] = {
+	{ "min_width", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_fb_size, min_width) },
+	{ "max_width", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_fb_size, max_width) },
+	{ "min_height", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_fb_size, min_height) },
+	{ "max_height", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_fb_size, max_height) },
+	{0},
+};
+
+static const struct model_field mode_fields[] = {
+	{ "clock", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, clock) },
+	{ "hdisplay", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, hdisplay) },
+	{ "hsync_start", MODEL_FIELD_UINT, 0,
+		MEMBER(drmModeModeInfo, hsync_start) },
+	{ "hsync_end", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, hsync_end) },
+	{ "htotal", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, htotal) },
+	{ "hskew", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, hskew) },
+	{ "vdisplay", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, vdisplay) },
+	{ "vsync_start", MODEL_FIELD_UINT, 0,
+		MEMBER(drmModeModeInfo, vsync_start) },
+	{ "vsync_end", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, vsync_end) },
+	{ "vtotal", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, vtotal) },
+	{ "vscan", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, vscan) },
+	{ "vrefresh", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, vrefresh) },
+	{ "flags", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, flags) },
+	{ "type", MODEL_FIELD_UINT, 0, MEMBER(drmModeModeInfo, type) },
+	{ "name", MODEL_FIELD_NAME, 0, MEMBER(drmModeModeInfo, name) },
+	{0},
+};
+
+const struct model_field model_fb_plane_fields[] = {
+	{ "offset", MODEL_FIELD_UINT, 0, MEMBER(struct model_fb_plane, offset) },
+	{ "pitch", MODEL_FIELD_UINT, 0, MEMBER(struct model_fb_plane, pitch) },
+	{0},
+};
+
+const struct model_field model_range_fields[] = {
+	{ "min", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_prop_def, spec.range.min) },
+	{ "max", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_prop_def, spec.range.max) },
+	{0},
+};
+
+const struct model_field model_srange_fields[] = {
+	{ "min", MODEL_FIELD_INT, 0,
+		MEMBER(struct model_prop_def, spec.srange.min) },
+	{ "max", MODEL_FIELD_INT, 0,
+		MEMBER(struct model_prop_def, spec.srange.max) },
+	{0},
+};
+
+static const struct model_field enum_fields[] = {
+	{ "name", MODEL_FIELD_NAME, 0, MEMBER(struct model_enum, name) },
+	{ "value", MODEL_FIELD_UINT, 0, MEMBER(struct model_enum, value) },
+	{0},
+};
+
+// Every object with the property has the same spec
+const struct model_field model_spec_enums_field = {
+	NULL, MODEL_FIELD_OBJECT, MODEL_FIELD_LIST | MODEL_FIELD_SHARED,
+	LIST(struct model_prop_def, spec.enums.items, spec.enums.n_items),
+	.fields = enum_fields,
+};
+
+static const struct model_field in_format_fields[] = {
+	{ "modifier", MODEL_FIELD_MODIFIER, 0,
+		MEMBER(struct model_in_format, modifier) },
+	{ "formats", MODEL_FIELD_UINT, MODEL_FIELD_LIST,
+		LIST(struct model_in_format, formats, n_formats) },
+	{0},
+};
+
+static const struct model_field edid_fields[] = {
+	{ "vendor", MODEL_FIELD_NAME, 0, MEMBER(struct model_edid, vendor) },
+	{ "product", MODEL_FIELD_UINT, 0, MEMBER(struct model_edid, product) },
+	{ "serial", MODEL_FIELD_UINT, 0, MEMBER(struct model_edid, serial) },
+	{ "name", MODEL_FIELD_NAME, 0, MEMBER(struct model_edid, name) },
+	{ "week", MODEL_FIELD_UINT, 0, MEMBER(struct model_edid, week) },
+	{ "year", MODEL_FIELD_UINT, 0, MEMBER(struct model_edid, year) },
+	{ "version", MODEL_FIELD_UINT, 0, MEMBER(struct model_edid, version) },
+	{ "revision", MODEL_FIELD_UINT, 0, MEMBER(struct model_edid, revision) },
+	{ "extensions", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_edid, n_extensions) },
+	{0},
+};
+
+static const struct model_field lut_fields[] = {
+	{ "size", MODEL_FIELD_UINT, 0, MEMBER(struct model_lut, size) },
+	{ "min", MODEL_FIELD_UINT, MODEL_FIELD_ARRAY,
+		ITEMS(struct model_lut, min, 3) },
+	{ "max", MODEL_FIELD_UINT, MODEL_FIELD_ARRAY,
+		ITEMS(struct model_lut, max, 3) },
+	{ "monotonic", MODEL_FIELD_BOOL, 0, MEMBER(struct model_lut, monotonic) },
+	{ "linear", MODEL_FIELD_BOOL, 0, MEMBER(struct model_lut, linear) },
+	{0},
+};
+
+// The display primaries have the same layout as the white point
+static const struct model_field chromaticity_fields[] = {
+	{ "x", MODEL_FIELD_UINT, 0,
+		NESTED(struct hdr_metadata_infoframe, white_point, x) },
+	{ "y", MODEL_FIELD_UINT, 0,
+		NESTED(struct hdr_metadata_infoframe, white_point, y) },
+	{0},
+};
+
+static const struct model_field hdr_metadata_fields[] = {
+	{ "metadata_type", MODEL_FIELD_UINT, 0,
+		MEMBER(struct hdr_output_metadata, metadata_type) },
+	{ "eotf", MODEL_FIELD_UINT, 0,
+		MEMBER(struct hdr_output_metadata, hdmi_metadata_type1.eotf) },
+	{ "display_primaries", MODEL_FIELD_OBJECT, MODEL_FIELD_ARRAY,
+		ITEMS(struct hdr_output_metadata,
+			hdmi_metadata_type1.display_primaries, 3),
+		.fields = chromaticity_fields },
+	{ "white_point", MODEL_FIELD_OBJECT, 0,
+		MEMBER(struct hdr_output_metadata, hdmi_metadata_type1.white_point),
+		.fields = chromaticity_fields },
+	{ "max_display_mastering_luminance", MODEL_FIELD_UINT, 0,
+		MEMBER(struct hdr_output_metadata,
+			hdmi_metadata_type1.max_display_mastering_luminance) },
+	{ "min_display_mastering_luminance", MODEL_FIELD_UINT, 0,
+		MEMBER(struct hdr_output_metadata,
+			hdmi_metadata_type1.min_display_mastering_luminance) },
+	{ "max_cll", MODEL_FIELD_UINT, 0,
+		MEMBER(struct hdr_output_metadata, hdmi_metadata_type1.max_cll) },
+	{ "max_fall", MODEL_FIELD_UINT, 0,
+		MEMBER(struct hdr_output_metadata, hdmi_metadata_type1.max_fall) },
+	{0},
+};
+
+static const struct model_field rect_fields[] = {
+	{ "x1", MODEL_FIELD_INT, 0, MEMBER(struct drm_mode_rect, x1) },
+	{ "y1", MODEL_FIELD_INT, 0, MEMBER(struct drm_mode_rect, y1) },
+	{ "x2", MODEL_FIELD_INT, 0, MEMBER(struct drm_mode_rect, x2) },
+	{ "y2", MODEL_FIELD_INT, 0, MEMBER(struct drm_mode_rect, y2) },
+	{0},
+};
+
+static const struct model_field blob_fields[] = {
+	// Planes of the same type usually have the same formats
+	[MODEL_BLOB_IN_FORMATS] = { NULL, MODEL_FIELD_OBJECT,
+		MODEL_FIELD_LIST | MODEL_FIELD_SHARED,
+		LIST(struct model_blob, in_formats.mods, in_formats.n_mods),
+		.fields = in_format_fields },
+	[MODEL_BLOB_MODE] = { NULL, MODEL_FIELD_OBJECT, MODEL_FIELD_SHARED,
+		MEMBER(struct model_blob, mode), .fields = mode_fields },
+	[MODEL_BLOB_FORMATS] = { NULL, MODEL_FIELD_UINT, MODEL_FIELD_LIST,
+		LIST(struct model_blob, formats.formats, formats.n_formats) },
+	[MODEL_BLOB_PATH] = { NULL, MODEL_FIELD_STRING, MODEL_FIELD_SIZED,
+		.offset = offsetof(struct model_blob, path.str),
+		.size = sizeof(char *),
+		.count = offsetof(struct model_blob, path.len) },
+	[MODEL_BLOB_EDID] = { NULL, MODEL_FIELD_OBJECT, 0,
+		MEMBER(struct model_blob, edid), .fields = edid_fields },
+	[MODEL_BLOB_LUT] = { NULL, MODEL_FIELD_OBJECT, 0,
+		MEMBER(struct model_blob, lut), .fields = lut_fields },
+	[MODEL_BLOB_CTM] = { NULL, MODEL_FIELD_INT, MODEL_FIELD_ARRAY,
+		ITEMS(struct model_blob, ctm, 9) },
+	[MODEL_BLOB_HDR_METADATA] = { NULL, MODEL_FIELD_OBJECT, 0,
+		MEMBER(struct model_blob, hdr_metadata),
+		.fields = hdr_metadata_fields },
+	[MODEL_BLOB_RECTS] = { NULL, MODEL_FIELD_OBJECT, MODEL_FIELD_LIST,
+		LIST(struct model_blob, rects.rects, rects.n_rects),
+		.fields = rect_fields },
+};
+
+const struct model_field model_connector_fields[] = {
+	{ "id", MODEL_FIELD_UINT, 0, MEMBER(struct model_connector, id) },
+	{ "type", MODEL_FIELD_UINT, 0, MEMBER(struct model_connector, type) },
+	{ "status", MODEL_FIELD_UINT, 0, MEMBER(struct model_connector, status) },
+	{ "phy_width", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_connector, phy_width) },
+	{ "phy_height", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_connector, phy_height) },
+	{ "subpixel", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_connector, subpixel) },
+	{ "encoder_id", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_connector, encoder_id) },
+	{ "encoders", MODEL_FIELD_UINT, MODEL_FIELD_LIST,
+		LIST(struct model_connector, encoders, n_encoders) },
+	// Connectors showing the same monitor have the same modes
+	{ "modes", MODEL_FIELD_OBJECT, MODEL_FIELD_LIST | MODEL_FIELD_SHARED_ITEMS,
+		LIST(struct model_connector, modes, n_modes), .fields = mode_fields },
+	{ "properties", MODEL_FIELD_PROPERTIES, 0,
+		MEMBER(struct model_connector, props) },
+	{0},
+};
+
+const struct model_field model_encoder_fields[] = {
+	{ "id", MODEL_FIELD_UINT, 0, MEMBER(struct model_encoder, id) },
+	{ "type", MODEL_FIELD_UINT, 0, MEMBER(struct model_encoder, type) },
+	{ "crtc_id", MODEL_FIELD_UINT, 0, MEMBER(struct model_encoder, crtc_id) },
+	{ "possible_crtcs", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_encoder, possible_crtcs) },
+	{ "possible_clones", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_encoder, possible_clones) },
+	{0},
+};
+
+const struct model_field model_crtc_fields[] = {
+	{ "id", MODEL_FIELD_UINT, 0, MEMBER(struct model_crtc, id) },
+	{ "fb_id", MODEL_FIELD_UINT, 0, MEMBER(struct model_crtc, fb_id) },
+	{ "x", MODEL_FIELD_UINT, 0, MEMBER(struct model_crtc, x) },
+	{ "y", MODEL_FIELD_UINT, 0, MEMBER(struct model_crtc, y) },
+	{ "mode", MODEL_FIELD_OBJECT, MODEL_FIELD_POINTER | MODEL_FIELD_SHARED,
+		POINTER(struct model_crtc, mode), .fields = mode_fields },
+	{ "gamma_size", MODEL_FIELD_INT, 0, MEMBER(struct model_crtc, gamma_size) },
+	{ "properties", MODEL_FIELD_PROPERTIES, 0,
+		MEMBER(struct model_crtc, props) },
+	{0},
+};
+
+const struct model_field model_plane_fields[] = {
+	{ "id", MODEL_FIELD_UINT, 0, MEMBER(struct model_plane, id) },
+	{ "possible_crtcs", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_plane, possible_crtcs) },
+	{ "crtc_id", MODEL_FIELD_UINT, 0, MEMBER(struct model_plane, crtc_id) },
+	{ "fb_id", MODEL_FIELD_UINT, 0, MEMBER(struct model_plane, fb_id) },
+	{ "crtc_x", MODEL_FIELD_UINT, 0, MEMBER(struct model_plane, crtc_x) },
+	{ "crtc_y", MODEL_FIELD_UINT, 0, MEMBER(struct model_plane, crtc_y) },
+	{ "x", MODEL_FIELD_UINT, 0, MEMBER(struct model_plane, x) },
+	{ "y", MODEL_FIELD_UINT, 0, MEMBER(struct model_plane, y) },
+	{ "gamma_size", MODEL_FIELD_UINT, 0,
+		MEMBER(struct model_plane, gamma_size) },
+	{ "fb", MODEL_FIELD_FB, 0, MEMBER(struct model_plane, fb) },
+	{ "formats", MODEL_FIELD_UINT, MODEL_FIELD_LIST,
+		LIST(struct model_plane, formats, n_formats) },
+	{ "properties", MODEL_FIELD_PROPERTIES, 0,
+		MEMBER(struct model_plane, props) },
+	{0},
+};
+
+const struct model_field *model_device_data_fields(int bus_type)
+{
+	switch (bus_type) {
+	case DRM_BUS_PCI:
+		return pci_fields;
+	case DRM_BUS_USB:
+		return usb_fields;
+	case DRM_BUS_PLATFORM:
+		return platform_fields;
+	}
+	return NULL;
+}
+
+const struct model_field *model_blob_field(enum model_blob_type type)
+{
+	if ((size_t)type >= sizeof(blob_fields) / sizeof(blob_fields[0])) {
+		return NULL;
+	}
+	return &blob_fields[type];
+}
+
+const struct model_field *model_field_find(const struct model_field *fields,
+		const char *name, size_t len)
+{
+	for (const struct model_field *field = fields; field->name; ++field) {
+		if (strlen(field->name) == len &&
+				memcmp(field->name, name, len) == 0) {
+			return field;
+		}
+	}
+	return NULL;
+}
+
+void model_fields_init(const struct model_field *fields, void *base)
+{
+	uint32_t indirect = MODEL_FIELD_ARRAY | MODEL_FIELD_LIST |
+		MODEL_FIELD_POINTER;
+	for (const struct model_field *field = fields; field->name; ++field) {
+		char *member = (char *)base + field->offset;
+		if (field->flags & indirect) {
+			continue;
+		}
+		if (field->type == MODEL_FIELD_STRING) {
+			*(char **)member = "";
+		} else if (field->type == MODEL_FIELD_OBJECT) {
+			model_fields_init(field->fields, member);
+		}
+	}
+}
+
+uint64_t model_field_get_uint(const void *ptr, size_t size)
+{
+	switch (size) {
+	case 1:
+		return *(const uint8_t *)ptr;
+	case 2:
+		return *(const uint16_t *)ptr;
+	case 4:
+		return *(const uint32_t *)ptr;
+	default:
+		return *(const uint64_t *)ptr;
+	}
+}
+
+int64_t model_field_get_int(const void *ptr, size_t size)
+{
+	switch (size) {
+	case 1:
+		return *(const int8_t *)ptr;
+	case 2:
+		return *(const int16_t *)ptr;
+	case 4:
+		return *(const int32_t *)ptr;
+	default:
+		return *(const int64_t *)ptr;
+	}
+}
+
+void model_field_set_uint(void *ptr, size_t size, uint64_t val)
+{
+	switch (size) {
+	case 1:
+		*(uint8_t *)ptr = val;
+		break;
+	case 2:
+		*(uint16_t *)ptr = val;
+		break;
+	case 4:
+		*(uint32_t *)ptr = val;
+		break;
+	default:
+		*(uint64_t *)ptr = val;
+		break;
+	}
+}
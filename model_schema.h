@@ -0,0 +1,99 @@
+#ifndef MODEL_SCHEMA_H
+#define MODEL_SCHEMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "model.h"
+
+/* Layout of the snapshot model in the JSON and CBOR documents, shared by
+ * model_json.c and both loaders so that they can't disagree. Each object is
+ * described by a table of fields, in the order they're written in, and
+ * terminated by a field without a name.
+ *
+ * Members which depend on each other, e.g. the ones of FBs, properties and
+ * caps, aren't described here and are handled by hand. */
+
+enum model_field_type {
+	MODEL_FIELD_UINT,
+	// Signed, of any size
+	MODEL_FIELD_INT,
+	MODEL_FIELD_BOOL,
+	// Fixed-size, NUL-terminated char array
+	MODEL_FIELD_NAME,
+	// char *, allocated from the arena when loaded
+	MODEL_FIELD_STRING,
+	// uint64_t format modifier, written along with its modifier_info
+	MODEL_FIELD_MODIFIER,
+	// Struct described by fields
+	MODEL_FIELD_OBJECT,
+	// struct model_fb *
+	MODEL_FIELD_FB,
+	// struct model_properties *
+	MODEL_FIELD_PROPERTIES,
+};
+
+enum model_field_flag {
+	// count items, stored in place
+	MODEL_FIELD_ARRAY = 1 << 0,
+	// Pointer to items allocated from the arena, their number is a size_t
+	// at offset count
+	MODEL_FIELD_LIST = 1 << 1,
+	// Pointer to the value, which is null if NULL
+	MODEL_FIELD_POINTER = 1 << 2,
+	// String which may contain NUL bytes, its length is a size_t at offset
+	// count
+	MODEL_FIELD_SIZED = 1 << 3,
+	// Written as a shared value, see json_writer_shared_begin()
+	MODEL_FIELD_SHARED = 1 << 4,
+	// Each item is written as a shared value
+	MODEL_FIELD_SHARED_ITEMS = 1 << 5,
+};
+
+struct model_field {
+	const char *name;
+	enum model_field_type type;
+	uint32_t flags;
+	// From the start of the object
+	size_t offset;
+	// Of the member, or of each item of arrays, lists and pointers
+	size_t size;
+	// See enum model_field_flag
+	size_t count;
+	// MODEL_FIELD_OBJECT only
+	const struct model_field *fields;
+};
+
+extern const struct model_field model_driver_fields[];
+extern const struct model_field model_device_fields[];
+extern const struct model_field model_fb_size_fields[];
+extern const struct model_field model_fb_plane_fields[];
+extern const struct model_field model_range_fields[];
+extern const struct model_field model_srange_fields[];
+extern const struct model_field model_connector_fields[];
+extern const struct model_field model_encoder_fields[];
+extern const struct model_field model_crtc_fields[];
+extern const struct model_field model_plane_fields[];
+
+/* Items of enum and bitmask specs, in struct model_prop_def */
+extern const struct model_field model_spec_enums_field;
+
+/* Returns the fields of device_data, in struct model_device, NULL if there
+ * aren't any for bus_type */
+const struct model_field *model_device_data_fields(int bus_type);
+/* Returns the value of blobs of type, in struct model_blob */
+const struct model_field *model_blob_field(enum model_blob_type type);
+
+/* Returns the field called name, NULL if there's none */
+const struct model_field *model_field_find(const struct model_field *fields,
+	const char *name, size_t len);
+/* Sets the strings of fields to "", for the ones which are missing */
+void model_fields_init(const struct model_field *fields, void *base);
+
+uint64_t model_field_get_uint(const void *ptr, size_t size);
+/* Sign-extends integers smaller than 64 bits */
+int64_t model_field_get_int(const void *ptr, size_t size);
+/* Truncates val to size bytes */
+void model_field_set_uint(void *ptr, size_t size, uint64_t val);
+
+#endif
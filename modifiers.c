@@ -1,14 +1,69 @@
 #include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <drm_fourcc.h>
 
+#include "modifiers.h"
 #include "tables.h"
+#include "tree_writer.h"
 
-static void print_nvidia_modifier(uint64_t mod) {
+/* Appends to the name of info, which is truncated if it doesn't fit */
+static void name_printf(struct modifier_info *info, const char *fmt, ...) {
+	size_t len = strlen(info->name);
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(info->name + len, sizeof(info->name) - len, fmt, args);
+	va_end(args);
+}
+
+/* Adds a flag which isn't part of the name */
+static void push_flag(struct modifier_info *info, const char *flag) {
+	if (info->n_flags < MODIFIER_MAX_FLAGS) {
+		info->flags[info->n_flags++] = flag;
+	}
+}
+
+static void add_flag(struct modifier_info *info, const char *flag) {
+	push_flag(info, flag);
+	name_printf(info, ", %s", flag);
+}
+
+static void add_param(struct modifier_info *info, const char *name,
+		uint64_t value) {
+	if (info->n_params < MODIFIER_MAX_PARAMS) {
+		info->params[info->n_params++] =
+			(struct modifier_param){ .name = name, .value = value };
+	}
+}
+
+static void add_str_param(struct modifier_info *info, const char *name,
+		const char *str) {
+	if (info->n_params < MODIFIER_MAX_PARAMS) {
+		info->params[info->n_params++] =
+			(struct modifier_param){ .name = name, .str = str };
+	}
+}
+
+/* Marks info as a modifier which can't be decoded, e.g. one from a newer
+ * drm_fourcc.h than the decoders know about */
+static void mark_unknown(struct modifier_info *info) {
+	info->tiling = "Unknown";
+}
+
+static void decode_nvidia_modifier(struct modifier_info *info, uint64_t mod) {
 	if (!(mod & 0x10)) {
-		printf("NVIDIA(unknown)");
+		// Only block linear modifiers are described in the name
+		if (mod == DRM_FORMAT_MOD_NVIDIA_TEGRA_TILED) {
+			info->tiling = "TEGRA_TILED";
+		} else {
+			mark_unknown(info);
+		}
+		name_printf(info, "NVIDIA(unknown)");
 		return;
 	}
 
@@ -18,8 +73,14 @@ static void print_nvidia_modifier(uint64_t mod) {
 	uint64_t s = (mod >> 22) & 0x1;
 	uint64_t c = (mod >> 23) & 0x7;
 
-	printf("NVIDIA_BLOCK_LINEAR_2D(h=%"PRIu64", k=%"PRIu64", g=%"PRIu64", "
-		"s=%"PRIu64", c=%"PRIu64")", h, k, g, s, c);
+	info->tiling = "BLOCK_LINEAR_2D";
+	add_param(info, "h", h);
+	add_param(info, "k", k);
+	add_param(info, "g", g);
+	add_param(info, "s", s);
+	add_param(info, "c", c);
+	name_printf(info, "NVIDIA_BLOCK_LINEAR_2D(h=%"PRIu64", k=%"PRIu64", "
+		"g=%"PRIu64", s=%"PRIu64", c=%"PRIu64")", h, k, g, s, c);
 }
 
 static const char *amd_tile_version_str(uint64_t tile_version) {
@@ -79,56 +140,70 @@ static bool amd_gfx9_tile_is_x_t(uint64_t tile) {
 	return false;
 }
 
-static void print_amd_modifier(uint64_t mod) {
+static void decode_amd_modifier(struct modifier_info *info, uint64_t mod) {
 	uint64_t tile_version = AMD_FMT_MOD_GET(TILE_VERSION, mod);
 	uint64_t tile = AMD_FMT_MOD_GET(TILE, mod);
 	uint64_t dcc = AMD_FMT_MOD_GET(DCC, mod);
 	uint64_t dcc_retile = AMD_FMT_MOD_GET(DCC_RETILE, mod);
 
-	printf("AMD(TILE_VERSION = %s, TILE = %s",
-		amd_tile_version_str(tile_version), amd_tile_str(tile, tile_version));
+	info->tiling = amd_tile_str(tile, tile_version);
+	add_str_param(info, "TILE_VERSION", amd_tile_version_str(tile_version));
+	name_printf(info, "AMD(TILE_VERSION = %s, TILE = %s",
+		amd_tile_version_str(tile_version), info->tiling);
 
 	if (dcc) {
-		printf(", DCC");
+		info->compression = "DCC";
+		name_printf(info, ", DCC");
 		if (dcc_retile) {
-			printf(", DCC_RETILE");
+			add_flag(info, "DCC_RETILE");
 		}
 		if (!dcc_retile && AMD_FMT_MOD_GET(DCC_PIPE_ALIGN, mod)) {
-			printf(", DCC_PIPE_ALIGN");
+			add_flag(info, "DCC_PIPE_ALIGN");
 		}
 		if (AMD_FMT_MOD_GET(DCC_INDEPENDENT_64B, mod)) {
-			printf(", DCC_INDEPENDENT_64B");
+			add_flag(info, "DCC_INDEPENDENT_64B");
 		}
 		if (AMD_FMT_MOD_GET(DCC_INDEPENDENT_128B, mod)) {
-			printf(", DCC_INDEPENDENT_128B");
+			add_flag(info, "DCC_INDEPENDENT_128B");
 		}
 		uint64_t dcc_max_compressed_block =
 			AMD_FMT_MOD_GET(DCC_MAX_COMPRESSED_BLOCK, mod);
-		printf(", DCC_MAX_COMPRESSED_BLOCK = %s",
-			amd_dcc_block_size_str(dcc_max_compressed_block));
+		info->block_size = amd_dcc_block_size_str(dcc_max_compressed_block);
+		name_printf(info, ", DCC_MAX_COMPRESSED_BLOCK = %s",
+			info->block_size);
 		if (AMD_FMT_MOD_GET(DCC_CONSTANT_ENCODE, mod)) {
-			printf(", DCC_CONSTANT_ENCODE");
+			add_flag(info, "DCC_CONSTANT_ENCODE");
 		}
 	}
 
 	if (tile_version >= AMD_FMT_MOD_TILE_VER_GFX9 && amd_gfx9_tile_is_x_t(tile)) {
-		printf(", PIPE_XOR_BITS = %"PRIu64, AMD_FMT_MOD_GET(PIPE_XOR_BITS, mod));
+		uint64_t pipe_xor_bits = AMD_FMT_MOD_GET(PIPE_XOR_BITS, mod);
+		add_param(info, "PIPE_XOR_BITS", pipe_xor_bits);
+		name_printf(info, ", PIPE_XOR_BITS = %"PRIu64, pipe_xor_bits);
 		if (tile_version == AMD_FMT_MOD_TILE_VER_GFX9) {
-			printf(", BANK_XOR_BITS = %"PRIu64, AMD_FMT_MOD_GET(BANK_XOR_BITS, mod));
+			uint64_t bank_xor_bits = AMD_FMT_MOD_GET(BANK_XOR_BITS, mod);
+			add_param(info, "BANK_XOR_BITS", bank_xor_bits);
+			name_printf(info, ", BANK_XOR_BITS = %"PRIu64, bank_xor_bits);
 		}
 		if (tile_version == AMD_FMT_MOD_TILE_VER_GFX10_RBPLUS) {
-			printf(", PACKERS = %"PRIu64, AMD_FMT_MOD_GET(PACKERS, mod));
+			uint64_t packers = AMD_FMT_MOD_GET(PACKERS, mod);
+			add_param(info, "PACKERS", packers);
+			name_printf(info, ", PACKERS = %"PRIu64, packers);
 		}
 		if (tile_version == AMD_FMT_MOD_TILE_VER_GFX9 && dcc) {
-			printf(", RB = %"PRIu64, AMD_FMT_MOD_GET(RB, mod));
+			uint64_t rb = AMD_FMT_MOD_GET(RB, mod);
+			add_param(info, "RB", rb);
+			name_printf(info, ", RB = %"PRIu64, rb);
 		}
 		if (tile_version == AMD_FMT_MOD_TILE_VER_GFX9 && dcc &&
 				(dcc_retile || AMD_FMT_MOD_GET(DCC_PIPE_ALIGN, mod))) {
-			printf(", PIPE = %"PRIu64, AMD_FMT_MOD_GET(PIPE, mod));
+			uint64_t pipe = AMD_FMT_MOD_GET(PIPE, mod);
+			add_param(info, "PIPE", pipe);
+			name_printf(info, ", PIPE = %"PRIu64, pipe);
 		}
 	}
 
-	printf(")");
+	name_printf(info, ")");
 }
 
 static const char *arm_afbc_block_size_str(uint64_t block_size) {
@@ -157,66 +232,71 @@ static const char *arm_afrc_cu_size_str(uint64_t cu_size) {
 	return "Unknown";
 }
 
-static void print_arm_modifier(uint64_t mod) {
+static void decode_arm_modifier(struct modifier_info *info, uint64_t mod) {
 	uint64_t type = (mod >> 52) & 0xF;
 	uint64_t value = mod & 0x000FFFFFFFFFFFFFULL;
 
 	switch (type) {
 	case DRM_FORMAT_MOD_ARM_TYPE_AFBC:;
 		uint64_t block_size = value & AFBC_FORMAT_MOD_BLOCK_SIZE_MASK;
-		printf("ARM_AFBC(BLOCK_SIZE = %s", arm_afbc_block_size_str(block_size));
+		info->compression = "AFBC";
+		info->block_size = arm_afbc_block_size_str(block_size);
+		name_printf(info, "ARM_AFBC(BLOCK_SIZE = %s", info->block_size);
 		if (value & AFBC_FORMAT_MOD_YTR) {
-			printf(", YTR");
+			add_flag(info, "YTR");
 		}
 		if (value & AFBC_FORMAT_MOD_SPLIT) {
-			printf(", SPLIT");
+			add_flag(info, "SPLIT");
 		}
 		if (value & AFBC_FORMAT_MOD_SPARSE) {
-			printf(", SPARSE");
+			add_flag(info, "SPARSE");
 		}
 		if (value & AFBC_FORMAT_MOD_CBR) {
-			printf(", CBR");
+			add_flag(info, "CBR");
 		}
 		if (value & AFBC_FORMAT_MOD_TILED) {
-			printf(", TILED");
+			add_flag(info, "TILED");
 		}
 		if (value & AFBC_FORMAT_MOD_SC) {
-			printf(", SC");
+			add_flag(info, "SC");
 		}
 		if (value & AFBC_FORMAT_MOD_DB) {
-			printf(", DB");
+			add_flag(info, "DB");
 		}
 		if (value & AFBC_FORMAT_MOD_BCH) {
-			printf(", BCH");
+			add_flag(info, "BCH");
 		}
 		if (value & AFBC_FORMAT_MOD_USM) {
-			printf(", USM");
+			add_flag(info, "USM");
 		}
-		printf(")");
+		name_printf(info, ")");
 		break;
 	case DRM_FORMAT_MOD_ARM_TYPE_MISC:
 		switch (mod) {
 		case DRM_FORMAT_MOD_ARM_16X16_BLOCK_U_INTERLEAVED:
-			printf("ARM_16X16_BLOCK_U_INTERLEAVED");
+			info->tiling = "16X16_BLOCK_U_INTERLEAVED";
+			name_printf(info, "ARM_16X16_BLOCK_U_INTERLEAVED");
 			break;
 		default:
-			printf("ARM_MISC(unknown)");
+			mark_unknown(info);
+			name_printf(info, "ARM_MISC(unknown)");
 		}
 		break;
-	case DRM_FORMAT_MOD_ARM_TYPE_AFRC:
+	case DRM_FORMAT_MOD_ARM_TYPE_AFRC:;
 		uint64_t cu_size_p0 = value & AFRC_FORMAT_MOD_CU_SIZE_MASK;
 		uint64_t cu_size_p12 = (value >> 4) & AFRC_FORMAT_MOD_CU_SIZE_MASK;
-		printf("ARM_AFRC(");
-		printf("CU_SIZE_P0 = %s", arm_afrc_cu_size_str(cu_size_p0));
-		printf(", CU_SIZE_P12 = %s", arm_afrc_cu_size_str(cu_size_p12));
-		if (value & AFRC_FORMAT_MOD_LAYOUT_SCAN)
-			printf(", SCAN");
-		else
-			printf(", ROT");
-		printf(")");
+		info->compression = "AFRC";
+		info->tiling = value & AFRC_FORMAT_MOD_LAYOUT_SCAN ? "SCAN" : "ROT";
+		add_str_param(info, "CU_SIZE_P0", arm_afrc_cu_size_str(cu_size_p0));
+		add_str_param(info, "CU_SIZE_P12",
+			arm_afrc_cu_size_str(cu_size_p12));
+		name_printf(info, "ARM_AFRC(CU_SIZE_P0 = %s, CU_SIZE_P12 = %s, %s)",
+			arm_afrc_cu_size_str(cu_size_p0),
+			arm_afrc_cu_size_str(cu_size_p12), info->tiling);
 		break;
 	default:
-		printf("ARM(unknown)");
+		mark_unknown(info);
+		name_printf(info, "ARM(unknown)");
 	}
 }
 
@@ -230,35 +310,395 @@ static const char *amlogic_layout_str(uint64_t layout) {
 	return "Unknown";
 }
 
-static void print_amlogic_modifier(uint64_t mod) {
+static void decode_amlogic_modifier(struct modifier_info *info,
+		uint64_t mod) {
 	uint64_t layout = mod & 0xFF;
 	uint64_t options = (mod >> 8) & 0xFF;
 
-	printf("AMLOGIC_FBC(layout = %s, options = %s)",
-		amlogic_layout_str(layout),
-		(options & AMLOGIC_FBC_OPTION_MEM_SAVING) ? "MEM_SAVING" : "0");
+	info->compression = "FBC";
+	info->tiling = amlogic_layout_str(layout);
+	name_printf(info, "AMLOGIC_FBC(layout = %s, options = ", info->tiling);
+	if (options & AMLOGIC_FBC_OPTION_MEM_SAVING) {
+		push_flag(info, "MEM_SAVING");
+		name_printf(info, "MEM_SAVING)");
+	} else {
+		name_printf(info, "0)");
+	}
+}
+
+static const struct {
+	uint64_t modifier;
+	const char *tiling;
+	const char *compression;
+	// Generation the compression is specific to
+	const char *platform;
+	bool clear_color;
+} intel_modifiers[] = {
+	{ I915_FORMAT_MOD_X_TILED, "X_TILED", NULL, NULL, false },
+	{ I915_FORMAT_MOD_Y_TILED, "Y_TILED", NULL, NULL, false },
+	{ I915_FORMAT_MOD_Yf_TILED, "Yf_TILED", NULL, NULL, false },
+	{ I915_FORMAT_MOD_Y_TILED_CCS, "Y_TILED", "CCS", NULL, false },
+	{ I915_FORMAT_MOD_Yf_TILED_CCS, "Yf_TILED", "CCS", NULL, false },
+	{ I915_FORMAT_MOD_Y_TILED_GEN12_RC_CCS, "Y_TILED", "RC_CCS", "GEN12",
+		false },
+	{ I915_FORMAT_MOD_Y_TILED_GEN12_MC_CCS, "Y_TILED", "MC_CCS", "GEN12",
+		false },
+	{ I915_FORMAT_MOD_Y_TILED_GEN12_RC_CCS_CC, "Y_TILED", "RC_CCS", "GEN12",
+		true },
+	{ I915_FORMAT_MOD_4_TILED, "4_TILED", NULL, NULL, false },
+	{ I915_FORMAT_MOD_4_TILED_DG2_RC_CCS, "4_TILED", "RC_CCS", "DG2", false },
+	{ I915_FORMAT_MOD_4_TILED_DG2_MC_CCS, "4_TILED", "MC_CCS", "DG2", false },
+	{ I915_FORMAT_MOD_4_TILED_DG2_RC_CCS_CC, "4_TILED", "RC_CCS", "DG2",
+		true },
+	// The ones below are newer than the libdrm we require
+#ifdef I915_FORMAT_MOD_4_TILED_MTL_RC_CCS
+	{ I915_FORMAT_MOD_4_TILED_MTL_RC_CCS, "4_TILED", "RC_CCS", "MTL", false },
+	{ I915_FORMAT_MOD_4_TILED_MTL_MC_CCS, "4_TILED", "MC_CCS", "MTL", false },
+	{ I915_FORMAT_MOD_4_TILED_MTL_RC_CCS_CC, "4_TILED", "RC_CCS", "MTL",
+		true },
+#endif
+#ifdef I915_FORMAT_MOD_4_TILED_LNL_CCS
+	{ I915_FORMAT_MOD_4_TILED_LNL_CCS, "4_TILED", "CCS", "LNL", false },
+#endif
+#ifdef I915_FORMAT_MOD_4_TILED_BMG_CCS
+	{ I915_FORMAT_MOD_4_TILED_BMG_CCS, "4_TILED", "CCS", "BMG", false },
+#endif
+};
+
+static void decode_intel_modifier(struct modifier_info *info, uint64_t mod) {
+	for (size_t i = 0; i < sizeof(intel_modifiers) /
+			sizeof(intel_modifiers[0]); ++i) {
+		if (intel_modifiers[i].modifier != mod) {
+			continue;
+		}
+		info->tiling = intel_modifiers[i].tiling;
+		info->compression = intel_modifiers[i].compression;
+		if (intel_modifiers[i].platform) {
+			add_str_param(info, "PLATFORM", intel_modifiers[i].platform);
+		}
+		if (intel_modifiers[i].clear_color) {
+			push_flag(info, "CLEAR_COLOR");
+		}
+		return;
+	}
+	mark_unknown(info);
+}
+
+static void decode_samsung_modifier(struct modifier_info *info,
+		uint64_t mod) {
+	switch (mod) {
+	case DRM_FORMAT_MOD_SAMSUNG_64_32_TILE:
+		info->tiling = "64_32_TILE";
+		break;
+	case DRM_FORMAT_MOD_SAMSUNG_16_16_TILE:
+		info->tiling = "16_16_TILE";
+		break;
+	default:
+		mark_unknown(info);
+	}
+}
+
+static void decode_qcom_modifier(struct modifier_info *info, uint64_t mod) {
+	switch (mod) {
+	case DRM_FORMAT_MOD_QCOM_COMPRESSED:
+		// Universal Bandwidth Compression, of macrotiles
+		info->tiling = "MACROTILE";
+		info->compression = "UBWC";
+		break;
+	case DRM_FORMAT_MOD_QCOM_TILED3:
+		info->tiling = "TILED3";
+		break;
+	case DRM_FORMAT_MOD_QCOM_TILED2:
+		info->tiling = "TILED2";
+		break;
+	default:
+		mark_unknown(info);
+	}
+}
+
+#ifdef VIVANTE_MOD_EXT_MASK
+static const char *vivante_ts_str(uint64_t ts) {
+	switch (ts) {
+	case VIVANTE_MOD_TS_64_4:
+		return "64_4";
+	case VIVANTE_MOD_TS_64_2:
+		return "64_2";
+	case VIVANTE_MOD_TS_128_4:
+		return "128_4";
+	case VIVANTE_MOD_TS_256_4:
+		return "256_4";
+	}
+	return "Unknown";
+}
+
+static const char *vivante_comp_str(uint64_t comp) {
+	switch (comp) {
+	case VIVANTE_MOD_COMP_DEC400:
+		return "DEC400";
+	}
+	return "Unknown";
+}
+#endif
+
+static void decode_vivante_modifier(struct modifier_info *info,
+		uint64_t mod) {
+	uint64_t base = mod;
+#ifdef VIVANTE_MOD_EXT_MASK
+	// Tile status and compression can be added to any of the layouts
+	base = mod & ~VIVANTE_MOD_EXT_MASK;
+#endif
+
+	switch (base) {
+	case DRM_FORMAT_MOD_VIVANTE_TILED:
+		info->tiling = "TILED";
+		break;
+	case DRM_FORMAT_MOD_VIVANTE_SUPER_TILED:
+		info->tiling = "SUPER_TILED";
+		break;
+	case DRM_FORMAT_MOD_VIVANTE_SPLIT_TILED:
+		info->tiling = "SPLIT_TILED";
+		break;
+	case DRM_FORMAT_MOD_VIVANTE_SPLIT_SUPER_TILED:
+		info->tiling = "SPLIT_SUPER_TILED";
+		break;
+	default:
+		mark_unknown(info);
+		return;
+	}
+
+#ifdef VIVANTE_MOD_EXT_MASK
+	uint64_t ts = mod & VIVANTE_MOD_TS_MASK;
+	uint64_t comp = mod & VIVANTE_MOD_COMP_MASK;
+	if (ts) {
+		add_str_param(info, "TS", vivante_ts_str(ts));
+	}
+	if (comp) {
+		// Compression needs tile status, its tags are in there
+		info->compression = vivante_comp_str(comp);
+	}
+#endif
+}
+
+static void decode_broadcom_modifier(struct modifier_info *info,
+		uint64_t mod) {
+	// SAND modifiers have the column height as a parameter
+	uint64_t base = fourcc_mod_broadcom_mod(mod);
+	uint64_t param = fourcc_mod_broadcom_param(mod);
+
+	switch (base) {
+	case DRM_FORMAT_MOD_BROADCOM_VC4_T_TILED:
+		info->tiling = "T_TILED";
+		break;
+	case DRM_FORMAT_MOD_BROADCOM_SAND32:
+		info->tiling = "SAND32";
+		break;
+	case DRM_FORMAT_MOD_BROADCOM_SAND64:
+		info->tiling = "SAND64";
+		break;
+	case DRM_FORMAT_MOD_BROADCOM_SAND128:
+		info->tiling = "SAND128";
+		break;
+	case DRM_FORMAT_MOD_BROADCOM_SAND256:
+		info->tiling = "SAND256";
+		break;
+	case DRM_FORMAT_MOD_BROADCOM_UIF:
+		info->tiling = "UIF";
+		break;
+	default:
+		mark_unknown(info);
+		return;
+	}
+
+	if (base == mod) {
+		return;
+	} else if (base == DRM_FORMAT_MOD_BROADCOM_VC4_T_TILED ||
+			base == DRM_FORMAT_MOD_BROADCOM_UIF) {
+		// Only SAND has a parameter
+		mark_unknown(info);
+	} else {
+		add_param(info, "COL_HEIGHT", param);
+	}
+}
+
+static void decode_allwinner_modifier(struct modifier_info *info,
+		uint64_t mod) {
+	switch (mod) {
+	case DRM_FORMAT_MOD_ALLWINNER_TILED:
+		info->tiling = "TILED";
+		break;
+	default:
+		mark_unknown(info);
+	}
+}
+
+static void decode_none_modifier(struct modifier_info *info, uint64_t mod) {
+	switch (mod) {
+	case DRM_FORMAT_MOD_LINEAR:
+		info->tiling = "LINEAR";
+		break;
+	case DRM_FORMAT_MOD_INVALID:
+		// Not a layout, the driver picks one
+		break;
+	default:
+		mark_unknown(info);
+	}
 }
 
 static uint8_t mod_vendor(uint64_t mod) {
 	return (uint8_t)(mod >> 56);
 }
 
-void print_modifier(uint64_t mod) {
+static const char *vendor_str(uint8_t vendor) {
+	switch (vendor) {
+	case DRM_FORMAT_MOD_VENDOR_NONE:      return "NONE";
+	case DRM_FORMAT_MOD_VENDOR_INTEL:     return "INTEL";
+	case DRM_FORMAT_MOD_VENDOR_AMD:       return "AMD";
+	case DRM_FORMAT_MOD_VENDOR_NVIDIA:    return "NVIDIA";
+	case DRM_FORMAT_MOD_VENDOR_SAMSUNG:   return "SAMSUNG";
+	case DRM_FORMAT_MOD_VENDOR_QCOM:      return "QCOM";
+	case DRM_FORMAT_MOD_VENDOR_VIVANTE:   return "VIVANTE";
+	case DRM_FORMAT_MOD_VENDOR_BROADCOM:  return "BROADCOM";
+	case DRM_FORMAT_MOD_VENDOR_ARM:       return "ARM";
+	case DRM_FORMAT_MOD_VENDOR_ALLWINNER: return "ALLWINNER";
+	case DRM_FORMAT_MOD_VENDOR_AMLOGIC:   return "AMLOGIC";
+	default:                              return "Unknown";
+	}
+}
+
+void modifier_info_decode(struct modifier_info *info, uint64_t mod) {
+	*info = (struct modifier_info){
+		.modifier = mod,
+		.vendor = vendor_str(mod_vendor(mod)),
+	};
+
 	switch (mod_vendor(mod)) {
 	case DRM_FORMAT_MOD_VENDOR_NVIDIA:
-		print_nvidia_modifier(mod);
+		decode_nvidia_modifier(info, mod);
 		break;
 	case DRM_FORMAT_MOD_VENDOR_AMD:
-		print_amd_modifier(mod);
+		decode_amd_modifier(info, mod);
 		break;
 	case DRM_FORMAT_MOD_VENDOR_ARM:
-		print_arm_modifier(mod);
+		decode_arm_modifier(info, mod);
 		break;
 	case DRM_FORMAT_MOD_VENDOR_AMLOGIC:
-		print_amlogic_modifier(mod);
+		decode_amlogic_modifier(info, mod);
+		break;
+	case DRM_FORMAT_MOD_VENDOR_INTEL:
+		decode_intel_modifier(info, mod);
+		break;
+	case DRM_FORMAT_MOD_VENDOR_SAMSUNG:
+		decode_samsung_modifier(info, mod);
+		break;
+	case DRM_FORMAT_MOD_VENDOR_QCOM:
+		decode_qcom_modifier(info, mod);
+		break;
+	case DRM_FORMAT_MOD_VENDOR_VIVANTE:
+		decode_vivante_modifier(info, mod);
+		break;
+	case DRM_FORMAT_MOD_VENDOR_BROADCOM:
+		decode_broadcom_modifier(info, mod);
+		break;
+	case DRM_FORMAT_MOD_VENDOR_ALLWINNER:
+		decode_allwinner_modifier(info, mod);
+		break;
+	case DRM_FORMAT_MOD_VENDOR_NONE:
+		decode_none_modifier(info, mod);
 		break;
 	default:
-		printf("%s", basic_modifier_str(mod));
+		mark_unknown(info);
+	}
+
+	// Vendors whose modifiers have fields are described by their decoder,
+	// the others keep their name from drm_fourcc.h
+	if (info->name[0] == '\0') {
+		name_printf(info, "%s", basic_modifier_str(mod));
+	}
+}
+
+/* Open-addressing hash table of decoded modifiers, keyed by modifier. Entries
+ * live until modifier_info_finish(). */
+static struct {
+	pthread_mutex_t lock;
+	struct modifier_info **infos;
+	size_t len, cap;
+} cache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static size_t mod_hash(uint64_t mod) {
+	// Fibonacci hashing, vendor bits are in the top byte
+	return (mod * 0x9E3779B97F4A7C15ull) >> 32;
+}
+
+static void cache_insert(struct modifier_info *info) {
+	if (2 * (cache.len + 1) > cache.cap) {
+		size_t cap = cache.cap ? 2 * cache.cap : 64;
+		struct modifier_info **infos = calloc(cap, sizeof(*infos));
+		if (!infos) {
+			perror("calloc");
+			abort();
+		}
+		for (size_t i = 0; i < cache.cap; ++i) {
+			struct modifier_info *old = cache.infos[i];
+			if (!old) {
+				continue;
+			}
+			size_t j = mod_hash(old->modifier) & (cap - 1);
+			while (infos[j]) {
+				j = (j + 1) & (cap - 1);
+			}
+			infos[j] = old;
+		}
+		free(cache.infos);
+		cache.infos = infos;
+		cache.cap = cap;
 	}
-	printf(" (0x%"PRIx64")", mod);
+
+	size_t mask = cache.cap - 1;
+	size_t i = mod_hash(info->modifier) & mask;
+	while (cache.infos[i]) {
+		i = (i + 1) & mask;
+	}
+	cache.infos[i] = info;
+	++cache.len;
+}
+
+const struct modifier_info *modifier_info_get(uint64_t mod) {
+	pthread_mutex_lock(&cache.lock);
+
+	size_t mask = cache.cap - 1;
+	for (size_t i = mod_hash(mod) & mask; cache.cap && cache.infos[i];
+			i = (i + 1) & mask) {
+		if (cache.infos[i]->modifier == mod) {
+			struct modifier_info *info = cache.infos[i];
+			pthread_mutex_unlock(&cache.lock);
+			return info;
+		}
+	}
+
+	struct modifier_info *info = malloc(sizeof(*info));
+	if (!info) {
+		perror("malloc");
+		abort();
+	}
+	modifier_info_decode(info, mod);
+	cache_insert(info);
+
+	pthread_mutex_unlock(&cache.lock);
+	return info;
+}
+
+void modifier_info_finish(void) {
+	for (size_t i = 0; i < cache.cap; ++i) {
+		free(cache.infos[i]);
+	}
+	free(cache.infos);
+	cache.infos = NULL;
+	cache.len = cache.cap = 0;
+}
+
+void print_modifier(struct tree_writer *w, uint64_t mod) {
+	tree_writer_puts(w, modifier_info_get(mod)->name);
+	tree_writer_puts(w, " (0x");
+	tree_writer_hex(w, mod, 0);
+	tree_writer_putc(w, ')');
 }
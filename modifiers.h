@@ -1,8 +1,48 @@
 #ifndef MODIFIERS_H
 #define MODIFIERS_H
 
+#include <stddef.h>
 #include <stdint.h>
 
-void print_modifier(uint64_t modifier);
+struct tree_writer;
+
+#define MODIFIER_MAX_FLAGS 12
+#define MODIFIER_MAX_PARAMS 8
+
+/* Vendor-specific field of a modifier, with a number or a name */
+struct modifier_param {
+	const char *name;
+	// NULL if the value is a number
+	const char *str;
+	uint64_t value;
+};
+
+/* Decoded format modifier. Strings are static, fields which don't apply to
+ * the modifier are NULL. */
+struct modifier_info {
+	uint64_t modifier;
+	const char *vendor;
+	// Layout of the pixels, e.g. LINEAR or an AMD swizzle mode
+	const char *tiling;
+	// Compression scheme, e.g. DCC or AFBC
+	const char *compression;
+	// Superblock size for AFBC, max compressed block size for DCC
+	const char *block_size;
+	const char *flags[MODIFIER_MAX_FLAGS];
+	size_t n_flags;
+	struct modifier_param params[MODIFIER_MAX_PARAMS];
+	size_t n_params;
+	// Human-readable description, as printed by print_modifier()
+	char name[256];
+};
+
+/* Decodes mod into info */
+void modifier_info_decode(struct modifier_info *info, uint64_t mod);
+/* Returns the decoded mod, which is only decoded the first time it's asked
+ * for. Thread-safe, and valid until modifier_info_finish(). */
+const struct modifier_info *modifier_info_get(uint64_t mod);
+void modifier_info_finish(void);
+
+void print_modifier(struct tree_writer *w, uint64_t modifier);
 
 #endif
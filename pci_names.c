@@ -0,0 +1,114 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_LIBPCI
+#include <pci/pci.h>
+#endif
+
+#include "pci_names.h"
+
+struct pci_name {
+	uint32_t id; // Vendor in the top half
+	char *name; // NULL if the vendor isn't known
+};
+
+/* Every device which was asked for, there's only one or two per machine.
+ * libpci is only set up for the first device which isn't in pci.ids. */
+static struct {
+	pthread_mutex_t lock;
+	struct pci_name *names;
+	size_t len, cap;
+#ifdef HAVE_LIBPCI
+	struct pci_access *pci;
+#endif
+} cache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static char *lookup_name(uint16_t vendor, uint16_t device)
+{
+#if defined(HAVE_PCI_IDS) || defined(HAVE_LIBPCI)
+	char name[512];
+#else
+	// Nothing to look them up in
+	(void)vendor;
+	(void)device;
+#endif
+
+#ifdef HAVE_PCI_IDS
+	const char *vendor_name = pci_ids_vendor(vendor);
+	const char *device_name = pci_ids_device(vendor, device);
+	if (vendor_name && device_name) {
+		snprintf(name, sizeof(name), "%s %s", vendor_name, device_name);
+		return strdup(name);
+	}
+#endif
+
+#ifdef HAVE_LIBPCI
+	if (!cache.pci) {
+		cache.pci = pci_alloc();
+		pci_init(cache.pci);
+	}
+	if (pci_lookup_name(cache.pci, name, sizeof(name),
+			PCI_LOOKUP_VENDOR | PCI_LOOKUP_DEVICE, vendor, device)) {
+		return strdup(name);
+	}
+#endif
+
+#ifdef HAVE_PCI_IDS
+	// Same as libpci for devices which are newer than pci.ids
+	if (vendor_name) {
+		snprintf(name, sizeof(name), "%s Device %04x", vendor_name, device);
+		return strdup(name);
+	}
+#endif
+	return NULL;
+}
+
+const char *pci_name_get(uint16_t vendor, uint16_t device)
+{
+	uint32_t id = (uint32_t)vendor << 16 | device;
+
+	pthread_mutex_lock(&cache.lock);
+
+	for (size_t i = 0; i < cache.len; ++i) {
+		if (cache.names[i].id == id) {
+			char *name = cache.names[i].name;
+			pthread_mutex_unlock(&cache.lock);
+			return name;
+		}
+	}
+
+	if (cache.len == cache.cap) {
+		size_t cap = cache.cap ? 2 * cache.cap : 4;
+		struct pci_name *names = realloc(cache.names, cap * sizeof(*names));
+		if (!names) {
+			perror("realloc");
+			exit(EXIT_FAILURE);
+		}
+		cache.names = names;
+		cache.cap = cap;
+	}
+
+	char *name = lookup_name(vendor, device);
+	cache.names[cache.len++] = (struct pci_name){ id, name };
+
+	pthread_mutex_unlock(&cache.lock);
+	return name;
+}
+
+void pci_names_finish(void)
+{
+	for (size_t i = 0; i < cache.len; ++i) {
+		free(cache.names[i].name);
+	}
+	free(cache.names);
+	cache.names = NULL;
+	cache.len = cache.cap = 0;
+#ifdef HAVE_LIBPCI
+	if (cache.pci) {
+		pci_cleanup(cache.pci);
+		cache.pci = NULL;
+	}
+#endif
+}
@@ -0,0 +1,19 @@
+#ifndef PCI_NAMES_H
+#define PCI_NAMES_H
+
+#include <stdint.h>
+
+/* Returns the name of a PCI device as "vendor device", the same as lspci
+ * prints, or NULL if its vendor isn't known. Names are looked up in the
+ * display devices embedded from pci.ids, then with libpci, and are only looked
+ * up once per device. Thread-safe, and valid until pci_names_finish(). */
+const char *pci_name_get(uint16_t vendor, uint16_t device);
+void pci_names_finish(void);
+
+#ifdef HAVE_PCI_IDS
+/* Generated by pciids.py, NULL if the vendor or device isn't in pci.ids */
+const char *pci_ids_vendor(uint16_t vendor);
+const char *pci_ids_device(uint16_t vendor, uint16_t device);
+#endif
+
+#endif
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+
+import sys
+import re
+
+# pci.ids doesn't say which class devices are, so the display subset is
+# every device of the vendors with DRM drivers for their display controllers
+# or GPUs. Names of other devices still come from libpci, if it's available.
+display_vendors = {
+	0x0014, # Loongson
+	0x1002, # AMD/ATI
+	0x1010, # Imagination
+	0x1013, # Cirrus Logic
+	0x1039, # SiS
+	0x102b, # Matrox
+	0x1106, # VIA
+	0x10de, # NVIDIA
+	0x1234, # Bochs/QEMU
+	0x126f, # Silicon Motion
+	0x1414, # Microsoft
+	0x15ad, # VMware
+	0x18ca, # XGI
+	0x19e5, # Huawei
+	0x1a03, # ASPEED
+	0x1af4, # Red Hat (virtio)
+	0x1b36, # Red Hat (QEMU)
+	0x1d17, # Zhaoxin
+	0x1ed5, # Moore Threads
+	0x5333, # S3
+	0x8086, # Intel
+}
+
+vendor_re = re.compile(r'^([0-9a-f]{4})  (.*)$')
+device_re = re.compile(r'^\t([0-9a-f]{4})  (.*)$')
+
+def c_str(s):
+	# '?' is escaped so that "??" never makes a trigraph
+	return '"{}"'.format(s.replace('\\', '\\\\').replace('"', '\\"')
+		.replace('?', '\\?'))
+
+def id_table(f, name, ids, digits):
+	f.write('static const struct pci_id {}[] = {{\n'.format(name))
+	for id, s in sorted(ids.items()):
+		f.write('\t{{ 0x{:0{}x}, {} }},\n'.format(id, digits, c_str(s)))
+	# C doesn't allow empty arrays, a NULL name is the same as no entry
+	if not ids:
+		f.write('\t{ 0, NULL },\n')
+	f.write('};\n\n')
+
+vendors = {}
+devices = {}
+vendor = None
+with open(sys.argv[1], 'r', encoding='utf-8', errors='replace') as f:
+	for line in f:
+		line = line.rstrip('\n')
+		if not line or line.startswith('#'):
+			continue
+		# Device classes follow the vendors, and aren't needed
+		if line.startswith('C '):
+			break
+		m = vendor_re.match(line)
+		if m:
+			vendor = int(m.group(1), 16)
+			if vendor in display_vendors:
+				vendors[vendor] = m.group(2)
+			continue
+		m = device_re.match(line)
+		if m and vendor in display_vendors:
+			devices[vendor << 16 | int(m.group(1), 16)] = m.group(2)
+
+with open(sys.argv[2], 'w') as f:
+	f.write('''\
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "pci_names.h"
+
+struct pci_id {
+	uint32_t id;
+	const char *name;
+};
+
+''')
+
+	f.write('/* Sorted by ID, vendor IDs are in the top half of device IDs */\n')
+	id_table(f, 'vendors', vendors, 4)
+	id_table(f, 'devices', devices, 8)
+
+	f.write('''\
+static int id_cmp(const void *key, const void *elem)
+{
+	uint32_t id = *(const uint32_t *)key;
+	const struct pci_id *pci_id = elem;
+	return (id > pci_id->id) - (id < pci_id->id);
+}
+
+static const char *find(const struct pci_id *ids, size_t len, uint32_t id)
+{
+	const struct pci_id *pci_id = bsearch(&id, ids, len, sizeof(*ids), id_cmp);
+	return pci_id ? pci_id->name : NULL;
+}
+
+const char *pci_ids_vendor(uint16_t vendor)
+{
+	return find(vendors, sizeof(vendors) / sizeof(vendors[0]), vendor);
+}
+
+const char *pci_ids_device(uint16_t vendor, uint16_t device)
+{
+	return find(devices, sizeof(devices) / sizeof(devices[0]),
+		(uint32_t)vendor << 16 | device);
+}
+''')
@@ -0,0 +1,69 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+struct pool {
+	pthread_mutex_t lock;
+	size_t next, n;
+	pool_func func;
+	void *data;
+};
+
+static void *pool_worker(void *data)
+{
+	struct pool *pool = data;
+
+	while (1) {
+		pthread_mutex_lock(&pool->lock);
+		size_t i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (i >= pool->n)
+			break;
+
+		pool->func(i, pool->data);
+	}
+
+	return NULL;
+}
+
+void pool_run(size_t n, int jobs, pool_func func, void *data)
+{
+	struct pool pool = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.n = n,
+		.func = func,
+		.data = data,
+	};
+
+	size_t n_threads = n;
+	if (jobs > 0 && (size_t)jobs < n_threads)
+		n_threads = jobs;
+
+	// The calling thread is a worker too, so only spawn the extra ones. If
+	// we can't get a thread, whoever we did get picks up the slack.
+	pthread_t *threads = NULL;
+	size_t n_spawned = 0;
+	if (n_threads > 1)
+		threads = calloc(n_threads - 1, sizeof(*threads));
+	for (size_t i = 0; threads && i < n_threads - 1; ++i) {
+		if (pthread_create(&threads[i], NULL, pool_worker, &pool) != 0)
+			break;
+		++n_spawned;
+	}
+
+	pool_worker(&pool);
+
+	for (size_t i = 0; i < n_spawned; ++i)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	pthread_mutex_destroy(&pool.lock);
+}
+
+int pool_cpu_count(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? n : 1;
+}
@@ -0,0 +1,15 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+typedef void (*pool_func)(size_t i, void *data);
+
+/* Calls func(i, data) for each i in [0, n), with up to jobs calls running
+ * concurrently. jobs <= 0 means one thread per item. Returns once every call
+ * has completed. */
+void pool_run(size_t n, int jobs, pool_func func, void *data);
+/* Number of online CPUs, at least 1 */
+int pool_cpu_count(void);
+
+#endif
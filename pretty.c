@@ -1,77 +1,47 @@
+#include <inttypes.h>
 #include <stdbool.h>
-#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
 
-#include <json.h>
 #include <drm_fourcc.h>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
-#ifdef HAVE_LIBPCI
-#include <pci/pci.h>
-#endif
-
 #include "drm_info.h"
+#include "model.h"
 #include "modifiers.h"
+#include "pci_names.h"
 #include "tables.h"
+#include "tree_writer.h"
 
-#define L_LINE "│   "
-#define L_VAL  "├───"
-#define L_LAST "└───"
-#define L_GAP  "    "
-
-static const char *get_object_object_string(struct json_object *obj,
-		const char *key)
+static void print_driver(struct tree_writer *w,
+		const struct model_driver *driver)
 {
-	struct json_object *str_obj = json_object_object_get(obj, key);
-	if (!str_obj) {
-		return NULL;
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "Driver: %s (%s) version %d.%d.%d (%s)\n",
+		driver->name, driver->desc, driver->version.major,
+		driver->version.minor, driver->version.patch, driver->version.date);
+
+	tree_writer_push(w, false);
+	for (size_t i = 0; i < driver->n_client_caps; ++i) {
+		const struct model_cap *cap = &driver->client_caps[i];
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "DRM_CLIENT_CAP_%s %s\n", cap->name,
+			cap->supported ? "supported" : "not supported");
 	}
-	return json_object_get_string(str_obj);
-}
 
-static uint64_t get_object_object_uint64(struct json_object *obj,
-		const char *key)
-{
-	struct json_object *uint64_obj = json_object_object_get(obj, key);
-	if (!uint64_obj) {
-		return 0;
-	}
-	return json_object_get_uint64(uint64_obj);
-}
-
-static void print_driver(struct json_object *obj)
-{
-	const char *name = get_object_object_string(obj, "name");
-	const char *desc = get_object_object_string(obj, "desc");
-	struct json_object *version_obj = json_object_object_get(obj, "version");
-	int version_major = get_object_object_uint64(version_obj, "major");
-	int version_minor = get_object_object_uint64(version_obj, "minor");
-	int version_patch = get_object_object_uint64(version_obj, "patch");
-	const char *version_date = get_object_object_string(version_obj, "date");
-
-	printf(L_VAL "Driver: %s (%s) version %d.%d.%d (%s)\n", name, desc,
-		version_major, version_minor, version_patch, version_date);
-
-	struct json_object_iter iter;
-	struct json_object *client_caps_obj =
-		json_object_object_get(obj, "client_caps");
-	json_object_object_foreachC(client_caps_obj, iter) {
-		json_bool supported = json_object_get_boolean(iter.val);
-		printf(L_LINE L_VAL "DRM_CLIENT_CAP_%s %s\n", iter.key,
-			supported ? "supported" : "not supported");
-	}
-
-	struct json_object *caps_obj = json_object_object_get(obj, "caps");
-	json_object_object_foreachC(caps_obj, iter) {
-		printf(!iter.entry->next ? L_LINE L_LAST : L_LINE L_VAL);
-		if (iter.val == NULL) {
-			printf("DRM_CAP_%s not supported\n", iter.key);
+	for (size_t i = 0; i < driver->n_caps; ++i) {
+		const struct model_cap *cap = &driver->caps[i];
+		tree_writer_item(w, i == driver->n_caps - 1);
+		if (!cap->supported) {
+			tree_writer_printf(w, "DRM_CAP_%s not supported\n", cap->name);
 		} else {
-			printf("DRM_CAP_%s = %"PRIu64"\n", iter.key,
-				json_object_get_uint64(iter.val));
+			tree_writer_printf(w, "DRM_CAP_%s = %"PRIu64"\n", cap->name,
+				cap->value);
 		}
 	}
+	tree_writer_pop(w);
 }
 
 static const char *bustype_str(int type)
@@ -99,73 +69,64 @@ static const char *node_type_str(int type)
 	}
 }
 
-static void print_available_nodes(int available_nodes)
+static void print_available_nodes(struct tree_writer *w, int available_nodes)
 {
 	bool first = true;
 	for (int i = 0; i < DRM_NODE_MAX; i++) {
 		if (!(available_nodes & (1 << i)))
 			continue;
-		printf("%s%s", first ? "" : ", ", node_type_str(i));
+		if (!first)
+			tree_writer_puts(w, ", ");
+		tree_writer_puts(w, node_type_str(i));
 		first = false;
 	}
 }
 
-static void print_device(struct json_object *obj)
+static void print_device(struct tree_writer *w, const struct model_device *dev)
 {
-	if (!obj)
+	if (!dev)
 		return;
 
-	int available_nodes = get_object_object_uint64(obj, "available_nodes");
-	int bus_type = get_object_object_uint64(obj, "bus_type");
-	struct json_object *data_obj = json_object_object_get(obj, "device_data");
-
-	printf(L_VAL "Device: %s", bustype_str(bus_type));
-	switch (bus_type) {
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "Device: %s", bustype_str(dev->bus_type));
+	switch (dev->bus_type) {
 	case DRM_BUS_PCI:;
-		uint16_t pci_vendor = get_object_object_uint64(data_obj, "vendor");
-		uint16_t pci_device = get_object_object_uint64(data_obj, "device");
-		printf(" %04x:%04x", pci_vendor, pci_device);
-#ifdef HAVE_LIBPCI
-		struct pci_access *pci = pci_alloc();
-		pci_init(pci);
-		char name[512];
-		if (pci_lookup_name(pci, name, sizeof(name),
-				PCI_LOOKUP_VENDOR | PCI_LOOKUP_DEVICE,
-				pci_vendor, pci_device)) {
-			printf(" %s", name);
+		uint16_t pci_vendor = dev->data.pci.vendor;
+		uint16_t pci_device = dev->data.pci.device;
+		tree_writer_printf(w, " %04x:%04x", pci_vendor, pci_device);
+		const char *name = pci_name_get(pci_vendor, pci_device);
+		if (name) {
+			tree_writer_printf(w, " %s", name);
 		}
-		pci_cleanup(pci);
-#endif
 		break;
-	case DRM_BUS_USB:;
-		uint16_t usb_vendor = get_object_object_uint64(data_obj, "vendor");
-		uint16_t usb_product = get_object_object_uint64(data_obj, "product");
-		printf(" %04x:%04x", usb_vendor, usb_product);
+	case DRM_BUS_USB:
+		tree_writer_printf(w, " %04x:%04x", dev->data.usb.vendor,
+			dev->data.usb.product);
 		break;
-	case DRM_BUS_PLATFORM:;
-		struct json_object *compatible_arr =
-			json_object_object_get(data_obj, "compatible");
-		for (size_t i = 0; i < json_object_array_length(compatible_arr); i++) {
-			printf(" %s", json_object_get_string(
-				json_object_array_get_idx(compatible_arr, i)));
+	case DRM_BUS_PLATFORM:
+		for (size_t i = 0; i < dev->data.platform.n_compatible; i++) {
+			tree_writer_printf(w, " %s", dev->data.platform.compatible[i]);
 		}
 		break;
 	}
-	printf("\n");
-
-	printf(L_LINE L_LAST "Available nodes: ");
-	print_available_nodes(available_nodes);
-	printf("\n");
+	tree_writer_putc(w, '\n');
+
+	tree_writer_push(w, false);
+	tree_writer_item(w, true);
+	tree_writer_puts(w, "Available nodes: ");
+	print_available_nodes(w, dev->available_nodes);
+	tree_writer_putc(w, '\n');
+	tree_writer_pop(w);
 }
 
 // The refresh rate provided by the mode itself is innacurate,
 // so we calculate it ourself.
-static int32_t refresh_rate(struct json_object *obj) {
-	int clock = get_object_object_uint64(obj, "clock");
-	int htotal = get_object_object_uint64(obj, "htotal");
-	int vtotal = get_object_object_uint64(obj, "vtotal");
-	int vscan = get_object_object_uint64(obj, "vscan");
-	int flags = get_object_object_uint64(obj, "flags");
+static int32_t refresh_rate(const drmModeModeInfo *mode) {
+	int clock = mode->clock;
+	int htotal = mode->htotal;
+	int vtotal = mode->vtotal;
+	int vscan = mode->vscan;
+	int flags = mode->flags;
 
 	int32_t refresh = (clock * 1000000LL / htotal +
 		vtotal / 2) / vtotal;
@@ -182,62 +143,62 @@ static int32_t refresh_rate(struct json_object *obj) {
 	return refresh;
 }
 
-static void print_mode(struct json_object *obj)
+static void print_mode(struct tree_writer *w, const drmModeModeInfo *mode)
 {
-	int hdisplay = get_object_object_uint64(obj, "hdisplay");
-	int vdisplay = get_object_object_uint64(obj, "vdisplay");
-	int type = get_object_object_uint64(obj, "type");
-	int flags = get_object_object_uint64(obj, "flags");
+	int hdisplay = mode->hdisplay;
+	int vdisplay = mode->vdisplay;
+	int type = mode->type;
+	int flags = mode->flags;
 
-	printf("%"PRIu16"x%"PRIu16"@%.02f ", hdisplay, vdisplay,
-		refresh_rate(obj) / 1000.0);
+	tree_writer_printf(w, "%"PRIu16"x%"PRIu16"@%.02f ", hdisplay, vdisplay,
+		refresh_rate(mode) / 1000.0);
 
 	if (type & DRM_MODE_TYPE_PREFERRED)
-		printf("preferred ");
+		tree_writer_puts(w, "preferred ");
 	if (type & DRM_MODE_TYPE_USERDEF)
-		printf("userdef ");
+		tree_writer_puts(w, "userdef ");
 	if (type & DRM_MODE_TYPE_DRIVER)
-		printf("driver ");
+		tree_writer_puts(w, "driver ");
 
 	if (flags & DRM_MODE_FLAG_PHSYNC)
-		printf("phsync ");
+		tree_writer_puts(w, "phsync ");
 	if (flags & DRM_MODE_FLAG_NHSYNC)
-		printf("nhsync ");
+		tree_writer_puts(w, "nhsync ");
 	if (flags & DRM_MODE_FLAG_PVSYNC)
-		printf("pvsync ");
+		tree_writer_puts(w, "pvsync ");
 	if (flags & DRM_MODE_FLAG_NVSYNC)
-		printf("nvsync ");
+		tree_writer_puts(w, "nvsync ");
 	if (flags & DRM_MODE_FLAG_INTERLACE)
-		printf("interlace ");
+		tree_writer_puts(w, "interlace ");
 	if (flags & DRM_MODE_FLAG_DBLSCAN)
-		printf("dblscan ");
+		tree_writer_puts(w, "dblscan ");
 	if (flags & DRM_MODE_FLAG_CSYNC)
-		printf("csync ");
+		tree_writer_puts(w, "csync ");
 	if (flags & DRM_MODE_FLAG_PCSYNC)
-		printf("pcsync ");
+		tree_writer_puts(w, "pcsync ");
 	if (flags & DRM_MODE_FLAG_NCSYNC)
-		printf("nvsync ");
+		tree_writer_puts(w, "nvsync ");
 	if (flags & DRM_MODE_FLAG_HSKEW)
-		printf("hskew ");
+		tree_writer_puts(w, "hskew ");
 	if (flags & DRM_MODE_FLAG_DBLCLK)
-		printf("dblclk ");
+		tree_writer_puts(w, "dblclk ");
 	if (flags & DRM_MODE_FLAG_CLKDIV2)
-		printf("clkdiv2 ");
+		tree_writer_puts(w, "clkdiv2 ");
 
 	switch (flags & DRM_MODE_FLAG_PIC_AR_MASK) {
 	case DRM_MODE_FLAG_PIC_AR_NONE:
 		break;
 	case DRM_MODE_FLAG_PIC_AR_4_3:
-		printf("4:3 ");
+		tree_writer_puts(w, "4:3 ");
 		break;
 	case DRM_MODE_FLAG_PIC_AR_16_9:
-		printf("16:9 ");
+		tree_writer_puts(w, "16:9 ");
 		break;
 	case DRM_MODE_FLAG_PIC_AR_64_27:
-		printf("64:27 ");
+		tree_writer_puts(w, "64:27 ");
 		break;
 	case DRM_MODE_FLAG_PIC_AR_256_135:
-		printf("256:135 ");
+		tree_writer_puts(w, "256:135 ");
 		break;
 	}
 
@@ -245,28 +206,28 @@ static void print_mode(struct json_object *obj)
 	case DRM_MODE_FLAG_3D_NONE:
 		break;
 	case DRM_MODE_FLAG_3D_FRAME_PACKING:
-		printf("3d-frame-packing ");
+		tree_writer_puts(w, "3d-frame-packing ");
 		break;
 	case DRM_MODE_FLAG_3D_FIELD_ALTERNATIVE:
-		printf("3d-field-alternative ");
+		tree_writer_puts(w, "3d-field-alternative ");
 		break;
 	case DRM_MODE_FLAG_3D_LINE_ALTERNATIVE:
-		printf("3d-line-alternative ");
+		tree_writer_puts(w, "3d-line-alternative ");
 		break;
 	case DRM_MODE_FLAG_3D_SIDE_BY_SIDE_FULL:
-		printf("3d-side-by-side-full ");
+		tree_writer_puts(w, "3d-side-by-side-full ");
 		break;
 	case DRM_MODE_FLAG_3D_L_DEPTH:
-		printf("3d-l-depth ");
+		tree_writer_puts(w, "3d-l-depth ");
 		break;
 	case DRM_MODE_FLAG_3D_L_DEPTH_GFX_GFX_DEPTH:
-		printf("3d-l-depth-gfx-gfx-depth ");
+		tree_writer_puts(w, "3d-l-depth-gfx-gfx-depth ");
 		break;
 	case DRM_MODE_FLAG_3D_TOP_AND_BOTTOM:
-		printf("3d-top-and-bottom ");
+		tree_writer_puts(w, "3d-top-and-bottom ");
 		break;
 	case DRM_MODE_FLAG_3D_SIDE_BY_SIDE_HALF:
-		printf("3d-side-by-side-half ");
+		tree_writer_puts(w, "3d-side-by-side-half ");
 		break;
 	}
 }
@@ -322,288 +283,580 @@ static const char *obj_str(uint32_t type)
 	}
 }
 
-static void print_in_formats(struct json_object *arr, const char *prefix)
+static void print_format(struct tree_writer *w, uint32_t fmt)
+{
+	tree_writer_puts(w, format_str(fmt));
+	tree_writer_puts(w, " (0x");
+	tree_writer_hex(w, fmt, 8);
+	tree_writer_puts(w, ")\n");
+}
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325
+
+/* 64-bit FNV-1a, continued from hash */
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= p[i];
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+static bool formats_equal(const struct model_in_format *a,
+		const struct model_in_format *b)
+{
+	return a->n_formats == b->n_formats && memcmp(a->formats, b->formats,
+		a->n_formats * sizeof(uint32_t)) == 0;
+}
+
+static uint64_t in_formats_hash(const struct model_blob *blob)
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < blob->in_formats.n_mods; ++i) {
+		const struct model_in_format *mod = &blob->in_formats.mods[i];
+		hash = hash_bytes(hash, &mod->modifier, sizeof(mod->modifier));
+		hash = hash_bytes(hash, &mod->n_formats, sizeof(mod->n_formats));
+		hash = hash_bytes(hash, mod->formats,
+			mod->n_formats * sizeof(uint32_t));
+	}
+	return hash;
+}
+
+static bool in_formats_equal(const struct model_blob *a,
+		const struct model_blob *b)
+{
+	if (a->in_formats.n_mods != b->in_formats.n_mods) {
+		return false;
+	}
+	for (size_t i = 0; i < a->in_formats.n_mods; ++i) {
+		const struct model_in_format *mod_a = &a->in_formats.mods[i];
+		const struct model_in_format *mod_b = &b->in_formats.mods[i];
+		if (mod_a->modifier != mod_b->modifier ||
+				!formats_equal(mod_a, mod_b)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static size_t table_cap(size_t n)
+{
+	size_t cap = 16;
+	while (cap < 2 * n) {
+		cap *= 2;
+	}
+	return cap;
+}
+
+static void print_in_format_mods(struct tree_writer *w,
+		const struct model_blob *blob)
+{
+	size_t n_mods = blob->in_formats.n_mods;
+	for (size_t i = 0; i < n_mods; ++i) {
+		bool last = i == n_mods - 1;
+		const struct model_in_format *mod = &blob->in_formats.mods[i];
+
+		tree_writer_item(w, last);
+		print_modifier(w, mod->modifier);
+		tree_writer_putc(w, '\n');
+
+		tree_writer_push(w, last);
+		for (size_t j = 0; j < mod->n_formats; ++j) {
+			tree_writer_item(w, j == mod->n_formats - 1);
+			print_format(w, mod->formats[j]);
+		}
+		tree_writer_pop(w);
+	}
+}
+
+/* Prints the modifiers supporting the same formats on a single line, followed
+ * by the formats. Groups are found by hashing the format lists, and are in the
+ * order of their first modifier. */
+static void print_in_format_groups(struct tree_writer *w,
+		const struct model_blob *blob)
 {
-	for (size_t i = 0; i < json_object_array_length(arr); ++i) {
-		bool last = i == json_object_array_length(arr) - 1;
-		struct json_object *mod_obj = json_object_array_get_idx(arr, i);
-		uint64_t mod = get_object_object_uint64(mod_obj, "modifier");
-		struct json_object *formats_arr =
-			json_object_object_get(mod_obj, "formats");
+	const struct model_in_format *mods = blob->in_formats.mods;
+	size_t n_mods = blob->in_formats.n_mods;
+	size_t cap = table_cap(n_mods);
+
+	// slots hold the first modifier of a group + 1, heads the first modifier
+	// of each group, next links the modifiers of a group and tail is the
+	// last modifier of the group started by a modifier
+	size_t *slots = calloc(cap + 3 * n_mods, sizeof(*slots));
+	if (!slots) {
+		print_in_format_mods(w, blob);
+		return;
+	}
+	size_t *heads = slots + cap;
+	size_t *next = heads + n_mods;
+	size_t *tail = next + n_mods;
+
+	size_t n_groups = 0;
+	for (size_t i = 0; i < n_mods; ++i) {
+		uint64_t hash = hash_bytes(FNV_OFFSET_BASIS, mods[i].formats,
+			mods[i].n_formats * sizeof(uint32_t));
+		size_t j = hash & (cap - 1);
+		while (slots[j] && !formats_equal(&mods[slots[j] - 1], &mods[i])) {
+			j = (j + 1) & (cap - 1);
+		}
 
-		printf("%s%s", prefix, last ? L_LAST : L_VAL);
-		print_modifier(mod);
-		printf("\n");
-		for (size_t j = 0; j < json_object_array_length(formats_arr); ++j) {
-			bool fmt_last = j == json_object_array_length(formats_arr) - 1;
-			uint32_t fmt = json_object_get_uint64(
-				json_object_array_get_idx(formats_arr, j));
-			printf("%s%s%s%s (0x%08"PRIx32")\n", prefix, last ? L_GAP : L_LINE,
-				fmt_last ? L_LAST : L_VAL, format_str(fmt), fmt);
+		next[i] = SIZE_MAX;
+		if (slots[j]) {
+			size_t head = slots[j] - 1;
+			next[tail[head]] = i;
+			tail[head] = i;
+		} else {
+			slots[j] = i + 1;
+			heads[n_groups++] = i;
+			tail[i] = i;
 		}
 	}
+
+	for (size_t i = 0; i < n_groups; ++i) {
+		bool last = i == n_groups - 1;
+		const struct model_in_format *head = &mods[heads[i]];
+
+		tree_writer_item(w, last);
+		for (size_t j = heads[i]; j != SIZE_MAX; j = next[j]) {
+			if (j != heads[i]) {
+				tree_writer_puts(w, ", ");
+			}
+			print_modifier(w, mods[j].modifier);
+		}
+		tree_writer_putc(w, '\n');
+
+		tree_writer_push(w, last);
+		for (size_t j = 0; j < head->n_formats; ++j) {
+			tree_writer_item(w, j == head->n_formats - 1);
+			print_format(w, head->formats[j]);
+		}
+		tree_writer_pop(w);
+	}
+
+	free(slots);
+}
+
+/* How to print the IN_FORMATS blob of an object */
+struct in_formats_style {
+	bool group;
+	// Index of an earlier plane with the same IN_FORMATS, or -1
+	ssize_t same_as;
+};
+
+static void print_in_formats(struct tree_writer *w,
+		const struct model_blob *blob, const struct in_formats_style *style)
+{
+	if (style->same_as >= 0) {
+		tree_writer_item(w, true);
+		tree_writer_printf(w, "Same as plane %zd\n", style->same_as);
+	} else if (style->group) {
+		print_in_format_groups(w, blob);
+	} else {
+		print_in_format_mods(w, blob);
+	}
 }
 
-static void print_mode_id(struct json_object *obj, const char *prefix)
+static void print_mode_id(struct tree_writer *w, const struct model_blob *blob)
 {
-	printf("%s" L_LAST, prefix);
-	print_mode(obj);
-	printf("\n");
+	tree_writer_item(w, true);
+	print_mode(w, &blob->mode);
+	tree_writer_putc(w, '\n');
 }
 
-static void print_writeback_pixel_formats(struct json_object *arr,
-		const char *prefix)
+static void print_writeback_pixel_formats(struct tree_writer *w,
+		const struct model_blob *blob)
 {
-	for (size_t i = 0; i < json_object_array_length(arr); ++i) {
-		bool last = i == json_object_array_length(arr) - 1;
-		uint32_t fmt = json_object_get_uint64(json_object_array_get_idx(arr, i));
-		printf("%s%s%s (0x%08"PRIx32")\n", prefix, last ? L_LAST : L_VAL,
-			format_str(fmt), fmt);
+	size_t n_formats = blob->formats.n_formats;
+	for (size_t i = 0; i < n_formats; ++i) {
+		tree_writer_item(w, i == n_formats - 1);
+		print_format(w, blob->formats.formats[i]);
 	}
 }
 
-static void print_path(struct json_object *obj, const char *prefix)
+static void print_path(struct tree_writer *w, const struct model_blob *blob)
 {
-	printf("%s" L_LAST "%s\n", prefix, json_object_get_string(obj));
+	tree_writer_item(w, true);
+	tree_writer_write(w, blob->path.str, strnlen(blob->path.str,
+		blob->path.len));
+	tree_writer_putc(w, '\n');
 }
 
-static void print_fb(struct json_object *obj, const char *prefix)
+static void print_edid(struct tree_writer *w, const struct model_blob *blob)
 {
-	uint32_t id = get_object_object_uint64(obj, "id");
-	uint32_t width = get_object_object_uint64(obj, "width");
-	uint32_t height = get_object_object_uint64(obj, "height");
+	const struct model_edid *edid = &blob->edid;
+	if (edid->name[0] != '\0') {
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "Monitor: %s\n", edid->name);
+	}
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "Vendor: %s\n", edid->vendor);
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "Product: 0x%04"PRIx16"\n", edid->product);
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "Serial: %"PRIu32"\n", edid->serial);
+	tree_writer_item(w, false);
+	if (edid->week == 0xFF) {
+		tree_writer_printf(w, "Model year: %"PRIu16"\n", edid->year);
+	} else if (edid->week == 0) {
+		tree_writer_printf(w, "Manufactured: %"PRIu16"\n", edid->year);
+	} else {
+		tree_writer_printf(w, "Manufactured: week %"PRIu8" of %"PRIu16"\n",
+			edid->week, edid->year);
+	}
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "Version: %"PRIu8".%"PRIu8"\n", edid->version,
+		edid->revision);
+	tree_writer_item(w, true);
+	tree_writer_printf(w, "Extensions: %"PRIu8"\n", edid->n_extensions);
+}
+
+static void print_lut(struct tree_writer *w, const struct model_blob *blob)
+{
+	static const char *const channels[] = { "Red", "Green", "Blue" };
+
+	const struct model_lut *lut = &blob->lut;
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "Size: %"PRIu32"\n", lut->size);
+	for (size_t i = 0; i < 3; ++i) {
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "%s: [0x%04"PRIx16", 0x%04"PRIx16"]\n",
+			channels[i], lut->min[i], lut->max[i]);
+	}
+	tree_writer_item(w, true);
+	if (lut->linear) {
+		tree_writer_puts(w, "Shape: linear\n");
+	} else if (lut->monotonic) {
+		tree_writer_puts(w, "Shape: monotonic\n");
+	} else {
+		tree_writer_puts(w, "Shape: not monotonic\n");
+	}
+}
 
-	struct json_object *pitch_obj = json_object_object_get(obj, "pitch");
-	struct json_object *bpp_obj = json_object_object_get(obj, "bpp");
-	struct json_object *depth_obj = json_object_object_get(obj, "depth");
-	struct json_object *format_obj = json_object_object_get(obj, "format");
-	struct json_object *modifier_obj = json_object_object_get(obj, "modifier");
-	struct json_object *planes_arr = json_object_object_get(obj, "planes");
-	bool has_legacy = pitch_obj && bpp_obj && depth_obj;
+static double ctm_coeff(int64_t val)
+{
+	return (double)val / 4294967296.0;
+}
 
-	printf("%s" L_VAL "Object ID: %"PRIu32"\n", prefix, id);
-	printf("%s%sSize: %"PRIu32"x%"PRIu32"\n", prefix,
-		(has_legacy || format_obj) ? L_VAL : L_LAST,
-		width, height);
+static void print_ctm(struct tree_writer *w, const struct model_blob *blob)
+{
+	const int64_t *matrix = blob->ctm;
+	for (size_t i = 0; i < 3; ++i) {
+		tree_writer_item(w, i == 2);
+		tree_writer_printf(w, "[%9.4f %9.4f %9.4f ]\n",
+			ctm_coeff(matrix[3 * i]), ctm_coeff(matrix[3 * i + 1]),
+			ctm_coeff(matrix[3 * i + 2]));
+	}
+}
 
-	if (has_legacy) {
-		printf("%s" L_VAL "Pitch: %"PRIu32" bytes\n", prefix,
-			(uint32_t)json_object_get_uint64(pitch_obj));
-		printf("%s" L_VAL "Bits per pixel: %"PRIu32"\n", prefix,
-			(uint32_t)json_object_get_uint64(bpp_obj));
-		printf("%s%sDepth: %"PRIu32"\n", prefix, format_obj ? L_VAL : L_LAST,
-			(uint32_t)json_object_get_uint64(depth_obj));
+static const char *eotf_str(uint8_t eotf)
+{
+	switch (eotf) {
+	case 0:  return "traditional gamma, SDR";
+	case 1:  return "traditional gamma, HDR";
+	case 2:  return "SMPTE ST 2084 (PQ)";
+	case 3:  return "HLG";
+	default: return "unknown";
 	}
-	if (format_obj) {
-		bool last = !modifier_obj && !planes_arr;
-		uint32_t fmt = (uint32_t)json_object_get_uint64(format_obj);
-		printf("%s%sFormat: %s (0x%08"PRIx32")\n", prefix,
-			last ? L_LAST : L_VAL, format_str(fmt), fmt);
+}
+
+static void print_hdr_metadata(struct tree_writer *w,
+		const struct model_blob *blob)
+{
+	static const char *const primaries[] = { "Red", "Green", "Blue" };
+
+	const struct hdr_output_metadata *hdr = &blob->hdr_metadata;
+	const struct hdr_metadata_infoframe *info = &hdr->hdmi_metadata_type1;
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "Type: %"PRIu32"\n", hdr->metadata_type);
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "EOTF: %s (%"PRIu8")\n", eotf_str(info->eotf),
+		info->eotf);
+	// Chromaticity coordinates are in units of 0.00002
+	for (size_t i = 0; i < 3; ++i) {
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "%s primary: (%.4f, %.4f)\n", primaries[i],
+			info->display_primaries[i].x * 0.00002,
+			info->display_primaries[i].y * 0.00002);
 	}
-	if (modifier_obj) {
-		uint64_t mod = json_object_get_uint64(modifier_obj);
-		printf("%s%sModifier: ", prefix, planes_arr ? L_VAL : L_LAST);
-		print_modifier(mod);
-		printf("\n");
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "White point: (%.4f, %.4f)\n",
+		info->white_point.x * 0.00002, info->white_point.y * 0.00002);
+	// The minimum is in units of 0.0001 cd/m², the others in cd/m²
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "Mastering luminance: %.4f to %"PRIu16" cd/m²\n",
+		info->min_display_mastering_luminance * 0.0001,
+		info->max_display_mastering_luminance);
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "Max CLL: %"PRIu16" cd/m²\n", info->max_cll);
+	tree_writer_item(w, true);
+	tree_writer_printf(w, "Max FALL: %"PRIu16" cd/m²\n", info->max_fall);
+}
+
+static void print_rects(struct tree_writer *w, const struct model_blob *blob)
+{
+	size_t n_rects = blob->rects.n_rects;
+	for (size_t i = 0; i < n_rects; ++i) {
+		const struct drm_mode_rect *rect = &blob->rects.rects[i];
+		tree_writer_item(w, i == n_rects - 1);
+		tree_writer_printf(w, "%"PRIi32"x%"PRIi32"%+"PRIi32"%+"PRIi32"\n",
+			rect->x2 - rect->x1, rect->y2 - rect->y1, rect->x1, rect->y1);
 	}
-	if (planes_arr) {
-		printf("%s" L_LAST "Planes:\n", prefix);
-		for (size_t i = 0; i < json_object_array_length(planes_arr); ++i) {
-			bool last = i == json_object_array_length(planes_arr) - 1;
-			struct json_object *plane_obj =
-				json_object_array_get_idx(planes_arr, i);
-			uint64_t offset = get_object_object_uint64(plane_obj, "offset");
-			uint64_t pitch = get_object_object_uint64(plane_obj, "pitch");
-			printf("%s" L_GAP "%sPlane %zu: "
-				"offset = %"PRIu64", pitch = %"PRIu64" bytes\n",
-				prefix, last ? L_LAST : L_VAL, i, offset, pitch);
+}
+
+static void print_fb(struct tree_writer *w, const struct model_fb *fb)
+{
+	tree_writer_item(w, false);
+	tree_writer_printf(w, "Object ID: %"PRIu32"\n", fb->id);
+	tree_writer_item(w, !fb->legacy && !fb->has_format);
+	tree_writer_printf(w, "Size: %"PRIu32"x%"PRIu32"\n", fb->width,
+		fb->height);
+
+	if (fb->legacy) {
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "Pitch: %"PRIu32" bytes\n", fb->pitch);
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "Bits per pixel: %"PRIu32"\n", fb->bpp);
+		tree_writer_item(w, !fb->has_format);
+		tree_writer_printf(w, "Depth: %"PRIu32"\n", fb->depth);
+	}
+	if (fb->has_format) {
+		// FBs with a format always have a planes array
+		tree_writer_item(w, false);
+		tree_writer_puts(w, "Format: ");
+		print_format(w, fb->format);
+	}
+	if (fb->has_modifier) {
+		tree_writer_item(w, false);
+		tree_writer_puts(w, "Modifier: ");
+		print_modifier(w, fb->modifier);
+		tree_writer_putc(w, '\n');
+	}
+	if (fb->has_format) {
+		tree_writer_item(w, true);
+		tree_writer_puts(w, "Planes:\n");
+		tree_writer_push(w, true);
+		for (size_t i = 0; i < fb->n_planes; ++i) {
+			tree_writer_item(w, i == fb->n_planes - 1);
+			tree_writer_printf(w, "Plane %zu: "
+				"offset = %"PRIu32", pitch = %"PRIu32" bytes\n",
+				i, fb->planes[i].offset, fb->planes[i].pitch);
 		}
+		tree_writer_pop(w);
 	}
 }
 
-static void print_properties(struct json_object *obj, const char *prefix)
-{
-	printf("%s" L_LAST "Properties\n", prefix);
-
-	struct json_object_iter iter;
-	json_object_object_foreachC(obj, iter) {
-		bool last = !iter.entry->next;
-		const char *prop_name = iter.key;
-		struct json_object *prop_obj = iter.val;
-
-		char sub_prefix[strlen(prefix) + 2 * strlen(L_VAL) + 1];
-		snprintf(sub_prefix, sizeof(sub_prefix), "%s" L_GAP "%s",
-			prefix, last ? L_GAP : L_LINE);
-
-		uint32_t flags = get_object_object_uint64(prop_obj, "flags");
-		uint32_t type = flags & (DRM_MODE_PROP_LEGACY_TYPE |
-			DRM_MODE_PROP_EXTENDED_TYPE);
-		bool atomic = flags & DRM_MODE_PROP_ATOMIC;
-		bool immutable = flags & DRM_MODE_PROP_IMMUTABLE;
-
-		printf("%s" L_GAP "%s\"%s\"", prefix, last ? L_LAST : L_VAL, prop_name);
-		if (atomic && immutable)
-			printf(" (atomic, immutable)");
-		else if (atomic)
-			printf(" (atomic)");
-		else if (immutable)
-			printf(" (immutable)");
-
-		printf(": ");
-
-		uint64_t raw_val = get_object_object_uint64(prop_obj, "raw_value");
-		struct json_object *spec_obj = json_object_object_get(prop_obj, "spec");
-		struct json_object *val_obj = json_object_object_get(prop_obj, "value");
-		struct json_object *data_obj = json_object_object_get(prop_obj, "data");
-		bool first;
-		switch (type) {
-		case DRM_MODE_PROP_RANGE:;
-			uint64_t min = get_object_object_uint64(spec_obj, "min");
-			uint64_t max = get_object_object_uint64(spec_obj, "max");
-			const char *min_str = u64_str(min);
-			const char *max_str = u64_str(max);
-
-			if (min_str)
-				printf("range [%s, ", min_str);
-			else
-				printf("range [%"PRIu64", ", min);
-
-			if (max_str)
-				printf("%s]", max_str);
-			else
-				printf("%"PRIu64"]", max);
-
-			if (data_obj != NULL)
-				printf(" = %"PRIu64"\n", json_object_get_uint64(data_obj));
-			else
-				printf(" = %"PRIu64"\n", json_object_get_uint64(val_obj));
-			break;
-		case DRM_MODE_PROP_ENUM:
-			printf("enum {");
-			const char *val_name = NULL;
-			first = true;
-			for (size_t j = 0; j < json_object_array_length(spec_obj); ++j) {
-				struct json_object *item_obj =
-					json_object_array_get_idx(spec_obj, j);
-				const char *item_name =
-					get_object_object_string(item_obj, "name");
-				uint64_t item_value =
-					get_object_object_uint64(item_obj, "value");
-
-				if (raw_val == item_value) {
-					val_name = item_name;
-				}
-
-				printf("%s%s", first ? "" : ", ", item_name);
-				first = false;
+static void print_property(struct tree_writer *w,
+		const struct model_property *prop,
+		const struct in_formats_style *style)
+{
+	const struct model_prop_def *def = prop->def;
+	uint32_t flags = def->flags;
+	uint32_t type = flags & (DRM_MODE_PROP_LEGACY_TYPE |
+		DRM_MODE_PROP_EXTENDED_TYPE);
+	bool atomic = flags & DRM_MODE_PROP_ATOMIC;
+	bool immutable = flags & DRM_MODE_PROP_IMMUTABLE;
+
+	tree_writer_putc(w, '"');
+	tree_writer_puts(w, def->name);
+	tree_writer_putc(w, '"');
+	if (atomic && immutable)
+		tree_writer_puts(w, " (atomic, immutable)");
+	else if (atomic)
+		tree_writer_puts(w, " (atomic)");
+	else if (immutable)
+		tree_writer_puts(w, " (immutable)");
+
+	tree_writer_puts(w, ": ");
+
+	uint64_t raw_val = prop->raw_value;
+	bool first;
+	switch (type) {
+	case DRM_MODE_PROP_RANGE:;
+		uint64_t min = def->spec.range.min;
+		uint64_t max = def->spec.range.max;
+		const char *min_str = u64_str(min);
+		const char *max_str = u64_str(max);
+
+		tree_writer_puts(w, "range [");
+		if (min_str)
+			tree_writer_puts(w, min_str);
+		else
+			tree_writer_uint(w, min);
+		tree_writer_puts(w, ", ");
+
+		if (max_str)
+			tree_writer_puts(w, max_str);
+		else
+			tree_writer_uint(w, max);
+		tree_writer_puts(w, "] = ");
+
+		if (prop->data_type == MODEL_DATA_UINT)
+			tree_writer_uint(w, prop->data.uint);
+		else
+			tree_writer_uint(w, raw_val);
+		tree_writer_putc(w, '\n');
+		break;
+	case DRM_MODE_PROP_ENUM:
+		tree_writer_puts(w, "enum {");
+		const char *val_name = NULL;
+		first = true;
+		for (size_t j = 0; j < def->spec.enums.n_items; ++j) {
+			const struct model_enum *item = &def->spec.enums.items[j];
+
+			if (raw_val == item->value) {
+				val_name = item->name;
 			}
-			printf("} = ");
 
-			if (val_name) {
-				printf("%s\n", val_name);
-			} else {
-				printf("invalid (%"PRIu64")\n", raw_val);
-			}
+			if (!first)
+				tree_writer_puts(w, ", ");
+			tree_writer_puts(w, item->name);
+			first = false;
+		}
+		tree_writer_puts(w, "} = ");
+
+		if (val_name) {
+			tree_writer_puts(w, val_name);
+			tree_writer_putc(w, '\n');
+		} else {
+			tree_writer_printf(w, "invalid (%"PRIu64")\n", raw_val);
+		}
+		break;
+	case DRM_MODE_PROP_BLOB:;
+		tree_writer_puts(w, "blob = ");
+		tree_writer_uint(w, raw_val);
+		tree_writer_putc(w, '\n');
+		if (prop->data_type != MODEL_DATA_BLOB)
 			break;
-		case DRM_MODE_PROP_BLOB:;
-			printf("blob = %" PRIu64 "\n", raw_val);
-			if (!data_obj)
-				break;
-			if (strcmp(prop_name, "IN_FORMATS") == 0)
-				print_in_formats(data_obj, sub_prefix);
-			else if (strcmp(prop_name, "MODE_ID") == 0)
-				print_mode_id(data_obj, sub_prefix);
-			else if (strcmp(prop_name, "WRITEBACK_PIXEL_FORMATS") == 0)
-				print_writeback_pixel_formats(data_obj, sub_prefix);
-			else if (strcmp(prop_name, "PATH") == 0)
-				print_path(data_obj, sub_prefix);
+		const struct model_blob *blob = prop->data.blob;
+		switch (blob->type) {
+		case MODEL_BLOB_IN_FORMATS:
+			print_in_formats(w, blob, style);
 			break;
-		case DRM_MODE_PROP_BITMASK:
-			printf("bitmask {");
-			first = true;
-			for (size_t j = 0; j < json_object_array_length(spec_obj); ++j) {
-				struct json_object *item_obj =
-					json_object_array_get_idx(spec_obj, j);
-				const char *item_name =
-					get_object_object_string(item_obj, "name");
-
-				printf("%s%s", first ? "" : ", ", item_name);
-				first = false;
-			}
-			printf("} = (");
-
-			first = true;
-			for (size_t j = 0; j < json_object_array_length(spec_obj); ++j) {
-				struct json_object *item_obj =
-					json_object_array_get_idx(spec_obj, j);
-				const char *item_name =
-					get_object_object_string(item_obj, "name");
-				uint64_t item_value =
-					get_object_object_uint64(item_obj, "value");
-				uint64_t item_bit = 1 << item_value;
-				if ((item_bit & raw_val) != item_bit) {
-					continue;
-				}
-
-				printf("%s%s", first ? "" : " | ", item_name);
-				first = false;
-			}
-
-			printf(")\n");
+		case MODEL_BLOB_MODE:
+			print_mode_id(w, blob);
 			break;
-		case DRM_MODE_PROP_OBJECT:;
-			uint32_t obj_type = json_object_get_uint64(spec_obj);
-			printf("object %s = %"PRIu64"\n", obj_str(obj_type), raw_val);
-			if (!data_obj)
-				break;
-			if (strcmp(prop_name, "FB_ID") == 0)
-				print_fb(data_obj, sub_prefix);
+		case MODEL_BLOB_FORMATS:
+			print_writeback_pixel_formats(w, blob);
 			break;
-		case DRM_MODE_PROP_SIGNED_RANGE:;
-			int64_t smin =
-				json_object_get_int64(json_object_object_get(spec_obj, "min"));
-			int64_t smax =
-				json_object_get_int64(json_object_object_get(spec_obj, "max"));
-			const char *smin_str = i64_str(smin);
-			const char *smax_str = i64_str(smax);
-
-			if (smin_str)
-				printf("srange [%s, ", smin_str);
-			else
-				printf("srange [%"PRIi64", ", smin);
-
-			if (smax_str)
-				printf("%s]", smax_str);
-			else
-				printf("%"PRIi64"]", smax);
-
-			if (data_obj != NULL)
-				printf(" = %"PRIi64"\n", json_object_get_int64(data_obj));
-			else
-				printf(" = %"PRIi64"\n", json_object_get_int64(val_obj));
+		case MODEL_BLOB_PATH:
+			print_path(w, blob);
 			break;
-		default:
-			printf("unknown type (%"PRIu32") = %"PRIu64"\n", type, raw_val);
+		case MODEL_BLOB_EDID:
+			print_edid(w, blob);
+			break;
+		case MODEL_BLOB_LUT:
+			print_lut(w, blob);
+			break;
+		case MODEL_BLOB_CTM:
+			print_ctm(w, blob);
+			break;
+		case MODEL_BLOB_HDR_METADATA:
+			print_hdr_metadata(w, blob);
+			break;
+		case MODEL_BLOB_RECTS:
+			print_rects(w, blob);
+			break;
+		}
+		break;
+	case DRM_MODE_PROP_BITMASK:
+		tree_writer_puts(w, "bitmask {");
+		first = true;
+		for (size_t j = 0; j < def->spec.enums.n_items; ++j) {
+			const struct model_enum *item = &def->spec.enums.items[j];
+
+			if (!first)
+				tree_writer_puts(w, ", ");
+			tree_writer_puts(w, item->name);
+			first = false;
+		}
+		tree_writer_puts(w, "} = (");
+
+		first = true;
+		for (size_t j = 0; j < def->spec.enums.n_items; ++j) {
+			const struct model_enum *item = &def->spec.enums.items[j];
+			uint64_t item_bit = 1 << item->value;
+			if ((item_bit & raw_val) != item_bit) {
+				continue;
+			}
+
+			if (!first)
+				tree_writer_puts(w, " | ");
+			tree_writer_puts(w, item->name);
+			first = false;
 		}
+
+		tree_writer_puts(w, ")\n");
+		break;
+	case DRM_MODE_PROP_OBJECT:
+		tree_writer_printf(w, "object %s = %"PRIu64"\n",
+			obj_str(def->spec.object_type), raw_val);
+		if (prop->data_type == MODEL_DATA_FB)
+			print_fb(w, prop->data.fb);
+		break;
+	case DRM_MODE_PROP_SIGNED_RANGE:;
+		int64_t smin = def->spec.srange.min;
+		int64_t smax = def->spec.srange.max;
+		const char *smin_str = i64_str(smin);
+		const char *smax_str = i64_str(smax);
+
+		if (smin_str)
+			tree_writer_printf(w, "srange [%s, ", smin_str);
+		else
+			tree_writer_printf(w, "srange [%"PRIi64", ", smin);
+
+		if (smax_str)
+			tree_writer_printf(w, "%s]", smax_str);
+		else
+			tree_writer_printf(w, "%"PRIi64"]", smax);
+
+		tree_writer_printf(w, " = %"PRIi64"\n", (int64_t)raw_val);
+		break;
+	default:
+		tree_writer_printf(w, "unknown type (%"PRIu32") = %"PRIu64"\n",
+			type, raw_val);
 	}
 }
 
-static void print_modes(struct json_object *arr, const char *prefix)
+static void print_properties(struct tree_writer *w,
+		const struct model_properties *props,
+		const struct in_formats_style *style)
 {
-	if (json_object_array_length(arr) == 0) {
+	tree_writer_item(w, true);
+	tree_writer_puts(w, "Properties\n");
+
+	tree_writer_push(w, true);
+	for (size_t i = 0; props && i < props->len; ++i) {
+		bool last = i == props->len - 1;
+		tree_writer_item(w, last);
+		// Blob contents and FBs are children of the property
+		tree_writer_push(w, last);
+		print_property(w, &props->items[i], style);
+		tree_writer_pop(w);
+	}
+	tree_writer_pop(w);
+}
+
+static void print_modes(struct tree_writer *w, const drmModeModeInfo *modes,
+		size_t n_modes)
+{
+	if (n_modes == 0) {
 		return;
 	}
 
-	printf("%s" L_VAL "Modes\n", prefix);
-	for (size_t i = 0; i < json_object_array_length(arr); ++i) {
-		bool last = i == json_object_array_length(arr) - 1;
-		printf("%s" L_LINE "%s", prefix, last ? L_LAST : L_VAL);
-		print_mode(json_object_array_get_idx(arr, i));
-		printf("\n");
+	tree_writer_item(w, false);
+	tree_writer_puts(w, "Modes\n");
+	tree_writer_push(w, false);
+	for (size_t i = 0; i < n_modes; ++i) {
+		tree_writer_item(w, i == n_modes - 1);
+		print_mode(w, &modes[i]);
+		tree_writer_putc(w, '\n');
 	}
+	tree_writer_pop(w);
 }
 
-static const char *conn_name(uint32_t type)
+const char *conn_name(uint32_t type)
 {
 	switch (type) {
 	case DRM_MODE_CONNECTOR_Unknown:     return "unknown";
@@ -652,66 +905,67 @@ static const char *conn_subpixel(drmModeSubPixel subpixel)
 	}
 }
 
-static ssize_t find_encoder_index(struct json_object *encoders_arr,
+static ssize_t find_encoder_index(const struct model_node *node,
 		uint32_t enc_id)
 {
-	for (size_t i = 0; i < json_object_array_length(encoders_arr); ++i) {
-		struct json_object *obj = json_object_array_get_idx(encoders_arr, i);
-		uint32_t id = get_object_object_uint64(obj, "id");
-		if (enc_id == id) {
+	for (size_t i = 0; i < node->n_encoders; ++i) {
+		if (node->encoders[i]->id == enc_id) {
 			return i;
 		}
 	}
 	return -1;
 }
 
-static void print_connectors(struct json_object *arr,
-		struct json_object *encoders_arr)
-{
-	printf(L_VAL "Connectors\n");
-	for (size_t i = 0; i < json_object_array_length(arr); ++i) {
-		struct json_object *obj = json_object_array_get_idx(arr, i);
-		bool last = i == json_object_array_length(arr) - 1;
-
-		uint32_t id = get_object_object_uint64(obj, "id");
-		uint32_t type = get_object_object_uint64(obj, "type");
-		drmModeConnection status = get_object_object_uint64(obj, "status");
-		uint32_t phy_width = get_object_object_uint64(obj, "phy_width");
-		uint32_t phy_height = get_object_object_uint64(obj, "phy_height");
-		drmModeSubPixel subpixel = get_object_object_uint64(obj, "subpixel");
-		struct json_object *encs_arr = json_object_object_get(obj, "encoders");
-		struct json_object *modes_arr = json_object_object_get(obj, "modes");
-		struct json_object *props_obj = json_object_object_get(obj, "properties");
-
-		printf(L_LINE "%sConnector %zu\n", last ? L_LAST : L_VAL, i);
-
-		printf(L_LINE "%s" L_VAL "Object ID: %"PRIu32"\n",
-			last ? L_GAP : L_LINE, id);
-		printf(L_LINE "%s" L_VAL "Type: %s\n", last ? L_GAP : L_LINE,
-			conn_name(type));
-		printf(L_LINE "%s" L_VAL "Status: %s\n", last ? L_GAP : L_LINE,
-			conn_status(status));
+static void print_connectors(struct tree_writer *w,
+		const struct model_node *node, const struct in_formats_style *style)
+{
+	tree_writer_item(w, false);
+	tree_writer_puts(w, "Connectors\n");
+	tree_writer_push(w, false);
+	for (size_t i = 0; i < node->n_connectors; ++i) {
+		const struct model_connector *conn = node->connectors[i];
+		bool last = i == node->n_connectors - 1;
+
+		uint32_t id = conn->id;
+		uint32_t type = conn->type;
+		drmModeConnection status = conn->status;
+		uint32_t phy_width = conn->phy_width;
+		uint32_t phy_height = conn->phy_height;
+		drmModeSubPixel subpixel = conn->subpixel;
+
+		tree_writer_item(w, last);
+		tree_writer_printf(w, "Connector %zu\n", i);
+		tree_writer_push(w, last);
+
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "Object ID: %"PRIu32"\n", id);
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "Type: %s\n", conn_name(type));
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "Status: %s\n", conn_status(status));
 		if (status != DRM_MODE_DISCONNECTED) {
-			printf(L_LINE "%s" L_VAL "Physical size: %"PRIu32"x%"PRIu32" mm\n",
-				last ? L_GAP : L_LINE, phy_width, phy_height);
-			printf(L_LINE "%s" L_VAL "Subpixel: %s\n", last ? L_GAP : L_LINE,
-				conn_subpixel(subpixel));
+			tree_writer_item(w, false);
+			tree_writer_printf(w, "Physical size: %"PRIu32"x%"PRIu32" mm\n",
+				phy_width, phy_height);
+			tree_writer_item(w, false);
+			tree_writer_printf(w, "Subpixel: %s\n", conn_subpixel(subpixel));
 		}
 
 		bool first = true;
-		printf(L_LINE "%s" L_VAL "Encoders: {", last ? L_GAP : L_LINE);
-		for (size_t j = 0; j < json_object_array_length(encs_arr); ++j) {
-			uint32_t enc_id = json_object_get_uint64(
-				json_object_array_get_idx(encs_arr, j));
-			printf("%s%zi", first ? "" : ", ",
-				find_encoder_index(encoders_arr, enc_id));
+		tree_writer_item(w, false);
+		tree_writer_puts(w, "Encoders: {");
+		for (size_t j = 0; j < conn->n_encoders; ++j) {
+			tree_writer_printf(w, "%s%zi", first ? "" : ", ",
+				find_encoder_index(node, conn->encoders[j]));
 			first = false;
 		}
-		printf("}\n");
+		tree_writer_puts(w, "}\n");
 
-		print_modes(modes_arr, last ? L_LINE L_GAP : L_LINE L_LINE);
-		print_properties(props_obj, last ? L_LINE L_GAP : L_LINE L_LINE);
+		print_modes(w, conn->modes, conn->n_modes);
+		print_properties(w, conn->props, style);
+		tree_writer_pop(w);
 	}
+	tree_writer_pop(w);
 }
 
 static const char *encoder_str(uint32_t type)
@@ -730,154 +984,266 @@ static const char *encoder_str(uint32_t type)
 	}
 }
 
-static void print_bitmask(uint32_t mask)
+static void print_bitmask(struct tree_writer *w, uint32_t mask)
 {
 	bool first = true;
-	printf("{");
+	tree_writer_putc(w, '{');
 	for (uint32_t i = 0; i < 31; ++i) {
 		if (!(mask & (1 << i)))
 			continue;
 
-		printf("%s%"PRIu32, first ? "" : ", ", i);
+		if (!first)
+			tree_writer_puts(w, ", ");
+		tree_writer_uint(w, i);
 		first = false;
 	}
-	printf("}");
+	tree_writer_putc(w, '}');
 }
 
-static void print_encoders(struct json_object *arr)
+static void print_encoders(struct tree_writer *w,
+		const struct model_node *node)
 {
-	printf(L_VAL "Encoders\n");
-	for (size_t i = 0; i < json_object_array_length(arr); ++i) {
-		struct json_object *obj = json_object_array_get_idx(arr, i);
-		bool last = i == json_object_array_length(arr) - 1;
-
-		uint32_t id = get_object_object_uint64(obj, "id");
-		uint32_t type = get_object_object_uint64(obj, "type");
-		uint32_t crtcs = get_object_object_uint64(obj, "possible_crtcs");
-		uint32_t clones = get_object_object_uint64(obj, "possible_clones");
-
-		printf(L_LINE "%sEncoder %zu\n", last ? L_LAST : L_VAL, i);
-
-		printf(L_LINE "%s" L_VAL "Object ID: %"PRIu32"\n",
-			last ? L_GAP : L_LINE, id);
-		printf(L_LINE "%s" L_VAL "Type: %s\n", last ? L_GAP : L_LINE,
-			encoder_str(type));
-
-		printf(L_LINE "%s" L_VAL "CRTCS: ", last ? L_GAP : L_LINE);
-		print_bitmask(crtcs);
-		printf("\n");
-
-		printf(L_LINE "%s" L_LAST "Clones: ", last ? L_GAP : L_LINE);
-		print_bitmask(clones);
-		printf("\n");
+	tree_writer_item(w, false);
+	tree_writer_puts(w, "Encoders\n");
+	tree_writer_push(w, false);
+	for (size_t i = 0; i < node->n_encoders; ++i) {
+		const struct model_encoder *enc = node->encoders[i];
+		bool last = i == node->n_encoders - 1;
+
+		uint32_t id = enc->id;
+		uint32_t type = enc->type;
+		uint32_t crtcs = enc->possible_crtcs;
+		uint32_t clones = enc->possible_clones;
+
+		tree_writer_item(w, last);
+		tree_writer_printf(w, "Encoder %zu\n", i);
+		tree_writer_push(w, last);
+
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "Object ID: %"PRIu32"\n", id);
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "Type: %s\n", encoder_str(type));
+
+		tree_writer_item(w, false);
+		tree_writer_puts(w, "CRTCS: ");
+		print_bitmask(w, crtcs);
+		tree_writer_putc(w, '\n');
+
+		tree_writer_item(w, true);
+		tree_writer_puts(w, "Clones: ");
+		print_bitmask(w, clones);
+		tree_writer_putc(w, '\n');
+		tree_writer_pop(w);
 	}
+	tree_writer_pop(w);
 }
 
-static void print_crtcs(struct json_object *arr)
+static void print_crtcs(struct tree_writer *w, const struct model_node *node,
+		const struct in_formats_style *style)
 {
-	printf(L_VAL "CRTCs\n");
-	for (size_t i = 0; i < json_object_array_length(arr); ++i) {
-		struct json_object *obj = json_object_array_get_idx(arr, i);
-		bool last = i == json_object_array_length(arr) - 1;
-		const char *prefix = last ? L_LINE L_GAP : L_LINE L_LINE;
-
-		uint32_t id = get_object_object_uint64(obj, "id");
-		struct json_object *props_obj = json_object_object_get(obj, "properties");
-
-		printf(L_LINE "%sCRTC %zu\n", last ? L_LAST : L_VAL, i);
-
-		printf("%s" L_VAL "Object ID: %"PRIu32"\n", prefix, id);
-
-		printf("%s" L_VAL "Legacy info\n", prefix);
-
-		struct json_object *mode_obj = json_object_object_get(obj, "mode");
-		if (mode_obj) {
-			printf("%s" L_LINE L_VAL "Mode: ", prefix);
-			print_mode(mode_obj);
-			printf("\n");
+	tree_writer_item(w, false);
+	tree_writer_puts(w, "CRTCs\n");
+	tree_writer_push(w, false);
+	for (size_t i = 0; i < node->n_crtcs; ++i) {
+		const struct model_crtc *crtc = node->crtcs[i];
+		bool last = i == node->n_crtcs - 1;
+
+		tree_writer_item(w, last);
+		tree_writer_printf(w, "CRTC %zu\n", i);
+		tree_writer_push(w, last);
+
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "Object ID: %"PRIu32"\n", crtc->id);
+
+		tree_writer_item(w, false);
+		tree_writer_puts(w, "Legacy info\n");
+		tree_writer_push(w, false);
+
+		if (crtc->mode) {
+			tree_writer_item(w, false);
+			tree_writer_puts(w, "Mode: ");
+			print_mode(w, crtc->mode);
+			tree_writer_putc(w, '\n');
 		}
 
-		struct json_object *gamma_size_obj =
-			json_object_object_get(obj, "gamma_size");
-		printf("%s" L_LINE L_LAST "Gamma size: %d\n", prefix,
-			json_object_get_int(gamma_size_obj));
+		tree_writer_item(w, true);
+		tree_writer_printf(w, "Gamma size: %d\n", crtc->gamma_size);
+		tree_writer_pop(w);
 
-		print_properties(props_obj, prefix);
+		print_properties(w, crtc->props, style);
+		tree_writer_pop(w);
 	}
+	tree_writer_pop(w);
 }
 
-static void print_planes(struct json_object *arr)
+static const struct model_blob *find_in_formats(
+		const struct model_properties *props)
 {
-	printf(L_LAST "Planes\n");
-	for (size_t i = 0; i < json_object_array_length(arr); ++i) {
-		struct json_object *obj = json_object_array_get_idx(arr, i);
-		bool last = i == json_object_array_length(arr) - 1;
-		const char *prefix = last ? L_GAP L_GAP : L_GAP L_LINE;
-
-		uint32_t id = get_object_object_uint64(obj, "id");
-		uint32_t crtcs = get_object_object_uint64(obj, "possible_crtcs");
-		uint32_t fb_id = get_object_object_uint64(obj, "fb_id");
-		struct json_object *fb_obj = json_object_object_get(obj, "fb");
-		struct json_object *formats_arr = json_object_object_get(obj, "formats");
-		struct json_object *props_obj = json_object_object_get(obj, "properties");
+	for (size_t i = 0; props && i < props->len; ++i) {
+		const struct model_property *prop = &props->items[i];
+		if (prop->data_type == MODEL_DATA_BLOB &&
+				prop->data.blob->type == MODEL_BLOB_IN_FORMATS) {
+			return prop->data.blob;
+		}
+	}
+	return NULL;
+}
 
-		printf(L_GAP "%sPlane %zu\n", last ? L_LAST : L_VAL, i);
+/* Sets same_as[i] to the first plane with the same IN_FORMATS as plane i, or
+ * -1 if there's none before it. Returns false if out of memory. */
+static bool find_same_in_formats(const struct model_node *node,
+		ssize_t *same_as)
+{
+	size_t cap = table_cap(node->n_planes);
+	size_t *slots = calloc(cap, sizeof(*slots));
+	if (!slots) {
+		return false;
+	}
 
-		printf("%s" L_VAL "Object ID: %"PRIu32"\n", prefix, id);
-		printf("%s" L_VAL "CRTCs: ", prefix);
-		print_bitmask(crtcs);
-		printf("\n");
+	for (size_t i = 0; i < node->n_planes; ++i) {
+		same_as[i] = -1;
+		const struct model_blob *blob =
+			find_in_formats(node->planes[i]->props);
+		if (!blob) {
+			continue;
+		}
 
-		printf("%s" L_VAL "Legacy info\n", prefix);
+		size_t j = in_formats_hash(blob) & (cap - 1);
+		for (; slots[j]; j = (j + 1) & (cap - 1)) {
+			size_t other = slots[j] - 1;
+			if (in_formats_equal(find_in_formats(node->planes[other]->props),
+					blob)) {
+				same_as[i] = other;
+				break;
+			}
+		}
+		if (!slots[j]) {
+			slots[j] = i + 1;
+		}
+	}
 
-		char sub_prefix[strlen(prefix) + 2 * strlen(L_LINE) + 1];
-		snprintf(sub_prefix, sizeof(sub_prefix), "%s" L_LINE L_LINE, prefix);
+	free(slots);
+	return true;
+}
 
-		printf("%s" L_LINE L_VAL "FB ID: %"PRIu32"\n", prefix, fb_id);
-		if (fb_obj) {
-			print_fb(fb_obj, sub_prefix);
+static void print_planes(struct tree_writer *w, const struct model_node *node,
+		const struct print_options *opts)
+{
+	// Only planes with IN_FORMATS different from every plane before them
+	// are printed in full
+	ssize_t *same_as = NULL;
+	if (opts->group_formats) {
+		same_as = malloc(node->n_planes * sizeof(*same_as));
+		if (same_as && !find_same_in_formats(node, same_as)) {
+			free(same_as);
+			same_as = NULL;
 		}
+	}
 
-		printf("%s" L_LINE L_LAST "Formats:\n", prefix);
-		for (size_t j = 0; j < json_object_array_length(formats_arr); ++j) {
-			uint32_t fmt = json_object_get_uint64(
-				json_object_array_get_idx(formats_arr, j));
-			bool fmt_last = j == json_object_array_length(formats_arr) - 1;
-
-			printf("%s" L_LINE L_GAP "%s%s (0x%08"PRIx32")\n", prefix,
-				fmt_last ? L_LAST : L_VAL,
-				format_str(fmt), fmt);
+	tree_writer_item(w, true);
+	tree_writer_puts(w, "Planes\n");
+	tree_writer_push(w, true);
+	for (size_t i = 0; node->planes && i < node->n_planes; ++i) {
+		const struct model_plane *plane = node->planes[i];
+		bool last = i == node->n_planes - 1;
+
+		uint32_t id = plane->id;
+		uint32_t crtcs = plane->possible_crtcs;
+		uint32_t fb_id = plane->fb_id;
+
+		tree_writer_item(w, last);
+		tree_writer_printf(w, "Plane %zu\n", i);
+		tree_writer_push(w, last);
+
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "Object ID: %"PRIu32"\n", id);
+		tree_writer_item(w, false);
+		tree_writer_puts(w, "CRTCs: ");
+		print_bitmask(w, crtcs);
+		tree_writer_putc(w, '\n');
+
+		tree_writer_item(w, false);
+		tree_writer_puts(w, "Legacy info\n");
+		tree_writer_push(w, false);
+
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "FB ID: %"PRIu32"\n", fb_id);
+		if (plane->fb) {
+			tree_writer_push(w, false);
+			print_fb(w, plane->fb);
+			tree_writer_pop(w);
 		}
 
-		print_properties(props_obj, prefix);
+		tree_writer_item(w, true);
+		tree_writer_puts(w, "Formats:\n");
+		tree_writer_push(w, true);
+		for (size_t j = 0; j < plane->n_formats; ++j) {
+			tree_writer_item(w, j == plane->n_formats - 1);
+			print_format(w, plane->formats[j]);
+		}
+		tree_writer_pop(w);
+		tree_writer_pop(w);
+
+		struct in_formats_style style = {
+			.group = opts->group_formats,
+			.same_as = same_as ? same_as[i] : -1,
+		};
+		print_properties(w, plane->props, &style);
+		tree_writer_pop(w);
 	}
+	tree_writer_pop(w);
+
+	free(same_as);
 }
 
-static void print_node(const char *path, struct json_object *obj)
+void print_node(struct tree_writer *w, const char *path,
+		const struct model_node *node, const struct print_options *opts)
 {
-	printf("Node: %s\n", path);
-	print_driver(json_object_object_get(obj, "driver"));
-	print_device(json_object_object_get(obj, "device"));
+	struct in_formats_style style = {
+		.group = opts->group_formats,
+		.same_as = -1,
+	};
+
+	tree_writer_line(w);
+	tree_writer_printf(w, "Node: %s\n", path);
+
+	// Nodes which timed out only have the sections collected in time
+	if (node->timed_out) {
+		tree_writer_item(w, false);
+		tree_writer_puts(w, "Timed out, information is incomplete\n");
+	}
 
-	printf(L_VAL "Framebuffer size\n");
-	struct json_object *fb_size_obj = json_object_object_get(obj, "fb_size");
-	printf(L_LINE L_VAL "Width: [%"PRIu64", %"PRIu64"]\n",
-		get_object_object_uint64(fb_size_obj, "min_width"),
-		get_object_object_uint64(fb_size_obj, "max_width"));
-	printf(L_LINE L_LAST "Height: [%"PRIu64", %"PRIu64"]\n",
-		get_object_object_uint64(fb_size_obj, "min_height"),
-		get_object_object_uint64(fb_size_obj, "max_height"));
+	if ((node->sections & MODEL_DRIVER) && node->driver) {
+		print_driver(w, node->driver);
+	}
+	if (node->sections & MODEL_DEVICE) {
+		print_device(w, node->device);
+	}
 
-	struct json_object *encs_arr = json_object_object_get(obj, "encoders");
-	print_connectors(json_object_object_get(obj, "connectors"), encs_arr);
-	print_encoders(encs_arr);
-	print_crtcs(json_object_object_get(obj, "crtcs"));
-	print_planes(json_object_object_get(obj, "planes"));
-}
+	if (node->sections & MODEL_FB_SIZE) {
+		const struct model_fb_size *fb_size = node->fb_size;
+		tree_writer_item(w, false);
+		tree_writer_puts(w, "Framebuffer size\n");
+		tree_writer_push(w, false);
+		tree_writer_item(w, false);
+		tree_writer_printf(w, "Width: [%"PRIu32", %"PRIu32"]\n",
+			fb_size->min_width, fb_size->max_width);
+		tree_writer_item(w, true);
+		tree_writer_printf(w, "Height: [%"PRIu32", %"PRIu32"]\n",
+			fb_size->min_height, fb_size->max_height);
+		tree_writer_pop(w);
+	}
 
-void print_drm(struct json_object *obj)
-{
-	json_object_object_foreach(obj, path, node_obj) {
-		print_node(path, node_obj);
+	if (node->sections & MODEL_CONNECTORS) {
+		print_connectors(w, node, &style);
+	}
+	if (node->sections & MODEL_ENCODERS) {
+		print_encoders(w, node);
+	}
+	if (node->sections & MODEL_CRTCS) {
+		print_crtcs(w, node, &style);
+	}
+	if ((node->sections & MODEL_PLANES) && node->planes) {
+		print_planes(w, node, opts);
 	}
 }
@@ -0,0 +1,304 @@
+#include <stdalign.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <drm_fourcc.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "arena.h"
+#include "model.h"
+#include "props.h"
+
+static bool decode_in_formats(struct model_blob *blob, struct arena *arena,
+		const void *blob_data, size_t len)
+{
+	const struct drm_format_modifier_blob *data = blob_data;
+	if (len < sizeof(*data) ||
+			data->formats_offset % alignof(uint32_t) != 0 ||
+			data->formats_offset > len ||
+			data->count_formats >
+			(len - data->formats_offset) / sizeof(uint32_t) ||
+			data->modifiers_offset % alignof(struct drm_format_modifier) != 0 ||
+			data->modifiers_offset > len ||
+			data->count_modifiers > (len - data->modifiers_offset) /
+			sizeof(struct drm_format_modifier)) {
+		return false;
+	}
+
+	const uint32_t *fmts = (const uint32_t *)
+		((const char *)data + data->formats_offset);
+
+	const struct drm_format_modifier *mods = (const struct drm_format_modifier *)
+		((const char *)data + data->modifiers_offset);
+
+	blob->type = MODEL_BLOB_IN_FORMATS;
+	blob->in_formats.n_mods = data->count_modifiers;
+	blob->in_formats.mods = arena_alloc(arena,
+		data->count_modifiers * sizeof(*blob->in_formats.mods));
+
+	for (uint32_t i = 0; i < data->count_modifiers; ++i) {
+		struct model_in_format *mod = &blob->in_formats.mods[i];
+		mod->modifier = mods[i].modifier;
+		mod->formats = arena_alloc(arena,
+			__builtin_popcountll(mods[i].formats) * sizeof(uint32_t));
+		for (uint64_t j = 0; j < 64; ++j) {
+			if (!(mods[i].formats & (1ull << j))) {
+				continue;
+			}
+			if (j + mods[i].offset >= data->count_formats) {
+				return false;
+			}
+			mod->formats[mod->n_formats++] = fmts[j + mods[i].offset];
+		}
+	}
+	return true;
+}
+
+static bool decode_mode_id(struct model_blob *blob, struct arena *arena,
+		const void *data, size_t len)
+{
+	(void)arena;
+
+	if (len != sizeof(blob->mode)) {
+		return false;
+	}
+	blob->type = MODEL_BLOB_MODE;
+	memcpy(&blob->mode, data, len);
+	return true;
+}
+
+static bool decode_writeback_pixel_formats(struct model_blob *blob,
+		struct arena *arena, const void *data, size_t len)
+{
+	blob->type = MODEL_BLOB_FORMATS;
+	blob->formats.n_formats = len / sizeof(uint32_t);
+	blob->formats.formats = arena_memdup(arena, data,
+		blob->formats.n_formats * sizeof(uint32_t));
+	return true;
+}
+
+static bool decode_path(struct model_blob *blob, struct arena *arena,
+		const void *data, size_t len)
+{
+	blob->type = MODEL_BLOB_PATH;
+	blob->path.str = arena_memdup(arena, data, len);
+	blob->path.len = len;
+	return true;
+}
+
+/* Copies the text of an EDID descriptor, which ends with a newline and is
+ * padded with spaces */
+static void edid_string(char *dst, const uint8_t *src, size_t len)
+{
+	size_t n = 0;
+	while (n < len && src[n] != '\n' && src[n] != '\0') {
+		dst[n] = src[n];
+		++n;
+	}
+	while (n > 0 && dst[n - 1] == ' ') {
+		--n;
+	}
+	dst[n] = '\0';
+}
+
+static bool decode_edid(struct model_blob *blob, struct arena *arena,
+		const void *data, size_t len)
+{
+	(void)arena;
+
+	static const uint8_t header[] = {
+		0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00,
+	};
+	const uint8_t *edid = data;
+	if (len < 128 || memcmp(edid, header, sizeof(header)) != 0) {
+		return false;
+	}
+
+	struct model_edid *result = &blob->edid;
+	blob->type = MODEL_BLOB_EDID;
+
+	// Three 5-bit letters, 1 is 'A'
+	uint16_t vendor = edid[8] << 8 | edid[9];
+	result->vendor[0] = '@' + ((vendor >> 10) & 0x1F);
+	result->vendor[1] = '@' + ((vendor >> 5) & 0x1F);
+	result->vendor[2] = '@' + (vendor & 0x1F);
+	result->vendor[3] = '\0';
+
+	result->product = edid[10] | edid[11] << 8;
+	result->serial = edid[12] | edid[13] << 8 | edid[14] << 16 |
+		(uint32_t)edid[15] << 24;
+	result->week = edid[16];
+	result->year = 1990 + edid[17];
+	result->version = edid[18];
+	result->revision = edid[19];
+	result->n_extensions = edid[126];
+
+	// The 18-byte descriptors which aren't detailed timings have a zero
+	// pixel clock, and their type in the fourth byte
+	for (size_t i = 0; i < 4; ++i) {
+		const uint8_t *desc = &edid[54 + 18 * i];
+		if (desc[0] == 0 && desc[1] == 0 && desc[3] == 0xFC) {
+			edid_string(result->name, &desc[5], 13);
+		}
+	}
+
+	return true;
+}
+
+static bool decode_lut(struct model_blob *blob, struct arena *arena,
+		const void *data, size_t len)
+{
+	(void)arena;
+
+	if (len == 0 || len % sizeof(struct drm_color_lut) != 0) {
+		return false;
+	}
+
+	struct model_lut *lut = &blob->lut;
+	blob->type = MODEL_BLOB_LUT;
+
+	const struct drm_color_lut *entries = data;
+	size_t n = len / sizeof(*entries);
+	lut->size = n;
+	lut->monotonic = true;
+	lut->linear = n > 1;
+	for (size_t c = 0; c < 3; ++c) {
+		lut->min[c] = UINT16_MAX;
+		lut->max[c] = 0;
+	}
+
+	// Linear means each entry is within half a step of the identity ramp
+	uint32_t tolerance = n > 1 ? 0xFFFF / (2 * (n - 1)) : 0;
+	uint16_t prev[3] = {0};
+	for (size_t i = 0; i < n; ++i) {
+		uint16_t values[] = {
+			entries[i].red, entries[i].green, entries[i].blue,
+		};
+		uint32_t expected = n > 1 ? i * 0xFFFF / (n - 1) : 0;
+		for (size_t c = 0; c < 3; ++c) {
+			uint16_t v = values[c];
+			if (v < lut->min[c]) {
+				lut->min[c] = v;
+			}
+			if (v > lut->max[c]) {
+				lut->max[c] = v;
+			}
+			if (v < prev[c]) {
+				lut->monotonic = false;
+			}
+			prev[c] = v;
+			uint32_t diff = v > expected ? v - expected : expected - v;
+			if (diff > tolerance) {
+				lut->linear = false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool decode_ctm(struct model_blob *blob, struct arena *arena,
+		const void *data, size_t len)
+{
+	(void)arena;
+
+	struct drm_color_ctm ctm;
+	if (len != sizeof(ctm)) {
+		return false;
+	}
+	blob->type = MODEL_BLOB_CTM;
+	memcpy(&ctm, data, len);
+	// From S31.32 sign-magnitude, negative zero becomes zero
+	for (size_t i = 0; i < 9; ++i) {
+		int64_t mag = ctm.matrix[i] & ~(1ull << 63);
+		blob->ctm[i] = ctm.matrix[i] >> 63 ? -mag : mag;
+	}
+	return true;
+}
+
+static bool decode_hdr_metadata(struct model_blob *blob, struct arena *arena,
+		const void *data, size_t len)
+{
+	(void)arena;
+
+	if (len != sizeof(blob->hdr_metadata)) {
+		return false;
+	}
+	blob->type = MODEL_BLOB_HDR_METADATA;
+	memcpy(&blob->hdr_metadata, data, len);
+	return true;
+}
+
+static bool decode_rects(struct model_blob *blob, struct arena *arena,
+		const void *data, size_t len)
+{
+	if (len % sizeof(struct drm_mode_rect) != 0) {
+		return false;
+	}
+	blob->type = MODEL_BLOB_RECTS;
+	blob->rects.n_rects = len / sizeof(struct drm_mode_rect);
+	blob->rects.rects = arena_memdup(arena, data, len);
+	return true;
+}
+
+/* Perfect hash of the names in handlers, picked so that none of them collide.
+ * Handlers are at PROP_SLOT(strlen(name), last character of name). */
+#define PROP_SLOTS 32
+#define PROP_SLOT(len, last) (((len) + 11 * (last)) % PROP_SLOTS)
+
+static const struct prop_handler handlers[PROP_SLOTS] = {
+	[PROP_SLOT(10, 'S')] = {
+		"IN_FORMATS", PROP_BLOB, MODEL_BLOB_IN_FORMATS,
+		decode_in_formats,
+	},
+	[PROP_SLOT(7, 'D')] = {
+		"MODE_ID", PROP_BLOB, MODEL_BLOB_MODE, decode_mode_id,
+	},
+	[PROP_SLOT(23, 'S')] = {
+		"WRITEBACK_PIXEL_FORMATS", PROP_BLOB, MODEL_BLOB_FORMATS,
+		decode_writeback_pixel_formats,
+	},
+	[PROP_SLOT(4, 'H')] = {
+		"PATH", PROP_BLOB, MODEL_BLOB_PATH, decode_path,
+	},
+	[PROP_SLOT(4, 'D')] = {
+		"EDID", PROP_BLOB, MODEL_BLOB_EDID, decode_edid,
+	},
+	[PROP_SLOT(9, 'T')] = {
+		"GAMMA_LUT", PROP_BLOB, MODEL_BLOB_LUT, decode_lut,
+	},
+	[PROP_SLOT(11, 'T')] = {
+		"DEGAMMA_LUT", PROP_BLOB, MODEL_BLOB_LUT, decode_lut,
+	},
+	[PROP_SLOT(3, 'M')] = {
+		"CTM", PROP_BLOB, MODEL_BLOB_CTM, decode_ctm,
+	},
+	[PROP_SLOT(19, 'A')] = {
+		"HDR_OUTPUT_METADATA", PROP_BLOB, MODEL_BLOB_HDR_METADATA,
+		decode_hdr_metadata,
+	},
+	[PROP_SLOT(15, 'S')] = {
+		"FB_DAMAGE_CLIPS", PROP_BLOB, MODEL_BLOB_RECTS, decode_rects,
+	},
+	[PROP_SLOT(5, 'D')] = { "FB_ID", PROP_FB },
+	[PROP_SLOT(5, 'X')] = { "SRC_X", PROP_FIXED_16_16 },
+	[PROP_SLOT(5, 'Y')] = { "SRC_Y", PROP_FIXED_16_16 },
+	[PROP_SLOT(5, 'W')] = { "SRC_W", PROP_FIXED_16_16 },
+	[PROP_SLOT(5, 'H')] = { "SRC_H", PROP_FIXED_16_16 },
+};
+
+const struct prop_handler *prop_handler_get(const char *name)
+{
+	size_t len = strlen(name);
+	if (len == 0) {
+		return NULL;
+	}
+
+	const struct prop_handler *handler =
+		&handlers[PROP_SLOT(len, (unsigned char)name[len - 1])];
+	if (!handler->name || strcmp(handler->name, name) != 0) {
+		return NULL;
+	}
+	return handler;
+}
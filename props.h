@@ -0,0 +1,40 @@
+#ifndef PROPS_H
+#define PROPS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "model.h"
+
+struct arena;
+
+/* Decodes blob contents, returns false if they aren't valid. Whatever is
+ * allocated comes from arena. */
+typedef bool (*blob_decoder)(struct model_blob *blob, struct arena *arena,
+	const void *data, size_t len);
+
+enum prop_kind {
+	// Blob property whose contents are decoded
+	PROP_BLOB,
+	// Object property referring to an FB
+	PROP_FB,
+	// Range property in 16.16 fixed point
+	PROP_FIXED_16_16,
+};
+
+/* Property which is collected and rendered with more than its raw value.
+ * Collectors and loaders fill model_property.data according to it, and
+ * renderers go by the type of the data. */
+struct prop_handler {
+	const char *name;
+	enum prop_kind kind;
+	// PROP_BLOB only
+	enum model_blob_type blob_type;
+	blob_decoder decode;
+};
+
+/* Returns the handler of the property called name, NULL if it doesn't have
+ * one. Handlers are found with a perfect hash of the name. */
+const struct prop_handler *prop_handler_get(const char *name);
+
+#endif
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "selector.h"
+
+static struct selector *find_child(const struct selector *sel,
+		const char *name, size_t len)
+{
+	for (struct selector *child = sel->children; child; child = child->next) {
+		if (strlen(child->name) == len &&
+				strncmp(child->name, name, len) == 0) {
+			return child;
+		}
+	}
+	return NULL;
+}
+
+static void destroy_children(struct selector *sel)
+{
+	struct selector *child = sel->children;
+	while (child) {
+		struct selector *next = child->next;
+		selector_destroy(child);
+		child = next;
+	}
+	sel->children = NULL;
+}
+
+/* Adds a dot-separated path of len bytes */
+static bool add_path(struct selector *root, const char *path, size_t len)
+{
+	struct selector *sel = root;
+	const char *end = path + len;
+	while (path <= end) {
+		const char *dot = memchr(path, '.', end - path);
+		size_t name_len = (dot ? dot : end) - path;
+		if (name_len == 0) {
+			return false;
+		}
+
+		// Already selected with all of its sub-fields
+		if (sel->all) {
+			return true;
+		}
+
+		struct selector *child = find_child(sel, path, name_len);
+		if (!child) {
+			child = calloc(1, sizeof(*child));
+			child->name = strndup(path, name_len);
+			// Keep the order fields were given in
+			struct selector **link = &sel->children;
+			while (*link)
+				link = &(*link)->next;
+			*link = child;
+		}
+
+		sel = child;
+		path += name_len + 1;
+	}
+
+	sel->all = true;
+	destroy_children(sel);
+	return true;
+}
+
+struct selector *selector_parse(const char *str)
+{
+	struct selector *root = calloc(1, sizeof(*root));
+
+	const char *field = str;
+	while (1) {
+		const char *comma = strchr(field, ',');
+		size_t len = comma ? (size_t)(comma - field) : strlen(field);
+		if (!add_path(root, field, len)) {
+			fprintf(stderr, "invalid selector: %s\n", str);
+			selector_destroy(root);
+			return NULL;
+		}
+
+		if (!comma)
+			break;
+		field = comma + 1;
+	}
+
+	return root;
+}
+
+void selector_destroy(struct selector *sel)
+{
+	if (!sel) {
+		return;
+	}
+	destroy_children(sel);
+	free(sel->name);
+	free(sel);
+}
+
+bool selector_has(const struct selector *sel, const char *name)
+{
+	return !sel || sel->all || find_child(sel, name, strlen(name));
+}
+
+const struct selector *selector_get(const struct selector *sel,
+		const char *name)
+{
+	if (!sel || sel->all) {
+		return NULL;
+	}
+
+	const struct selector *child = find_child(sel, name, strlen(name));
+	return child && !child->all ? child : NULL;
+}
+
+bool selector_within(const struct selector *sel, const char *const fields[])
+{
+	if (!sel || sel->all) {
+		return false;
+	}
+
+	for (const struct selector *child = sel->children; child;
+			child = child->next) {
+		size_t i = 0;
+		while (fields[i] && strcmp(fields[i], child->name) != 0)
+			++i;
+		if (!fields[i]) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,28 @@
+#ifndef SELECTOR_H
+#define SELECTOR_H
+
+#include <stdbool.h>
+
+/* A tree of field names, parsed from e.g. "connectors.status,crtcs.mode".
+ * A NULL selector selects everything, as does a field selected without any
+ * of its sub-fields. */
+struct selector {
+	char *name;
+	bool all;
+	struct selector *children;
+	struct selector *next;
+};
+
+/* Returns NULL and prints an error if str is invalid */
+struct selector *selector_parse(const char *str);
+void selector_destroy(struct selector *sel);
+
+bool selector_has(const struct selector *sel, const char *name);
+/* Returns true if sel only selects some sub-fields of its own, all of which
+ * are in the NULL-terminated fields */
+bool selector_within(const struct selector *sel, const char *const fields[]);
+/* Returns the selector for the sub-fields of name, which must be selected */
+const struct selector *selector_get(const struct selector *sel,
+	const char *name);
+
+#endif
@@ -0,0 +1,338 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <xf86drmMode.h>
+
+#include "sysfs.h"
+
+/* Connector type names, as used by the kernel in connector names */
+static const struct {
+	const char *name;
+	uint32_t type;
+} conn_types[] = {
+	{ "Unknown", DRM_MODE_CONNECTOR_Unknown },
+	{ "VGA", DRM_MODE_CONNECTOR_VGA },
+	{ "DVI-I", DRM_MODE_CONNECTOR_DVII },
+	{ "DVI-D", DRM_MODE_CONNECTOR_DVID },
+	{ "DVI-A", DRM_MODE_CONNECTOR_DVIA },
+	{ "Composite", DRM_MODE_CONNECTOR_Composite },
+	{ "SVIDEO", DRM_MODE_CONNECTOR_SVIDEO },
+	{ "LVDS", DRM_MODE_CONNECTOR_LVDS },
+	{ "Component", DRM_MODE_CONNECTOR_Component },
+	{ "DIN", DRM_MODE_CONNECTOR_9PinDIN },
+	{ "DP", DRM_MODE_CONNECTOR_DisplayPort },
+	{ "HDMI-A", DRM_MODE_CONNECTOR_HDMIA },
+	{ "HDMI-B", DRM_MODE_CONNECTOR_HDMIB },
+	{ "TV", DRM_MODE_CONNECTOR_TV },
+	{ "eDP", DRM_MODE_CONNECTOR_eDP },
+	{ "Virtual", DRM_MODE_CONNECTOR_VIRTUAL },
+	{ "DSI", DRM_MODE_CONNECTOR_DSI },
+	{ "DPI", DRM_MODE_CONNECTOR_DPI },
+	{ "Writeback", DRM_MODE_CONNECTOR_WRITEBACK },
+	{ "SPI", DRM_MODE_CONNECTOR_SPI },
+	{ "USB", DRM_MODE_CONNECTOR_USB },
+};
+
+static const struct {
+	const char *name;
+	int dpms;
+} dpms_names[] = {
+	{ "On", DRM_MODE_DPMS_ON },
+	{ "Standby", DRM_MODE_DPMS_STANDBY },
+	{ "Suspend", DRM_MODE_DPMS_SUSPEND },
+	{ "Off", DRM_MODE_DPMS_OFF },
+};
+
+/* Reads a whole file, NUL-terminated. Returns NULL on error. */
+static char *read_file(int dir_fd, const char *name, size_t *len)
+{
+	int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	size_t cap = 256, n = 0;
+	char *buf = malloc(cap);
+	while (buf) {
+		ssize_t ret = read(fd, buf + n, cap - n - 1);
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		} else if (ret < 0) {
+			free(buf);
+			buf = NULL;
+			break;
+		} else if (ret == 0) {
+			break;
+		}
+
+		n += ret;
+		if (n + 1 == cap) {
+			cap *= 2;
+			char *new_buf = realloc(buf, cap);
+			if (!new_buf) {
+				free(buf);
+			}
+			buf = new_buf;
+		}
+	}
+	close(fd);
+
+	if (!buf) {
+		return NULL;
+	}
+	buf[n] = '\0';
+	if (len) {
+		*len = n;
+	}
+	return buf;
+}
+
+/* Reads a file holding a single line, without the newline */
+static char *read_line(int dir_fd, const char *name)
+{
+	char *str = read_file(dir_fd, name, NULL);
+	if (str) {
+		str[strcspn(str, "\n")] = '\0';
+	}
+	return str;
+}
+
+/* Splits a connector name like "HDMI-A-1" into its type and type ID */
+static bool parse_conn_name(struct sysfs_connector *conn)
+{
+	const char *dash = strrchr(conn->name, '-');
+	if (!dash) {
+		return false;
+	}
+
+	char *end;
+	unsigned long type_id = strtoul(dash + 1, &end, 10);
+	if (dash[1] == '\0' || *end != '\0') {
+		return false;
+	}
+	conn->type_id = type_id;
+
+	size_t len = dash - conn->name;
+	for (size_t i = 0; i < sizeof(conn_types) / sizeof(conn_types[0]); ++i) {
+		if (strlen(conn_types[i].name) == len &&
+				strncmp(conn_types[i].name, conn->name, len) == 0) {
+			conn->type = conn_types[i].type;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool read_status(struct sysfs_connector *conn, int dir_fd)
+{
+	char *str = read_line(dir_fd, "status");
+	if (!str) {
+		return false;
+	}
+
+	bool ok = true;
+	if (strcmp(str, "connected") == 0) {
+		conn->status = DRM_MODE_CONNECTED;
+	} else if (strcmp(str, "disconnected") == 0) {
+		conn->status = DRM_MODE_DISCONNECTED;
+	} else if (strcmp(str, "unknown") == 0) {
+		conn->status = DRM_MODE_UNKNOWNCONNECTION;
+	} else {
+		ok = false;
+	}
+	free(str);
+	return ok;
+}
+
+static bool read_dpms(struct sysfs_connector *conn, int dir_fd)
+{
+	char *str = read_line(dir_fd, "dpms");
+	if (!str) {
+		return false;
+	}
+
+	bool ok = false;
+	for (size_t i = 0; i < sizeof(dpms_names) / sizeof(dpms_names[0]); ++i) {
+		if (strcmp(str, dpms_names[i].name) == 0) {
+			conn->dpms = dpms_names[i].dpms;
+			ok = true;
+			break;
+		}
+	}
+	free(str);
+	return ok;
+}
+
+static bool read_modes(struct sysfs_connector *conn, int dir_fd)
+{
+	char *str = read_file(dir_fd, "modes", NULL);
+	if (!str) {
+		return false;
+	}
+
+	// One mode name per line
+	size_t n = 0;
+	for (const char *c = str; *c; ++c) {
+		if (*c == '\n')
+			++n;
+	}
+
+	conn->modes = calloc(n + 1, sizeof(*conn->modes));
+	if (!conn->modes) {
+		free(str);
+		return false;
+	}
+	char *line = str;
+	bool ok = true;
+	while (*line) {
+		char *nl = strchr(line, '\n');
+		size_t len = nl ? (size_t)(nl - line) : strlen(line);
+		char *mode = strndup(line, len);
+		if (!mode) {
+			ok = false;
+			break;
+		}
+		conn->modes[conn->n_modes++] = mode;
+		line += nl ? len + 1 : len;
+	}
+	free(str);
+	return ok;
+}
+
+static bool read_connector(struct sysfs_connector *conn, int dir_fd,
+		uint32_t fields)
+{
+	if (!parse_conn_name(conn)) {
+		return false;
+	}
+
+	// Only exposed by newer kernels
+	char *id_str = read_line(dir_fd, "connector_id");
+	if (id_str) {
+		conn->id = strtoul(id_str, NULL, 10);
+		free(id_str);
+	}
+
+	if ((fields & SYSFS_STATUS) && !read_status(conn, dir_fd)) {
+		return false;
+	}
+	if ((fields & SYSFS_DPMS) && !read_dpms(conn, dir_fd)) {
+		return false;
+	}
+	if ((fields & SYSFS_MODES) && !read_modes(conn, dir_fd)) {
+		return false;
+	}
+	if (fields & SYSFS_EDID) {
+		conn->edid = (uint8_t *)read_file(dir_fd, "edid", &conn->edid_len);
+		if (!conn->edid) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* The kernel lists connectors in the order they were created, which is also
+ * the order of their IDs */
+static int conn_cmp(const void *a, const void *b)
+{
+	const struct sysfs_connector *conn_a = a, *conn_b = b;
+	if (conn_a->id != conn_b->id) {
+		return conn_a->id < conn_b->id ? -1 : 1;
+	}
+	if (conn_a->type != conn_b->type) {
+		return conn_a->type < conn_b->type ? -1 : 1;
+	}
+	if (conn_a->type_id != conn_b->type_id) {
+		return conn_a->type_id < conn_b->type_id ? -1 : 1;
+	}
+	return 0;
+}
+
+bool sysfs_get_connectors(const char *root, const char *card, uint32_t fields,
+		struct sysfs_connector **conns_ptr, size_t *n_conns_ptr)
+{
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/class/drm", root);
+
+	int class_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (class_fd < 0) {
+		return false;
+	}
+	DIR *dir = fdopendir(class_fd);
+	if (!dir) {
+		close(class_fd);
+		return false;
+	}
+
+	// Connector directories are named <card>-<connector>
+	size_t card_len = strlen(card);
+	struct sysfs_connector *conns = NULL;
+	size_t n_conns = 0, cap = 0;
+	bool ok = true;
+	struct dirent *ent;
+	while (ok && (ent = readdir(dir))) {
+		if (strncmp(ent->d_name, card, card_len) != 0 ||
+				ent->d_name[card_len] != '-') {
+			continue;
+		}
+
+		if (n_conns == cap) {
+			cap = cap ? cap * 2 : 8;
+			struct sysfs_connector *new_conns =
+				realloc(conns, cap * sizeof(*conns));
+			if (!new_conns) {
+				ok = false;
+				break;
+			}
+			conns = new_conns;
+		}
+
+		struct sysfs_connector *conn = &conns[n_conns++];
+		memset(conn, 0, sizeof(*conn));
+		conn->name = strdup(ent->d_name + card_len + 1);
+		if (!conn->name) {
+			ok = false;
+			break;
+		}
+
+		int conn_fd = openat(class_fd, ent->d_name,
+			O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (conn_fd < 0) {
+			ok = false;
+			break;
+		}
+		ok = read_connector(conn, conn_fd, fields);
+		close(conn_fd);
+	}
+	closedir(dir);
+
+	if (!ok || n_conns == 0) {
+		sysfs_free_connectors(conns, n_conns);
+		return false;
+	}
+
+	qsort(conns, n_conns, sizeof(*conns), conn_cmp);
+
+	*conns_ptr = conns;
+	*n_conns_ptr = n_conns;
+	return true;
+}
+
+void sysfs_free_connectors(struct sysfs_connector *conns, size_t n_conns)
+{
+	for (size_t i = 0; i < n_conns; ++i) {
+		for (size_t j = 0; j < conns[i].n_modes; ++j) {
+			free(conns[i].modes[j]);
+		}
+		free(conns[i].modes);
+		free(conns[i].edid);
+		free(conns[i].name);
+	}
+	free(conns);
+}
@@ -0,0 +1,42 @@
+#ifndef SYSFS_H
+#define SYSFS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Reads connector state from <root>/class/drm/<card>-<connector>/, without
+ * opening the DRM node or issuing any ioctl. The kernel doesn't probe
+ * connectors when these files are read, so this never disturbs the display
+ * driver. */
+
+enum sysfs_field {
+	SYSFS_STATUS = 1 << 0,
+	SYSFS_MODES = 1 << 1,
+	SYSFS_EDID = 1 << 2,
+	SYSFS_DPMS = 1 << 3,
+};
+
+struct sysfs_connector {
+	char *name; // e.g. "HDMI-A-1"
+	uint32_t id; // 0 if the kernel doesn't expose connector_id
+	uint32_t type; // DRM_MODE_CONNECTOR_*
+	uint32_t type_id;
+
+	// Only filled if asked for:
+	uint32_t status; // drmModeConnection
+	int dpms; // DRM_MODE_DPMS_*
+	char **modes; // Mode names
+	size_t n_modes;
+	uint8_t *edid;
+	size_t edid_len;
+};
+
+/* Reads the connectors of card (e.g. "card0"), sorted like the kernel lists
+ * them. fields is a mask of enum sysfs_field. Returns false if sysfs doesn't
+ * have the card's connectors, or any of them couldn't be read. */
+bool sysfs_get_connectors(const char *root, const char *card, uint32_t fields,
+	struct sysfs_connector **conns, size_t *n_conns);
+void sysfs_free_connectors(struct sysfs_connector *conns, size_t n_conns);
+
+#endif
@@ -1,11 +1,36 @@
 #ifndef TABLES_H
 #define TABLES_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
-/* The implementation of these functions are generated by fourcc.py */
+/* The implementation of these functions are generated by fourcc.py, with
+ * perfect hash tables for everything but basic_modifier_str() */
 
+/* Layout of a format, from the kernel's format table. Formats fourcc.py
+ * doesn't know about only have a name, and n_planes is 0. */
+struct format_info {
+	uint32_t format;
+	const char *name;
+	uint8_t n_planes;
+	// Bits per pixel of each plane. Chroma planes of subsampled formats
+	// have one pixel per chroma sample.
+	uint8_t bpp[3];
+	uint8_t hsub, vsub;
+	bool has_alpha;
+	bool is_yuv;
+};
+
+/* Returns NULL for unknown formats */
+const struct format_info *format_info_get(uint32_t format);
+/* Looks up a format by name, without the DRM_FORMAT_ prefix. Returns NULL for
+ * unknown names. */
+const struct format_info *format_info_from_str(const char *name);
 const char *format_str(uint32_t format);
+
 const char *basic_modifier_str(uint64_t modifier);
+/* Looks up a modifier without vendor-specific fields by its full name, e.g.
+ * I915_FORMAT_MOD_X_TILED. Returns false for unknown names. */
+bool basic_modifier_from_str(const char *name, uint64_t *modifier);
 
 #endif
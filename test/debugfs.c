@@ -0,0 +1,60 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "debugfs.h"
+
+/* Prints everything debugfs_state_read() got out of a state file, fixed
+ * point values in hex so the rounding is visible */
+int main(int argc, char *argv[])
+{
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <state>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	struct debugfs_state *state = debugfs_state_read(argv[1]);
+	if (!state) {
+		fprintf(stderr, "failed to read %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < state->n_planes; ++i) {
+		const struct debugfs_plane *plane = &state->planes[i];
+		printf("plane %"PRIu32": crtc=%"PRIu32" fb=%"PRIu32" "
+			"crtc-pos=%"PRIu32"x%"PRIu32"%+"PRId32"%+"PRId32" "
+			"src-pos=0x%08"PRIx32"x0x%08"PRIx32"+0x%08"PRIx32"+0x%08"PRIx32"\n",
+			plane->id, plane->crtc_id, plane->fb_id,
+			plane->crtc_w, plane->crtc_h, plane->crtc_x, plane->crtc_y,
+			plane->src_w, plane->src_h, plane->src_x, plane->src_y);
+	}
+
+	for (size_t i = 0; i < state->n_crtcs; ++i) {
+		const struct debugfs_crtc *crtc = &state->crtcs[i];
+		const drmModeModeInfo *mode = &crtc->mode;
+		printf("crtc %"PRIu32": enable=%d active=%d "
+			"mode=\"%s\" %"PRIu32" %"PRIu32" "
+			"%"PRIu16" %"PRIu16" %"PRIu16" %"PRIu16" "
+			"%"PRIu16" %"PRIu16" %"PRIu16" %"PRIu16" "
+			"0x%"PRIx32" 0x%"PRIx32"\n",
+			crtc->id, crtc->enable, crtc->active,
+			mode->name, mode->vrefresh, mode->clock,
+			mode->hdisplay, mode->hsync_start, mode->hsync_end,
+			mode->htotal, mode->vdisplay, mode->vsync_start,
+			mode->vsync_end, mode->vtotal, mode->type, mode->flags);
+	}
+
+	for (size_t i = 0; i < state->n_fbs; ++i) {
+		const struct debugfs_fb *fb = &state->fbs[i];
+		printf("fb %"PRIu32": %"PRIu32"x%"PRIu32" format=0x%08"PRIx32" "
+			"modifier=0x%016"PRIx64"\n",
+			fb->id, fb->width, fb->height, fb->format, fb->modifier);
+		for (size_t j = 0; j < 4; ++j) {
+			printf("\tpitch[%zu]=%"PRIu32" offset[%zu]=%"PRIu32"\n",
+				j, fb->pitches[j], j, fb->offsets[j]);
+		}
+	}
+
+	debugfs_state_destroy(state);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,12 @@
+#!/bin/sh
+# Usage: expect.sh <expected> <command> [args...]
+# Runs the command and compares what it prints with the expected file.
+
+expected="$1"
+shift
+
+out="$(mktemp)" || exit 1
+trap 'rm -f "$out"' EXIT
+
+"$@" > "$out" || exit 1
+diff -u "$expected" "$out"
@@ -0,0 +1,240 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "tree_writer.h"
+
+#define L_LINE "│   "
+#define L_VAL  "├───"
+#define L_LAST "└───"
+#define L_GAP  "    "
+
+// Initial capacity of mem
+#define TREE_WRITER_MEM_MIN_CAP 4096
+
+void tree_writer_init(struct tree_writer *w, int fd)
+{
+	w->fd = fd;
+	w->failed = false;
+	w->mem = NULL;
+	w->prefix_len = 0;
+	w->depth = 0;
+	w->buf = w->fd_buf;
+	w->len = 0;
+	w->cap = sizeof(w->fd_buf);
+}
+
+void tree_writer_init_mem(struct tree_writer *w, struct tree_writer_mem *mem)
+{
+	tree_writer_init(w, -1);
+	w->mem = mem;
+	w->buf = mem->data;
+	w->cap = mem->cap;
+	mem->len = 0;
+}
+
+/* Makes room for n more bytes in mem */
+static bool grow_mem(struct tree_writer *w, size_t n)
+{
+	if (n <= w->cap - w->len) {
+		return true;
+	} else if (w->failed) {
+		return false;
+	}
+
+	size_t cap = w->cap ? w->cap : TREE_WRITER_MEM_MIN_CAP;
+	while (n > cap - w->len) {
+		cap *= 2;
+	}
+	char *buf = realloc(w->buf, cap);
+	if (!buf) {
+		w->failed = true;
+		return false;
+	}
+	w->buf = w->mem->data = buf;
+	w->cap = w->mem->cap = cap;
+	return true;
+}
+
+/* Writes all of iov, which is modified along the way */
+static void write_iov(struct tree_writer *w, struct iovec *iov, int n)
+{
+	while (n > 0 && !w->failed) {
+		ssize_t written = writev(w->fd, iov, n);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			w->failed = true;
+			break;
+		}
+
+		size_t left = written;
+		while (n > 0 && left >= iov->iov_len) {
+			left -= iov->iov_len;
+			++iov;
+			--n;
+		}
+		if (n > 0) {
+			iov->iov_base = (char *)iov->iov_base + left;
+			iov->iov_len -= left;
+		}
+	}
+}
+
+bool tree_writer_flush(struct tree_writer *w)
+{
+	if (w->mem) {
+		w->mem->len = w->len;
+		return !w->failed;
+	}
+
+	if (w->len > 0) {
+		struct iovec iov = { .iov_base = w->buf, .iov_len = w->len };
+		write_iov(w, &iov, 1);
+		w->len = 0;
+	}
+	return !w->failed;
+}
+
+void tree_writer_write(struct tree_writer *w, const char *data, size_t len)
+{
+	// data may be NULL then, which memcpy() doesn't allow
+	if (len == 0) {
+		return;
+	}
+
+	if (w->mem && !grow_mem(w, len)) {
+		return;
+	} else if (len <= w->cap - w->len) {
+		memcpy(w->buf + w->len, data, len);
+		w->len += len;
+		return;
+	}
+
+	// Write out the buffer and the data together, without copying the data
+	struct iovec iov[] = {
+		{ .iov_base = w->buf, .iov_len = w->len },
+		{ .iov_base = (char *)data, .iov_len = len },
+	};
+	if (w->len > 0) {
+		write_iov(w, iov, 2);
+	} else {
+		write_iov(w, &iov[1], 1);
+	}
+	w->len = 0;
+}
+
+void tree_writer_puts(struct tree_writer *w, const char *str)
+{
+	tree_writer_write(w, str, strlen(str));
+}
+
+void tree_writer_putc(struct tree_writer *w, char c)
+{
+	if (w->mem && !grow_mem(w, 1)) {
+		return;
+	} else if (w->len == w->cap) {
+		tree_writer_flush(w);
+	}
+	w->buf[w->len++] = c;
+}
+
+void tree_writer_printf(struct tree_writer *w, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	// mem may not have been allocated yet
+	size_t space = w->cap - w->len;
+	int n = vsnprintf(space ? w->buf + w->len : NULL, space, fmt, args);
+	va_end(args);
+	if (n < 0) {
+		return;
+	} else if ((size_t)n < space) {
+		w->len += n;
+		return;
+	}
+
+	// Didn't fit, vsnprintf() wrote a truncated copy which is dropped
+	if (w->mem) {
+		if (grow_mem(w, (size_t)n + 1)) {
+			va_start(args, fmt);
+			w->len += vsnprintf(w->buf + w->len, w->cap - w->len, fmt,
+				args);
+			va_end(args);
+		}
+		return;
+	}
+	tree_writer_flush(w);
+	va_start(args, fmt);
+	if ((size_t)n < w->cap) {
+		w->len = vsnprintf(w->buf, w->cap, fmt, args);
+	} else {
+		char *str = malloc(n + 1);
+		if (str) {
+			vsnprintf(str, n + 1, fmt, args);
+			tree_writer_write(w, str, n);
+			free(str);
+		} else {
+			w->failed = true;
+		}
+	}
+	va_end(args);
+}
+
+void tree_writer_uint(struct tree_writer *w, uint64_t val)
+{
+	char str[20];
+	size_t i = sizeof(str);
+	do {
+		str[--i] = '0' + val % 10;
+		val /= 10;
+	} while (val > 0);
+	tree_writer_write(w, str + i, sizeof(str) - i);
+}
+
+void tree_writer_hex(struct tree_writer *w, uint64_t val, int min_digits)
+{
+	static const char hex[] = "0123456789abcdef";
+	char str[16];
+	size_t i = sizeof(str);
+	do {
+		str[--i] = hex[val & 0xF];
+		val >>= 4;
+	} while (i > 0 && (val > 0 || sizeof(str) - i < (size_t)min_digits));
+	tree_writer_write(w, str + i, sizeof(str) - i);
+}
+
+void tree_writer_line(struct tree_writer *w)
+{
+	tree_writer_write(w, w->prefix, w->prefix_len);
+}
+
+void tree_writer_item(struct tree_writer *w, bool last)
+{
+	tree_writer_write(w, w->prefix, w->prefix_len);
+	tree_writer_write(w, last ? L_LAST : L_VAL, strlen(L_VAL));
+}
+
+void tree_writer_push(struct tree_writer *w, bool last)
+{
+	const char *segment = last ? L_GAP : L_LINE;
+	size_t len = strlen(segment);
+	if (w->depth == TREE_WRITER_MAX_DEPTH ||
+			w->prefix_len + len > sizeof(w->prefix)) {
+		fprintf(stderr, "Tree nested too deeply\n");
+		abort();
+	}
+
+	w->prefix_lens[w->depth++] = w->prefix_len;
+	memcpy(w->prefix + w->prefix_len, segment, len);
+	w->prefix_len += len;
+}
+
+void tree_writer_pop(struct tree_writer *w)
+{
+	w->prefix_len = w->prefix_lens[--w->depth];
+}
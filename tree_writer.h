@@ -0,0 +1,73 @@
+#ifndef TREE_WRITER_H
+#define TREE_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Renders the pretty-printed tree to a file descriptor, through a large buffer
+ * which is only written out when full or flushed, whether or not the output is
+ * a terminal.
+ *
+ * Each line starts with the box-drawing prefix of the current level, kept as
+ * an explicit stack, followed by the branch of the item. Write errors are
+ * sticky and reported by tree_writer_flush(). */
+
+#define TREE_WRITER_MAX_DEPTH 16
+#define TREE_WRITER_BUF_SIZE (64 * 1024)
+
+/* Growable buffer, owned by the caller, which a writer can render to */
+struct tree_writer_mem {
+	char *data;
+	size_t len, cap;
+};
+
+struct tree_writer {
+	int fd; // Negative to render to mem
+	bool failed;
+	struct tree_writer_mem *mem;
+
+	// Concatenated segments of the current prefix, and the length of the
+	// prefix before each of them
+	char prefix[TREE_WRITER_MAX_DEPTH * 8];
+	size_t prefix_len;
+	size_t depth;
+	size_t prefix_lens[TREE_WRITER_MAX_DEPTH];
+
+	// Either fd_buf, or the data of mem which grows instead of being written
+	// out
+	char *buf;
+	size_t len, cap;
+	char fd_buf[TREE_WRITER_BUF_SIZE];
+};
+
+void tree_writer_init(struct tree_writer *w, int fd);
+/* Renders straight to mem instead of a file descriptor, replacing what it
+ * held. Its data is kept to be reused, and freed by the caller. */
+void tree_writer_init_mem(struct tree_writer *w, struct tree_writer_mem *mem);
+
+/* Starts a line with the prefix and a branch, the last one of its level or
+ * not. The text of the line follows, up to a newline. */
+void tree_writer_item(struct tree_writer *w, bool last);
+/* Starts a line at the top level, without any prefix nor branch */
+void tree_writer_line(struct tree_writer *w);
+/* Enters the children of the last item, which are preceded by a vertical line
+ * unless it's the last one of its level */
+void tree_writer_push(struct tree_writer *w, bool last);
+void tree_writer_pop(struct tree_writer *w);
+
+void tree_writer_write(struct tree_writer *w, const char *data, size_t len);
+void tree_writer_puts(struct tree_writer *w, const char *str);
+void tree_writer_putc(struct tree_writer *w, char c);
+void tree_writer_printf(struct tree_writer *w, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+/* Shortcuts for the most common printf() conversions */
+void tree_writer_uint(struct tree_writer *w, uint64_t val);
+/* Lowercase hexadecimal, without any "0x", padded with zeros to min_digits */
+void tree_writer_hex(struct tree_writer *w, uint64_t val, int min_digits);
+
+/* Writes out everything buffered so far, or sets the length of mem. Returns
+ * false if any write failed since the writer was initialised. */
+bool tree_writer_flush(struct tree_writer *w);
+
+#endif